@@ -11,6 +11,7 @@ type BufferSource = ArrayBufferView | ArrayBuffer;
 
 export function byteLength(value: string): number;
 export function compare(a: Uint8Array, b: Uint8Array, options?: CompareOptions): number;
+export function compareAll(a: Uint8Array, b: Uint8Array): number;
 export function concat(list: Uint8Array[], length: number): ArrayBuffer;
 export function decodeString(value: string, encoding: string): ArrayBuffer;
 export function fillImpl(buffer: Uint8Array,
@@ -435,7 +435,7 @@ export function compare(a: Buffer|Uint8Array, b: Buffer|Uint8Array) {
   }
   if (a === b) return 0;
 
-  return bufferUtil.compare(a, b);
+  return bufferUtil.compareAll(a, b);
 }
 
 Buffer.compare = compare;
@@ -46,10 +46,10 @@ jsg::JsValue deserializeMaybeV8Value(
 template <typename T, typename Options, typename Func>
 auto transformCacheResult(jsg::Lock& js,
     kj::OneOf<T, kj::Promise<T>> input, const Options& options, Func&& func)
-    -> jsg::Promise<decltype(func(js, kj::instance<T>()))> {
+    -> jsg::MaybeSync<decltype(func(js, kj::instance<T>()))> {
   KJ_SWITCH_ONEOF(input) {
     KJ_CASE_ONEOF(value, T) {
-      return js.resolvedPromise(func(js, kj::mv(value)));
+      return func(js, kj::mv(value));
     }
     KJ_CASE_ONEOF(promise, kj::Promise<T>) {
       auto& context = IoContext::current();
@@ -72,10 +72,10 @@ auto transformCacheResult(jsg::Lock& js,
 template <typename T, typename Options, typename Func>
 auto transformCacheResultWithCacheStatus(
     jsg::Lock& js, kj::OneOf<T, kj::Promise<T>> input, const Options& options, Func&& func)
-    -> jsg::Promise<decltype(func(js, kj::instance<T>(), kj::instance<bool>()))> {
+    -> jsg::MaybeSync<decltype(func(js, kj::instance<T>(), kj::instance<bool>()))> {
   KJ_SWITCH_ONEOF(input) {
     KJ_CASE_ONEOF(value, T) {
-      return js.resolvedPromise(func(js, kj::mv(value), true));
+      return func(js, kj::mv(value), true);
     }
     KJ_CASE_ONEOF(promise, kj::Promise<T>) {
       auto& context = IoContext::current();
@@ -114,6 +114,20 @@ jsg::Promise<void> transformMaybeBackpressure(
   }
 }
 
+// Records a trace span for a storage operation that has to wait on the underlying storage.
+// Operations answered from the cache complete synchronously and are not traced.
+template <typename T>
+kj::OneOf<T, kj::Promise<T>> traceStorageOp(
+    kj::OneOf<T, kj::Promise<T>> input, kj::ConstString operationName) {
+  KJ_IF_SOME(promise, input.template tryGet<kj::Promise<T>>()) {
+    auto span = IoContext::current().makeTraceSpan(kj::mv(operationName));
+    if (span.isObserved()) {
+      return kj::mv(promise).attach(kj::mv(span));
+    }
+  }
+  return kj::mv(input);
+}
+
 ActorObserver& currentActorMetrics() {
   return IoContext::current().getActorOrThrow().getMetrics();
 }
@@ -125,12 +139,14 @@ jsg::JsRef<jsg::JsValue> listResultsToMap(jsg::Lock& js,
     auto map = js.map();
     size_t cachedReadBytes = 0;
     size_t uncachedReadBytes = 0;
-    for (auto entry: value) {
+    // For SQLite-backed storage, `value` is borrowed and each value is deserialized straight out
+    // of the database's row buffer.
+    value.forEach([&](ActorCacheOps::KeyValuePtrPairWithCache entry) {
       auto& bytesRef = entry.status == ActorCacheOps::CacheStatus::CACHED
                     ? cachedReadBytes : uncachedReadBytes;
       bytesRef += entry.key.size() + entry.value.size();
       map.set(js, entry.key, deserializeV8Value(js, entry.key, entry.value));
-    }
+    });
     auto& actorMetrics = currentActorMetrics();
     if (cachedReadBytes || uncachedReadBytes) {
       size_t totalReadBytes = cachedReadBytes + uncachedReadBytes;
@@ -162,21 +178,23 @@ getMultipleResultsToMap(
       auto map = js.map();
       uint32_t cachedUnits = 0;
       uint32_t uncachedUnits = 0;
-      for (auto entry: value) {
+      size_t resultCount = 0;
+      value.forEach([&](ActorCacheOps::KeyValuePtrPairWithCache entry) {
         auto& unitsRef = entry.status == ActorCacheOps::CacheStatus::CACHED
                       ? cachedUnits : uncachedUnits;
         unitsRef += billingUnits(entry.key.size() + entry.value.size());
         map.set(js, entry.key, deserializeV8Value(js, entry.key, entry.value));
-      }
+        ++resultCount;
+      });
       auto& actorMetrics = currentActorMetrics();
       actorMetrics.addCachedStorageReadUnits(cachedUnits);
 
       size_t leftoverKeys = 0;
-      if (numInputKeys >= value.size()) {
-        leftoverKeys = numInputKeys - value.size();
+      if (numInputKeys >= resultCount) {
+        leftoverKeys = numInputKeys - resultCount;
       } else {
         KJ_LOG(ERROR, "More returned pairs than provided input keys in getMultipleResultsToMap",
-            numInputKeys, value.size());
+            numInputKeys, resultCount);
       }
 
       // leftover keys weren't in the result set, but potentially still
@@ -194,7 +212,12 @@ getMultipleResultsToMap(
 
 kj::Promise<void> updateStorageWriteUnit(IoContext& context,
                                          ActorObserver& metrics,
-                                         uint32_t units) {
+                                         uint32_t units,
+                                         kj::ConstString operationName) {
+  // The output gate is released once the write is durable, so this span covers the write's
+  // round trip to storage.
+  auto span = context.makeTraceSpan(kj::mv(operationName));
+
   // The ActorObserver& reference here is guaranteed to outlive this task, so
   // accessing it after the co_await here is safe.
   co_await context.waitForOutputLocks();
@@ -232,7 +255,7 @@ kj::Maybe<kj::String> getCurrentActorId() {
 
 }  // namespace
 
-jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::get(
+jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::get(
     jsg::Lock& js,
     kj::OneOf<kj::String, kj::Array<kj::String>> keys,
     jsg::Optional<GetOptions> maybeOptions) {
@@ -248,11 +271,12 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::get(
   KJ_UNREACHABLE
 }
 
-jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getOne(
+jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getOne(
     jsg::Lock& js, kj::String key, const GetOptions& options) {
   ActorStorageLimits::checkMaxKeySize(key);
 
-  auto result = getCache(OP_GET).get(kj::str(key), options);
+  auto result = traceStorageOp(getCache(OP_GET).get(kj::str(key), options),
+                               "durable_object_storage_get"_kjc);
   return transformCacheResultWithCacheStatus(js, kj::mv(result), options,
       [key = kj::mv(key)](jsg::Lock& js, kj::Maybe<ActorCacheOps::Value> value, bool cached) {
     uint32_t units = 1;
@@ -269,7 +293,7 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getOne(
   });
 }
 
-jsg::Promise<kj::Maybe<double>> DurableObjectStorageOperations::getAlarm(
+jsg::MaybeSync<kj::Maybe<double>> DurableObjectStorageOperations::getAlarm(
     jsg::Lock& js, jsg::Optional<GetAlarmOptions> maybeOptions) {
   // Even if we do not have an alarm handler, we might once have had one. It's fine to return
   // whatever a previous alarm setting or a falsy result.
@@ -279,7 +303,8 @@ jsg::Promise<kj::Maybe<double>> DurableObjectStorageOperations::getAlarm(
       .noCache = false
     };
   }).orDefault(GetOptions{}));
-  auto result = getCache(OP_GET_ALARM).getAlarm(options);
+  auto result = traceStorageOp(getCache(OP_GET_ALARM).getAlarm(options),
+                               "durable_object_storage_getAlarm"_kjc);
 
   return transformCacheResult(js, kj::mv(result), options,
       [](jsg::Lock&, kj::Maybe<kj::Date> date) {
@@ -289,7 +314,7 @@ jsg::Promise<kj::Maybe<double>> DurableObjectStorageOperations::getAlarm(
   });
 }
 
-jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::list(
+jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::list(
     jsg::Lock& js, jsg::Optional<ListOptions> maybeOptions) {
   kj::String start;
   kj::Maybe<kj::String> end;
@@ -297,7 +322,7 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::list(
   kj::Maybe<uint> limit;
 
   auto makeEmptyResult = [&]() {
-    return js.resolvedPromise(jsg::JsValue(js.map()).addRef(js));
+    return jsg::JsValue(js.map()).addRef(js);
   };
 
   KJ_IF_SOME(o, maybeOptions) {
@@ -395,6 +420,7 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::list(
   auto result = reverse
       ? getCache(OP_LIST).listReverse(kj::mv(start), kj::mv(end), limit, readOptions)
       : getCache(OP_LIST).list(kj::mv(start), kj::mv(end), limit, readOptions);
+  result = traceStorageOp(kj::mv(result), "durable_object_storage_list"_kjc);
   return transformCacheResultWithCacheStatus(js, kj::mv(result),
                                              options, &listResultsToMap);
 }
@@ -469,7 +495,8 @@ jsg::Promise<void> DurableObjectStorageOperations::setAlarm(
       getCache(OP_PUT_ALARM).setAlarm(kj::max(scheduledTime, dateNowKjDate), options));
 
   // setAlarm() is billed as a single write unit.
-  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), 1));
+  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), 1,
+                                         "durable_object_storage_setAlarm"_kjc));
 
   return kj::mv(maybeBackpressure);
 }
@@ -490,7 +517,8 @@ jsg::Promise<void> DurableObjectStorageOperations::putOne(
       getCache(OP_PUT).put(kj::mv(key), kj::mv(buffer), options));
 
   auto& context = IoContext::current();
-  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), units));
+  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), units,
+                                         "durable_object_storage_put"_kjc));
 
   return maybeBackpressure;
 }
@@ -547,14 +575,16 @@ jsg::Promise<bool> DurableObjectStorageOperations::deleteOne(
     jsg::Lock& js, kj::String key, const PutOptions& options) {
   ActorStorageLimits::checkMaxKeySize(key);
 
-  return transformCacheResult(js, getCache(OP_DELETE).delete_(kj::mv(key), options), options,
+  auto result = traceStorageOp(getCache(OP_DELETE).delete_(kj::mv(key), options),
+                               "durable_object_storage_delete"_kjc);
+  return transformCacheResult(js, kj::mv(result), options,
       [](jsg::Lock&, bool value) {
     currentActorMetrics().addStorageDeletes(1);
     return value;
-  });
+  }).toPromise(js);
 }
 
-jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getMultiple(
+jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getMultiple(
     jsg::Lock& js,
     kj::Array<kj::String> keys,
     const GetOptions& options) {
@@ -562,8 +592,9 @@ jsg::Promise<jsg::JsRef<jsg::JsValue>> DurableObjectStorageOperations::getMultip
 
   auto numKeys = keys.size();
 
-  return transformCacheResult(js, getCache(OP_GET).get(kj::mv(keys), options),
-                              options, getMultipleResultsToMap(numKeys));
+  auto result = traceStorageOp(getCache(OP_GET).get(kj::mv(keys), options),
+                               "durable_object_storage_get"_kjc);
+  return transformCacheResult(js, kj::mv(result), options, getMultipleResultsToMap(numKeys));
 }
 
 jsg::Promise<void> DurableObjectStorageOperations::putMultiple(
@@ -593,7 +624,8 @@ jsg::Promise<void> DurableObjectStorageOperations::putMultiple(
       getCache(OP_PUT).put(kvs.releaseAsArray(), options));
 
   auto& context = IoContext::current();
-  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), units));
+  context.addTask(updateStorageWriteUnit(context, currentActorMetrics(), units,
+                                         "durable_object_storage_put"_kjc));
 
   return maybeBackpressure;
 }
@@ -606,11 +638,13 @@ jsg::Promise<int> DurableObjectStorageOperations::deleteMultiple(
 
   auto numKeys = keys.size();
 
-  return transformCacheResult(js, getCache(OP_DELETE).delete_(kj::mv(keys), options), options,
+  auto result = traceStorageOp(getCache(OP_DELETE).delete_(kj::mv(keys), options),
+                               "durable_object_storage_delete"_kjc);
+  return transformCacheResult(js, kj::mv(result), options,
       [numKeys](jsg::Lock&, uint count) -> int {
     currentActorMetrics().addStorageDeletes(numKeys);
     return count;
-  });
+  }).toPromise(js);
 }
 
 ActorCacheOps& DurableObjectStorage::getCache(OpName op) {
@@ -43,7 +43,7 @@ public:
     JSG_STRUCT_TS_OVERRIDE(DurableObjectGetOptions); // Rename from DurableObjectStorageOperationsGetOptions
   };
 
-  jsg::Promise<jsg::JsRef<jsg::JsValue>> get(
+  jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> get(
       jsg::Lock& js,
       kj::OneOf<kj::String, kj::Array<kj::String>> keys,
       jsg::Optional<GetOptions> options);
@@ -55,7 +55,8 @@ public:
     JSG_STRUCT_TS_OVERRIDE(DurableObjectGetAlarmOptions); // Rename from DurableObjectStorageOperationsGetAlarmOptions
   };
 
-  jsg::Promise<kj::Maybe<double>> getAlarm(jsg::Lock& js, jsg::Optional<GetAlarmOptions> options);
+  jsg::MaybeSync<kj::Maybe<double>> getAlarm(
+      jsg::Lock& js, jsg::Optional<GetAlarmOptions> options);
 
   struct ListOptions {
     jsg::Optional<kj::String> start;
@@ -78,7 +79,7 @@ public:
     JSG_STRUCT_TS_OVERRIDE(DurableObjectListOptions); // Rename from DurableObjectStorageOperationsListOptions
   };
 
-  jsg::Promise<jsg::JsRef<jsg::JsValue>> list(jsg::Lock& js, jsg::Optional<ListOptions> options);
+  jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> list(jsg::Lock& js, jsg::Optional<ListOptions> options);
 
   struct PutOptions {
     jsg::Optional<bool> allowConcurrency;
@@ -160,12 +161,12 @@ protected:
   }
 
 private:
-  jsg::Promise<jsg::JsRef<jsg::JsValue>> getOne(jsg::Lock& js,
-                                                kj::String key,
-                                                const GetOptions& options);
-  jsg::Promise<jsg::JsRef<jsg::JsValue>> getMultiple(jsg::Lock& js,
-                                                     kj::Array<kj::String> keys,
-                                                     const GetOptions& options);
+  jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> getOne(jsg::Lock& js,
+                                                  kj::String key,
+                                                  const GetOptions& options);
+  jsg::MaybeSync<jsg::JsRef<jsg::JsValue>> getMultiple(jsg::Lock& js,
+                                                       kj::Array<kj::String> keys,
+                                                       const GetOptions& options);
 
   jsg::Promise<void> putOne(jsg::Lock& js,
                             kj::String key,
@@ -998,6 +998,15 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
     jsg::Lock& js, kj::StringPtr normalizedName,
     SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
     kj::ArrayPtr<const kj::String> keyUsages) {
+  auto finish = prepareGenerateRsa(js, normalizedName, kj::mv(algorithm), extractable, keyUsages)
+      .run();
+  return finish(js);
+}
+
+DeferredCryptoWork<CryptoKey::Impl::FinishGenerateFunc> CryptoKey::Impl::prepareGenerateRsa(
+    jsg::Lock& js, kj::StringPtr normalizedName,
+    SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
+    kj::ArrayPtr<const kj::String> keyUsages) {
 
   KJ_ASSERT(normalizedName == "RSASSA-PKCS1-v1_5" || normalizedName == "RSA-PSS" ||
       normalizedName == "RSA-OAEP", "generateRsa called on non-RSA cryptoKey", normalizedName);
@@ -1029,27 +1038,46 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
   JSG_REQUIRE(!(FeatureFlags::get(js).getStrictCrypto() && (modulusLength & 127)), DOMOperationError,
       "Can't generate key: RSA key size is required to be a multiple of 128");
 
-  auto bnExponent = OSSLCALL_OWN(BIGNUM, BN_bin2bn(publicExponent.begin(),
-      publicExponent.size(), nullptr), InternalDOMOperationError, "Error setting up RSA keygen.");
-
-  auto rsaPrivateKey = OSSL_NEW(RSA);
-  OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, bnExponent.get(), 0));
-  auto privateEvpPKey = OSSL_NEW(EVP_PKEY);
-  OSSLCALL(EVP_PKEY_set1_RSA(privateEvpPKey.get(), rsaPrivateKey.get()));
-  kj::Own<RSA> rsaPublicKey = OSSLCALL_OWN(RSA, RSAPublicKey_dup(rsaPrivateKey.get()),
-      InternalDOMOperationError, "Error finalizing RSA keygen", internalDescribeOpensslErrors());
-  auto publicEvpPKey = OSSL_NEW(EVP_PKEY);
-  OSSLCALL(EVP_PKEY_set1_RSA(publicEvpPKey.get(), rsaPublicKey));
-
-  auto keyAlgorithm = CryptoKey::RsaKeyAlgorithm {
-    .name = normalizedName,
-    .modulusLength = static_cast<uint16_t>(modulusLength),
-    .publicExponent = kj::mv(publicExponent),
-    .hash = KeyAlgorithm { normalizedHashName }
+  // Prime generation is by far the most expensive thing WebCrypto does, taking tens to hundreds
+  // of milliseconds for common key sizes, so it's always worth moving off the isolate thread
+  // except for toy key sizes.
+  bool worthOffloading = modulusLength >= 1024;
+
+  return {
+    .run = [normalizedName, normalizedHashName = normalizedHashName, modulusLength,
+            publicExponent = kj::mv(publicExponent), extractable, usages]() mutable
+        -> FinishGenerateFunc {
+      auto bnExponent = OSSLCALL_OWN(BIGNUM, BN_bin2bn(publicExponent.begin(),
+          publicExponent.size(), nullptr), InternalDOMOperationError,
+          "Error setting up RSA keygen.");
+
+      auto rsaPrivateKey = OSSL_NEW(RSA);
+      OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, bnExponent.get(), 0));
+      auto privateEvpPKey = OSSL_NEW(EVP_PKEY);
+      OSSLCALL(EVP_PKEY_set1_RSA(privateEvpPKey.get(), rsaPrivateKey.get()));
+      kj::Own<RSA> rsaPublicKey = OSSLCALL_OWN(RSA, RSAPublicKey_dup(rsaPrivateKey.get()),
+          InternalDOMOperationError, "Error finalizing RSA keygen",
+          internalDescribeOpensslErrors());
+      auto publicEvpPKey = OSSL_NEW(EVP_PKEY);
+      OSSLCALL(EVP_PKEY_set1_RSA(publicEvpPKey.get(), rsaPublicKey));
+
+      return [normalizedName, normalizedHashName, modulusLength,
+              publicExponent = kj::mv(publicExponent), extractable, usages,
+              privateEvpPKey = kj::mv(privateEvpPKey), publicEvpPKey = kj::mv(publicEvpPKey)]
+          (jsg::Lock& js) mutable -> kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> {
+        auto keyAlgorithm = CryptoKey::RsaKeyAlgorithm {
+          .name = normalizedName,
+          .modulusLength = static_cast<uint16_t>(modulusLength),
+          .publicExponent = kj::mv(publicExponent),
+          .hash = KeyAlgorithm { normalizedHashName }
+        };
+
+        return generateRsaPair(js, normalizedName, kj::mv(privateEvpPKey),
+            kj::mv(publicEvpPKey), kj::mv(keyAlgorithm), extractable, usages);
+      };
+    },
+    .worthOffloading = worthOffloading,
   };
-
-  return generateRsaPair(js, normalizedName, kj::mv(privateEvpPKey), kj::mv(publicEvpPKey),
-      kj::mv(keyAlgorithm), extractable, usages);
 }
 
 kj::Own<EVP_PKEY> rsaJwkReader(SubtleCrypto::JsonWebKey&& keyDataJwk) {
@@ -8,6 +8,10 @@
 namespace workerd::api {
 namespace {
 
+// Derivations needing fewer HMAC computations than this take well under a millisecond, so they
+// are cheaper to run inline than to hand off to the crypto thread pool.
+constexpr uint64_t PBKDF2_OFFLOAD_MIN_COST = 10000;
+
 class Pbkdf2Key final: public CryptoKey::Impl {
 public:
   explicit Pbkdf2Key(kj::Array<kj::byte> keyData, CryptoKey::KeyAlgorithm keyAlgorithm,
@@ -26,6 +30,20 @@ private:
   kj::Array<kj::byte> deriveBits(
       jsg::Lock& js, SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
       kj::Maybe<uint32_t> maybeLength) const override {
+    return prepareDerivation(js, algorithm, maybeLength).run();
+  }
+
+  kj::Maybe<DeferredCryptoWork<kj::Array<kj::byte>>> prepareDeriveBits(
+      jsg::Lock& js, SubtleCrypto::DeriveKeyAlgorithm& algorithm,
+      kj::Maybe<uint32_t> maybeLength) const override {
+    return prepareDerivation(js, algorithm, maybeLength);
+  }
+
+  // Validates the derivation parameters and returns the derivation itself as deferred work. The
+  // work owns copies of the key and salt so it can be run on another thread.
+  DeferredCryptoWork<kj::Array<kj::byte>> prepareDerivation(
+      jsg::Lock& js, SubtleCrypto::DeriveKeyAlgorithm& algorithm,
+      kj::Maybe<uint32_t> maybeLength) const {
     kj::StringPtr hashName = api::getAlgorithmName(JSG_REQUIRE_NONNULL(algorithm.hash, TypeError,
         "Missing field \"hash\" in \"algorithm\"."));
     auto hashType = lookupDigestAlgorithm(hashName).second;
@@ -49,14 +67,25 @@ private:
     // maximum iteration count a user can select -- this is an intentional non-conformity.
     // Another approach might be to fork OpenSSL's PKCS5_PBKDF2_HMAC() function and insert a
     // check for v8::Isolate::IsExecutionTerminating() in the loop, but for now a hard cap seems
-    // wisest.
+    // wisest. The cap still matters when the derivation runs on the crypto thread pool, since the
+    // pool has only a few threads to go around.
     checkPbkdfLimits(js, iterations);
 
-    auto output = kj::heapArray<kj::byte>(length / 8);
-    OSSLCALL(PKCS5_PBKDF2_HMAC(keyData.asPtr().asChars().begin(), keyData.size(),
-                               salt.begin(), salt.size(),
-                               iterations, hashType, output.size(), output.begin()));
-    return kj::mv(output);
+    // Each output block of the digest's size costs `iterations` HMAC computations.
+    uint64_t cost = uint64_t(iterations) * integerCeilDivision<uint64_t>(length / 8,
+        EVP_MD_size(hashType));
+
+    return {
+      .run = [keyData = kj::heap<ZeroOnFree>(kj::heapArray(keyData.asPtr())),
+              salt = kj::heapArray(salt), iterations, hashType, length]() {
+        auto output = kj::heapArray<kj::byte>(length / 8);
+        OSSLCALL(PKCS5_PBKDF2_HMAC(keyData->asPtr().asChars().begin(), keyData->size(),
+                                   salt.begin(), salt.size(),
+                                   iterations, hashType, output.size(), output.begin()));
+        return kj::mv(output);
+      },
+      .worthOffloading = cost >= PBKDF2_OFFLOAD_MIN_COST,
+    };
   }
 
   // TODO(bug): Possibly by mistake, PBKDF2 was historically not on the allow list of
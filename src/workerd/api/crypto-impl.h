@@ -94,6 +94,16 @@ kj::StringPtr getAlgorithmName(const kj::OneOf<kj::String, T>& param) {
   }
 }
 
+// Crypto work that has already been validated on the isolate thread and that touches no
+// JavaScript state, so it may be run on the crypto thread pool instead of blocking the isolate.
+// `worthOffloading` is the algorithm's judgment of whether the work is expensive enough to make
+// the cross-thread round trip pay off; if it's false, SubtleCrypto simply calls `run()` inline.
+template <typename T>
+struct DeferredCryptoWork {
+  kj::Function<T()> run;
+  bool worthOffloading;
+};
+
 class CryptoKey::Impl {
 public:
   // C++ API
@@ -126,6 +136,19 @@ public:
   static GenerateFunc generateEcdh;
   static GenerateFunc generateEddsa;
 
+  // Some algorithms split key generation into an expensive part that may run on the crypto
+  // thread pool and a cheap part that creates the CryptoKey objects back on the isolate thread.
+  // A PrepareGenerateFunc validates the request and returns the expensive part, which in turn
+  // returns the cheap part. Calling all three in sequence is equivalent to the GenerateFunc.
+  using FinishGenerateFunc = kj::Function<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>(
+      jsg::Lock& js)>;
+  using PrepareGenerateFunc = DeferredCryptoWork<FinishGenerateFunc>(
+      jsg::Lock& js, kj::StringPtr normalizedName,
+      SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
+      kj::ArrayPtr<const kj::String> keyUsages);
+
+  static PrepareGenerateFunc prepareGenerateRsa;
+
   Impl(bool extractable, CryptoKeyUsageSet usages) : extractable(extractable), usages(usages) {}
 
   bool isExtractable() const { return extractable; }
@@ -165,6 +188,15 @@ public:
         getAlgorithmName(), "\".");
   }
 
+  // Like deriveBits(), but validates the parameters immediately and returns the derivation
+  // itself as deferred work so that it can be moved off the isolate thread. Returns kj::none if
+  // the algorithm doesn't support this, in which case deriveBits() should be called instead.
+  virtual kj::Maybe<DeferredCryptoWork<kj::Array<kj::byte>>> prepareDeriveBits(
+      jsg::Lock& js,
+      SubtleCrypto::DeriveKeyAlgorithm& algorithm, kj::Maybe<uint32_t> length) const {
+    return kj::none;
+  }
+
   virtual kj::Array<kj::byte> wrapKey(SubtleCrypto::EncryptAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> unwrappedKey) const {
     // For many algorithms, wrapKey() is the same as encrypt(), so as a convenience the default
@@ -243,6 +275,10 @@ struct CryptoAlgorithm {
   //   template metaprogramming cannot recognize it as const). Maybe we can fix this in KJ, by
   //   making `RemoveConstOrDisable` recognize function references are inherenly const.
 
+  // Optional split version of `generateFunc` that allows the expensive part of key generation to
+  // run on the crypto thread pool. If non-null, it is used in preference to `generateFunc`.
+  CryptoKey::Impl::PrepareGenerateFunc* prepareGenerateFunc = nullptr;
+
   // Allow comparison by name, case-insensitive. This is a convenience for placing in an std::set.
   inline bool operator==(const CryptoAlgorithm& other) const {
     return strcasecmp(name.cStr(), other.name.cStr()) == 0;
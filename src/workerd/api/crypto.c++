@@ -10,6 +10,8 @@
 #include <workerd/jsg/jsg.h>
 #include "util.h"
 #include <workerd/io/io-context.h>
+#include <workerd/util/cpu-watchdog.h>
+#include <workerd/util/thread-pool.h>
 #include <workerd/util/uuid.h>
 #include <set>
 #include <algorithm>
@@ -81,16 +83,19 @@ namespace {
 // Note that SubtleCrypto.digest() is special. It is not a key-based operation and we only support
 // one hash family, SHA, so its implementation is non-virtual.
 //
-// NOTE(perf): The SubtleCrypto interface is asynchronous, but all of our implementations perform
-//   the crypto synchronously before returning. In theory, we could be performing bulk crypto in a
-//   separate thread, maybe improving performance. However, it's unclear what real use case would
-//   benefit from this. It's also unclear that we would want a single request to be able to use
-//   multiple cores -- certainly it would greatly complicate our implementation of request CPU
-//   limits. So, we probably shouldn't implement true asynchronous crypto.
-//
-//   Additionally, performing the crypto synchronously actually has a performance benefit: we can
+// NOTE(perf): The SubtleCrypto interface is asynchronous, but most of our implementations perform
+//   the crypto synchronously before returning. This is usually the fastest thing to do: we can
 //   safely avoid copying input BufferSources -- most of our functions can take
-//   kj::ArrayPtr<const kj::byte>s, rather than kj::Array<kj::byte>s.
+//   kj::ArrayPtr<const kj::byte>s, rather than kj::Array<kj::byte>s -- and we avoid a round trip
+//   through another thread.
+//
+//   The exception is work that is expensive enough to noticeably stall every other request on the
+//   isolate: large digests, PBKDF2 with high iteration counts, and RSA key generation. When such
+//   an operation runs inside a request, its inputs are copied, the work is handed to a small
+//   process-wide thread pool (see runCryptoWork() below), and the result is delivered back
+//   through the IoContext. CPU time spent on the pool is not counted against the request's CPU
+//   limit; this is acceptable because the pool is bounded and the work itself is bounded (e.g. by
+//   checkPbkdfLimits()). If the pool's queue is full, the work simply runs inline as before.
 
 // =======================================================================================
 // OpenSSL shims
@@ -99,6 +104,81 @@ std::unique_ptr<EVP_MD_CTX, void(*)(EVP_MD_CTX*)> makeDigestContext() {
   return {EVP_MD_CTX_new(), EVP_MD_CTX_free};
 }
 
+// Digests of inputs smaller than this complete in well under a millisecond, which is less than it
+// would cost to hand them to the thread pool.
+constexpr size_t DIGEST_OFFLOAD_MIN_SIZE = 1024 * 1024;
+
+kj::Array<kj::byte> computeDigest(const EVP_MD* type, kj::ArrayPtr<const kj::byte> data) {
+  auto digestCtx = makeDigestContext();
+  KJ_ASSERT(digestCtx != nullptr);
+
+  OSSLCALL(EVP_DigestInit_ex(digestCtx.get(), type, nullptr));
+  OSSLCALL(EVP_DigestUpdate(digestCtx.get(), data.begin(), data.size()));
+  auto messageDigest = kj::heapArray<kj::byte>(EVP_MD_CTX_size(digestCtx.get()));
+  uint messageDigestSize = 0;
+  OSSLCALL(EVP_DigestFinal_ex(digestCtx.get(), messageDigest.begin(), &messageDigestSize));
+
+  KJ_ASSERT(messageDigestSize == messageDigest.size());
+  return kj::mv(messageDigest);
+}
+
+// =======================================================================================
+// Off-thread execution
+
+// CPU time used by one job on the crypto thread pool. The pool thread writes it before delivering
+// the job's result, and the isolate thread only reads it once the result has arrived.
+struct PoolCpuTime: public kj::AtomicRefcounted {
+  kj::Duration time = 0 * kj::NANOSECONDS;
+};
+
+// Runs `work`, then passes its result to `then` on the isolate thread, returning a JS promise for
+// the final result. If the work is worth offloading and we're running in a request, it runs on the
+// shared thread pool and the result is delivered back through the IoContext. Otherwise (or if the
+// pool's queue is full) it runs inline.
+//
+// Work on the pool runs outside of enterJs(), so the CPU limit can't stop it part way through.
+// Instead, no more is offloaded once the request has exceeded its limits, and the CPU time each
+// job used is charged to the request's LimitEnforcer when it finishes.
+template <typename T, typename Then>
+jsg::PromiseForResult<Then, T, true> runCryptoWork(
+    jsg::Lock& js, DeferredCryptoWork<T> work, Then&& then) {
+  if (work.worthOffloading && IoContext::hasCurrent()) {
+    auto& context = IoContext::current();
+    auto& limitEnforcer = context.getLimitEnforcer();
+    limitEnforcer.requireLimitsNotExceeded();
+
+    // OpenSSL's error queue is thread-local. Errors are turned into exceptions where they occur,
+    // but make sure nothing is left behind on the pool thread for the next job to trip over.
+    auto cpuTime = kj::atomicRefcounted<PoolCpuTime>();
+    kj::Function<T()> func = [run = kj::mv(work.run),
+                              cpuTime = kj::atomicAddRef(*cpuTime)]() mutable {
+      ClearErrorOnReturn clearErrors;
+      auto start = CpuWatchdog::threadCpuTime();
+      KJ_DEFER(cpuTime->time = CpuWatchdog::threadCpuTime() - start);
+      return run();
+    };
+    KJ_IF_SOME(promise, ThreadPool::getShared().tryRun(kj::mv(func))) {
+      // Charge on failure too, but not on cancellation, since the job may still be running then.
+      auto charged = promise.then(
+          [&limitEnforcer, cpuTime = kj::atomicAddRef(*cpuTime)](T result) {
+        limitEnforcer.chargeOffThreadCpu(cpuTime->time);
+        return kj::mv(result);
+      }, [&limitEnforcer, cpuTime = kj::atomicAddRef(*cpuTime)](kj::Exception&& e) -> T {
+        limitEnforcer.chargeOffThreadCpu(cpuTime->time);
+        kj::throwFatalException(kj::mv(e));
+      });
+      return context.awaitIo(js, kj::mv(charged), kj::fwd<Then>(then));
+    }
+    return js.resolvedPromise(then(js, func()));
+  }
+  return js.resolvedPromise(then(js, work.run()));
+}
+
+template <typename T>
+jsg::Promise<T> runCryptoWork(jsg::Lock& js, DeferredCryptoWork<T> work) {
+  return runCryptoWork(js, kj::mv(work), [](jsg::Lock&, T result) { return kj::mv(result); });
+}
+
 // =======================================================================================
 // Registered algorithms
 
@@ -111,9 +191,12 @@ static kj::Maybe<const CryptoAlgorithm&> lookupAlgorithm(kj::StringPtr name) {
     {"HMAC"_kj,              &CryptoKey::Impl::importHmac, &CryptoKey::Impl::generateHmac},
     {"PBKDF2"_kj,            &CryptoKey::Impl::importPbkdf2},
     {"HKDF"_kj,              &CryptoKey::Impl::importHkdf},
-    {"RSASSA-PKCS1-v1_5"_kj, &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
-    {"RSA-PSS"_kj,           &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
-    {"RSA-OAEP"_kj,          &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
+    {"RSASSA-PKCS1-v1_5"_kj, &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+        &CryptoKey::Impl::prepareGenerateRsa},
+    {"RSA-PSS"_kj,           &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+        &CryptoKey::Impl::prepareGenerateRsa},
+    {"RSA-OAEP"_kj,          &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+        &CryptoKey::Impl::prepareGenerateRsa},
     {"ECDSA"_kj,             &CryptoKey::Impl::importEcdsa, &CryptoKey::Impl::generateEcdsa},
     {"ECDH"_kj,              &CryptoKey::Impl::importEcdh, &CryptoKey::Impl::generateEcdh},
     {"NODE-ED25519"_kj,      &CryptoKey::Impl::importEddsa, &CryptoKey::Impl::generateEddsa},
@@ -365,17 +448,17 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::digest(
   return js.evalNow([&] {
     auto type = lookupDigestAlgorithm(algorithm.name).second;
 
-    auto digestCtx = makeDigestContext();
-    KJ_ASSERT(digestCtx != nullptr);
-
-    OSSLCALL(EVP_DigestInit_ex(digestCtx.get(), type, nullptr));
-    OSSLCALL(EVP_DigestUpdate(digestCtx.get(), data.begin(), data.size()));
-    auto messageDigest = kj::heapArray<kj::byte>(EVP_MD_CTX_size(digestCtx.get()));
-    uint messageDigestSize = 0;
-    OSSLCALL(EVP_DigestFinal_ex(digestCtx.get(), messageDigest.begin(), &messageDigestSize));
+    if (data.size() < DIGEST_OFFLOAD_MIN_SIZE) {
+      return js.resolvedPromise(computeDigest(type, data));
+    }
 
-    KJ_ASSERT(messageDigestSize == messageDigest.size());
-    return kj::mv(messageDigest);
+    // The caller may modify their buffer while we're hashing it on another thread, so hash a copy.
+    return runCryptoWork(js, DeferredCryptoWork<kj::Array<kj::byte>> {
+      .run = [type, data = kj::heapArray(data.asPtr())]() {
+        return computeDigest(type, data);
+      },
+      .worthOffloading = true,
+    });
   });
 }
 
@@ -393,22 +476,35 @@ jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> SubtleCrypto::genera
     JSG_REQUIRE(algoImpl.generateFunc != nullptr, DOMNotSupportedError,
         "Unrecognized key generation algorithm \"", algorithm.name, "\" requested.");
 
-    auto cryptoKeyOrPair = algoImpl.generateFunc(js, algoImpl.name, kj::mv(algorithm), extractable,
-                                                 keyUsages);
-    KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
-      KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
-        if (keyUsages.size() == 0) {
-          auto type = cryptoKey->getType();
-          JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
-              "Secret/private CryptoKeys must have at least one usage.");
+    auto checkResult = [noUsages = keyUsages.size() == 0](
+        kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> cryptoKeyOrPair) {
+      KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
+        KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
+          if (noUsages) {
+            auto type = cryptoKey->getType();
+            JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
+                "Secret/private CryptoKeys must have at least one usage.");
+          }
+        }
+        KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
+          JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
+            "Attempt to generate asymmetric keys with no valid private key usages.");
         }
       }
-      KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
-        JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
-          "Attempt to generate asymmetric keys with no valid private key usages.");
-      }
+      return cryptoKeyOrPair;
+    };
+
+    if (algoImpl.prepareGenerateFunc != nullptr) {
+      auto work = algoImpl.prepareGenerateFunc(js, algoImpl.name, kj::mv(algorithm), extractable,
+                                               keyUsages);
+      return runCryptoWork(js, kj::mv(work),
+          [checkResult](jsg::Lock& js, CryptoKey::Impl::FinishGenerateFunc finish) {
+        return checkResult(finish(js));
+      });
     }
-    return cryptoKeyOrPair;
+
+    return js.resolvedPromise(checkResult(algoImpl.generateFunc(
+        js, algoImpl.name, kj::mv(algorithm), extractable, keyUsages)));
   });
 }
 
@@ -429,13 +525,21 @@ jsg::Promise<jsg::Ref<CryptoKey>> SubtleCrypto::deriveKey(
 
     auto length = getKeyLength(derivedKeyAlgorithm);
 
-    auto secret = baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
-
     // TODO(perf): For conformance, importKey() makes a copy of `secret`. In this case we really
     //   don't need to, but rather we ought to call the appropriate CryptoKey::Impl::import*()
     //   function directly.
-    return importKeySync(
-        js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages));
+    KJ_IF_SOME(work, baseKey.impl->prepareDeriveBits(js, algorithm, length)) {
+      return runCryptoWork(js, kj::mv(work),
+          [self = JSG_THIS, derivedKeyAlgorithm = kj::mv(derivedKeyAlgorithm), extractable,
+           keyUsages = kj::mv(keyUsages)](jsg::Lock& js, kj::Array<kj::byte> secret) mutable {
+        return self->importKeySync(js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm),
+                                   extractable, kj::mv(keyUsages));
+      });
+    }
+
+    auto secret = baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
+    return js.resolvedPromise(importKeySync(
+        js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages)));
   });
 }
 
@@ -456,7 +560,10 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::deriveBits(
 
   return js.evalNow([&] {
     validateOperation(baseKey, algorithm.name, CryptoKeyUsageSet::deriveBits());
-    return baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
+    KJ_IF_SOME(work, baseKey.impl->prepareDeriveBits(js, algorithm, length)) {
+      return runCryptoWork(js, kj::mv(work));
+    }
+    return js.resolvedPromise(baseKey.impl->deriveBits(js, kj::mv(algorithm), length));
   });
 }
 
@@ -5,6 +5,7 @@
 #include "encoding.h"
 #include <workerd/jsg/jsg.h>
 #include <workerd/jsg/buffersource.h>
+#include <workerd/util/utf8.h>
 #include <unicode/ucnv.h>
 #include <unicode/utf8.h>
 #include <algorithm>
@@ -399,6 +400,166 @@ kj::Maybe<jsg::JsString> AsciiDecoder::decode(jsg::Lock& js,
   return js.str(buffer);
 }
 
+namespace {
+
+constexpr kj::byte UTF8_BOM[] = { 0xef, 0xbb, 0xbf };
+constexpr char16_t REPLACEMENT_CHARACTER = 0xfffd;
+
+// If `buffer` ends partway through an otherwise valid sequence, returns the number of bytes of
+// that sequence it contains. Otherwise returns zero.
+size_t incompleteSuffixLength(kj::ArrayPtr<const kj::byte> buffer) {
+  for (size_t back = 1; back <= kj::min(buffer.size(), size_t(3)); back++) {
+    auto byte = buffer[buffer.size() - back];
+    if ((byte & 0xc0) == 0x80) continue;  // A continuation byte; keep looking for the lead.
+    if (byte < 0x80) return 0;
+    auto tail = buffer.slice(buffer.size() - back, buffer.size());
+    return decodeUtf8Sequence(tail).kind == Utf8Sequence::TRUNCATED ? back : 0;
+  }
+  return 0;
+}
+
+char16_t* appendUtf16(char16_t* out, uint32_t codePoint) {
+  if (codePoint < 0x10000) {
+    *out++ = codePoint;
+  } else {
+    codePoint -= 0x10000;
+    *out++ = 0xd800 + (codePoint >> 10);
+    *out++ = 0xdc00 + (codePoint & 0x3ff);
+  }
+  return out;
+}
+
+// Converts valid UTF-8 whose code points are all below U+0100 to a one-byte string.
+jsg::JsString decodeLatin1(jsg::Lock& js, kj::ArrayPtr<const kj::byte> buffer) {
+  KJ_STACK_ARRAY(kj::byte, result, buffer.size(), 512, 4096);
+  auto out = result.begin();
+  size_t i = 0;
+  while (i < buffer.size()) {
+    auto ascii = asciiPrefixLength(buffer.slice(i, buffer.size()));
+    memcpy(out, buffer.begin() + i, ascii);
+    out += ascii;
+    i += ascii;
+    if (i == buffer.size()) break;
+    // Validation guarantees a C2 or C3 lead byte followed by a continuation byte.
+    *out++ = static_cast<kj::byte>((buffer[i] << 6) | (buffer[i + 1] & 0x3f));
+    i += 2;
+  }
+  return js.str(kj::arrayPtr(result.begin(), out));
+}
+
+// Decodes UTF-8 containing errors, replacing the maximal subpart of each invalid or truncated
+// sequence with U+FFFD as the Encoding Standard requires.
+jsg::JsString decodeWithReplacement(jsg::Lock& js, kj::ArrayPtr<const kj::byte> buffer) {
+  // No sequence produces more UTF-16 code units than it has bytes.
+  KJ_STACK_ARRAY(char16_t, result, buffer.size(), 512, 4096);
+  auto out = result.begin();
+  size_t i = 0;
+  while (i < buffer.size()) {
+    auto ascii = asciiPrefixLength(buffer.slice(i, buffer.size()));
+    out = std::copy(buffer.begin() + i, buffer.begin() + i + ascii, out);
+    i += ascii;
+    if (i == buffer.size()) break;
+    auto seq = decodeUtf8Sequence(buffer.slice(i, buffer.size()));
+    if (seq.kind == Utf8Sequence::VALID) {
+      out = appendUtf16(out, seq.codePoint);
+    } else {
+      *out++ = REPLACEMENT_CHARACTER;
+    }
+    i += seq.length;
+  }
+  return js.str(kj::arrayPtr(result.begin(), out));
+}
+
+}  // namespace
+
+kj::Maybe<jsg::JsString> Utf8Decoder::decode(
+    jsg::Lock& js,
+    kj::ArrayPtr<const kj::byte> buffer,
+    bool flush) {
+  KJ_DEFER({ if (flush) reset(); });
+
+  // If the previous chunk ended partway through a sequence, finish it off first. At most one code
+  // point comes out of this, ahead of whatever the rest of the buffer decodes to.
+  char16_t head[2];
+  size_t headSize = 0;
+  if (pendingSize > 0) {
+    kj::byte joined[4];
+    memcpy(joined, pending, pendingSize);
+    auto taken = kj::min(buffer.size(), sizeof(joined) - pendingSize);
+    if (taken > 0) memcpy(joined + pendingSize, buffer.begin(), taken);
+    auto seq = decodeUtf8Sequence(kj::arrayPtr(joined, pendingSize + taken));
+
+    if (seq.kind == Utf8Sequence::TRUNCATED && !flush) {
+      // Still incomplete, so wait for more.
+      memcpy(pending, joined, seq.length);
+      pendingSize = seq.length;
+      return js.str();
+    }
+
+    if (seq.kind == Utf8Sequence::VALID) {
+      if (bomSeen || ignoreBom || seq.codePoint != 0xfeff) {
+        headSize = appendUtf16(head, seq.codePoint) - head;
+      }
+    } else {
+      if (fatal) return kj::none;
+      head[headSize++] = REPLACEMENT_CHARACTER;
+    }
+    bomSeen = true;
+
+    // The pending bytes were the start of a valid sequence, so however it ended, the sequence
+    // covers all of them.
+    buffer = buffer.slice(seq.length - pendingSize, buffer.size());
+    pendingSize = 0;
+  }
+
+  if (!flush) {
+    auto tail = incompleteSuffixLength(buffer);
+    if (tail > 0) {
+      memcpy(pending, buffer.end() - tail, tail);
+      pendingSize = tail;
+      buffer = buffer.first(buffer.size() - tail);
+    }
+  }
+
+  auto body = decodeComplete(js, buffer);
+  if (headSize == 0) return body;
+  KJ_IF_SOME(rest, body) {
+    return jsg::JsString::concat(js, js.str(kj::arrayPtr(head, headSize)), rest);
+  }
+  return kj::none;
+}
+
+kj::Maybe<jsg::JsString> Utf8Decoder::decodeComplete(jsg::Lock& js,
+                                                     kj::ArrayPtr<const kj::byte> buffer) {
+  if (!bomSeen && buffer.size() > 0) {
+    if (!ignoreBom && buffer.size() >= sizeof(UTF8_BOM) &&
+        buffer.first(sizeof(UTF8_BOM)) == kj::arrayPtr(UTF8_BOM, sizeof(UTF8_BOM))) {
+      buffer = buffer.slice(sizeof(UTF8_BOM), buffer.size());
+    }
+    bomSeen = true;
+  }
+
+  switch (checkUtf8(buffer)) {
+    case Utf8Content::ASCII:
+      return js.str(buffer);
+    case Utf8Content::LATIN1:
+      return decodeLatin1(js, buffer);
+    case Utf8Content::WIDE:
+      // The input is known to be valid, so V8's UTF-8 decoder gives the same result as ours would,
+      // and saves a copy.
+      return js.str(buffer.asChars());
+    case Utf8Content::INVALID:
+      if (fatal) return kj::none;
+      return decodeWithReplacement(js, buffer);
+  }
+  KJ_UNREACHABLE;
+}
+
+void Utf8Decoder::reset() {
+  bomSeen = false;
+  pendingSize = 0;
+}
+
 void IcuDecoder::reset() {
   bomSeen = false;
   return ucnv_reset(inner.get());
@@ -407,6 +568,7 @@ void IcuDecoder::reset() {
 Decoder& TextDecoder::getImpl() {
   KJ_SWITCH_ONEOF(decoder) {
     KJ_CASE_ONEOF(dec, AsciiDecoder) { return dec; }
+    KJ_CASE_ONEOF(dec, Utf8Decoder) { return dec; }
     KJ_CASE_ONEOF(dec, IcuDecoder) { return dec; }
   }
   KJ_UNREACHABLE;
@@ -436,6 +598,10 @@ TextDecoder::constructor(jsg::Optional<kj::String> maybeLabel,
     return jsg::alloc<TextDecoder>(AsciiDecoder(), options);
   }
 
+  if (encoding == Encoding::Utf8) {
+    return jsg::alloc<TextDecoder>(Utf8Decoder(options.fatal, options.ignoreBOM), options);
+  }
+
   return jsg::alloc<TextDecoder>(
       JSG_REQUIRE_NONNULL(IcuDecoder::create(encoding, options.fatal, options.ignoreBOM),
                            RangeError,
@@ -466,6 +632,9 @@ kj::Maybe<jsg::JsString> TextDecoder::decodePtr(jsg::Lock& js,
     KJ_CASE_ONEOF(dec, AsciiDecoder) {
       return dec.decode(js, buffer, flush);
     }
+    KJ_CASE_ONEOF(dec, Utf8Decoder) {
+      return dec.decode(js, buffer, flush);
+    }
     KJ_CASE_ONEOF(dec, IcuDecoder) {
       return dec.decode(js, buffer, flush);
     }
@@ -495,13 +664,44 @@ TextEncoder::EncodeIntoResult encodeIntoImpl(jsg::Lock& js,
 }
 }  // namespace
 
+namespace {
+// Strings whose UTF-8 encoding could be larger than this are encoded straight into the memory
+// that will back the result, rather than into a scratch buffer that's then copied.
+constexpr size_t ENCODE_SCRATCH_SIZE = 4096;
+}  // namespace
+
 jsg::BufferSource TextEncoder::encode(jsg::Lock& js, jsg::Optional<jsg::JsString> input) {
   auto str = input.orDefault(js.str());
-  auto view = JSG_REQUIRE_NONNULL(jsg::BufferSource::tryAlloc(js, str.utf8Length(js)),
-                                  RangeError, "Cannot allocate space for TextEncoder.encode");
-  [[maybe_unused]] auto result = encodeIntoImpl(js, str, view);
-  KJ_DASSERT(result.written == view.size());
-  return kj::mv(view);
+  static constexpr auto options = static_cast<jsg::JsString::WriteOptions>(
+      jsg::JsString::NO_NULL_TERMINATION | jsg::JsString::REPLACE_INVALID_UTF8);
+
+  // Rather than measuring the UTF-8 length first, which means transcoding the string twice, we
+  // encode into a buffer big enough for the worst case -- three bytes per UTF-16 code unit -- and
+  // then trim it to what was actually written.
+  size_t capacity = static_cast<size_t>(str.length(js)) * 3;
+
+  if (capacity <= ENCODE_SCRATCH_SIZE) {
+    KJ_STACK_ARRAY(char, scratch, capacity, ENCODE_SCRATCH_SIZE, ENCODE_SCRATCH_SIZE);
+    auto result = str.writeInto(js, scratch, options);
+    auto view = JSG_REQUIRE_NONNULL(jsg::BufferSource::tryAlloc(js, result.written),
+                                    RangeError, "Cannot allocate space for TextEncoder.encode");
+    view.asArrayPtr().copyFrom(scratch.first(result.written).asBytes());
+    return kj::mv(view);
+  }
+
+  auto data = static_cast<char*>(malloc(capacity));
+  JSG_REQUIRE(data != nullptr, RangeError, "Cannot allocate space for TextEncoder.encode");
+  auto result = str.writeInto(js, kj::arrayPtr(data, capacity), options);
+  size_t written = result.written;
+  if (written < capacity) {
+    // Shrinking an allocation in place is cheap, and if realloc() can't do it we keep the
+    // original, larger one.
+    if (auto shrunk = static_cast<char*>(realloc(data, written))) {
+      data = shrunk;
+    }
+  }
+  return jsg::BufferSource::wrap(js, data, written,
+      [](void* data, size_t, void*) { free(data); }, nullptr);
 }
 
 TextEncoder::EncodeIntoResult TextEncoder::encodeInto(jsg::Lock& js,
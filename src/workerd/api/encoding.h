@@ -91,6 +91,38 @@ public:
       bool flush = false) override;
 };
 
+// Decoder implementation for UTF-8, by far the most common encoding. Input is validated in bulk
+// and, when it contains only ASCII or Latin-1 code points, becomes a one-byte string without ever
+// being widened to UTF-16. Only input containing errors goes through a per-code-point decoder to
+// insert replacement characters.
+class Utf8Decoder final: public Decoder {
+public:
+  Utf8Decoder(bool fatal, bool ignoreBom): fatal(fatal), ignoreBom(ignoreBom) {}
+  Utf8Decoder(Utf8Decoder&&) = default;
+  Utf8Decoder& operator=(Utf8Decoder&&) = default;
+  KJ_DISALLOW_COPY(Utf8Decoder);
+
+  Encoding getEncoding() override { return Encoding::Utf8; }
+
+  kj::Maybe<jsg::JsString> decode(
+      jsg::Lock& js,
+      kj::ArrayPtr<const kj::byte> buffer,
+      bool flush = false) override;
+
+  void reset() override;
+
+private:
+  kj::Maybe<jsg::JsString> decodeComplete(jsg::Lock& js, kj::ArrayPtr<const kj::byte> buffer);
+
+  bool fatal;
+  bool ignoreBom;
+  bool bomSeen = false;
+
+  // The start of a sequence that was cut off at the end of the previous chunk when streaming.
+  kj::byte pending[3];
+  uint pendingSize = 0;
+};
+
 // Decoder implementation that uses ICU's built-in conversion APIs.
 // ICU's decoder is fairly comprehensive, covering the full range
 // of encodings required by the Encoding specification.
@@ -128,7 +160,7 @@ private:
 // https://encoding.spec.whatwg.org/#interface-textdecoder
 class TextDecoder: public jsg::Object {
 public:
-  using DecoderImpl = kj::OneOf<AsciiDecoder, IcuDecoder>;
+  using DecoderImpl = kj::OneOf<AsciiDecoder, Utf8Decoder, IcuDecoder>;
 
   struct ConstructorOptions {
     bool fatal = false;
@@ -222,8 +254,9 @@ public:
     }
 
     // `encode()` returns `jsg::BufferSource`, which may be an `ArrayBuffer` or `ArrayBufferView`,
-    // but the implementation uses `jsg::BufferSource::tryAlloc()` which always tries to allocate a
-    // `Uint8Array`. The spec defines that this function returns a `Uint8Array` too.
+    // but the implementation always creates a `Uint8Array`, either with
+    // `jsg::BufferSource::tryAlloc()` or by wrapping the memory it encoded into. The spec defines
+    // that this function returns a `Uint8Array` too.
     JSG_TS_OVERRIDE({
       encode(input?: string): Uint8Array;
     });
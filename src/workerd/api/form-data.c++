@@ -10,7 +10,6 @@
 #include <kj/compat/http.h>
 #include <workerd/util/mimetype.h>
 #include <algorithm>
-#include <regex>
 
 #if !_MSC_VER
 #include <strings.h>
@@ -19,17 +18,94 @@
 namespace workerd::api {
 
 namespace {
+
+// Finds a fixed substring using the Boyer-Moore-Horspool algorithm. The skip table is built once,
+// so every search for the multipart boundary within a body shares it, and most bytes of a part
+// are skipped over without being compared at all.
+class SubStringSearcher {
+public:
+  explicit SubStringSearcher(kj::ArrayPtr<const char> needle): needle(needle) {
+    KJ_REQUIRE(needle.size() > 0);
+    for (auto& distance: skip) {
+      distance = needle.size();
+    }
+    for (size_t i = 0; i + 1 < needle.size(); i++) {
+      skip[static_cast<kj::byte>(needle[i])] = needle.size() - 1 - i;
+    }
+  }
+
+  size_t size() const { return needle.size(); }
+
+  // Returns the offset of the first occurrence of the needle in `text`, or text.size() if there
+  // is none.
+  size_t find(kj::ArrayPtr<const char> text) const {
+    auto n = needle.size();
+    if (text.size() < n) return text.size();
+
+    auto last = needle[n - 1];
+    for (size_t pos = 0; pos <= text.size() - n;) {
+      auto c = text[pos + n - 1];
+      if (c == last && memcmp(text.begin() + pos, needle.begin(), n - 1) == 0) {
+        return pos;
+      }
+      pos += skip[static_cast<kj::byte>(c)];
+    }
+    return text.size();
+  }
+
+private:
+  kj::ArrayPtr<const char> needle;
+  size_t skip[256];
+};
+
 // Like split() in kj/compat/url.c++, but splits at a substring rather than a character.
 kj::ArrayPtr<const char> splitAtSubString(
-    kj::ArrayPtr<const char>& text, kj::StringPtr subString) {
-  // TODO(perf): Use a Boyer-Moore search?
-  auto iter = std::search(text.begin(), text.end(), subString.begin(), subString.end());
-  auto result = kj::arrayPtr(text.begin(), iter - text.begin());
-  text = text.slice(kj::min(text.size(), result.end() - text.begin() + subString.size()),
-                    text.size());
+    kj::ArrayPtr<const char>& text, const SubStringSearcher& subString) {
+  auto pos = subString.find(text);
+  auto result = text.slice(0, pos);
+  text = text.slice(kj::min(text.size(), pos + subString.size()), text.size());
   return result;
 }
 
+// Returns the end of the first blank line in `text`, i.e. just past the first match of
+// /\r?\n\r?\n/, or none if there isn't one.
+kj::Maybe<size_t> findHeaderTermination(kj::ArrayPtr<const char> text) {
+  auto pos = text.begin();
+  while (auto lf = static_cast<const char*>(memchr(pos, '\n', text.end() - pos))) {
+    auto rest = text.end() - (lf + 1);
+    if (rest >= 1 && lf[1] == '\n') {
+      return lf + 2 - text.begin();
+    } else if (rest >= 2 && lf[1] == '\r' && lf[2] == '\n') {
+      return lf + 3 - text.begin();
+    }
+    pos = lf + 1;
+  }
+  return kj::none;
+}
+
+// Holds the body of a multipart/form-data message while parsing it, and afterwards on behalf of
+// any large file parts that refer to it rather than having their own copy.
+class SharedFormDataBody final: public kj::Refcounted {
+public:
+  explicit SharedFormDataBody(kj::String text): text(kj::mv(text)) {}
+
+  kj::String text;
+};
+
+// File parts at least this large refer to the body rather than being copied out of it, provided
+// they also make up a good part of the body. That way, a small file can't keep a much larger body
+// alive.
+constexpr size_t MIN_SHARED_FILE_SIZE = 16 * 1024;
+
+kj::Array<kj::byte> getFileData(SharedFormDataBody& body, kj::ArrayPtr<const char> part) {
+  if (part.size() >= kj::max(MIN_SHARED_FILE_SIZE, body.text.size() / 8)) {
+    auto offset = part.begin() - body.text.begin();
+    return body.text.asArray().asBytes().slice(offset, offset + part.size())
+        .attach(kj::addRef(body));
+  }
+  return kj::heapArray(part.asBytes());
+}
+
 bool startsWith(kj::ArrayPtr<const char> bytes, kj::StringPtr prefix) {
   return bytes.size() >= prefix.size() && bytes.slice(0, prefix.size()) == prefix;
 }
@@ -67,15 +143,18 @@ constexpr auto contentDisposition =
                 p::discardWhitespace, p::many(contentDispositionParam));
 
 void parseFormData(kj::Vector<FormData::Entry>& data, kj::StringPtr boundary,
-                   kj::ArrayPtr<const char> body, bool convertFilesToStrings) {
+                   SharedFormDataBody& sharedBody, bool convertFilesToStrings) {
+  kj::ArrayPtr<const char> body = sharedBody.text;
+
   // multipart/form-data messages are delimited by <CRLF>--<boundary>. We want to be able to handle
   // omitted carriage returns, though, so our delimiter only matches against a preceding line feed.
-  const auto delimiter = kj::str("\n--", boundary);
+  const auto delimiterText = kj::str("\n--", boundary);
+  const SubStringSearcher delimiter(delimiterText);
 
   // We want to slice off the delimiter's preceding newline for the initial search, because the very
   // first instance does not require one. In every subsequent multipart message, the preceding
   // newline is required.
-  auto message = splitAtSubString(body, delimiter.slice(1));
+  auto message = splitAtSubString(body, SubStringSearcher(delimiterText.slice(1)));
 
   JSG_REQUIRE(body.size() > 0, TypeError,
       "No initial boundary string (or you have a truncated message).");
@@ -96,22 +175,15 @@ void parseFormData(kj::Vector<FormData::Entry>& data, kj::StringPtr boundary,
     return false;
   };
 
-  constexpr auto staticRegexFlags = std::regex_constants::ECMAScript
-                                  | std::regex_constants::optimize;
-
-  static const auto headerTerminationRegex = std::regex("\r?\n\r?\n", staticRegexFlags);
-
-  std::cmatch match;
-
   auto& formDataHeaderTable = getFormDataHeaderTable();
 
   while (!done(body)) {
-    JSG_REQUIRE(std::regex_search(body.begin(), body.end(), match, headerTerminationRegex),
-                 TypeError, "No multipart message header termination found.");
+    auto headersEnd = JSG_REQUIRE_NONNULL(findHeaderTermination(body),
+        TypeError, "No multipart message header termination found.");
 
     // TODO(cleanup): Use kj-http to parse multipart headers. Right now that API isn't public, so
-    //   I'm just using a regex. For reference, multipart/form-data supports the following three
-    //   headers (https://tools.ietf.org/html/rfc7578#section-4.8):
+    //   I'm just finding the blank line by hand. For reference, multipart/form-data supports the
+    //   following three headers (https://tools.ietf.org/html/rfc7578#section-4.8):
     //
     //   Content-Disposition        (required)
     //   Content-Type               (optional, recommended for files)
@@ -119,8 +191,8 @@ void parseFormData(kj::Vector<FormData::Entry>& data, kj::StringPtr boundary,
     //
     // TODO(soon): Read the Content-Type to support files.
 
-    auto headersText = kj::str(body.slice(0, match[0].second - body.begin()));
-    body = body.slice(match[0].second - body.begin(), body.size());
+    auto headersText = kj::str(body.slice(0, headersEnd));
+    body = body.slice(headersEnd, body.size());
 
     kj::HttpHeaders headers(*formDataHeaderTable.table);
     JSG_REQUIRE(headers.tryParse(headersText), TypeError, "FormData part had invalid headers.");
@@ -167,7 +239,7 @@ void parseFormData(kj::Vector<FormData::Entry>& data, kj::StringPtr boundary,
     } else {
       data.add(FormData::Entry {
         kj::mv(name),
-        jsg::alloc<File>(kj::heapArray(message.asBytes()), KJ_ASSERT_NONNULL(kj::mv(filename)),
+        jsg::alloc<File>(getFileData(sharedBody, message), KJ_ASSERT_NONNULL(kj::mv(filename)),
                           kj::str(type.orDefault(nullptr)), dateNow())
       });
     }
@@ -207,9 +279,43 @@ blobToFile(kj::StringPtr name, kj::OneOf<jsg::Ref<File>, jsg::Ref<Blob>, kj::Str
   KJ_UNREACHABLE;
 }
 
+// Output for writeFormData() that just counts the bytes that would be written, so that the output
+// buffer can be allocated at exactly the right size.
+class SizeCounter {
+public:
+  void add(char c) { ++size; }
+  void addAll(kj::ArrayPtr<const char> chars) { size += chars.size(); }
+
+  size_t size = 0;
+};
+
+// Output for writeFormData() that writes into a buffer which is known to be large enough.
+class BufferWriter {
+public:
+  explicit BufferWriter(kj::ArrayPtr<kj::byte> buffer)
+      : pos(buffer.asChars().begin()), end(buffer.asChars().end()) {}
+
+  void add(char c) {
+    KJ_DASSERT(pos < end);
+    *pos++ = c;
+  }
+  void addAll(kj::ArrayPtr<const char> chars) {
+    KJ_DASSERT(size_t(end - pos) >= chars.size());
+    memcpy(pos, chars.begin(), chars.size());
+    pos += chars.size();
+  }
+
+  bool isFull() const { return pos == end; }
+
+private:
+  char* pos;
+  char* end;
+};
+
 // Add the chars from `value` into `builder` escaping the characters '"' and '\n' using %
 // encoding, exactly as Chrome does for Content-Disposition values.
-void addEscapingQuotes(kj::Vector<char>& builder, kj::StringPtr value) {
+template <typename Output>
+void addEscapingQuotes(Output& builder, kj::StringPtr value) {
   // Chrome throws "Failed to fetch" if the name ends with a backslash. Otherwise it worries that
   // the backslash may be interpreted as escaping the final quote.
   JSG_REQUIRE(!value.endsWith("\\"), TypeError, "Name or filename can't end with backslash");
@@ -237,20 +343,11 @@ void addEscapingQuotes(kj::Vector<char>& builder, kj::StringPtr value) {
   }
 }
 
-}  // namespace
-
-// =======================================================================================
-// FormData implementation
-
-kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
-  // Boundary string requirement per RFC7578
-  JSG_REQUIRE(boundary.size() > 0 && boundary.size() <= 70, TypeError,
-      "Length of multipart/form-data boundary string must be in the range [1, 70].");
-
-  // TODO(perf): We should be able to trivially calculate the length of the serialized form data
-  //   beforehand. I tried, but apparently my math REALLY sucks and I hate memory overruns, so ...
-  auto builder = kj::Vector<char>{};
-
+// Writes `data` as a multipart/form-data body. This is run twice by FormData::serialize(): once
+// with a SizeCounter to size the buffer, then again to fill it in.
+template <typename Output>
+void writeFormData(Output& builder, kj::ArrayPtr<FormData::Entry> data,
+                   kj::ArrayPtr<const char> boundary) {
   for (auto& kv: data) {
     builder.addAll("--"_kj);
     builder.addAll(boundary);
@@ -281,8 +378,27 @@ kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
   builder.addAll("--"_kj);
   builder.addAll(boundary);
   builder.addAll("--"_kj);
+}
+
+}  // namespace
+
+// =======================================================================================
+// FormData implementation
 
-  return builder.releaseAsArray().releaseAsBytes();
+kj::Array<kj::byte> FormData::serialize(kj::ArrayPtr<const char> boundary) {
+  // Boundary string requirement per RFC7578
+  JSG_REQUIRE(boundary.size() > 0 && boundary.size() <= 70, TypeError,
+      "Length of multipart/form-data boundary string must be in the range [1, 70].");
+
+  SizeCounter counter;
+  writeFormData(counter, data.asPtr(), boundary);
+
+  auto result = kj::heapArray<kj::byte>(counter.size);
+  BufferWriter writer(result);
+  writeFormData(writer, data.asPtr(), boundary);
+  KJ_ASSERT(writer.isFull());
+
+  return result;
 }
 
 FormData::EntryType FormData::clone(FormData::EntryType& value) {
@@ -297,7 +413,7 @@ FormData::EntryType FormData::clone(FormData::EntryType& value) {
   KJ_UNREACHABLE;
 }
 
-void FormData::parse(kj::ArrayPtr<const char> rawText, kj::StringPtr contentType,
+void FormData::parse(kj::String rawText, kj::StringPtr contentType,
                      bool convertFilesToStrings) {
   KJ_IF_SOME(parsed, MimeType::tryParse(contentType)) {
     auto& params = parsed.params();
@@ -306,7 +422,8 @@ void FormData::parse(kj::ArrayPtr<const char> rawText, kj::StringPtr contentType
           "No boundary string in Content-Type header. The multipart/form-data MIME "
           "type requires a boundary parameter, e.g. 'Content-Type: multipart/form-data; "
           "boundary=\"abcd\"'. See RFC 7578, section 4.");
-      parseFormData(data, boundary, rawText, convertFilesToStrings);
+      auto body = kj::refcounted<SharedFormDataBody>(kj::mv(rawText));
+      parseFormData(data, boundary, *body, convertFilesToStrings);
       return;
     } else if (MimeType::FORM_URLENCODED == parsed) {
       // Let's read the charset so we can barf if the body isn't UTF-8.
@@ -320,7 +437,7 @@ void FormData::parse(kj::ArrayPtr<const char> rawText, kj::StringPtr contentType
             TypeError, "Non-utf-8 application/x-www-form-urlencoded body.");
       }
       kj::Vector<kj::Url::QueryParam> query;
-      parseQueryString(query, kj::mv(rawText));
+      parseQueryString(query, rawText);
       data.reserve(query.size());
       for (auto& param: query) {
         data.add(Entry { kj::mv(param.name), kj::mv(param.value) });
@@ -46,11 +46,13 @@ public:
   // Parse `rawText`, storing the results in this FormData object. `contentType` must be either
   // multipart/form-data or application/x-www-form-urlencoded.
   //
+  // Large files in a multipart/form-data body keep referring to `rawText` rather than copying
+  // their contents out of it.
+  //
   // `convertFilesToStrings` is for backwards-compatibility. The first implementation of this
   // class in Workers incorrectly represented files as strings (of their content). Changing this
   // could break deployed code, so this has to be controlled by a compatibility flag.
-  void parse(kj::ArrayPtr<const char> rawText, kj::StringPtr contentType,
-             bool convertFilesToStrings);
+  void parse(kj::String rawText, kj::StringPtr contentType, bool convertFilesToStrings);
 
   struct Entry {
     kj::String name;
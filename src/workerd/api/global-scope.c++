@@ -16,6 +16,7 @@
 #include <workerd/jsg/util.h>
 #include <workerd/io/io-context.h>
 #include <workerd/io/features.h>
+#include <workerd/util/base64.h>
 #include <workerd/util/sentry.h>
 #include <workerd/util/thread-scopes.h>
 #include <workerd/api/hibernatable-web-socket.h>
@@ -638,10 +639,10 @@ kj::String ServiceWorkerGlobalScope::btoa(jsg::Lock& js, jsg::JsValue data) {
   //   negatives. Conceivably we could take advantage of this fact to completely avoid the later
   //   WriteOneByte() call in some cases!
 
-  return kj::encodeBase64(str.toArray<kj::byte>(js));
+  return fastEncodeBase64(str.toArray<kj::byte>(js));
 }
 jsg::JsString ServiceWorkerGlobalScope::atob(jsg::Lock& js, kj::String data) {
-  auto decoded = kj::decodeBase64(data.asArray());
+  auto decoded = fastDecodeBase64(data.asArray());
 
   JSG_REQUIRE(!decoded.hadErrors, DOMInvalidCharacterError,
       "atob() called with invalid base64-encoded data. (Only whitespace, '+', '/', alphanumeric "
@@ -842,7 +842,7 @@ jsg::Promise<jsg::Ref<FormData>> Body::formData(jsg::Lock& js) {
 
 jsg::Promise<jsg::Value> Body::json(jsg::Lock& js) {
   return text(js).then(js, [](jsg::Lock& js, kj::String text) {
-    return js.parseJson(text);
+    return js.parseJson(kj::mv(text));
   });
 }
 
@@ -1441,7 +1441,8 @@ jsg::Ref<Response> Response::json_(
     };
   }
 
-  return constructor(js, kj::Maybe(any.toJson(js)), kj::mv(maybeInit));
+  // The Content-Type was set above, so the body can go in as bytes rather than text.
+  return constructor(js, kj::Maybe(any.toJsonBytes(js)), kj::mv(maybeInit));
 }
 
 jsg::Ref<Response> Response::clone(jsg::Lock& js) {
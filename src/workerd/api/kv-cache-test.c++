@@ -0,0 +1,133 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "kv-cache.h"
+#include <kj/test.h>
+
+namespace workerd::api {
+namespace {
+
+kj::Own<const KvCache::Value> makeValue(kj::StringPtr text) {
+  auto value = kj::atomicRefcounted<KvCache::Value>();
+  value->bytes = kj::heapArray<const kj::byte>(text.asBytes());
+  return kj::mv(value);
+}
+
+kj::Own<const KvCache::Value> makeNotFound() {
+  return kj::atomicRefcounted<KvCache::Value>();
+}
+
+kj::Own<KvCache::Fill> expectFill(KvCache::Lookup lookup) {
+  KJ_ASSERT(lookup.is<kj::Own<KvCache::Fill>>());
+  return kj::mv(lookup.get<kj::Own<KvCache::Fill>>());
+}
+
+kj::String text(const KvCache::Value& value) {
+  return kj::str(KJ_ASSERT_NONNULL(value.bytes).asPtr().asChars());
+}
+
+kj::String expectHit(KvCache::Lookup lookup) {
+  KJ_ASSERT(lookup.is<kj::Own<const KvCache::Value>>());
+  return text(*lookup.get<kj::Own<const KvCache::Value>>());
+}
+
+KJ_TEST("KvCache caches values and missing keys") {
+  auto cache = kj::atomicRefcounted<KvCache>(KvCache::Limits {});
+
+  expectFill(cache->lookup("a"))->complete(makeValue("hello"), 60 * kj::SECONDS);
+  expectFill(cache->lookup("b"))->complete(makeNotFound(), 60 * kj::SECONDS);
+
+  KJ_EXPECT(expectHit(cache->lookup("a")) == "hello");
+
+  auto b = cache->lookup("b");
+  KJ_ASSERT(b.is<kj::Own<const KvCache::Value>>());
+  KJ_EXPECT(b.get<kj::Own<const KvCache::Value>>()->bytes == kj::none);
+
+  KJ_EXPECT(cache->getStats().hits == 2);
+  KJ_EXPECT(cache->getStats().misses == 2);
+}
+
+KJ_TEST("KvCache coalesces concurrent reads of the same key") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto cache = kj::atomicRefcounted<KvCache>(KvCache::Limits {});
+
+  auto fill = expectFill(cache->lookup("a"));
+  auto second = cache->lookup("a");
+  KJ_ASSERT(second.is<KvCache::Waiting>());
+  auto waiting = kj::mv(second.get<KvCache::Waiting>());
+  KJ_EXPECT(!waiting.poll(ws));
+
+  fill->complete(makeValue("hello"), 60 * kj::SECONDS);
+  auto value = KJ_ASSERT_NONNULL(waiting.wait(ws));
+  KJ_EXPECT(text(*value) == "hello");
+  KJ_EXPECT(cache->getStats().coalesced == 1);
+
+  // If the fetch fails, waiting reads are told to fetch for themselves.
+  expectHit(cache->lookup("a"));
+  cache->invalidate("a");
+  fill = expectFill(cache->lookup("a"));
+  auto third = cache->lookup("a");
+  KJ_ASSERT(third.is<KvCache::Waiting>());
+  fill = nullptr;
+  KJ_EXPECT(third.get<KvCache::Waiting>().wait(ws) == kj::none);
+}
+
+KJ_TEST("KvCache doesn't cache a value written while it was being fetched") {
+  auto cache = kj::atomicRefcounted<KvCache>(KvCache::Limits {});
+
+  auto fill = expectFill(cache->lookup("a"));
+  cache->invalidate("a");
+  fill->complete(makeValue("stale"), 60 * kj::SECONDS);
+  fill = nullptr;
+
+  expectFill(cache->lookup("a"));
+}
+
+KJ_TEST("KvCache enforces its limits") {
+  auto cache = kj::atomicRefcounted<KvCache>(KvCache::Limits {
+    .maxKeys = 2,
+    .maxValueSize = 8,
+    .maxTotalSize = 10,
+  });
+
+  // Too large to cache.
+  expectFill(cache->lookup("big"))->complete(makeValue("0123456789"), 60 * kj::SECONDS);
+  expectFill(cache->lookup("big"));
+
+  // No TTL, no caching.
+  expectFill(cache->lookup("a"))->complete(makeValue("a"), 0 * kj::SECONDS);
+  expectFill(cache->lookup("a"))->complete(makeValue("aaaa"), 60 * kj::SECONDS);
+  expectFill(cache->lookup("b"))->complete(makeValue("bbbb"), 60 * kj::SECONDS);
+
+  // Reading `a` makes `b` the least recently used, so `c` evicts it.
+  KJ_EXPECT(expectHit(cache->lookup("a")) == "aaaa");
+  expectFill(cache->lookup("c"))->complete(makeValue("cccc"), 60 * kj::SECONDS);
+  expectFill(cache->lookup("b"));
+  KJ_EXPECT(expectHit(cache->lookup("a")) == "aaaa");
+
+  // Over maxTotalSize, evicting `c` then `a`.
+  expectFill(cache->lookup("d"))->complete(makeValue("dddddddd"), 60 * kj::SECONDS);
+  KJ_EXPECT(expectHit(cache->lookup("d")) == "dddddddd");
+  expectFill(cache->lookup("c"));
+  KJ_EXPECT(cache->getStats().evictions == 3);
+}
+
+KJ_TEST("KvCacheProvider shares caches by id") {
+  KvCacheProvider provider;
+  auto a = kj::mv(provider.getInstance("shared"_kj, "kv"_kj, {}).get<kj::Own<const KvCache>>());
+  auto b = kj::mv(provider.getInstance("shared"_kj, "kv"_kj, {}).get<kj::Own<const KvCache>>());
+  auto c = kj::mv(provider.getInstance(kj::none, "kv"_kj, {}).get<kj::Own<const KvCache>>());
+  KJ_EXPECT(a.get() == b.get());
+  KJ_EXPECT(a.get() != c.get());
+
+  // An id can't be reused for another namespace, or with other limits.
+  auto otherNamespace = provider.getInstance("shared"_kj, "other"_kj, {});
+  KJ_EXPECT(otherNamespace.get<kj::String>().contains("already used for namespace \"kv\""));
+  auto otherLimits = provider.getInstance("shared"_kj, "kv"_kj, { .maxKeys = 1 });
+  KJ_EXPECT(otherLimits.get<kj::String>().contains("already used with different limits"));
+}
+
+}  // namespace
+}  // namespace workerd::api
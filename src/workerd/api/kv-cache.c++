@@ -0,0 +1,143 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "kv-cache.h"
+#include <kj/debug.h>
+
+namespace workerd::api {
+
+size_t KvCache::Value::size() const {
+  size_t result = 0;
+  KJ_IF_SOME(b, bytes) result += b.size();
+  KJ_IF_SOME(m, metadata) result += m.size();
+  return result;
+}
+
+KvCache::Fill::Fill(kj::Own<const KvCache> cache, kj::String key)
+    : cache(kj::mv(cache)), key(kj::mv(key)) {}
+
+KvCache::Fill::~Fill() noexcept(false) {
+  if (!completed) {
+    // The fetch failed or was canceled. Let the waiting reads try for themselves.
+    cache->finishFill(key, kj::none, 0 * kj::SECONDS);
+  }
+}
+
+void KvCache::Fill::complete(kj::Own<const Value> value, kj::Duration ttl) {
+  KJ_REQUIRE(!completed, "KvCache::Fill completed twice");
+  completed = true;
+  cache->finishFill(key, kj::mv(value), ttl);
+}
+
+KvCache::Lookup KvCache::lookup(kj::StringPtr key) const {
+  auto lock = state.lockExclusive();
+  auto now = kj::systemCoarseMonotonicClock().now();
+
+  KJ_IF_SOME(entry, lock->entries.find(key)) {
+    if (entry.expiration > now) {
+      ++lock->stats.hits;
+      auto result = kj::atomicAddRef(*entry.value);
+
+      // Move the entry to the back of the eviction order.
+      lock->entries.insert(lock->entries.release(entry));
+      return kj::mv(result);
+    }
+    erase(*lock, entry);
+  }
+
+  KJ_IF_SOME(inProgress, lock->inProgress.find(key)) {
+    ++lock->stats.coalesced;
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<kj::Maybe<kj::Own<const Value>>>();
+    inProgress.waiters.add(kj::mv(paf.fulfiller));
+    return kj::mv(paf.promise);
+  }
+
+  ++lock->stats.misses;
+  lock->inProgress.insert(kj::str(key), {});
+  return kj::heap<Fill>(kj::atomicAddRef(*this), kj::str(key));
+}
+
+void KvCache::invalidate(kj::StringPtr key) const {
+  auto lock = state.lockExclusive();
+  KJ_IF_SOME(entry, lock->entries.find(key)) {
+    erase(*lock, entry);
+  }
+  KJ_IF_SOME(inProgress, lock->inProgress.find(key)) {
+    inProgress.invalidated = true;
+  }
+}
+
+KvCache::Stats KvCache::getStats() const {
+  return state.lockShared()->stats;
+}
+
+void KvCache::finishFill(kj::StringPtr key, kj::Maybe<kj::Own<const Value>> value,
+                         kj::Duration ttl) const {
+  kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<kj::Maybe<kj::Own<const Value>>>>> waiters;
+
+  {
+    auto lock = state.lockExclusive();
+    auto& inProgress = KJ_ASSERT_NONNULL(lock->inProgress.find(key));
+    waiters = kj::mv(inProgress.waiters);
+    bool invalidated = inProgress.invalidated;
+    lock->inProgress.erase(key);
+
+    KJ_IF_SOME(v, value) {
+      auto size = v->size();
+      if (!invalidated && ttl > 0 * kj::SECONDS && size <= limits.maxValueSize &&
+          size <= limits.maxTotalSize) {
+        while (lock->entries.size() > 0 && (lock->entries.size() >= limits.maxKeys ||
+                                            lock->totalSize + size > limits.maxTotalSize)) {
+          ++lock->stats.evictions;
+          erase(*lock, *lock->entries.ordered<1>().begin());
+        }
+        if (limits.maxKeys > 0) {
+          lock->totalSize += size;
+          lock->entries.insert(Entry {
+            .key = kj::str(key),
+            .value = kj::atomicAddRef(*v),
+            .expiration = kj::systemCoarseMonotonicClock().now() + ttl,
+          });
+        }
+      }
+    }
+  }
+
+  // Fulfilling may run code waiting on the promise if it belongs to this thread, so don't hold
+  // the lock while doing so.
+  for (auto& waiter: waiters) {
+    waiter->fulfill(value.map([](kj::Own<const Value>& v) { return kj::atomicAddRef(*v); }));
+  }
+}
+
+void KvCache::erase(State& lockedState, Entry& entry) const {
+  lockedState.totalSize -= entry.value->size();
+  lockedState.entries.erase(entry);
+}
+
+kj::OneOf<kj::Own<const KvCache>, kj::String> KvCacheProvider::getInstance(
+    kj::Maybe<kj::StringPtr> id, kj::StringPtr kvNamespace, KvCache::Limits limits) const {
+  KJ_IF_SOME(i, id) {
+    auto lock = caches.lockExclusive();
+    auto& shared = lock->findOrCreate(i, [&]() -> Caches::Entry {
+      return { kj::str(i), Shared {
+        .kvNamespace = kj::str(kvNamespace),
+        .cache = kj::atomicRefcounted<KvCache>(limits),
+      }};
+    });
+    if (shared.kvNamespace != kvNamespace) {
+      return kj::str("KV cache \"", i, "\" is already used for namespace \"", shared.kvNamespace,
+                     "\"; a cache can't be shared between namespaces.");
+    }
+    if (!(shared.cache->getLimits() == limits)) {
+      return kj::str("KV cache \"", i, "\" is already used with different limits; every binding "
+                     "sharing a cache must specify the same limits.");
+    }
+    return kj::atomicAddRef(*shared.cache);
+  } else {
+    return kj::atomicRefcounted<KvCache>(limits);
+  }
+}
+
+}  // namespace workerd::api
@@ -0,0 +1,164 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/hash.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/one-of.h>
+#include <kj/refcount.h>
+#include <kj/table.h>
+#include <kj/time.h>
+#include <kj/vector.h>
+
+namespace workerd::api {
+
+// An in-memory, read-through cache of KV values, configured per KV binding. Reads that hit the
+// cache are answered without a subrequest. A cache may be shared by any number of bindings, in
+// any number of isolates, within the process.
+//
+// Each entry lives for the `cacheTtl` of the read that filled it. Reads of keys that don't exist
+// are cached too. While one read is fetching a key, concurrent reads of the same key wait for it
+// rather than sending their own subrequests.
+//
+// The cache only knows about writes made through a binding that uses it. Writes made any other
+// way become visible once the cached entry expires, as with KV's own edge caching.
+class KvCache final: public kj::AtomicRefcounted {
+public:
+  struct Limits {
+    // The maximum number of keys cached at once.
+    uint32_t maxKeys = 1000;
+
+    // Values larger than this are never cached.
+    uint32_t maxValueSize = 1024 * 1024;
+
+    // The maximum combined size of all cached values and metadata.
+    uint64_t maxTotalSize = 64 * 1024 * 1024;
+
+    bool operator==(const Limits&) const = default;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // Reads that waited for another read of the same key.
+    uint64_t coalesced = 0;
+
+    uint64_t evictions = 0;
+  };
+
+  // The result of one read.
+  struct Value final: public kj::AtomicRefcounted {
+    // kj::none if the key doesn't exist.
+    kj::Maybe<kj::Array<const kj::byte>> bytes;
+
+    // The key's metadata, as JSON.
+    kj::Maybe<kj::String> metadata;
+
+    size_t size() const;
+  };
+
+  // Held by the read responsible for fetching a key which isn't cached. Reads of the same key
+  // wait until the Fill is completed or destroyed. If it is destroyed first, e.g. because the
+  // fetch failed, each waiting read fetches the key itself.
+  class Fill {
+  public:
+    Fill(kj::Own<const KvCache> cache, kj::String key);
+    ~Fill() noexcept(false);
+    KJ_DISALLOW_COPY_AND_MOVE(Fill);
+
+    void complete(kj::Own<const Value> value, kj::Duration ttl);
+
+  private:
+    kj::Own<const KvCache> cache;
+    kj::String key;
+    bool completed = false;
+  };
+
+  using Waiting = kj::Promise<kj::Maybe<kj::Own<const Value>>>;
+  using Lookup = kj::OneOf<kj::Own<const Value>, kj::Own<Fill>, Waiting>;
+
+  explicit KvCache(Limits limits): limits(limits) {}
+  KJ_DISALLOW_COPY_AND_MOVE(KvCache);
+
+  // Returns the cached value for `key` if there is one. Otherwise, if another read is already
+  // fetching the key, returns a promise for its result. Otherwise, returns a Fill, which the
+  // caller must complete once it has fetched the key.
+  Lookup lookup(kj::StringPtr key) const;
+
+  // Forgets the cached value for `key`, after a write through a binding that uses this cache.
+  // A read already fetching the key won't cache its result.
+  void invalidate(kj::StringPtr key) const;
+
+  Stats getStats() const;
+
+  const Limits& getLimits() const { return limits; }
+
+private:
+  struct Entry {
+    kj::String key;
+    kj::Own<const Value> value;
+    kj::TimePoint expiration;
+  };
+
+  struct InProgress {
+    kj::Vector<kj::Own<kj::CrossThreadPromiseFulfiller<kj::Maybe<kj::Own<const Value>>>>> waiters;
+
+    // Set if the key was written while being fetched.
+    bool invalidated = false;
+  };
+
+  struct EntryCallbacks {
+    inline kj::StringPtr keyForRow(const Entry& entry) const { return entry.key; }
+    inline bool matches(const Entry& entry, kj::StringPtr key) const { return entry.key == key; }
+    inline auto hashCode(kj::StringPtr key) const { return kj::hashCode(key); }
+  };
+
+  struct State {
+    // Least recently used first.
+    kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries;
+    uint64_t totalSize = 0;
+
+    kj::HashMap<kj::String, InProgress> inProgress;
+    Stats stats;
+  };
+
+  Limits limits;
+  kj::MutexGuarded<State> state;
+
+  void finishFill(kj::StringPtr key, kj::Maybe<kj::Own<const Value>> value,
+                  kj::Duration ttl) const;
+  void erase(State& lockedState, Entry& entry) const;
+};
+
+// All KvCaches that bindings have named, by id.
+class KvCacheProvider {
+public:
+  KvCacheProvider() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(KvCacheProvider);
+
+  // Returns the cache with the given id, creating it with the given limits if it doesn't exist
+  // yet. Without an id, always creates a new cache, not shared with any other binding.
+  //
+  // `kvNamespace` identifies the namespace whose values will be cached. Sharing a cache between
+  // namespaces would answer reads of one with the values of the other, so if the id already
+  // names a cache for a different namespace, or one with different limits, returns a description
+  // of the conflict instead.
+  kj::OneOf<kj::Own<const KvCache>, kj::String> getInstance(
+      kj::Maybe<kj::StringPtr> id, kj::StringPtr kvNamespace, KvCache::Limits limits) const;
+
+private:
+  struct Shared {
+    kj::String kvNamespace;
+    kj::Own<const KvCache> cache;
+  };
+
+  using Caches = kj::HashMap<kj::String, Shared>;
+  kj::MutexGuarded<Caches> caches;
+};
+
+}  // namespace workerd::api
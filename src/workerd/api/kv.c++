@@ -103,30 +103,405 @@ kj::Own<kj::HttpClient> KvNamespace::getHttpClient(
 }
 
 
+static kj::String getUrl(kj::StringPtr name, jsg::Optional<int> cacheTtl) {
+  kj::Url url;
+  url.scheme = kj::str("https");
+  url.host = kj::str("fake-host");
+  url.path.add(kj::str(name));
+  url.query.add(kj::Url::QueryParam { kj::str("urlencoded"), kj::str("true") });
+  KJ_IF_SOME(ttl, cacheTtl) {
+    url.query.add(kj::Url::QueryParam { kj::str("cache_ttl"), kj::str(ttl) });
+  }
+  return url.toString(kj::Url::Context::HTTP_PROXY_REQUEST);
+}
+
+// Builds the result of a read served through a KvCache.
+static KvNamespace::GetWithMetadataResult makeCachedResult(jsg::Lock& js, kj::StringPtr type,
+    const KvCache::Value& value, kj::Maybe<kj::StringPtr> cacheStatus) {
+  KvNamespace::GetResult result;
+  KJ_IF_SOME(bytes, value.bytes) {
+    if (type == "text") {
+      result = KvNamespace::GetResult(kj::str(bytes.asChars()));
+    } else if (type == "arrayBuffer") {
+      result = KvNamespace::GetResult(kj::heapArray<byte>(bytes));
+    } else {
+      KJ_ASSERT(type == "json");
+      result = KvNamespace::GetResult(jsg::JsRef(js, jsg::JsValue::fromJson(js, bytes.asChars())));
+    }
+  }
+
+  kj::Maybe<jsg::JsRef<jsg::JsValue>> meta;
+  KJ_IF_SOME(metaStr, value.metadata) {
+    meta = jsg::JsRef(js, jsg::JsValue::fromJson(js, metaStr));
+  }
+
+  return KvNamespace::GetWithMetadataResult {
+    .value = kj::mv(result),
+    .metadata = kj::mv(meta),
+    .cacheStatus = cacheStatus.map([&](kj::StringPtr cs) {
+      return jsg::JsRef<jsg::JsValue>(js, js.strIntern(cs));
+    }),
+  };
+}
+
+struct CachedRead {
+  kj::Own<const KvCache::Value> value;
+  kj::Maybe<kj::String> cacheStatus;
+};
+
+// Reads a value in full, for a read that missed the cache, then stores it in the cache.
+static kj::Promise<CachedRead> fetchForCache(
+    IoContext& context, kj::Own<kj::HttpClient> client,
+    kj::Promise<kj::HttpClient::Response> responsePromise, CompatibilityFlags::Reader flags,
+    kj::Own<KvCache::Fill> fill, kj::Duration ttl) {
+  auto response = co_await responsePromise;
+
+  auto cacheStatus = response.headers->get(context.getHeaderIds().cfCacheStatus)
+      .map([](kj::StringPtr cs) { return kj::str(cs); });
+
+  auto value = kj::atomicRefcounted<KvCache::Value>();
+  if (response.statusCode != 404 && response.statusCode != 410) {
+    checkForErrorStatus("GET", response);
+
+    KJ_IF_SOME(m, response.headers->get(context.getHeaderIds().cfKvMetadata)) {
+      value->metadata = kj::str(m);
+    }
+
+    auto stream = newSystemStream(kj::mv(response.body), getContentEncoding(
+        context, *response.headers, Response::BodyEncoding::AUTO, flags));
+    value->bytes = co_await stream->readAllBytes(context.getLimitEnforcer().getBufferingLimit());
+  }
+
+  fill->complete(kj::atomicAddRef(*value), ttl);
+  co_return CachedRead { .value = kj::mv(value), .cacheStatus = kj::mv(cacheStatus) };
+}
+
+jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getThroughCache(
+    jsg::Lock& js, const KvCache& cache, kj::String name, kj::String type,
+    jsg::Optional<int> cacheTtl) {
+  JSG_REQUIRE(type == "text" || type == "arrayBuffer" || type == "json", TypeError,
+      "Unknown response type. Possible types are \"text\", \"arrayBuffer\", "
+      "\"json\", and \"stream\".");
+
+  auto& context = IoContext::current();
+  auto lookup = cache.lookup(name);
+
+  KJ_SWITCH_ONEOF(lookup) {
+    KJ_CASE_ONEOF(value, kj::Own<const KvCache::Value>) {
+      return js.resolvedPromise(makeCachedResult(js, type, *value, "HIT"));
+    }
+    KJ_CASE_ONEOF(waiting, KvCache::Waiting) {
+      // Another read of this key is in progress, possibly in another isolate. Register a pending
+      // event so that the wait isn't mistaken for a hang.
+      return context.awaitIo(js, kj::mv(waiting).attach(context.registerPendingEvent()),
+          [self = JSG_THIS, name = kj::mv(name), type = kj::mv(type), cacheTtl]
+          (jsg::Lock& js, kj::Maybe<kj::Own<const KvCache::Value>> result) mutable
+          -> jsg::Promise<GetWithMetadataResult> {
+        KJ_IF_SOME(value, result) {
+          return js.resolvedPromise(makeCachedResult(js, type, *value, "HIT"));
+        }
+        // The other read failed. Try again, likely becoming the read that fetches the key.
+        return self->getWithMetadata(js, kj::mv(name), kj::OneOf<kj::String, GetOptions>(
+            GetOptions { .type = kj::mv(type), .cacheTtl = cacheTtl }));
+      });
+    }
+    KJ_CASE_ONEOF(fill, kj::Own<KvCache::Fill>) {
+      auto ttl = getCacheTtl(cacheTtl);
+      auto urlStr = getUrl(name, cacheTtl);
+      auto headers = kj::HttpHeaders(context.getHeaderTable());
+      auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET, urlStr);
+      auto request = client->request(kj::HttpMethod::GET, urlStr, headers);
+
+      return context.awaitIo(js,
+          fetchForCache(context, kj::mv(client), kj::mv(request.response), FeatureFlags::get(js),
+              kj::mv(fill), ttl),
+          [type = kj::mv(type)](jsg::Lock& js, CachedRead read) {
+        return makeCachedResult(js, type, *read.value,
+            read.cacheStatus.map([](kj::String& cs) -> kj::StringPtr { return cs; }));
+      });
+    }
+  }
+  KJ_UNREACHABLE;
+}
+
+kj::Duration KvNamespace::getCacheTtl(jsg::Optional<int> cacheTtl) {
+  KJ_IF_SOME(seconds, cacheTtl) {
+    return kj::max(seconds, 0) * kj::SECONDS;
+  }
+  return defaultCacheTtl;
+}
+
+kj::Promise<void> KvNamespace::invalidateAround(kj::StringPtr name, kj::Promise<void> write) {
+  KJ_IF_SOME(c, cache) {
+    c->invalidate(name);
+    return write.then([cache = kj::atomicAddRef(*c), name = kj::str(name)]() {
+      cache->invalidate(name);
+    });
+  }
+  return write;
+}
+
 jsg::Promise<KvNamespace::GetResult> KvNamespace::get(
-    jsg::Lock& js, kj::String name, jsg::Optional<kj::OneOf<kj::String, GetOptions>> options,
+    jsg::Lock& js, kj::OneOf<kj::Array<kj::String>, kj::String> name,
+    jsg::Optional<kj::OneOf<kj::String, GetOptions>> options,
     CompatibilityFlags::Reader flags) {
-  return js.evalNow([&] {
-    auto resp = getWithMetadata(js, kj::mv(name), kj::mv(options));
-    return resp.then(js, [](jsg::Lock&, KvNamespace::GetWithMetadataResult result) {
-      return kj::mv(result.value);
-    });
+  return js.evalNow([&]() -> jsg::Promise<KvNamespace::GetResult> {
+    KJ_SWITCH_ONEOF(name) {
+      KJ_CASE_ONEOF(names, kj::Array<kj::String>) {
+        kj::String type = kj::str("text");
+        jsg::Optional<int> cacheTtl;
+        KJ_IF_SOME(oneOfOptions, options) {
+          KJ_SWITCH_ONEOF(oneOfOptions) {
+            KJ_CASE_ONEOF(t, kj::String) {
+              type = kj::mv(t);
+            }
+            KJ_CASE_ONEOF(o, GetOptions) {
+              KJ_IF_SOME(t, o.type) {
+                type = kj::mv(t);
+              }
+              cacheTtl = o.cacheTtl;
+            }
+          }
+        }
+        return getBulk(js, kj::mv(names), kj::mv(type), cacheTtl);
+      }
+      KJ_CASE_ONEOF(n, kj::String) {
+        return getSingle(js, kj::mv(n), kj::mv(options));
+      }
+    }
+    KJ_UNREACHABLE;
   });
 }
 
-jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
+jsg::Promise<KvNamespace::GetResult> KvNamespace::getSingle(
     jsg::Lock& js, kj::String name, jsg::Optional<kj::OneOf<kj::String, GetOptions>> options) {
-  validateKeyName("GET", name);
+  auto resp = getWithMetadata(js, kj::mv(name), kj::mv(options));
+  return resp.then(js, [](jsg::Lock&, KvNamespace::GetWithMetadataResult result) {
+    return kj::mv(result.value);
+  });
+}
+
+namespace {
+
+// As documented in Cloudflare's Worker KV limits.
+constexpr size_t kMaxBulkGetKeys = 100;
+
+// The response to a bulk get is read in chunks of this size, each parsed as soon as it arrives.
+constexpr size_t kBulkGetChunkSize = 16 * 1024;
+
+// Converts a value read through a KvCache to what a bulk get returns for it.
+jsg::JsValue cachedValueToJs(jsg::Lock& js, kj::StringPtr type, const KvCache::Value& value) {
+  KJ_IF_SOME(bytes, value.bytes) {
+    if (type == "json") {
+      return jsg::JsValue::fromJson(js, bytes.asChars());
+    }
+    return js.str(bytes.asChars());
+  }
+  return js.null();
+}
 
+// A bulk get whose response is being read.
+//
+// The response holds one JSON object per line, of the form
+// `{"key": string, "value": string, "metadata"?: any}`, for each key that exists. Lines are
+// parsed as soon as they arrive, so only the line being received is ever buffered.
+struct BulkGet {
+  kj::String type;
+  jsg::JsRef<jsg::JsMap> results;
+
+  // Keys sent in the request. Anything else in the response is ignored, so that a misbehaving
+  // service can't add entries to the Map, or values to the cache, that weren't asked for.
+  kj::HashSet<kj::String> requested;
+
+  // Keys this read is responsible for filling in the cache.
+  kj::HashMap<kj::String, kj::Own<KvCache::Fill>> fills;
+  kj::Duration ttl;
+
+  kj::Own<ReadableStreamSource> stream;
+  kj::Array<byte> chunk = kj::heapArray<byte>(kBulkGetChunkSize);
+  kj::Vector<char> line;
+  uint64_t bytesRead = 0;
+
+  void handleLine(jsg::Lock& js, kj::ArrayPtr<const char> text) {
+    if (text.size() > 0 && text.back() == '\r') text = text.slice(0, text.size() - 1);
+    if (text.size() == 0) return;
+
+    auto record = JSG_REQUIRE_NONNULL(jsg::JsValue::fromJson(js, text).tryCast<jsg::JsObject>(),
+        Error, "KV GET failed: malformed bulk response.");
+    auto key = record.get(js, "key"_kjc).toString(js);
+    auto valueStr = JSG_REQUIRE_NONNULL(record.get(js, "value"_kjc).tryCast<jsg::JsString>(),
+        Error, "KV GET failed: malformed bulk response.");
+    if (!requested.contains(key)) return;
+
+    KJ_IF_SOME(fill, fills.find(key)) {
+      auto value = kj::atomicRefcounted<KvCache::Value>();
+      value->bytes = kj::heapArray<const kj::byte>(valueStr.toString(js).asBytes());
+      auto metadata = record.get(js, "metadata"_kjc);
+      if (!metadata.isUndefined()) {
+        value->metadata = metadata.toJson(js);
+      }
+      fill->complete(kj::mv(value), ttl);
+      fills.erase(key);
+    }
+
+    if (type == "json") {
+      results.getHandle(js).set(js, key, jsg::JsValue::fromJson(js, valueStr));
+    } else {
+      results.getHandle(js).set(js, key, valueStr);
+    }
+  }
+
+  void handleChunk(jsg::Lock& js, kj::ArrayPtr<const char> data) {
+    size_t start = 0;
+    for (auto i: kj::indices(data)) {
+      if (data[i] == '\n') {
+        if (line.size() == 0) {
+          handleLine(js, data.slice(start, i));
+        } else {
+          line.addAll(data.slice(start, i));
+          handleLine(js, line.asPtr());
+          line.clear();
+        }
+        start = i + 1;
+      }
+    }
+    line.addAll(data.slice(start, data.size()));
+  }
+
+  void finish(jsg::Lock& js) {
+    handleLine(js, line.asPtr());
+    line.clear();
+
+    // Whatever wasn't in the response doesn't exist.
+    for (auto& fill: fills) {
+      fill.value->complete(kj::atomicRefcounted<KvCache::Value>(), ttl);
+    }
+    fills.clear();
+  }
+};
+
+jsg::Promise<KvNamespace::GetResult> readBulkGet(jsg::Lock& js, kj::Own<BulkGet> state) {
   auto& context = IoContext::current();
+  auto& stream = *state->stream;
+  auto chunk = state->chunk.asPtr();
+  return context.awaitIo(js, stream.tryRead(chunk.begin(), 1, chunk.size()),
+      [state = kj::mv(state)](jsg::Lock& js, size_t amount) mutable
+      -> jsg::Promise<KvNamespace::GetResult> {
+    if (amount == 0) {
+      state->finish(js);
+      return js.resolvedPromise(KvNamespace::GetResult(
+          jsg::JsRef<jsg::JsValue>(js, state->results.getHandle(js))));
+    }
 
-  kj::Url url;
-  url.scheme = kj::str("https");
-  url.host = kj::str("fake-host");
-  url.path.add(kj::mv(name));
-  url.query.add(kj::Url::QueryParam { kj::str("urlencoded"), kj::str("true") });
+    state->bytesRead += amount;
+    auto limit = IoContext::current().getLimitEnforcer().getBufferingLimit();
+    JSG_REQUIRE(state->bytesRead <= limit, RangeError,
+        "KV GET failed: bulk response exceeded ", limit, " bytes.");
+
+    state->handleChunk(js, state->chunk.slice(0, amount).asChars());
+    return readBulkGet(js, kj::mv(state));
+  });
+}
+
+}  // namespace
+
+jsg::Promise<KvNamespace::GetResult> KvNamespace::getBulk(
+    jsg::Lock& js, kj::Array<kj::String> names, kj::String type, jsg::Optional<int> cacheTtl) {
+  JSG_REQUIRE(names.size() > 0, TypeError, "KV GET requires at least one key.");
+  JSG_REQUIRE(names.size() <= kMaxBulkGetKeys, RangeError, "KV GET failed: ", names.size(),
+      " keys exceeds the limit of ", kMaxBulkGetKeys, " keys per request.");
+  JSG_REQUIRE(type == "text" || type == "json", TypeError,
+      "Unknown response type. Possible types for a bulk get are \"text\" and \"json\".");
+  for (auto& name: names) {
+    validateKeyName("GET", name);
+  }
+
+  auto& context = IoContext::current();
+  auto ttl = getCacheTtl(cacheTtl);
+
+  // The Map is filled in the order the keys were given, starting with null for each.
+  auto results = js.map();
+  kj::Vector<jsg::JsValue> toFetch;
+  kj::HashSet<kj::String> requested;
+  kj::HashMap<kj::String, kj::Own<KvCache::Fill>> fills;
+  kj::HashSet<kj::StringPtr> seen;
+  for (auto& name: names) {
+    if (seen.contains(name)) continue;
+    seen.insert(name);
+
+    bool cached = false;
+    KJ_IF_SOME(c, cache) {
+      auto lookup = c->lookup(name);
+      KJ_SWITCH_ONEOF(lookup) {
+        KJ_CASE_ONEOF(value, kj::Own<const KvCache::Value>) {
+          results.set(js, name, cachedValueToJs(js, type, *value));
+          cached = true;
+        }
+        KJ_CASE_ONEOF(fill, kj::Own<KvCache::Fill>) {
+          fills.insert(kj::str(name), kj::mv(fill));
+        }
+        KJ_CASE_ONEOF(waiting, KvCache::Waiting) {
+          // Another read is fetching this key. Rather than wait for it and then possibly send a
+          // request of our own, just fetch it along with the others.
+        }
+      }
+    }
+
+    if (!cached) {
+      results.set(js, name, js.null());
+      toFetch.add(js.str(name));
+      requested.insert(kj::str(name));
+    }
+  }
+
+  if (toFetch.size() == 0) {
+    return js.resolvedPromise(GetResult(jsg::JsRef<jsg::JsValue>(js, results)));
+  }
+
+  auto request = js.obj();
+  request.set(js, "keys"_kjc, js.arr(toFetch.asPtr()));
+  KJ_IF_SOME(t, cacheTtl) {
+    request.set(js, "cacheTtl"_kjc, js.num(t));
+  }
+  auto body = jsg::JsValue(request).toJsonBytes(js);
+
+  auto urlStr = kj::str("https://fake-host/bulk/get?urlencoded=true");
+  auto headers = kj::HttpHeaders(context.getHeaderTable());
+  auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET, urlStr);
+  headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
+
+  auto req = client->request(kj::HttpMethod::POST, urlStr, headers, uint64_t(body.size()));
+  auto promise = req.body->write(body.begin(), body.size())
+      .attach(kj::mv(body), kj::mv(req.body))
+      .then([response = kj::mv(req.response)]() mutable { return kj::mv(response); });
+
+  auto state = kj::heap<BulkGet>(BulkGet {
+    .type = kj::mv(type),
+    .results = jsg::JsRef(js, results),
+    .requested = kj::mv(requested),
+    .fills = kj::mv(fills),
+    .ttl = ttl,
+  });
+
+  return context.awaitIo(js, kj::mv(promise),
+      [state = kj::mv(state), client = kj::mv(client)]
+      (jsg::Lock& js, kj::HttpClient::Response&& response) mutable {
+    checkForErrorStatus("GET", response);
+
+    auto& context = IoContext::current();
+    state->stream = newSystemStream(
+        response.body.attach(kj::mv(client)), getContentEncoding(context, *response.headers,
+            Response::BodyEncoding::AUTO, FeatureFlags::get(js)));
+    return readBulkGet(js, kj::mv(state));
+  });
+}
+
+jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
+    jsg::Lock& js, kj::String name, jsg::Optional<kj::OneOf<kj::String, GetOptions>> options) {
+  validateKeyName("GET", name);
 
   kj::Maybe<kj::String> type;
+  jsg::Optional<int> cacheTtl;
   KJ_IF_SOME(oneOfOptions, options) {
     KJ_SWITCH_ONEOF(oneOfOptions) {
       KJ_CASE_ONEOF(t, kj::String) {
@@ -136,14 +511,23 @@ jsg::Promise<KvNamespace::GetWithMetadataResult> KvNamespace::getWithMetadata(
         KJ_IF_SOME(t, options.type) {
           type = kj::mv(t);
         }
-        KJ_IF_SOME(cacheTtl, options.cacheTtl) {
-          url.query.add(kj::Url::QueryParam { kj::str("cache_ttl"), kj::str(cacheTtl) });
-        }
+        cacheTtl = options.cacheTtl;
+      }
+    }
+  }
+
+  KJ_IF_SOME(c, cache) {
+    KJ_IF_SOME(t, type) {
+      if (t != "stream") {
+        return getThroughCache(js, *c, kj::mv(name), kj::mv(t), cacheTtl);
       }
+    } else {
+      return getThroughCache(js, *c, kj::mv(name), kj::str("text"), cacheTtl);
     }
   }
 
-  auto urlStr = url.toString(kj::Url::Context::HTTP_PROXY_REQUEST);
+  auto& context = IoContext::current();
+  auto urlStr = getUrl(name, cacheTtl);
 
   auto headers = kj::HttpHeaders(context.getHeaderTable());
   auto client = getHttpClient(context, headers, LimitEnforcer::KvOpType::GET, urlStr);
@@ -316,7 +700,7 @@ jsg::Promise<void> KvNamespace::put(
     kj::Url url;
     url.scheme = kj::str("https");
     url.host = kj::str("fake-host");
-    url.path.add(kj::mv(name));
+    url.path.add(kj::str(name));
     url.query.add(kj::Url::QueryParam { kj::str("urlencoded"), kj::str("true") });
 
     kj::HttpHeaders headers(context.getHeaderTable());
@@ -417,6 +801,7 @@ jsg::Promise<void> KvNamespace::put(
         });
       });
     });
+    promise = invalidateAround(name, kj::mv(promise));
 
     return context.awaitIo(js, kj::mv(promise));
   });
@@ -442,6 +827,7 @@ jsg::Promise<void> KvNamespace::delete_(jsg::Lock& js, kj::String name) {
         checkForErrorStatus("DELETE", response);
       }).attach(kj::mv(client));
     });
+    promise = invalidateAround(name, kj::mv(promise));
 
     return context.awaitIo(js, kj::mv(promise));
   });
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <workerd/jsg/jsg.h>
+#include "kv-cache.h"
 #include "streams.h"
 #include <workerd/io/limit-enforcer.h>
 
@@ -30,6 +31,13 @@ public:
   explicit KvNamespace(kj::Array<AdditionalHeader> additionalHeaders, uint subrequestChannel)
       : additionalHeaders(kj::mv(additionalHeaders)), subrequestChannel(subrequestChannel) {}
 
+  // Serves reads other than `type: "stream"` through `cache`. `defaultCacheTtl` is how long to
+  // cache values read without a `cacheTtl` option.
+  void setCache(kj::Own<const KvCache> cache, kj::Duration defaultCacheTtl) {
+    this->cache = kj::mv(cache);
+    this->defaultCacheTtl = defaultCacheTtl;
+  }
+
   struct GetOptions {
     jsg::Optional<kj::String> type;
     jsg::Optional<int> cacheTtl;
@@ -46,12 +54,21 @@ public:
                 kj::String,
                 jsg::JsRef<jsg::JsValue>>>;
 
+  // Given an array of keys, reads them all with a single request, and resolves to a Map from each
+  // key to its value, or null if the key doesn't exist. Only exposed with the `kv_bulk_get`
+  // compatibility flag.
   jsg::Promise<GetResult> get(
       jsg::Lock& js,
-      kj::String name,
+      kj::OneOf<kj::Array<kj::String>, kj::String> name,
       jsg::Optional<kj::OneOf<kj::String, GetOptions>> options,
       CompatibilityFlags::Reader flags);
 
+  // get() as exposed without the `kv_bulk_get` compatibility flag, coercing any key to a string.
+  jsg::Promise<GetResult> getSingle(
+      jsg::Lock& js,
+      kj::String name,
+      jsg::Optional<kj::OneOf<kj::String, GetOptions>> options);
+
   struct GetWithMetadataResult {
     GetResult value;
     kj::Maybe<jsg::JsRef<jsg::JsValue>> metadata;
@@ -109,8 +126,12 @@ public:
 
   jsg::Promise<void> delete_(jsg::Lock& js, kj::String name);
 
-  JSG_RESOURCE_TYPE(KvNamespace) {
-    JSG_METHOD(get);
+  JSG_RESOURCE_TYPE(KvNamespace, CompatibilityFlags::Reader flags) {
+    if (flags.getKvBulkGet()) {
+      JSG_METHOD(get);
+    } else {
+      JSG_METHOD_NAMED(get, getSingle);
+    }
     JSG_METHOD(list);
     JSG_METHOD(put);
     JSG_METHOD(getWithMetadata);
@@ -141,6 +162,11 @@ public:
       get<ExpectedValue = unknown>(key: Key, options?: KVNamespaceGetOptions<"json">): Promise<ExpectedValue | null>;
       get(key: Key, options?: KVNamespaceGetOptions<"arrayBuffer">): Promise<ArrayBuffer | null>;
       get(key: Key, options?: KVNamespaceGetOptions<"stream">): Promise<ReadableStream | null>;
+      get(keys: Key[], type?: "text"): Promise<Map<string, string | null>>;
+      get<ExpectedValue = unknown>(keys: Key[], type: "json"): Promise<Map<string, ExpectedValue | null>>;
+      get(keys: Key[], options?: Partial<KVNamespaceGetOptions<undefined>>): Promise<Map<string, string | null>>;
+      get(keys: Key[], options?: KVNamespaceGetOptions<"text">): Promise<Map<string, string | null>>;
+      get<ExpectedValue = unknown>(keys: Key[], options?: KVNamespaceGetOptions<"json">): Promise<Map<string, ExpectedValue | null>>;
 
       list<Metadata = unknown>(options?: KVNamespaceListOptions): Promise<KVNamespaceListResult<Metadata, Key>>;
 
@@ -180,6 +206,22 @@ protected:
 private:
   kj::Array<AdditionalHeader> additionalHeaders;
   uint subrequestChannel;
+  kj::Maybe<kj::Own<const KvCache>> cache;
+  kj::Duration defaultCacheTtl = 0 * kj::SECONDS;
+
+  jsg::Promise<GetResult> getBulk(
+      jsg::Lock& js, kj::Array<kj::String> names, kj::String type, jsg::Optional<int> cacheTtl);
+
+  // How long to cache a value read with the given `cacheTtl` option.
+  kj::Duration getCacheTtl(jsg::Optional<int> cacheTtl);
+
+  jsg::Promise<GetWithMetadataResult> getThroughCache(
+      jsg::Lock& js, const KvCache& cache, kj::String name, kj::String type,
+      jsg::Optional<int> cacheTtl);
+
+  // Forgets `name` in the cache, if any, both now and once `write` completes, so that a read
+  // which overlaps the write can't leave the old value cached.
+  kj::Promise<void> invalidateAround(kj::StringPtr name, kj::Promise<void> write);
 };
 
 #define EW_KV_ISOLATE_TYPES                 \
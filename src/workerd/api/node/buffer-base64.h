@@ -24,6 +24,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
+#include <workerd/util/base64.h>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -32,8 +33,9 @@
 namespace workerd::api::node {
 
 // This is Node.js base64 implementation. We use this instead of kj's for Node.js buffer
-// so that decoding matches the Node.js semantics.
-// TODO(later): Reconcile this with kj so we don't have to duplicate.
+// so that decoding matches the Node.js semantics. The bulk of the input is handed to the
+// vectorized decoder in workerd/util/base64.h; only whitespace, padding and invalid characters
+// go through the code below.
 
 enum class Base64Mode {
   NORMAL,
@@ -133,6 +135,16 @@ size_t base64_decode_fast(char* const dst, const size_t dstlen,
   size_t max_i = srclen / 4 * 4;
   size_t i = 0;
   size_t k = 0;
+  if constexpr (sizeof(TypeName) == 1) {
+    // Decode the leading run of plain groups in bulk. This stops exactly where the loop below
+    // would first take the slow path or run out of room.
+    auto prefix = decodeBase64Prefix(
+        kj::arrayPtr(reinterpret_cast<const char*>(src), max_i),
+        kj::arrayPtr(reinterpret_cast<kj::byte*>(dst), max_k),
+        /* acceptUrlAlphabet = */ true);
+    i = prefix.consumed;
+    k = prefix.written;
+  }
   while (i < max_i && k < max_k) {
     const unsigned char txt[] = {
         static_cast<unsigned char>(unbase64(static_cast<uint8_t>(src[i + 0]))),
@@ -565,5 +565,38 @@ KJ_TEST("Buffer.prototype.indexOf/lastIndexOf") {
 
 
 }  // namespace
+KJ_TEST("Buffer.compare() and Buffer.equals() in a hot loop") {
+  capnp::MallocMessageBuilder message;
+  auto flags = message.initRoot<CompatibilityFlags>();
+  flags.setNodeJsCompat(true);
+  flags.setWorkerdExperimental(true);
+
+  // Enough calls for the loop to be optimized, at which point compareAll() is called through the
+  // V8 Fast API.
+  TestFixture fixture({
+    .featureFlags = flags.asReader(),
+    .mainModuleSource = R"SCRIPT(
+      import { Buffer } from 'node:buffer';
+
+      export default {
+        fetch(request) {
+          const a = Buffer.from("abc");
+          const b = Buffer.from("abd");
+          let result = 0;
+          for (let i = 0; i < 100000; i++) {
+            result += Buffer.compare(a, b) + Buffer.compare(b, a.subarray(0, 2));
+            if (!a.equals(Buffer.from("abc")) || a.equals(b)) throw new Error("wrong");
+          }
+          return new Response(String(result));
+        },
+      };
+    )SCRIPT"_kj});
+
+  auto response = fixture.runRequest(kj::HttpMethod::POST, "http://www.example.com"_kj, ""_kj);
+
+  KJ_EXPECT(response.statusCode == 200);
+  KJ_EXPECT(response.body == "0");
+}
+
 }  // namespace workerd::api
 
@@ -7,7 +7,7 @@
 #include "buffer-base64.h"
 #include "buffer-string-search.h"
 #include <workerd/jsg/buffersource.h>
-#include <kj/encoding.h>
+#include <workerd/util/base64.h>
 #include <algorithm>
 
 // These are defined by <sys/byteorder.h> or <netinet/in.h> on some systems.
@@ -114,17 +114,6 @@ Encoding getEncoding(kj::StringPtr encoding) {
   KJ_UNREACHABLE;
 }
 
-kj::Maybe<uint> tryFromHexDigit(char c) {
-  if ('0' <= c && c <= '9') {
-    return c - '0';
-  } else if ('a' <= c && c <= 'f') {
-    return c - ('a' - 10);
-  } else if ('A' <= c && c <= 'F') {
-    return c - ('A' - 10);
-  }
-  return kj::none;
-}
-
 kj::Array<byte> decodeHexTruncated(kj::ArrayPtr<kj::byte> text, bool strict = false) {
   // We do not use kj::decodeHex because we need to match Node.js'
   // behavior of truncating the response at the first invalid hex
@@ -136,30 +125,15 @@ kj::Array<byte> decodeHexTruncated(kj::ArrayPtr<kj::byte> text, bool strict = fa
     }
     text = text.slice(0, text.size() - 1);
   }
-  kj::Vector vec = kj::Vector<kj::byte>(text.size() / 2);
-
-  for (size_t i = 0; i < text.size(); i += 2) {
-    byte b = 0;
-    KJ_IF_SOME(d1, tryFromHexDigit(text[i])) {
-      b = d1 << 4;
-    } else {
-      if (strict) {
-        JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
-      }
-      break;
-    }
-    KJ_IF_SOME(d2, tryFromHexDigit(text[i+1])) {
-      b |= d2;
-    } else {
-      if (strict) {
-        JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
-      }
-      break;
+  auto dest = kj::heapArray<kj::byte>(text.size() / 2);
+  auto result = decodeHexPrefix(text.asChars(), dest);
+  if (result.written < dest.size()) {
+    if (strict) {
+      JSG_FAIL_REQUIRE(TypeError, "The text is not valid hex");
     }
-    vec.add(b);
+    return dest.slice(0, result.written).attach(kj::mv(dest));
   }
-
-  return vec.releaseAsArray();
+  return kj::mv(dest);
 }
 
 uint32_t writeInto(
@@ -280,6 +254,23 @@ uint32_t BufferUtil::byteLength(jsg::Lock& js, jsg::JsString str) {
   return str.utf8Length(js);
 }
 
+namespace {
+int compareBytes(kj::ArrayPtr<kj::byte> one, kj::ArrayPtr<kj::byte> two) {
+  size_t toCompare = kj::min(one.size(), two.size());
+  auto result = toCompare > 0 ? memcmp(one.begin(), two.begin(), toCompare) : 0;
+
+  if (result == 0) {
+    if (one.size() > two.size())
+      return 1;
+    else if (one.size() < two.size())
+      return -1;
+    else return 0;
+  }
+
+  return result > 0 ? 1 : -1;
+}
+}  // namespace
+
 int BufferUtil::compare(
     jsg::Lock& js,
     kj::Array<kj::byte> one,
@@ -298,18 +289,11 @@ int BufferUtil::compare(
     ptrTwo = ptrTwo.slice(start, end);
   }
 
-  size_t toCompare = kj::min(ptrOne.size(), ptrTwo.size());
-  auto result = toCompare > 0 ? memcmp(ptrOne.begin(), ptrTwo.begin(), toCompare) : 0;
-
-  if (result == 0) {
-    if (ptrOne.size() > ptrTwo.size())
-      return 1;
-    else if (ptrOne.size() < ptrTwo.size())
-      return -1;
-    else return 0;
-  }
+  return compareBytes(ptrOne, ptrTwo);
+}
 
-  return result > 0 ? 1 : -1;
+int BufferUtil::compareAll(kj::Array<kj::byte> one, kj::Array<kj::byte> two) {
+  return compareBytes(one, two);
 }
 
 kj::Array<kj::byte> BufferUtil::concat(
@@ -548,13 +532,13 @@ jsg::JsString toStringImpl(
       return js.str(data);
     }
     case Encoding::BASE64: {
-      return js.str(kj::encodeBase64(slice));
+      return js.str(fastEncodeBase64(slice));
     }
     case Encoding::BASE64URL: {
-      return js.str(kj::encodeBase64Url(slice));
+      return js.str(fastEncodeBase64(slice, Base64Alphabet::URL));
     }
     case Encoding::HEX: {
-      return js.str(kj::encodeHex(slice));
+      return js.str(fastEncodeHex(slice));
     }
   }
   KJ_UNREACHABLE;
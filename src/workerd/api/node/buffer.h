@@ -27,6 +27,10 @@ public:
               kj::Array<kj::byte> two,
               jsg::Optional<CompareOptions> maybeOptions);
 
+  // compare() of the whole of both arrays, which is what Buffer.compare() and Buffer.equals()
+  // need. It's separate so that it can be a fast method.
+  int compareAll(kj::Array<kj::byte> one, kj::Array<kj::byte> two);
+
   kj::Array<kj::byte> concat(jsg::Lock& js,
                              kj::Array<kj::Array<kj::byte>> list,
                              uint32_t length);
@@ -81,6 +85,7 @@ public:
   JSG_RESOURCE_TYPE(BufferUtil) {
     JSG_METHOD(byteLength);
     JSG_METHOD(compare);
+    JSG_FAST_METHOD(compareAll);
     JSG_METHOD(concat);
     JSG_METHOD(decodeString);
     JSG_METHOD(fillImpl);
@@ -1040,7 +1040,7 @@ jsg::Promise<kj::String> R2Bucket::GetResult::text(jsg::Lock& js) {
 jsg::Promise<jsg::Value> R2Bucket::GetResult::json(jsg::Lock& js) {
   // Copy-pasted from http.c++
   return text(js).then(js, [](jsg::Lock& js, kj::String text) {
-    return js.parseJson(text);
+    return js.parseJson(kj::mv(text));
   });
 }
 
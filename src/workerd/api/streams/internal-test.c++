@@ -256,5 +256,252 @@ KJ_TEST("WritableStreamInternalController queue size assertion") {
   });
 }
 
+KJ_TEST("IdentityTransformStreamImpl read with minBytes collects multiple writes") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto stream = kj::refcounted<IdentityTransformStreamImpl>();
+
+  kj::byte buffer[10];
+  auto read = stream->tryRead(buffer, 6, sizeof(buffer));
+
+  // Each write is consumed immediately, but the read isn't satisfied until it has 6 bytes.
+  stream->write("abc", 3).wait(waitScope);
+  KJ_EXPECT(!read.poll(waitScope));
+  stream->write("defgh", 5).wait(waitScope);
+  KJ_EXPECT(read.wait(waitScope) == 8);
+  KJ_EXPECT(kj::heapString(kj::arrayPtr(buffer, 8).asChars()) == "abcdefgh");
+
+  // A write that doesn't fit is split across reads, and the writer waits for the remainder.
+  auto write = stream->write("0123456789xy", 12);
+  KJ_EXPECT(stream->tryRead(buffer, 10, sizeof(buffer)).wait(waitScope) == 10);
+  KJ_EXPECT(!write.poll(waitScope));
+  KJ_EXPECT(stream->tryRead(buffer, 1, sizeof(buffer)).wait(waitScope) == 2);
+  write.wait(waitScope);
+  KJ_EXPECT(kj::heapString(kj::arrayPtr(buffer, 2).asChars()) == "xy");
+
+  // At EOF a read gets whatever was collected, even if it's less than minBytes.
+  read = stream->tryRead(buffer, 6, sizeof(buffer));
+  stream->write("ab", 2).wait(waitScope);
+  stream->end().wait(waitScope);
+  KJ_EXPECT(read.wait(waitScope) == 2);
+  KJ_EXPECT(stream->tryRead(buffer, 1, sizeof(buffer)).wait(waitScope) == 0);
+}
+
+KJ_TEST("IdentityTransformStreamImpl pumpTo forwards writes to the output") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  class RecordingSink final: public WritableStreamSink {
+  public:
+    kj::Vector<kj::ArrayPtr<const kj::byte>> writes;
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> pendingWrite;
+    bool ended = false;
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      // Record the caller's buffer itself, to verify that nothing was copied on the way.
+      writes.add(kj::arrayPtr(static_cast<const kj::byte*>(buffer), size));
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pendingWrite = kj::mv(paf.fulfiller);
+      return kj::mv(paf.promise);
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> end() override {
+      ended = true;
+      return kj::READY_NOW;
+    }
+    void abort(kj::Exception reason) override {}
+  };
+
+  auto stream = kj::refcounted<IdentityTransformStreamImpl>();
+  RecordingSink sink;
+
+  auto pump = stream->pumpTo(sink, true);
+  KJ_EXPECT(!pump.poll(waitScope));
+
+  kj::StringPtr data = "hello";
+  auto write = stream->write(data.begin(), data.size());
+
+  // The writer sees the output's backpressure.
+  KJ_EXPECT(!write.poll(waitScope));
+  KJ_ASSERT(sink.writes.size() == 1);
+  KJ_EXPECT(sink.writes[0].begin() == data.asBytes().begin());
+  KJ_ASSERT_NONNULL(sink.pendingWrite)->fulfill();
+  write.wait(waitScope);
+
+  stream->end().wait(waitScope);
+  pump.wait(waitScope).proxyTask.wait(waitScope);
+  KJ_EXPECT(sink.ended);
+}
+
+KJ_TEST("IdentityTransformStreamImpl canceling pumpTo cancels the write in progress") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  class HangingSink final: public WritableStreamSink {
+  public:
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> pendingWrite;
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pendingWrite = kj::mv(paf.fulfiller);
+      return kj::mv(paf.promise);
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  auto stream = kj::refcounted<IdentityTransformStreamImpl>();
+  auto sink = kj::heap<HangingSink>();
+
+  auto pump = stream->pumpTo(*sink, true);
+  auto write = stream->write("hello", 5);
+  KJ_EXPECT(!write.poll(waitScope));
+  auto& outputWrite = *KJ_ASSERT_NONNULL(sink->pendingWrite);
+  KJ_EXPECT(outputWrite.isWaiting());
+
+  // Dropping the pump cancels its write to the output, which can then be destroyed safely, and the
+  // writer is told that the reader went away.
+  pump = nullptr;
+  KJ_EXPECT(!outputWrite.isWaiting());
+  sink = nullptr;
+  KJ_EXPECT_THROW_MESSAGE("reader canceled", write.wait(waitScope));
+  KJ_EXPECT_THROW_MESSAGE("reader canceled", stream->write("again", 5).wait(waitScope));
+}
+
+KJ_TEST("IdentityTransformStreamImpl pumpTo enforces FixedLengthStream limits") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  class NullSink final: public WritableStreamSink {
+  public:
+    kj::Promise<void> write(const void* buffer, size_t size) override { return kj::READY_NOW; }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      return kj::READY_NOW;
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  auto stream = kj::refcounted<IdentityTransformStreamImpl>(uint64_t(4));
+  NullSink sink;
+
+  auto pump = stream->pumpTo(sink, true);
+  stream->write("abc", 3).wait(waitScope);
+  KJ_EXPECT_THROW_MESSAGE("Attempt to write too many bytes through a FixedLengthStream.",
+      stream->write("de", 2).wait(waitScope));
+  KJ_EXPECT_THROW_MESSAGE("Attempt to write too many bytes through a FixedLengthStream.",
+      pump.wait(waitScope));
+}
+
+KJ_TEST("CoalescingWritableStreamSink coalesces small writes") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  class RecordingSink final: public WritableStreamSink {
+  public:
+    kj::Vector<kj::String> writes;
+    bool ended = false;
+
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      writes.add(kj::heapString(static_cast<const char*>(buffer), size));
+      return kj::READY_NOW;
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> end() override {
+      ended = true;
+      return kj::READY_NOW;
+    }
+    void abort(kj::Exception reason) override {}
+  };
+
+  class FakeClock final: public kj::MonotonicClock {
+  public:
+    kj::TimePoint time = kj::origin<kj::TimePoint>();
+    kj::TimePoint now() const override { return time; }
+  };
+
+  auto inner = kj::heap<RecordingSink>();
+  auto& recorded = *inner;
+  FakeClock clock;
+  CoalescingWritableStreamSink sink(kj::mv(inner),
+      { .maxBytes = 8, .maxDelay = 10 * kj::MILLISECONDS }, clock);
+
+  // Small writes complete immediately and are held back while the producer is busy...
+  KJ_EXPECT(sink.write("ab", 2).poll(waitScope));
+  KJ_EXPECT(sink.write("cd", 2).poll(waitScope));
+  KJ_EXPECT(recorded.writes.size() == 0);
+
+  // ...and are flushed together once the event loop is idle.
+  waitScope.poll();
+  KJ_ASSERT(recorded.writes.size() == 1);
+  KJ_EXPECT(recorded.writes[0] == "abcd");
+
+  // Reaching the byte threshold flushes right away.
+  sink.write("efgh", 4).wait(waitScope);
+  sink.write("ijkl", 4).wait(waitScope);
+  KJ_ASSERT(recorded.writes.size() == 2);
+  KJ_EXPECT(recorded.writes[1] == "efghijkl");
+
+  // A write that doesn't fit pushes out what came before it.
+  sink.write("mnopqr", 6).wait(waitScope);
+  sink.write("stu", 3).wait(waitScope);
+  KJ_ASSERT(recorded.writes.size() == 3);
+  KJ_EXPECT(recorded.writes[2] == "mnopqr");
+
+  // Bytes that have waited too long are flushed by the next write.
+  clock.time += 10 * kj::MILLISECONDS;
+  sink.write("v", 1).wait(waitScope);
+  KJ_ASSERT(recorded.writes.size() == 4);
+  KJ_EXPECT(recorded.writes[3] == "stuv");
+
+  // A large write passes straight through, after what was buffered before it.
+  sink.write("w", 1).wait(waitScope);
+  sink.write("xyz0123456789", 13).wait(waitScope);
+  KJ_ASSERT(recorded.writes.size() == 6);
+  KJ_EXPECT(recorded.writes[4] == "w");
+  KJ_EXPECT(recorded.writes[5] == "xyz0123456789");
+
+  // end() flushes before ending the inner sink.
+  sink.write("!", 1).wait(waitScope);
+  sink.end().wait(waitScope);
+  KJ_ASSERT(recorded.writes.size() == 7);
+  KJ_EXPECT(recorded.writes[6] == "!");
+  KJ_EXPECT(recorded.ended);
+}
+
+KJ_TEST("CoalescingWritableStreamSink reports errors from buffered writes") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  class FailingSink final: public WritableStreamSink {
+  public:
+    kj::Promise<void> write(const void* buffer, size_t size) override {
+      return KJ_EXCEPTION(DISCONNECTED, "peer went away");
+    }
+    kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+      KJ_UNIMPLEMENTED("not used");
+    }
+    kj::Promise<void> end() override { return kj::READY_NOW; }
+    void abort(kj::Exception reason) override {}
+  };
+
+  CoalescingWritableStreamSink sink(kj::heap<FailingSink>(), { .maxBytes = 8 });
+
+  // The write itself succeeds since it's only buffered; the idle flush then fails...
+  sink.write("abc", 3).wait(waitScope);
+  waitScope.poll();
+
+  // ...which is reported by end().
+  KJ_EXPECT_THROW_MESSAGE("peer went away", sink.end().wait(waitScope));
+}
+
 }  // namespace
 }  // namespace workerd::api
@@ -8,6 +8,7 @@
 #include <workerd/jsg/jsg.h>
 #include <kj/vector.h>
 #include <workerd/api/util.h>
+#include <workerd/util/shared-tee.h>
 #include <workerd/util/string-buffer.h>
 
 namespace workerd::api {
@@ -245,7 +246,7 @@ kj::Exception reasonToException(
 
 // =======================================================================================
 
-// Adapt ReadableStreamSource to kj::AsyncInputStream's interface for use with `kj::newTee()`.
+// Adapt ReadableStreamSource to kj::AsyncInputStream's interface for use with `newSharedTee()`.
 class TeeAdapter final: public kj::AsyncInputStream {
 public:
   explicit TeeAdapter(kj::Own<ReadableStreamSource> inner)
@@ -284,9 +285,9 @@ public:
     JSG_REQUIRE(kj::dynamicDowncastIfAvailable<IdentityTransformStreamImpl>(output) == kj::none,
         TypeError, "Inter-TransformStream ReadableStream.pipeTo() is not implemented.");
 
-    // It is important we actually call `inner->pumpTo()` so that `kj::newTee()` is aware of this
-    // pump operation's backpressure. So we can't use the default `ReadableStreamSource::pumpTo()`
-    // implementation, and have to implement our own.
+    // It is important we actually call `inner->pumpTo()` so that the tee is aware of this pump
+    // operation's backpressure, and can write straight out of its shared buffers. So we can't use
+    // the default `ReadableStreamSource::pumpTo()` implementation, and have to implement our own.
 
     PumpAdapter outputAdapter(output);
     co_await inner->pumpTo(outputAdapter);
@@ -732,13 +733,15 @@ ReadableStreamController::Tee ReadableStreamInternalController::tee(jsg::Lock& j
             };
           };
 
-      auto bufferLimit = ioContext.getLimitEnforcer().getBufferingLimit();
-      KJ_IF_SOME(tee, readable->tryTee(bufferLimit)) {
+      auto& limitEnforcer = ioContext.getLimitEnforcer();
+      auto lagLimit = limitEnforcer.getTeeLagLimit();
+      KJ_IF_SOME(tee, readable->tryTee(lagLimit)) {
         // This ReadableStreamSource has an optimized tee implementation.
         return makeTee(kj::mv(tee.branches[0]), kj::mv(tee.branches[1]));
       }
 
-      auto tee = kj::newTee(kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
+      auto tee = newSharedTee(kj::heap<TeeAdapter>(kj::mv(readable)), lagLimit,
+                              limitEnforcer.getTeeLagPolicy());
 
       return makeTee(
           kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(tee.branches[0]))),
@@ -2105,44 +2108,17 @@ kj::Promise<size_t> IdentityTransformStreamImpl::tryRead(
     void* buffer,
     size_t minBytes,
     size_t maxBytes) {
-  size_t total = 0;
-  while (total < minBytes) {
-    // TODO(perf): tryReadInternal was written assuming minBytes would always be 1 but we've now
-    // introduced an API for user to specify a larger minBytes. For now, this is implemented as a
-    // naiive loop dispatching to the 1 byte version but would be better to bake it deeper into
-    // the implementation where it can be more efficient.
-    auto amount = co_await tryReadInternal(buffer, maxBytes);
-    KJ_ASSERT(amount <= maxBytes);
-    if (amount == 0) {
-      // EOF.
-      break;
-    }
-
-    total += amount;
-    buffer = reinterpret_cast<char*>(buffer) + amount;
-    maxBytes -= amount;
-  }
-
-  co_return total;
-}
+  if (maxBytes == 0) return size_t(0);
 
-kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, size_t maxBytes) {
-  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes));
+  auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes),
+                            kj::max(kj::min(minBytes, maxBytes), size_t(1)));
 
-  KJ_IF_SOME(l, limit) {
-    promise = promise.then([this, &l = l](size_t amount) -> kj::Promise<size_t> {
-      if (amount > l) {
-        auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
-            "Attempt to write too many bytes through a FixedLengthStream.");
-        cancel(exception);
-        return kj::mv(exception);
-      } else if (amount == 0 && l != 0) {
-        auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
-            "FixedLengthStream did not see all expected bytes before close().");
-        cancel(exception);
+  if (limit != kj::none) {
+    promise = promise.then([this](size_t amount) -> kj::Promise<size_t> {
+      KJ_IF_SOME(exception, consumeLimit(amount)) {
+        cancel(kj::cp(exception));
         return kj::mv(exception);
       }
-      l -= amount;
       return amount;
     });
   }
@@ -2150,6 +2126,20 @@ kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, s
   return promise;
 }
 
+kj::Maybe<kj::Exception> IdentityTransformStreamImpl::consumeLimit(size_t amount) {
+  KJ_IF_SOME(l, limit) {
+    if (amount > l) {
+      return JSG_KJ_EXCEPTION(FAILED, TypeError,
+          "Attempt to write too many bytes through a FixedLengthStream.");
+    } else if (amount == 0 && l != 0) {
+      return JSG_KJ_EXCEPTION(FAILED, TypeError,
+          "FixedLengthStream did not see all expected bytes before close().");
+    }
+    l -= amount;
+  }
+  return kj::none;
+}
+
 kj::Promise<DeferredProxy<void>> IdentityTransformStreamImpl::pumpTo(
     WritableStreamSink& output,
     bool end) {
@@ -2163,7 +2153,62 @@ kj::Promise<DeferredProxy<void>> IdentityTransformStreamImpl::pumpTo(
   JSG_REQUIRE(kj::dynamicDowncastIfAvailable<IdentityTransformStreamImpl>(output) == kj::none,
       TypeError, "Inter-TransformStream ReadableStream.pipeTo() is not implemented.");
 
-  return ReadableStreamSource::pumpTo(output, end);
+  // The writes we forward come from JavaScript, so the IoContext has to stay live for the
+  // duration of the pump anyway; there's nothing to gain from deferred proxying.
+  return addNoopDeferredProxy(pumpHelper(output, end));
+}
+
+kj::Promise<void> IdentityTransformStreamImpl::pumpHelper(WritableStreamSink& output, bool end) {
+  // Writes are forwarded to `output` from here rather than from write(), so that each one is part
+  // of the pump's promise. `output` belongs to whoever called pumpTo(), and canceling the pump has
+  // to cancel any write to it that is still in progress.
+  for (;;) {
+    if (state.is<Idle>()) {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      state = PumpRequest { kj::mv(paf.fulfiller) };
+      co_await paf.promise;
+    } else KJ_IF_SOME(request, state.tryGet<WriteRequest>()) {
+      auto bytes = request.bytes;
+      auto fulfiller = kj::mv(request.fulfiller);
+      state = Idle();
+
+      // If the pump is canceled while the write is in progress, fail the write the same way that a
+      // write to an already-canceled pump fails.
+      KJ_DEFER(if (fulfiller->isWaiting()) {
+        auto exception = KJ_EXCEPTION(DISCONNECTED, "reader canceled");
+        fulfiller->reject(kj::cp(exception));
+        if (state.is<Idle>()) state = kj::mv(exception);
+      });
+
+      KJ_IF_SOME(exception, consumeLimit(bytes.size())) {
+        fulfiller->reject(kj::cp(exception));
+        state = kj::cp(exception);
+        kj::throwFatalException(kj::mv(exception));
+      }
+
+      try {
+        co_await output.write(bytes.begin(), bytes.size());
+      } catch (...) {
+        auto exception = kj::getCaughtExceptionAsKj();
+        fulfiller->reject(kj::cp(exception));
+        state = kj::cp(exception);
+        kj::throwFatalException(kj::mv(exception));
+      }
+      fulfiller->fulfill();
+    } else if (state.is<StreamStates::Closed>()) {
+      break;
+    } else KJ_IF_SOME(exception, state.tryGet<kj::Exception>()) {
+      kj::throwFatalException(kj::cp(exception));
+    } else if (state.is<ReadRequest>()) {
+      KJ_FAIL_ASSERT("read operation already in flight");
+    } else {
+      KJ_FAIL_ASSERT("pump operation already in flight");
+    }
+  }
+
+  if (end) {
+    co_await output.end();
+  }
 }
 
 kj::Maybe<uint64_t> IdentityTransformStreamImpl::tryGetLength(StreamEncoding encoding) {
@@ -2180,11 +2225,15 @@ void IdentityTransformStreamImpl::cancel(kj::Exception reason) {
       // This is fine.
     }
     KJ_CASE_ONEOF(request, ReadRequest) {
-      request.fulfiller->fulfill(size_t(0));
+      // Deliver whatever was already collected; the next read will see the error.
+      request.fulfiller->fulfill(kj::cp(request.filled));
     }
     KJ_CASE_ONEOF(request, WriteRequest) {
       request.fulfiller->reject(kj::cp(reason));
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      request.fulfiller->reject(kj::cp(reason));
+    }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       // Already errored.
       return;
@@ -2232,6 +2281,9 @@ void IdentityTransformStreamImpl::abort(kj::Exception reason) {
     KJ_CASE_ONEOF(request, WriteRequest) {
       KJ_FAIL_ASSERT("abort() is supposed to wait for any pending write() to finish");
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      request.fulfiller->reject(kj::cp(reason));
+    }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       // Already errored.
       return;
@@ -2246,35 +2298,46 @@ void IdentityTransformStreamImpl::abort(kj::Exception reason) {
   // TODO(conform): Proactively put ReadableStream into Errored state.
 }
 
-kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byte> bytes) {
+kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(
+    kj::ArrayPtr<kj::byte> bytes, size_t minBytes) {
   KJ_SWITCH_ONEOF(state) {
     KJ_CASE_ONEOF(idle, Idle) {
       // No outstanding write request, switch to ReadRequest state.
 
       auto paf = kj::newPromiseAndFulfiller<size_t>();
-      state = ReadRequest { bytes, kj::mv(paf.fulfiller) };
+      state = ReadRequest { bytes, minBytes, 0, kj::mv(paf.fulfiller) };
       return kj::mv(paf.promise);
     }
     KJ_CASE_ONEOF(request, ReadRequest) {
       KJ_FAIL_ASSERT("read operation already in flight");
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      KJ_FAIL_ASSERT("pump operation already in flight");
+    }
     KJ_CASE_ONEOF(request, WriteRequest) {
-      if (bytes.size() >= request.bytes.size()) {
-        // The write buffer will entirely fit into our read buffer; fulfill both requests.
-        memcpy(bytes.begin(), request.bytes.begin(), request.bytes.size());
-        auto result = request.bytes.size();
-        request.fulfiller->fulfill();
+      if (bytes.size() < request.bytes.size()) {
+        // The write buffer won't quite fit into our read buffer; fulfill only the read request.
+        memcpy(bytes.begin(), request.bytes.begin(), bytes.size());
+        request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
+        return bytes.size();
+      }
 
-        // Switch to idle state.
-        state = Idle();
+      // The write buffer will entirely fit into our read buffer; fulfill the write request.
+      size_t filled = request.bytes.size();
+      memcpy(bytes.begin(), request.bytes.begin(), filled);
+      request.fulfiller->fulfill();
 
-        return result;
+      if (filled >= minBytes || filled == bytes.size()) {
+        // That was enough to satisfy the read, too.
+        state = Idle();
+        return filled;
       }
 
-      // The write buffer won't quite fit into our read buffer; fulfill only the read request.
-      memcpy(bytes.begin(), request.bytes.begin(), bytes.size());
-      request.bytes = request.bytes.slice(bytes.size(), request.bytes.size());
-      return bytes.size();
+      // Keep collecting subsequent writes into the rest of the read buffer.
+      auto paf = kj::newPromiseAndFulfiller<size_t>();
+      state = ReadRequest {
+        bytes.slice(filled, bytes.size()), minBytes, filled, kj::mv(paf.fulfiller) };
+      return kj::mv(paf.promise);
     }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       return kj::cp(exception);
@@ -2316,27 +2379,63 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
       }
 
       if (bytes.size() == 0) {
-        // This is a close operation.
-        request.fulfiller->fulfill(size_t(0));
+        // This is a close operation. The read gets whatever was collected so far.
+        request.fulfiller->fulfill(kj::cp(request.filled));
         state = StreamStates::Closed();
         return kj::READY_NOW;
       }
 
       KJ_ASSERT(request.bytes.size() > 0);
 
-      if (request.bytes.size() >= bytes.size()) {
-        // Our write buffer will entirely fit into the read buffer; fulfill both requests.
-        memcpy(request.bytes.begin(), bytes.begin(), bytes.size());
-        request.fulfiller->fulfill(bytes.size());
+      size_t amount = kj::min(request.bytes.size(), bytes.size());
+      memcpy(request.bytes.begin(), bytes.begin(), amount);
+      request.bytes = request.bytes.slice(amount, request.bytes.size());
+      request.filled += amount;
+      bytes = bytes.slice(amount, bytes.size());
+
+      if (request.filled < request.minBytes && request.bytes.size() > 0) {
+        // Our write buffer entirely fit into the read buffer, but the read wants more; fulfill
+        // only the write request.
+        KJ_ASSERT(bytes.size() == 0);
+        return kj::READY_NOW;
+      }
+
+      request.fulfiller->fulfill(kj::cp(request.filled));
+
+      if (bytes.size() == 0) {
+        // Our write buffer entirely fit into the read buffer; fulfilled both requests.
         state = Idle();
         return kj::READY_NOW;
       }
 
       // Our write buffer won't quite fit into the read buffer; fulfill only the read request.
-      memcpy(request.bytes.begin(), bytes.begin(), request.bytes.size());
-      bytes = bytes.slice(request.bytes.size(), bytes.size());
-      request.fulfiller->fulfill(request.bytes.size());
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      state = WriteRequest { bytes, kj::mv(paf.fulfiller) };
+      return kj::mv(paf.promise);
+    }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      if (!request.fulfiller->isWaiting()) {
+        // The pump was canceled; same as a canceled read above.
+        state = KJ_EXCEPTION(DISCONNECTED, "reader canceled");
+        return writeHelper(bytes);
+      }
+
+      if (bytes.size() == 0) {
+        // This is a close operation. pumpHelper() takes care of ending the output, if needed.
+        KJ_IF_SOME(exception, consumeLimit(0)) {
+          request.fulfiller->reject(kj::cp(exception));
+          state = kj::cp(exception);
+          return kj::mv(exception);
+        }
+        request.fulfiller->fulfill();
+        state = StreamStates::Closed();
+        return kj::READY_NOW;
+      }
 
+      // Hand the write to the pump, which forwards it to its output without copying. The writer
+      // doesn't get to write again until the output has accepted these bytes, which preserves
+      // backpressure.
+      request.fulfiller->fulfill();
       auto paf = kj::newPromiseAndFulfiller<void>();
       state = WriteRequest { bytes, kj::mv(paf.fulfiller) };
       return kj::mv(paf.promise);
@@ -2450,4 +2549,122 @@ void ReadableStreamInternalController::jsgGetMemoryInfo(jsg::MemoryTracker& trac
   }
 }
 
+// =======================================================================================
+
+CoalescingWritableStreamSink::CoalescingWritableStreamSink(
+    kj::Own<WritableStreamSink> inner,
+    WriteCoalescingOptions options,
+    const kj::MonotonicClock& clock)
+    : inner(kj::mv(inner)), options(options), clock(clock), tasks(*this) {
+  KJ_REQUIRE(options.maxBytes > 0, "write coalescing needs a non-zero byte threshold");
+}
+
+kj::Promise<void> CoalescingWritableStreamSink::write(const void* data, size_t size) {
+  if (size >= options.maxBytes) {
+    // Large enough on its own: write it directly, right after whatever is buffered.
+    return flush().then([this, data, size]() { return inner->write(data, size); });
+  }
+
+  kj::ArrayPtr<const kj::byte> piece(static_cast<const kj::byte*>(data), size);
+  return writeSmall(kj::arrayPtr(&piece, 1), size);
+}
+
+kj::Promise<void> CoalescingWritableStreamSink::write(
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
+  size_t size = 0;
+  for (auto& piece: pieces) size += piece.size();
+
+  if (size >= options.maxBytes) {
+    return flush().then([this, pieces]() { return inner->write(pieces); });
+  }
+
+  return writeSmall(pieces, size);
+}
+
+kj::Promise<void> CoalescingWritableStreamSink::writeSmall(
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces, size_t size) {
+  if (size == 0) return kj::READY_NOW;
+
+  // If this write doesn't fit, send what we have first. The writer waits for that before writing
+  // anything else, so at most one buffer's worth of data is ever in flight behind the buffer.
+  kj::Maybe<kj::Promise<void>> backpressure;
+  if (buffered + size > options.maxBytes) {
+    backpressure = flush();
+  }
+
+  if (buffered == 0) {
+    if (buffer.size() == 0) buffer = kj::heapArray<kj::byte>(options.maxBytes);
+    bufferStartTime = clock.now();
+  }
+  for (auto& piece: pieces) {
+    buffer.slice(buffered, buffered + piece.size()).copyFrom(piece);
+    buffered += piece.size();
+  }
+
+  if (buffered == options.maxBytes ||
+      clock.now() - KJ_ASSERT_NONNULL(bufferStartTime) >= options.maxDelay) {
+    // flush() chains after any earlier flush, so waiting on it covers `backpressure` too.
+    return flush();
+  }
+
+  scheduleIdleFlush();
+  KJ_IF_SOME(promise, backpressure) {
+    return kj::mv(promise);
+  }
+  return kj::READY_NOW;
+}
+
+kj::Promise<void> CoalescingWritableStreamSink::end() {
+  return flush().then([this]() { return inner->end(); });
+}
+
+void CoalescingWritableStreamSink::abort(kj::Exception reason) {
+  buffer = nullptr;
+  buffered = 0;
+  bufferStartTime = kj::none;
+  lastWrite = kj::none;
+  inner->abort(kj::mv(reason));
+}
+
+StreamEncoding CoalescingWritableStreamSink::disownEncodingResponsibility() {
+  return inner->disownEncodingResponsibility();
+}
+
+kj::Promise<void> CoalescingWritableStreamSink::flush() {
+  kj::Promise<void> previous = kj::READY_NOW;
+  KJ_IF_SOME(write, lastWrite) {
+    previous = write.addBranch();
+  }
+
+  if (buffered == 0) return kj::mv(previous);
+
+  auto bytes = kj::mv(buffer);
+  auto size = buffered;
+  buffered = 0;
+  bufferStartTime = kj::none;
+
+  auto promise = previous.then([this, bytes = kj::mv(bytes), size]() mutable {
+    auto ptr = bytes.begin();
+    return inner->write(ptr, size).attach(kj::mv(bytes));
+  });
+  return lastWrite.emplace(promise.fork()).addBranch();
+}
+
+void CoalescingWritableStreamSink::scheduleIdleFlush() {
+  if (idleFlushScheduled) return;
+  idleFlushScheduled = true;
+
+  // evalLast() runs once nothing else is queued on the event loop, i.e. once the producer has
+  // nothing more for us right now.
+  tasks.add(kj::evalLast([this]() -> kj::Promise<void> {
+    idleFlushScheduled = false;
+    return flush();
+  }));
+}
+
+void CoalescingWritableStreamSink::taskFailed(kj::Exception&& exception) {
+  // Nothing to do: every later flush() waits on the same failed write, so the error is reported
+  // to the writer by its next flushing write() or by end().
+}
+
 }  // namespace workerd::api
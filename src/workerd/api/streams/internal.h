@@ -362,11 +362,15 @@ private:
 //
 // This class is also used as the implementation of FixedLengthStream, in which case `limit` is
 // non-nullptr.
+//
+// Like kj::OneWayPipe, there is no buffering: each write() waits until a reader has consumed all
+// of its bytes, which is what gives the writable side its backpressure. Reads with minBytes > 1
+// keep collecting writes into the same read buffer until minBytes is satisfied. pumpTo() doesn't
+// go through a read buffer at all; instead, while a pump is in progress, each write() is forwarded
+// directly to the pump's output, and completes when the output's write completes.
 class IdentityTransformStreamImpl: public kj::Refcounted,
                                    public ReadableStreamSource,
                                    public WritableStreamSink {
-  // TODO(soon): Reimplement this in terms of kj::OneWayPipe, so we can optimize pumpTo().
-
 public:
   explicit IdentityTransformStreamImpl(kj::Maybe<uint64_t> limit = kj::none)
       : limit(limit) {}
@@ -385,8 +389,6 @@ public:
 
   kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
 
-  kj::Promise<size_t> tryReadInternal(void* buffer, size_t maxBytes);
-
   kj::Promise<DeferredProxy<void>> pumpTo(WritableStreamSink& output, bool end) override;
 
   kj::Maybe<uint64_t> tryGetLength(StreamEncoding encoding) override;
@@ -404,17 +406,31 @@ public:
   void abort(kj::Exception reason) override;
 
 private:
-  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes);
+  kj::Promise<size_t> readHelper(kj::ArrayPtr<kj::byte> bytes, size_t minBytes);
 
   kj::Promise<void> writeHelper(kj::ArrayPtr<const kj::byte> bytes);
 
+  kj::Promise<void> pumpHelper(WritableStreamSink& output, bool end);
+
+  // For FixedLengthStream, accounts for `amount` more bytes having passed through the stream,
+  // where `amount == 0` indicates the end of the stream. Returns an exception if the declared
+  // length was violated. Always returns kj::none if there is no limit.
+  kj::Maybe<kj::Exception> consumeLimit(size_t amount);
+
   kj::Maybe<uint64_t> limit;
 
   struct ReadRequest {
+    // The part of the read buffer that has not been filled yet.
     kj::ArrayPtr<kj::byte> bytes;
     // WARNING: `bytes` may be invalid if fulfiller->isWaiting() returns false! (This indicates the
     //   read was canceled.)
 
+    // The read completes once at least this many bytes have been filled in total (or at EOF).
+    size_t minBytes;
+
+    // Number of bytes filled so far, by earlier writes.
+    size_t filled = 0;
+
     kj::Own<kj::PromiseFulfiller<size_t>> fulfiller;
   };
 
@@ -423,9 +439,75 @@ private:
     kj::Own<kj::PromiseFulfiller<void>> fulfiller;
   };
 
+  // A pump waiting for the writer. The pump itself forwards each write to its output.
+  struct PumpRequest {
+    // Fulfilled when the writer hands the pump a write (leaving it in WriteRequest state) or closes
+    // the stream. Rejected if the stream is aborted or canceled.
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+
   struct Idle {};
 
-  kj::OneOf<Idle, ReadRequest, WriteRequest, kj::Exception, StreamStates::Closed> state = Idle();
+  kj::OneOf<Idle, ReadRequest, WriteRequest, PumpRequest, kj::Exception,
+            StreamStates::Closed> state = Idle();
+};
+
+// A WritableStreamSink that wraps another sink and coalesces small writes into fewer, larger
+// ones. This is used when a JavaScript-backed ReadableStream is pumped to a native sink: a stream
+// that enqueues many tiny chunks would otherwise turn each one into its own write on the
+// underlying connection (and often its own syscall and TLS record).
+//
+// A write smaller than `maxBytes` is copied into a buffer and completes immediately. The buffer is
+// written to the inner sink once it reaches `maxBytes`, once `maxDelay` has passed since it
+// started filling, or as soon as the event loop runs out of other work, whichever comes first. A
+// write of `maxBytes` or more is passed through without copying, right after whatever was
+// buffered before it. Writes to the inner sink are always issued one at a time, in order.
+//
+// Since a buffered write completes before its bytes reach the inner sink, an error from the inner
+// sink is reported by a later write() or end(). end() flushes the buffer before ending the inner
+// sink; abort() discards it.
+class CoalescingWritableStreamSink final: public WritableStreamSink,
+                                          private kj::TaskSet::ErrorHandler {
+public:
+  CoalescingWritableStreamSink(kj::Own<WritableStreamSink> inner,
+                               WriteCoalescingOptions options,
+                               const kj::MonotonicClock& clock = kj::systemCoarseMonotonicClock());
+
+  kj::Promise<void> write(const void* buffer, size_t size) override;
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override;
+  kj::Promise<void> end() override;
+  void abort(kj::Exception reason) override;
+  StreamEncoding disownEncodingResponsibility() override;
+
+private:
+  kj::Own<WritableStreamSink> inner;
+  WriteCoalescingOptions options;
+  const kj::MonotonicClock& clock;
+
+  // Holds bytes that have been accepted but not yet handed to the inner sink. Allocated with
+  // `maxBytes` capacity when the first of them arrives; only the first `buffered` bytes are used.
+  kj::Array<kj::byte> buffer;
+  size_t buffered = 0;
+
+  // When the first byte currently in `buffer` arrived.
+  kj::Maybe<kj::TimePoint> bufferStartTime;
+
+  // Completes when every write handed to the inner sink so far has completed.
+  kj::Maybe<kj::ForkedPromise<void>> lastWrite;
+
+  bool idleFlushScheduled = false;
+
+  kj::Promise<void> writeSmall(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces, size_t size);
+
+  // Hands the buffer to the inner sink after any writes that are already in progress. The returned
+  // promise completes when that write, and every write before it, has completed.
+  kj::Promise<void> flush();
+
+  void scheduleIdleFlush();
+  void taskFailed(kj::Exception&& exception) override;
+
+  // Declared last so that idle flushes are canceled before anything they use is destroyed.
+  kj::TaskSet tasks;
 };
 
 }  // namespace workerd::api
@@ -6,6 +6,7 @@
 #include <kj/debug.h>
 #include "readable.h"
 #include "writable.h"
+#include "internal.h"
 #include <workerd/jsg/buffersource.h>
 #include <workerd/util/weak-refs.h>
 #include <kj/vector.h>
@@ -3210,6 +3211,15 @@ kj::Promise<DeferredProxy<void>> ReadableStreamJsController::pumpTo(
 
   const auto handlePump = [&] {
     KJ_ASSERT(lock.lock());
+    if (end) {
+      // JS streams commonly enqueue many small chunks, each of which would otherwise become its
+      // own write to the sink. We only coalesce when we are going to end() the sink, since
+      // that's what flushes whatever is still buffered when the stream closes.
+      auto options = IoContext::current().getLimitEnforcer().getWriteCoalescingOptions();
+      if (options.maxBytes > 0) {
+        sink = kj::heap<CoalescingWritableStreamSink>(kj::mv(sink), options);
+      }
+    }
     auto reader = kj::heap<PumpToReader>(addRef(), kj::mv(sink), end);
     return addNoopDeferredProxy(reader->pumpTo(js).attach(kj::mv(reader)));
   };
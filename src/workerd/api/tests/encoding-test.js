@@ -346,6 +346,90 @@ export const utf16leFastTrack = {
   }
 };
 
+export const utf8FastTrack = {
+  test() {
+    const enc = new TextEncoder();
+    const dec = new TextDecoder();
+    const fatal = new TextDecoder('utf-8', { fatal: true });
+
+    // Long enough inputs that the vectorized validation sees every kind of content at every
+    // position within a block.
+    const samples = [
+      'hello world',
+      'café crème brûlée ÀÿÆ',
+      'Ā ŝ ſ',
+      '中文字符 日本語 한국어',
+      'emoji 😺 and 🐱 and 💩',
+      'mixed: abc é 中 😺 ü',
+    ];
+    for (const sample of samples) {
+      for (let n = 0; n < 40; n++) {
+        const text = 'x'.repeat(n) + sample.repeat(5);
+        const bytes = enc.encode(text);
+        strictEqual(dec.decode(bytes), text);
+        strictEqual(fatal.decode(bytes), text);
+        strictEqual(decodeStreaming(dec, bytes), text);
+
+        // Split in two at every offset in the first sample, including inside sequences.
+        for (let i = n; i < n + 12 && i < bytes.length; i++) {
+          const first = dec.decode(bytes.subarray(0, i), { stream: true });
+          strictEqual(first + dec.decode(bytes.subarray(i)), text);
+        }
+      }
+    }
+
+    // Invalid input is replaced one maximal subpart at a time, the same as the Encoding Standard's
+    // decoder, including in the middle of long runs of otherwise valid text.
+    const invalid = [
+      [[0x80], '\ufffd'],
+      [[0xc0, 0x80], '\ufffd\ufffd'],
+      [[0xe0, 0x80, 0x80], '\ufffd\ufffd\ufffd'],
+      [[0xed, 0xa0, 0x80], '\ufffd\ufffd\ufffd'],
+      [[0xf4, 0x90, 0x80, 0x80], '\ufffd\ufffd\ufffd\ufffd'],
+      [[0xf0, 0x9f, 0x98, 0x41], '\ufffdA'],
+      [[0xe4, 0xb8, 0x41], '\ufffdA'],
+      [[0xc3, 0xa9, 0xa9], 'é\ufffd'],
+      [[0xff, 0xe4, 0xb8, 0xad], '\ufffd中'],
+    ];
+    for (const [bytes, expected] of invalid) {
+      for (let n = 0; n < 20; n++) {
+        const input = new Uint8Array([...enc.encode('a'.repeat(n)), ...bytes, 0x62]);
+        const text = 'a'.repeat(n) + expected + 'b';
+        strictEqual(dec.decode(input), text);
+        strictEqual(decodeStreaming(dec, input), text);
+        throws(() => fatal.decode(input), TypeError);
+      }
+    }
+
+    // A sequence left incomplete at the end of the stream is replaced when flushed.
+    strictEqual(dec.decode(new Uint8Array([0x61, 0xf0, 0x9f]), { stream: true }), 'a');
+    strictEqual(dec.decode(), '\ufffd');
+    strictEqual(dec.decode(new Uint8Array([0xf0, 0x9f]), { stream: true }), '');
+    strictEqual(dec.decode(new Uint8Array([0x98]), { stream: true }), '');
+    strictEqual(dec.decode(new Uint8Array([0xba, 0x61])), '😺a');
+
+    // The BOM is only stripped at the very start, even when it arrives split across chunks.
+    strictEqual(dec.decode(new Uint8Array([0xef, 0xbb, 0xbf, 0x61, 0xef, 0xbb, 0xbf])),
+                'a\ufeff');
+    strictEqual(dec.decode(new Uint8Array([0xef]), { stream: true }), '');
+    strictEqual(dec.decode(new Uint8Array([0xbb, 0xbf, 0xc3, 0xa9])), 'é');
+  }
+};
+
+export const textEncoderLarge = {
+  test() {
+    // Large enough to skip the scratch buffer, with each kind of content.
+    const enc = new TextEncoder();
+    const dec = new TextDecoder();
+    for (const [unit, size] of [['a', 1], ['é', 2], ['中', 3], ['😺', 4], ['\ud800', 3]]) {
+      const text = unit.repeat(10000);
+      const bytes = enc.encode(text);
+      strictEqual(bytes.length, size * 10000);
+      strictEqual(dec.decode(bytes), unit === '\ud800' ? '\ufffd'.repeat(10000) : text);
+    }
+  }
+};
+
 export const allTheDecoders = {
   test() {
     [
@@ -518,6 +518,40 @@ export const testFormDataSerializer = {
   }
 };
 
+export const testFormDataLargeFiles = {
+  async test() {
+    // Files large enough to be served straight out of the parsed body, with contents that look a
+    // lot like the delimiter, survive a round trip through the serializer and parser.
+    const boundaryLike = new TextEncoder().encode('\r\n--\n--\r\n-');
+    const big = new Uint8Array(1024 * 1024);
+    for (let i = 0; i < big.length; i++) {
+      big[i] = i % 7 == 0 ? boundaryLike[i % boundaryLike.length] : i & 0xff;
+    }
+
+    const expected = new FormData();
+    expected.append('small', new File(['tiny'], 'small.txt'));
+    expected.append('big', new File([big], 'big.bin', { type: 'application/x-big' }));
+    expected.append('text', 'after');
+
+    const response = new Response(expected);
+    const boundary = /boundary=(.+)$/.exec(response.headers.get('Content-Type'))[1];
+    const serialized = new Uint8Array(await response.arrayBuffer());
+
+    const form = await new Request('https://example.org', {
+      method: 'POST',
+      body: serialized,
+      headers: { 'content-type': `multipart/form-data; boundary="${boundary}"` },
+    }).formData();
+
+    strictEqual(await form.get('small').text(), 'tiny');
+    const file = form.get('big');
+    strictEqual(file.name, 'big.bin');
+    strictEqual(file.type, 'application/x-big');
+    deepStrictEqual(new Uint8Array(await file.arrayBuffer()), big);
+    strictEqual(form.get('text'), 'after');
+  }
+};
+
 export const testFormDataSet = {
   test() {
     const fd = new FormData();
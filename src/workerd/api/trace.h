@@ -587,6 +587,9 @@ public:
 
 class TraceCustomEventImpl final: public WorkerInterface::CustomEvent {
 public:
+  // The type ID workerd itself uses for trace events. Embedders may use their own.
+  static const uint16_t EVENT_TYPE = 2;
+
   TraceCustomEventImpl(
       uint16_t typeId, kj::TaskSet& waitUntilTasks, kj::Array<kj::Own<Trace>> traces)
     : typeId(typeId), waitUntilTasks(waitUntilTasks), traces(kj::mv(traces)) {}
@@ -32,14 +32,22 @@ jsg::Url parseImpl(kj::StringPtr url, kj::Maybe<kj::StringPtr> maybeBase) {
 }
 }  // namespace
 
-jsg::Ref<URL> URL::constructor(kj::String url, jsg::Optional<kj::String> base) {
+jsg::Ref<URL> URL::constructor(
+    jsg::Lock& js, kj::String url, jsg::Optional<kj::String> base) {
+  KJ_IF_SOME(b, base) {
+    return jsg::alloc<URL>(url, b.asPtr());
+  }
+
+  // Without a base, the result depends only on the string, so a recent parse of the same string
+  // (typically `request.url`) can be reused.
   return jsg::alloc<URL>(
-      kj::mv(url),
-      base.map([](kj::String& base) { return base.asPtr(); }));
+      JSG_REQUIRE_NONNULL(js.tryParseUrl(url), TypeError, "Invalid URL string."));
 }
 
 URL::URL(kj::StringPtr url, kj::Maybe<kj::StringPtr> base) : inner(parseImpl(url, base)) {}
 
+URL::URL(jsg::Url inner) : inner(kj::mv(inner)) {}
+
 URL::~URL() noexcept(false) {
   KJ_IF_SOME(searchParams, maybeSearchParams) {
     searchParams->maybeUrl = nullptr;
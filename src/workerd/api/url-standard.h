@@ -149,14 +149,16 @@ private:
 class URL: public jsg::Object {
 public:
   URL(kj::StringPtr url, kj::Maybe<kj::StringPtr> base = kj::none);
+  explicit URL(jsg::Url inner);
   ~URL() noexcept(false) override;
 
-  static jsg::Ref<URL> constructor(kj::String url, jsg::Optional<kj::String> base);
+  static jsg::Ref<URL> constructor(
+      jsg::Lock& js, kj::String url, jsg::Optional<kj::String> base);
 
   static kj::Maybe<jsg::Ref<URL>> parse(jsg::Lock& js, kj::String url, jsg::Optional<kj::String> base) {
     // Method should not throw if the parse fails
     return js.tryCatch([&]() -> kj::Maybe<jsg::Ref<URL>> {
-      return constructor(kj::mv(url), kj::mv(base));
+      return constructor(js, kj::mv(url), kj::mv(base));
     }, [](auto) -> kj::Maybe<jsg::Ref<URL>> { return kj::none; });
   }
 
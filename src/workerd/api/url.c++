@@ -137,6 +137,27 @@ kj::String kjUrlToString(const kj::Url& url) {
   return kj::mv(result);
 }
 
+// Sets `component` of `url` to `value`, keeping the change only if the resulting URL still
+// parses. The old value is swapped out and restored on failure, which is much cheaper than
+// cloning the whole URL just to try the change.
+template <typename T>
+void trySetComponent(kj::Url& url, T& component, T value) {
+  auto old = kj::mv(component);
+  component = kj::mv(value);
+
+  kj::Maybe<kj::Url> parsed;
+  {
+    KJ_ON_SCOPE_FAILURE(component = kj::mv(old));
+    parsed = kj::Url::tryParse(kjUrlToString(url));
+  }
+
+  KJ_IF_SOME(u, parsed) {
+    url = kj::mv(u);
+  } else {
+    component = kj::mv(old);
+  }
+}
+
 }  // namespace
 
 // =======================================================================================
@@ -167,21 +188,23 @@ URL::URL(kj::Url&& u): url(kj::refcounted<RefcountedUrl>(kj::mv(u))) {
 // strategy:
 //
 // 1. Pre-process the input, if necessary. E.g., we drop anything after a ':' when setting protocol.
-// 2. Clone the kj::Url object.
-// 3. Replace the cloned component in question with the new value.
-// 4. Stringify and parse the clone. If this succeeds, the clone is the new kj::Url object.
+// 2. Swap the new value into the component in question (see trySetComponent()).
+// 3. Stringify and parse the URL. If this succeeds, the result is the new kj::Url object.
+//    Otherwise, the old value is swapped back.
 //
 // Notably, we do little to no validation in this wrapper class. As validation checks are added to
 // kj::Url's parser, more and more unit tests for this wrapper class should start passing without
 // modification.
 //
-// TODO(perf): Pre-processing input, cloning, stringifying, and parsing the cloned URL is an awfully
+// TODO(perf): Pre-processing input, stringifying, and parsing the URL is an awfully
 //   heavyweight operation when all we want to do is validly replace a URL component. A couple
 //   attributes, pathname and search, are able to take advantage of the kj::Url parser's context
 //   argument: we can parse a pathname using the HTTP_REQUEST context, for instance. The WHATWG URL
 //   spec defines a parser state machine allowing for the state to be overridden to parse only
 //   specific components of a URL. This is more or less a generalization of kj::Url's parser
-//   context, and offers an obvious path forward to both conformance and performance.
+//   context, and offers an obvious path forward to both conformance and performance. That is
+//   what the standard URL implementation (url-standard.h, backed by ada) does, so new code should
+//   prefer it; this class is kept as-is for compatibility.
 
 kj::String URL::getHref() {
   return toString();
@@ -218,12 +241,7 @@ void URL::setProtocol(kj::String value) {
     value = kj::str(value.slice(0, colon));
   }
 
-  auto copy = url->clone();
-  copy.scheme = kj::mv(value);
-
-  KJ_IF_SOME(u, kj::Url::tryParse(kjUrlToString(copy))) {
-    url->kj::Url::operator=(kj::mv(u));
-  }
+  trySetComponent(*url, url->scheme, kj::mv(value));
 
   normalizePort(*url);
 }
@@ -235,16 +253,14 @@ kj::String URL::getUsername() {
   return {};
 }
 void URL::setUsername(kj::String value) {
-  auto copy = url->clone();
-  KJ_IF_SOME(ui, copy.userInfo) {
-    ui.username = kj::mv(value);
-  } else {
-    copy.userInfo = kj::Url::UserInfo{.username = kj::mv(value)};
+  kj::Maybe<kj::Url::UserInfo> userInfo = kj::Url::UserInfo{.username = kj::mv(value)};
+  KJ_IF_SOME(ui, url->userInfo) {
+    KJ_ASSERT_NONNULL(userInfo).password = ui.password.map([](kj::String& p) {
+      return kj::str(p);
+    });
   }
 
-  KJ_IF_SOME(u, kj::Url::tryParse(kjUrlToString(copy))) {
-    url->kj::Url::operator=(kj::mv(u));
-  }
+  trySetComponent(*url, url->userInfo, kj::mv(userInfo));
 }
 
 kj::String URL::getPassword() {
@@ -256,22 +272,19 @@ kj::String URL::getPassword() {
   return {};
 }
 void URL::setPassword(kj::String value) {
-  auto copy = url->clone();
-  KJ_IF_SOME(ui, copy.userInfo) {
+  kj::Maybe<kj::Url::UserInfo> userInfo;
+  KJ_IF_SOME(ui, url->userInfo) {
     // We already have userInfo. Set the password if we were given a non-empty string, otherwise
     // reset the password Maybe.
+    userInfo = kj::Url::UserInfo{.username = kj::str(ui.username)};
     if (value.size() > 0) {
-      ui.password = kj::mv(value);
-    } else {
-      ui.password = kj::none;
+      KJ_ASSERT_NONNULL(userInfo).password = kj::mv(value);
     }
   } else if (value.size() > 0) {
-    copy.userInfo = kj::Url::UserInfo{.password = kj::mv(value)};
+    userInfo = kj::Url::UserInfo{.password = kj::mv(value)};
   }
 
-  KJ_IF_SOME(u, kj::Url::tryParse(kjUrlToString(copy))) {
-    url->kj::Url::operator=(kj::mv(u));
-  }
+  trySetComponent(*url, url->userInfo, kj::mv(userInfo));
 }
 
 kj::String URL::getHost() {
@@ -83,8 +83,8 @@ kj::Maybe<kj::Exception> translateKjException(
 
 // =======================================================================================
 
-// Wrap the given stream in an adapter which translates kj::newTee()-specific exceptions into
-// JS-visible exceptions.
+// Wrap the given stream in an adapter which translates tee-specific exceptions, as thrown by
+// newSharedTee() branches, into JS-visible exceptions.
 kj::Own<kj::AsyncInputStream> newTeeErrorAdapter(kj::Own<kj::AsyncInputStream> inner);
 
 // Redacts potential secret keys from a given URL using a couple heuristics:
@@ -197,6 +197,8 @@ struct ActorCacheTestOptions {
   size_t maxKeysPerRpc = 128;
   bool noCache = false;
   bool neverFlush = false;
+  uint maxListReadAheadKeys = 0;
+  kj::Maybe<ActorCache::Hooks&> hooks;
 };
 
 struct ActorCacheTest: public ActorCacheConvenienceWrappers {
@@ -221,8 +223,9 @@ struct ActorCacheTest: public ActorCacheConvenienceWrappers {
         ws(loop), mockStorage(kj::mv(mockPair.mock)),
         lru({options.softLimit, options.hardLimit,
              options.staleTimeout, options.dirtyListByteLimit, options.maxKeysPerRpc,
-             options.noCache, options.neverFlush}),
-        cache(kj::mv(mockPair.client), lru, gate),
+             options.noCache, options.neverFlush, options.maxListReadAheadKeys}),
+        cache(kj::mv(mockPair.client), lru, gate,
+              options.hooks.orDefault(ActorCache::Hooks::DEFAULT)),
         gateBrokenPromise(options.monitorOutputGate
             ? eagerlyReportExceptions(gate.onBroken())
             : kj::Promise<void>(kj::READY_NOW)) {}
@@ -3497,7 +3500,9 @@ KJ_TEST("ActorCache listReverse() retry on failure") {
 // =======================================================================================
 // LRU purge
 
-constexpr size_t ENTRY_SIZE = 128;
+// A bit more than what the LRU is charged for an entry with a short key and value: a 128-byte slab
+// block for the entry and a 32-byte one for its payload.
+constexpr size_t ENTRY_SIZE = 176;
 KJ_TEST("ActorCache LRU purge") {
   ActorCacheTest test({.softLimit = 1 * ENTRY_SIZE});
   auto& ws = test.ws;
@@ -3562,8 +3567,211 @@ KJ_TEST("ActorCache LRU purge ordering") {
   KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("yyy"))) == "bbb");
 }
 
+struct CountingHooks: public ActorCache::Hooks {
+  uint hits = 0;
+  uint misses = 0;
+  uint evictions = 0;
+
+  void storageCacheHits(uint count) override { hits += count; }
+  void storageCacheMisses(uint count) override { misses += count; }
+  void storageCacheEvictions(uint count) override { evictions += count; }
+};
+
+KJ_TEST("ActorCache LRU keeps re-read entries through a scan") {
+  CountingHooks hooks;
+  ActorCacheTest test({.softLimit = 4 * ENTRY_SIZE, .hooks = hooks});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  test.put("aaa", "hot");
+  mockStorage->expectCall("put", ws).thenReturn(CAPNP());
+  test.gate.wait().wait(ws);
+
+  // Reading aaa again moves it out of probation.
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("aaa"))) == "hot");
+
+  // Scan more keys than fit in the cache.
+  {
+    auto promise = expectUncached(test.list("b", "c"));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "b", end = "c"), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "b1", value = "1"),
+                                          (key = "b2", value = "2"),
+                                          (key = "b3", value = "3"),
+                                          (key = "b4", value = "4"),
+                                          (key = "b5", value = "5"),
+                                          (key = "b6", value = "6")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"b1", "1"}, {"b2", "2"}, {"b3", "3"},
+                                       {"b4", "4"}, {"b5", "5"}, {"b6", "6"}}));
+  }
+
+  KJ_EXPECT(hooks.hits == 1);
+  KJ_EXPECT(hooks.misses == 6);
+  KJ_EXPECT(hooks.evictions > 0);
+
+  // The scan evicted its own oldest entries rather than aaa, which a plain LRU would have evicted
+  // first.
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("aaa"))) == "hot");
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("b6"))) == "6");
+  (void)expectUncached(test.get("b1"));
+
+  KJ_EXPECT(hooks.hits == 3);
+  KJ_EXPECT(hooks.misses == 7);
+}
+
+KJ_TEST("ActorCache list() reads ahead of sequential pages") {
+  CountingHooks hooks;
+  ActorCacheTest test({.maxListReadAheadKeys = 64, .hooks = hooks});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  // The first two pages are listed as requested.
+  {
+    auto promise = expectUncached(test.list("a", "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "a", end = "z", limit = 2), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "a", value = "1"), (key = "b", value = "2")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"a", "1"}, {"b", "2"}}));
+  }
+  {
+    auto promise = expectUncached(test.list("b\0"_kj, "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "b\0", end = "z", limit = 2), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "c", value = "3"), (key = "d", value = "4")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"c", "3"}, {"d", "4"}}));
+  }
+
+  // The third page continues the scan, so it lists the page after it too. The page it needs is
+  // delivered as soon as it arrives, while the rest of the list call completes in the background.
+  {
+    auto promise = expectUncached(test.list("d\0"_kj, "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "d\0", end = "z", limit = 4), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "e", value = "5"), (key = "f", value = "6"),
+                                          (key = "g", value = "7"), (key = "h", value = "8")]))
+          .expectReturns(CAPNP(), ws);
+      KJ_ASSERT(promise.wait(ws) == kvs({{"e", "5"}, {"f", "6"}}));
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).thenReturn(CAPNP());
+  }
+
+  // So the fourth comes from cache.
+  KJ_ASSERT(expectCached(test.list("f\0"_kj, "z", 2)) == kvs({{"g", "7"}, {"h", "8"}}));
+
+  // The fifth reads further ahead, and finds the end of the range.
+  {
+    auto promise = expectUncached(test.list("h\0"_kj, "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "h\0", end = "z", limit = 6), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "i", value = "9")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).thenReturn(CAPNP());
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"i", "9"}}));
+  }
+
+  KJ_ASSERT(expectCached(test.list("i\0"_kj, "z", 2)) == kvs({}));
+
+  // Keys read ahead are counted as misses only when a list() has to wait for them.
+  KJ_EXPECT(hooks.misses == 7);
+  KJ_EXPECT(hooks.hits == 2);
+}
+
+KJ_TEST("ActorCache list() read-ahead doesn't hold back writes") {
+  ActorCacheTest test({.maxListReadAheadKeys = 64});
+  auto& ws = test.ws;
+  auto& mockStorage = test.mockStorage;
+
+  // The first two pages start a scan.
+  {
+    auto promise = expectUncached(test.list("a", "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "a", end = "z", limit = 2), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "a", value = "1"), (key = "b", value = "2")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"a", "1"}, {"b", "2"}}));
+  }
+  {
+    auto promise = expectUncached(test.list("b\0"_kj, "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "b\0", end = "z", limit = 2), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "c", value = "3"), (key = "d", value = "4")]))
+          .expectReturns(CAPNP(), ws);
+      stream.call("end", CAPNP()).expectReturns(CAPNP(), ws);
+    }).expectCanceled();
+
+    KJ_ASSERT(promise.wait(ws) == kvs({{"c", "3"}, {"d", "4"}}));
+  }
+
+  // The third page reads ahead.
+  {
+    auto promise = expectUncached(test.list("d\0"_kj, "z", 2));
+
+    mockStorage->expectCall("list", ws)
+        .withParams(CAPNP(start = "d\0", end = "z", limit = 4), "stream"_kj)
+        .useCallback("stream", [&](MockClient stream) {
+      stream.call("values", CAPNP(list = [(key = "e", value = "5"), (key = "f", value = "6")]))
+          .expectReturns(CAPNP(), ws);
+      KJ_ASSERT(promise.wait(ws) == kvs({{"e", "5"}, {"f", "6"}}));
+
+      // A put() made while the rest of the list is still streaming in is flushed right away,
+      // rather than waiting for the read-ahead to finish.
+      test.put("g", "new");
+      mockStorage->expectCall("put", ws)
+          .withParams(CAPNP(entries = [(key = "g", value = "new")]))
+          .thenReturn(CAPNP());
+      test.gate.wait().wait(ws);
+
+      // What storage streams after that may predate the write, so the read-ahead stops.
+      stream.call("values", CAPNP(list = [(key = "g", value = "7"), (key = "h", value = "8")]))
+          .expectThrows(kj::Exception::Type::FAILED, "read-ahead abandoned", ws);
+    }).thenReturn(CAPNP());
+  }
+
+  KJ_ASSERT(KJ_ASSERT_NONNULL(expectCached(test.get("g"))) == "new");
+
+  {
+    auto promise = expectUncached(test.get("h"));
+    mockStorage->expectCall("get", ws)
+        .withParams(CAPNP(key = "h"))
+        .thenReturn(CAPNP(value = "8"));
+    KJ_ASSERT(KJ_ASSERT_NONNULL(promise.wait(ws)) == "8");
+  }
+}
+
 KJ_TEST("ActorCache LRU purge larger") {
-  ActorCacheTest test({.softLimit = 32 * ENTRY_SIZE});
+  // Room for three of the kilobyte values below, but not four.
+  ActorCacheTest test({.softLimit = 4 * 1024});
   auto& ws = test.ws;
   auto& mockStorage = test.mockStorage;
 
@@ -5391,5 +5599,98 @@ KJ_TEST("ActorCache can shutdown") {
   });
 }
 
+
+KJ_TEST("ActorCache entries are allocated from slabs") {
+  auto before = ActorCache::getEntryMemoryStats();
+
+  {
+    ActorCacheTest test;
+    auto& ws = test.ws;
+    auto& mockStorage = test.mockStorage;
+
+    auto bigValue = kj::str(kj::repeat('x', 2048));
+
+    {
+      auto promise = expectUncached(test.get("foo"));
+      mockStorage->expectCall("get", ws)
+          .withParams(CAPNP(key = "foo"))
+          .thenReturn(CAPNP(value = "123"));
+      KJ_EXPECT(KJ_ASSERT_NONNULL(promise.wait(ws)) == "123");
+    }
+
+    {
+      auto promise = expectUncached(test.get("bar"));
+      mockStorage->expectCall("get", ws)
+          .withParams(CAPNP(key = "bar"))
+          .thenReturn(kj::str("value = \"", bigValue, "\""));
+      KJ_EXPECT(KJ_ASSERT_NONNULL(promise.wait(ws)) == bigValue);
+    }
+
+    // The small entry and its payload live in slab blocks; the big payload doesn't fit in one.
+    auto during = ActorCache::getEntryMemoryStats();
+    KJ_EXPECT(during.blockBytesInUse > before.blockBytesInUse);
+    KJ_EXPECT(during.largeBytesInUse > before.largeBytesInUse);
+    KJ_EXPECT(during.slabBytes >= during.blockBytesInUse);
+
+    // The LRU is charged for blocks at their rounded-up size, i.e. for exactly what was allocated.
+    KJ_EXPECT(test.lru.currentSize() ==
+        (during.blockBytesInUse - before.blockBytesInUse) +
+        (during.largeBytesInUse - before.largeBytesInUse));
+  }
+
+  // Everything is given back once the cache is gone.
+  auto after = ActorCache::getEntryMemoryStats();
+  KJ_EXPECT(after.blockBytesInUse == before.blockBytesInUse);
+  KJ_EXPECT(after.largeBytesInUse == before.largeBytesInUse);
+}
+
+KJ_TEST("ActorCache entry slabs are returned once empty") {
+  auto before = ActorCache::getEntryMemoryStats();
+
+  {
+    ActorCacheTest test({.softLimit = 16 << 20, .hardLimit = 32 << 20, .neverFlush = true});
+
+    // Enough entries to fill many slabs of a couple of size classes.
+    for (auto i: kj::zeroTo(10000)) {
+      test.put(kj::str("key", i), kj::str("value", i));
+    }
+
+    KJ_EXPECT(ActorCache::getEntryMemoryStats().slabBytes > before.slabBytes + (1 << 20));
+  }
+
+  // At most one empty slab per size class is kept for reuse.
+  auto after = ActorCache::getEntryMemoryStats();
+  KJ_EXPECT(after.blockBytesInUse == before.blockBytesInUse);
+  KJ_EXPECT(after.slabBytes <= before.slabBytes + 6 * (64 << 10), after.slabBytes);
+}
+
+KJ_TEST("ActorCache GetResultList borrowed mode") {
+  uint calls = 0;
+  auto list = ActorCache::GetResultList::borrowed(
+      [&](kj::FunctionParam<void(ActorCache::KeyPtr, ActorCache::ValuePtr)> callback) {
+    ++calls;
+    // The pointers only need to be valid during the callback.
+    auto value = kj::str("123");
+    callback("bar", value.asBytes());
+    value = kj::str("456");
+    callback("foo", value.asBytes());
+  });
+
+  // Nothing is read until the list is consumed.
+  KJ_EXPECT(calls == 0);
+
+  kj::Vector<KeyValue> results;
+  list.forEach([&](ActorCache::KeyValuePtrPairWithCache entry) {
+    KJ_EXPECT(entry.status == ActorCache::CacheStatus::UNCACHED);
+    results.add(stringifyValues(entry));
+  });
+  KJ_EXPECT(calls == 1);
+  KJ_EXPECT(results.releaseAsArray() == kvs({{"bar", "123"}, {"foo", "456"}}));
+
+  // The list is consumed by the first forEach().
+  list.forEach([&](ActorCache::KeyValuePtrPairWithCache) { KJ_FAIL_EXPECT("unexpected entry"); });
+  KJ_EXPECT(calls == 1);
+}
+
 }  // namespace
 }  // namespace workerd
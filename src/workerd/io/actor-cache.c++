@@ -11,6 +11,7 @@
 #include <workerd/io/io-gate.h>
 #include <workerd/util/sentry.h>
 #include <workerd/util/duration-exceeded-logger.h>
+#include <workerd/util/use-perfetto-categories.h>
 
 namespace workerd {
 
@@ -37,6 +38,246 @@ auto recordStorageWrite(ActorCache::Hooks& hooks, const kj::MonotonicClock& cloc
   return kj::defer([start, &hooks, &clock]() { hooks.storageWriteCompleted(clock.now() - start); });
 }
 
+// Allocator for `ActorCache::Entry` objects and their key/value payloads.
+//
+// An actor can cache millions of small keys, and allocating each entry, key, and value separately
+// spends much of the memory on malloc() bookkeeping and scatters related data across the heap.
+// Instead, blocks of up to MAX_BLOCK_SIZE bytes are carved out of SLAB_SIZE-byte slabs, one size
+// class (powers of two) per slab. Larger requests go directly to malloc().
+//
+// Each slab starts with a header holding its own free list, and slabs are aligned to SLAB_SIZE so
+// that free() can find the header from a block's address. A slab is returned to the system as soon
+// as all of its blocks are free, except that one empty slab per size class and shard is kept
+// around so that a cache hovering at a slab boundary doesn't allocate and free it over and over.
+// Memory held beyond what entries use is thus partly-used slabs plus at most
+// SHARD_COUNT * SIZE_CLASS_COUNT empty ones.
+//
+// Entries are shared across threads, so they may be freed on a different thread than the one that
+// allocated them. To keep threads from contending on a single lock, slabs belong to one of
+// SHARD_COUNT shards, each with its own mutex. A thread allocates from the shard it was assigned on
+// first use, and a block is always freed back to the shard owning its slab.
+class EntrySlab {
+public:
+  static constexpr size_t MIN_BLOCK_SIZE = 32;
+  static constexpr size_t MAX_BLOCK_SIZE = 1024;
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+  static EntrySlab& get() {
+    // Leaked on purpose: entries may outlive static destructors.
+    static EntrySlab& instance = *new EntrySlab;
+    return instance;
+  }
+
+  // Returns the number of bytes actually set aside by `allocate(size)`.
+  static size_t blockSizeFor(size_t size) {
+    if (size > MAX_BLOCK_SIZE) return size;
+    return MIN_BLOCK_SIZE << sizeClass(size);
+  }
+
+  void* allocate(size_t size) {
+    if (size > MAX_BLOCK_SIZE) {
+      stats.largeBytesInUse.fetch_add(size, std::memory_order_relaxed);
+      void* result = malloc(size);
+      KJ_ASSERT(result != nullptr, "out of memory");
+      return result;
+    }
+
+    auto index = sizeClass(size);
+    auto& shard = currentShard();
+    stats.blockBytesInUse.fetch_add(MIN_BLOCK_SIZE << index, std::memory_order_relaxed);
+
+    auto lock = shard.classes.lockExclusive();
+    auto& cls = lock->classes[index];
+    if (cls.available.empty()) {
+      cls.available.add(newSlab(shard, index));
+      ++cls.emptySlabs;
+    }
+
+    auto& slab = cls.available.front();
+    if (slab.liveBlocks++ == 0) --cls.emptySlabs;
+
+    void* result;
+    KJ_IF_SOME(block, slab.freeList) {
+      slab.freeList = block.next;
+      result = &block;
+    } else {
+      result = slab.nextUnused;
+      slab.nextUnused += MIN_BLOCK_SIZE << index;
+    }
+
+    if (slab.freeList == kj::none && slab.nextUnused == slab.end()) {
+      cls.available.remove(slab);
+    }
+    return result;
+  }
+
+  void free(void* ptr, size_t size) {
+    if (size > MAX_BLOCK_SIZE) {
+      stats.largeBytesInUse.fetch_sub(size, std::memory_order_relaxed);
+      ::free(ptr);
+      return;
+    }
+
+    auto& slab = Slab::containing(ptr);
+    stats.blockBytesInUse.fetch_sub(MIN_BLOCK_SIZE << slab.sizeClass, std::memory_order_relaxed);
+
+    {
+      auto lock = slab.shard.classes.lockExclusive();
+      auto& cls = lock->classes[slab.sizeClass];
+      if (!slab.link.isLinked()) {
+        // The slab was full, so it has room again.
+        cls.available.add(slab);
+      }
+      slab.freeList = *new (ptr) FreeBlock { slab.freeList };
+
+      if (--slab.liveBlocks > 0 || cls.emptySlabs == 0) {
+        if (slab.liveBlocks == 0) ++cls.emptySlabs;
+        return;
+      }
+
+      // We already keep an empty slab of this size class around; give this one back.
+      cls.available.remove(slab);
+    }
+    releaseSlab(slab);
+  }
+
+  ActorCache::EntryMemoryStats getStats() const {
+    return {
+      .slabBytes = stats.slabBytes.load(std::memory_order_relaxed),
+      .blockBytesInUse = stats.blockBytesInUse.load(std::memory_order_relaxed),
+      .largeBytesInUse = stats.largeBytesInUse.load(std::memory_order_relaxed),
+    };
+  }
+
+private:
+  static constexpr uint SIZE_CLASS_COUNT = 6;
+  static constexpr uint SHARD_COUNT = 16;
+  static_assert(MIN_BLOCK_SIZE << (SIZE_CLASS_COUNT - 1) == MAX_BLOCK_SIZE);
+  static_assert(SLAB_SIZE % MAX_BLOCK_SIZE == 0);
+  static_assert((SLAB_SIZE & (SLAB_SIZE - 1)) == 0, "slab lookup relies on power-of-two alignment");
+
+  struct FreeBlock {
+    kj::Maybe<FreeBlock&> next;
+  };
+
+  struct Shard;
+
+  // Header at the start of each slab. Its mutable members are protected by the owning shard's
+  // mutex.
+  struct Slab {
+    Shard& shard;
+    const uint sizeClass;
+    uint liveBlocks = 0;
+    kj::Maybe<FreeBlock&> freeList;
+
+    // Blocks at and past this address have never been handed out.
+    byte* nextUnused;
+
+    // Links the slab into its size class's `available` list whenever it has a free block.
+    kj::ListLink<Slab> link;
+
+    Slab(Shard& shard, uint sizeClass)
+        : shard(shard), sizeClass(sizeClass),
+          nextUnused(reinterpret_cast<byte*>(this) + firstBlockOffset(sizeClass)) {}
+
+    byte* end() { return reinterpret_cast<byte*>(this) + SLAB_SIZE; }
+
+    static Slab& containing(void* block) {
+      return *reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(block) & ~(SLAB_SIZE - 1));
+    }
+
+    // Blocks are aligned to their own size, so the header takes up the first block or few.
+    static size_t firstBlockOffset(uint sizeClass) {
+      size_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+      return (sizeof(Slab) + blockSize - 1) / blockSize * blockSize;
+    }
+  };
+
+  struct SizeClass {
+    // Slabs with at least one free block, including empty ones.
+    kj::List<Slab, &Slab::link> available;
+
+    // How many slabs in `available` have no live blocks.
+    uint emptySlabs = 0;
+  };
+
+  struct ShardState {
+    SizeClass classes[SIZE_CLASS_COUNT];
+  };
+
+  struct Shard {
+    kj::MutexGuarded<ShardState> classes;
+  };
+
+  Shard shards[SHARD_COUNT];
+  std::atomic<uint> nextShard = 0;
+
+  // Updated outside the shard locks, so that stats don't need any lock and large allocations
+  // don't touch the slabs at all.
+  struct {
+    std::atomic<size_t> slabBytes = 0;
+    std::atomic<size_t> blockBytesInUse = 0;
+    std::atomic<size_t> largeBytesInUse = 0;
+  } stats;
+
+  Shard& currentShard() {
+    static thread_local uint index = nextShard.fetch_add(1, std::memory_order_relaxed);
+    return shards[index % SHARD_COUNT];
+  }
+
+  Slab& newSlab(Shard& shard, uint sizeClass) {
+#if _WIN32
+    void* memory = _aligned_malloc(SLAB_SIZE, SLAB_SIZE);
+#else
+    void* memory = aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+#endif
+    KJ_ASSERT(memory != nullptr, "out of memory");
+    stats.slabBytes.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+    return *new (memory) Slab(shard, sizeClass);
+  }
+
+  void releaseSlab(Slab& slab) {
+    stats.slabBytes.fetch_sub(SLAB_SIZE, std::memory_order_relaxed);
+    slab.~Slab();
+#if _WIN32
+    _aligned_free(&slab);
+#else
+    ::free(&slab);
+#endif
+  }
+
+  static uint sizeClass(size_t size) {
+    uint result = 0;
+    size_t blockSize = MIN_BLOCK_SIZE;
+    while (blockSize < size) {
+      blockSize <<= 1;
+      ++result;
+    }
+    return result;
+  }
+};
+
+// Disposes the value of a payload allocated by `Entry::copyPayload()`, which starts the block
+// (right after its size header) and so is what frees it. The key points into the same block and
+// uses NullArrayDisposer.
+class PayloadDisposer final: public kj::ArrayDisposer {
+public:
+  static const PayloadDisposer instance;
+
+  static constexpr size_t HEADER_SIZE = sizeof(size_t);
+
+protected:
+  void disposeImpl(void* firstElement, size_t elementSize, size_t elementCount,
+                   size_t capacity, void (*destroyElement)(void*)) const override {
+    auto block = static_cast<byte*>(firstElement) - HEADER_SIZE;
+    size_t blockSize;
+    memcpy(&blockSize, block, sizeof(blockSize));
+    EntrySlab::get().free(block, blockSize);
+  }
+};
+
+const PayloadDisposer PayloadDisposer::instance;
+
 }  // namespace
 
 
@@ -73,6 +314,14 @@ ActorCache::Entry::Entry(ActorCache& cache, Key key, Value value)
   }
 }
 
+ActorCache::Entry::Entry(ActorCache& cache, Payload payload)
+    : maybeCache(cache), key(kj::mv(payload.key)), value(kj::mv(payload.value)),
+      payloadBlockSize(payload.blockSize), valueStatus(EntryValueStatus::PRESENT) {
+  KJ_IF_SOME(c, maybeCache) {
+    c.lru.size.fetch_add(size(), std::memory_order_relaxed);
+  }
+}
+
 ActorCache::Entry::Entry(ActorCache& cache, Key key, EntryValueStatus valueStatus)
     : maybeCache(cache), key(kj::mv(key)), valueStatus(valueStatus) {
   KJ_IASSERT(
@@ -85,9 +334,56 @@ ActorCache::Entry::Entry(ActorCache& cache, Key key, EntryValueStatus valueStatu
 
 ActorCache::Entry::Entry(Key key, Value value)
   : key(kj::mv(key)), value(kj::mv(value)), valueStatus(EntryValueStatus::PRESENT) {}
+ActorCache::Entry::Entry(Payload payload)
+  : key(kj::mv(payload.key)), value(kj::mv(payload.value)), payloadBlockSize(payload.blockSize),
+    valueStatus(EntryValueStatus::PRESENT) {}
 ActorCache::Entry::Entry(Key key, EntryValueStatus valueStatus)
   : key(kj::mv(key)), valueStatus(valueStatus) {}
 
+size_t ActorCache::Entry::size() const {
+  size_t payloadSize = payloadBlockSize > 0 ? payloadBlockSize : key.size() + value.size();
+  return EntrySlab::blockSizeFor(sizeof(*this)) + payloadSize;
+}
+
+void* ActorCache::Entry::operator new(size_t size) {
+  return EntrySlab::get().allocate(size);
+}
+
+void ActorCache::Entry::operator delete(void* ptr, size_t size) {
+  EntrySlab::get().free(ptr, size);
+}
+
+ActorCache::Entry::Payload ActorCache::Entry::copyPayload(KeyPtr key, ValuePtr value) {
+  // Layout: [block size][value][key]['\0']
+  size_t blockSize = PayloadDisposer::HEADER_SIZE + value.size() + key.size() + 1;
+  auto block = static_cast<byte*>(EntrySlab::get().allocate(blockSize));
+  memcpy(block, &blockSize, sizeof(blockSize));
+
+  auto valueBytes = block + PayloadDisposer::HEADER_SIZE;
+  memcpy(valueBytes, value.begin(), value.size());
+
+  auto keyChars = reinterpret_cast<char*>(valueBytes + value.size());
+  memcpy(keyChars, key.begin(), key.size());
+  keyChars[key.size()] = '\0';
+
+  return {
+    .key = Key(keyChars, key.size(), kj::NullArrayDisposer::instance),
+    .value = Value(valueBytes, value.size(), PayloadDisposer::instance),
+    .blockSize = EntrySlab::blockSizeFor(blockSize),
+  };
+}
+
+ActorCache::Entry::Payload ActorCache::Entry::compactPayload(Key key, Value value) {
+  if (PayloadDisposer::HEADER_SIZE + value.size() + key.size() + 1 > EntrySlab::MAX_BLOCK_SIZE) {
+    return { .key = kj::mv(key), .value = kj::mv(value) };
+  }
+  return copyPayload(key, value);
+}
+
+ActorCache::EntryMemoryStats ActorCache::getEntryMemoryStats() {
+  return EntrySlab::get().getStats();
+}
+
 ActorCache::Entry::~Entry() noexcept(false) {
   KJ_IF_SOME(c, maybeCache) {
     size_t size = this->size();
@@ -106,7 +402,9 @@ ActorCache::Entry::~Entry() noexcept(false) {
   }
 }
 
-ActorCache::SharedLru::SharedLru(Options options): options(options) {}
+ActorCache::SharedLru::SharedLru(Options options)
+    : options(options),
+      cleanList(options.softLimit / PROTECTED_DENOMINATOR * PROTECTED_NUMERATOR) {}
 
 ActorCache::SharedLru::~SharedLru() noexcept(false) {
   KJ_REQUIRE(cleanList.getWithoutLock().empty(),
@@ -117,6 +415,19 @@ ActorCache::SharedLru::~SharedLru() noexcept(false) {
   }
 }
 
+template <typename Func>
+void ActorCache::CleanList::forEach(Func&& func) {
+  for (auto list: { &probation, &protected_ }) {
+    auto iter = list->begin();
+    while (iter != list->end()) {
+      // Advance first, in case `func` removes the entry.
+      Entry& entry = *iter;
+      ++iter;
+      func(entry);
+    }
+  }
+}
+
 kj::Maybe<kj::Promise<void>> ActorCache::evictStale(kj::Date now) {
   int64_t nowNs = (now - kj::UNIX_EPOCH) / kj::NANOSECONDS;
   int64_t oldValue = lru.nextStaleCheckNs.load(std::memory_order_relaxed);
@@ -125,15 +436,17 @@ kj::Maybe<kj::Promise<void>> ActorCache::evictStale(kj::Date now) {
     int64_t newValue = nowNs + lru.options.staleTimeout / kj::NANOSECONDS;
     if (lru.nextStaleCheckNs.compare_exchange_strong(oldValue, newValue)) {
       auto lock = lru.cleanList.lockExclusive();
-      for (auto& entry: *lock) {
+      lock->forEach([&](Entry& entry) {
         if (entry.isStale) {
           auto& cache = KJ_ASSERT_NONNULL(entry.maybeCache);
           cache.removeEntry(lock, entry);
           cache.evictEntry(lock, entry);
+          ++cache.unreportedEvictions;
         } else {
           entry.isStale = true;
         }
-      }
+      });
+      reportEvictions(lock);
     }
   }
 
@@ -223,7 +536,9 @@ void ActorCache::requireNotTerminal() {
 }
 
 void ActorCache::evictOrOomIfNeeded(Lock& lock) {
-  if (lru.evictIfNeeded(lock)) {
+  bool oom = lru.evictIfNeeded(lock);
+  reportEvictions(lock);
+  if (oom) {
     auto exception = KJ_EXCEPTION(OVERLOADED,
         "broken.exceededMemory; jsg.Error: Durable Object's isolate exceeded its memory limit due to overflowing the "
         "storage cache. This could be due to writing too many values to storage without stopping "
@@ -243,6 +558,7 @@ void ActorCache::evictOrOomIfNeeded(Lock& lock) {
 
     clear(lock);
     oomCanceler.cancel(exception);
+    readAheadCanceler.cancel(exception);
 
     if (!gate.isBroken()) {
       // We want to break the OutputGate. We can't quite just do `gate.lockWhile(exception)` because
@@ -274,6 +590,85 @@ bool ActorCache::SharedLru::evictIfNeeded(Lock& lock) const {
     auto& cache = KJ_ASSERT_NONNULL(entry.maybeCache);
     cache.removeEntry(lock, entry);
     cache.evictEntry(lock, entry);
+    ++cache.unreportedEvictions;
+  }
+}
+
+void ActorCache::CleanList::add(Entry& entry) {
+  entry.isProtected = false;
+  probation.add(entry);
+}
+
+void ActorCache::CleanList::remove(Entry& entry) {
+  if (entry.isProtected) {
+    protected_.remove(entry);
+    protectedSize -= entry.size();
+    auto& cache = KJ_ASSERT_NONNULL(entry.maybeCache);
+    cache.protectedBytes -= entry.size();
+    if (cache.protectedBytes == 0) --protectedCacheCount;
+    entry.isProtected = false;
+  } else {
+    probation.remove(entry);
+  }
+}
+
+void ActorCache::CleanList::touch(Entry& entry) {
+  if (entry.isReadAhead) {
+    // The app is reading an entry that was read ahead of a list() scan for the first time, which
+    // is the entry's first use, not its second.
+    entry.isReadAhead = false;
+    probation.remove(entry);
+    probation.add(entry);
+    return;
+  }
+
+  if (entry.isProtected) {
+    protected_.remove(entry);
+    protected_.add(entry);
+    return;
+  }
+
+  probation.remove(entry);
+
+  auto& cache = KJ_ASSERT_NONNULL(entry.maybeCache);
+  uint sharers = protectedCacheCount + (cache.protectedBytes == 0);
+  if (cache.protectedBytes + entry.size() > protectedLimit / sharers) {
+    // This cache already has its share of the protected segment (or the entry is too big for it).
+    // The entry is recently used, but only within probation.
+    probation.add(entry);
+    return;
+  }
+
+  if (cache.protectedBytes == 0) ++protectedCacheCount;
+  cache.protectedBytes += entry.size();
+  protectedSize += entry.size();
+  entry.isProtected = true;
+  protected_.add(entry);
+
+  // The share check above means `entry` alone fits, so this never demotes it.
+  while (protectedSize > protectedLimit) {
+    demote(protected_.front());
+  }
+}
+
+ActorCache::Entry& ActorCache::CleanList::front() {
+  if (probation.empty()) {
+    return protected_.front();
+  } else {
+    return probation.front();
+  }
+}
+
+void ActorCache::CleanList::demote(Entry& entry) {
+  // Demoted entries go to the back of probation, so they still outlast anything older there.
+  remove(entry);
+  probation.add(entry);
+}
+
+void ActorCache::reportEvictions(Lock& lock) {
+  if (unreportedEvictions > 0) {
+    hooks.storageCacheEvictions(unreportedEvictions);
+    unreportedEvictions = 0;
   }
 }
 
@@ -281,8 +676,7 @@ void ActorCache::touchEntry(Lock& lock, Entry& entry, const ReadOptions& options
   if (!options.noCache) {
     if (!entry.isDirty()) {
       entry.isStale = false;
-      lock->remove(entry);
-      lock->add(entry);
+      lock->touch(entry);
     }
 
     // If this is a dirty entry previously marked no-cache, remove that mark. This results in the
@@ -373,9 +767,11 @@ kj::OneOf<kj::Maybe<ActorCache::Value>, kj::Promise<kj::Maybe<ActorCache::Value>
   switch (entry->valueStatus) {
     case EntryValueStatus::PRESENT:
     case EntryValueStatus::ABSENT: {
+      hooks.storageCacheHits(1);
       return entry->getValue();
     }
     case EntryValueStatus::UNKNOWN: {
+      hooks.storageCacheMisses(1);
       return getImpl(kj::mv(entry), options);
     }
   }
@@ -558,10 +954,12 @@ kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
     }
   }
 
+  if (cachedEntries.size() > 0) hooks.storageCacheHits(cachedEntries.size());
   if (keysToFetch.empty()) {
     // All satisfied, return early.
     return GetResultList(kj::mv(cachedEntries), {}, GetResultList::FORWARD);
   }
+  hooks.storageCacheMisses(keysToFetch.size());
 
   auto paf = kj::newPromiseAndFulfiller<GetResultList>();
   auto streamServer = kj::heap<GetMultiStreamImpl>(
@@ -711,23 +1109,30 @@ public:
                         kj::Vector<kj::Own<Entry>> cachedEntries,
                         kj::Own<kj::PromiseFulfiller<GetResultList>> fulfiller,
                         kj::Maybe<uint> originalLimit, kj::Maybe<uint> adjustedLimit,
-                        bool beginKeyIsKnown, const ReadOptions& options)
+                        kj::Maybe<uint> storageLimit, bool beginKeyIsKnown,
+                        const ReadOptions& options)
       : cache(cache), beginKey(kj::mv(beginKey)), endKey(kj::mv(endKey)),
         cachedEntries(kj::mv(cachedEntries)), fulfiller(kj::mv(fulfiller)),
-        originalLimit(originalLimit), adjustedLimit(adjustedLimit),
+        originalLimit(originalLimit), adjustedLimit(adjustedLimit), storageLimit(storageLimit),
         beginKeyIsKnown(beginKeyIsKnown), options(options) {}
 
   kj::Promise<void> values(ValuesContext context) override {
     if (!fulfiller->isWaiting()) {
-      // The original caller stopped listening. Try to cancel the stream by throwing.
-      return KJ_EXCEPTION(DISCONNECTED, "canceled");
+      if (!readingAhead) {
+        // The original caller stopped listening. Try to cancel the stream by throwing.
+        return KJ_EXCEPTION(DISCONNECTED, "canceled");
+      } else if (writeMayHaveOvertaken()) {
+        // Stop reading ahead. (Not DISCONNECTED, which scheduleStorageRead() would retry.)
+        return KJ_EXCEPTION(FAILED, "list() read-ahead abandoned after a write");
+      }
     }
 
     {
       auto lock = cache.lru.cleanList.lockExclusive();
       auto list = context.getParams().getList();
 
-      bool insertedAny = false;
+      kj::Own<Entry> lastEntry;
+      uint misses = 0;
 
       for (auto kv: list) {
         Key key = kj::str(kv.getKey().asChars());
@@ -751,29 +1156,37 @@ public:
 
         KJ_ASSERT(kv.hasValue());  // values that don't exist aren't listed!
         auto entry = cache.addReadResultToCache(lock, kj::mv(key), kv.getValue(), options);
-        fetchedEntries.add(kj::mv(entry));
-        insertedAny = true;
+        lastEntry = kj::atomicAddRef(*entry);
+        if (fulfiller->isWaiting() && fetchedCount < adjustedLimit.orDefault(kj::maxValue)) {
+          ++misses;
+          fetchedEntries.add(kj::mv(entry));
+        } else if (entry->syncStatus == EntrySyncStatus::CLEAN) {
+          // Past what the caller asked for, so we're reading ahead.
+          entry->isReadAhead = true;
+        }
+        ++fetchedCount;
       }
 
-      if (insertedAny) {
+      if (lastEntry.get() != nullptr) {
         // Update `gapIsKnownEmpty` on the whole range.
-        cache.markGapsEmpty(lock, beginKey, fetchedEntries.back()->key.asPtr(), options);
-        beginKey = cloneKey(fetchedEntries.back()->key);
+        cache.markGapsEmpty(lock, beginKey, lastEntry->key.asPtr(), options);
+        beginKey = cloneKey(lastEntry->key);
         beginKeyIsKnown = true;
       }
 
+      if (misses > 0) cache.hooks.storageCacheMisses(misses);
       cache.evictOrOomIfNeeded(lock);
     }
 
-    if (fetchedEntries.size() >= adjustedLimit.orDefault(kj::maxValue)) {
-      // Oh we're already done.
+    if (fulfiller->isWaiting() && fetchedCount >= adjustedLimit.orDefault(kj::maxValue)) {
+      // Oh we're already done. (Though if we're reading ahead, the stream continues.)
       fulfill();
     }
     return kj::READY_NOW;
   }
 
   kj::Promise<void> end(EndContext context) override {
-    if (!fulfiller->isWaiting()) {
+    if (!fulfiller->isWaiting() && (!readingAhead || writeMayHaveOvertaken())) {
       // Just ignore end() if we've already stopped waiting. In particular this happens in
       // limit requests that reach the limit -- the last call to values() will have already
       // fulfilled the fulfiller.
@@ -789,7 +1202,7 @@ public:
         markBeginAsEmpty(lock);
       }
 
-      if (fetchedEntries.size() < adjustedLimit.orDefault(kj::maxValue)) {
+      if (fetchedCount < storageLimit.orDefault(kj::maxValue)) {
         // We didn't reach the limit, so the rest of the range must be empty.
         cache.markGapsEmpty(lock, beginKey, endKey, options);
       }
@@ -797,16 +1210,35 @@ public:
       cache.evictOrOomIfNeeded(lock);
     }
 
-    fulfill();
+    if (fulfiller->isWaiting()) {
+      fulfill();
+    }
 
     return kj::READY_NOW;
   }
 
   void fulfill() {
-    fulfiller->fulfill(GetResultList(kj::mv(cachedEntries), kj::mv(fetchedEntries),
-                                     GetResultList::FORWARD, originalLimit));
+    auto results = GetResultList(kj::mv(cachedEntries), kj::mv(fetchedEntries),
+                                 GetResultList::FORWARD, originalLimit);
+    cache.finishListPage(results, originalLimit);
+    fulfiller->fulfill(kj::mv(results));
+    releaseReadCompletion();
   };
 
+  // Lets writes go ahead of the rest of a read-ahead. See `readCompletion`.
+  void releaseReadCompletion() {
+    if (readCompletion != kj::none) {
+      writesReleasedAtRelease = cache.writesReleased;
+      readCompletion = kj::none;
+    }
+  }
+
+  // Whether a write may have reached storage since we stopped holding back writes, in which case
+  // the rest of the stream could be older than the cache and must not be cached.
+  bool writeMayHaveOvertaken() const {
+    return readCompletion == kj::none && cache.writesReleased != writesReleasedAtRelease;
+  }
+
   // Mark the start of the list operation will a null entry, because we did not see it listed.
   //
   // Note that this insertion attempt will be ignored in two cases:
@@ -828,6 +1260,7 @@ public:
     KJ_ASSERT(!fulfiller->isWaiting());  // proves further RPCs will be ignored
     cachedEntries.clear();
     fetchedEntries.clear();
+    releaseReadCompletion();
   }
 
   ActorCache& cache;
@@ -845,18 +1278,36 @@ public:
   // Entries we gathered from cache.
   kj::Vector<kj::Own<Entry>> cachedEntries;
 
-  // Entries that have streamed in from disk.
+  // Entries that have streamed in from disk, up to `adjustedLimit` of them.
   kj::Vector<kj::Own<Entry>> fetchedEntries;
 
+  // Number of entries that have streamed in from disk, including those read ahead.
+  uint fetchedCount = 0;
+
   // Fulfiller for the final results.
   kj::Own<kj::PromiseFulfiller<GetResultList>> fulfiller;
 
   // The original requested limit, if any.
   kj::Maybe<uint> originalLimit;
 
-  // The limit we sent to storage.
+  // The limit needed to satisfy the original limit.
   kj::Maybe<uint> adjustedLimit;
 
+  // The limit we sent to storage. More than `adjustedLimit` if we're reading ahead.
+  kj::Maybe<uint> storageLimit;
+
+  // Set while the storage read is reading ahead. If so, we continue to cache what it streams
+  // after the caller has its results, or has gone away.
+  bool readingAhead = false;
+
+  // When reading ahead, the storage read doesn't hold back writes for its whole duration (see
+  // waitForPastReads()), only until the caller has its results. This reference does that instead
+  // of the one scheduleStorageRead() would hold, so that a long read-ahead can't delay flushes.
+  kj::Maybe<kj::Own<ReadCompletionChain>> readCompletion;
+
+  // `cache.writesReleased` as of releaseReadCompletion().
+  uint writesReleasedAtRelease = 0;
+
   // Does `beginKey` point to a key where we already know the associated value? This is
   // especially true when `beginKey` points to the last entry of a previous batch received via
   // a call to `values()`.
@@ -865,6 +1316,84 @@ public:
   ReadOptions options;
 };
 
+void ActorCache::startListPage(KeyPtr beginKey, kj::Maybe<KeyPtr> endKey,
+                               kj::Maybe<uint> limit) {
+  auto continuesScan = [&]() {
+    KJ_IF_SOME(lastKey, listScan.lastKey) {
+      if (limit.orDefault(0) != listScan.pageSize) return false;
+
+      KJ_IF_SOME(e, endKey) {
+        KJ_IF_SOME(scanEnd, listScan.endKey) {
+          if (e != scanEnd) return false;
+        } else {
+          return false;
+        }
+      } else if (listScan.endKey != kj::none) {
+        return false;
+      }
+
+      // The page may start at the last key of the previous page, or just after it, as when the
+      // app passes that key as `startAfter`.
+      return beginKey == lastKey ||
+          (beginKey.size() == lastKey.size() + 1 && beginKey.startsWith(lastKey) &&
+           beginKey[lastKey.size()] == '\0');
+    } else {
+      return false;
+    }
+  };
+
+  if (continuesScan()) {
+    ++listScan.pages;
+    listScan.lastKey = kj::none;
+  } else KJ_IF_SOME(l, limit) {
+    listScan = {
+      .endKey = endKey.map([](KeyPtr k) { return cloneKey(k); }),
+      .pageSize = l,
+    };
+  } else {
+    listScan = {};
+  }
+}
+
+void ActorCache::finishListPage(const GetResultList& results, kj::Maybe<uint> limit) {
+  KJ_IF_SOME(l, limit) {
+    if (l > 0 && l == listScan.pageSize && results.size() == l) {
+      size_t bytes = 0;
+      for (auto& kv: results) {
+        bytes += sizeof(Entry) + kv.key.size() + kv.value.size();
+      }
+      listScan.bytesPerKey = bytes / l;
+      listScan.lastKey = cloneKey(results.end()[-1].key);
+      return;
+    }
+  }
+
+  // A short page means the scan reached the end of its range.
+  listScan.lastKey = kj::none;
+}
+
+uint ActorCache::readAheadSize(uint limit, const ReadOptions& options) {
+  if (options.noCache || lru.options.maxListReadAheadKeys == 0 ||
+      listScan.pages < READ_AHEAD_AFTER_PAGES) {
+    return 0;
+  }
+
+  // Having to go to storage again means the app used up what we read ahead last time, so read
+  // further this time.
+  uint pages = kj::min(kj::max(listScan.readAheadPages * 2, 1u), MAX_READ_AHEAD_PAGES);
+  listScan.readAheadPages = pages;
+
+  // But don't let read-ahead push out much of what's already cached. The previous page tells us
+  // roughly how big the entries will be.
+  size_t used = lru.currentSize();
+  size_t room = used < lru.options.softLimit ? lru.options.softLimit - used : 0;
+  size_t affordable = room / READ_AHEAD_ROOM_DIVISOR /
+      kj::max(listScan.bytesPerKey, sizeof(Entry));
+
+  return kj::min(kj::min(size_t(pages) * limit, affordable),
+                 size_t(lru.options.maxListReadAheadKeys));
+}
+
 kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
     ActorCache::list(Key beginKey, kj::Maybe<Key> endKey,
                      kj::Maybe<uint> limit, ReadOptions options) {
@@ -885,6 +1414,8 @@ kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
     return ActorCache::GetResultList(kj::mv(cachedEntries), {}, GetResultList::FORWARD);
   }
 
+  startListPage(beginKey, endKey, limit);
+
   uint limitAdjustment = 0;
   // When requesting to storage, we need to adjust the limit to increase it by the number of cached
   // negative entries in the range, since each of those negative entries could potentially negate a
@@ -993,22 +1524,38 @@ kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
     touchEntry(lock, **iter, options);
   }
 
+  if (cachedEntries.size() > 0) hooks.storageCacheHits(cachedEntries.size());
   if (storageListStart == kj::none || knownPrefixSize >= limit.orDefault(kj::maxValue)) {
     // We fully satisfied the list operation from cache.
-    return GetResultList(kj::mv(cachedEntries), {}, GetResultList::FORWARD, limit);
+    auto results = GetResultList(kj::mv(cachedEntries), {}, GetResultList::FORWARD, limit);
+    finishListPage(results, limit);
+    return kj::mv(results);
   }
 
   auto adjustedLimit = limit.map([&](uint orig) {
     return orig + limitAdjustment - knownPrefixSize;
   });
 
+  // If this call continues a scan, list the following pages too, so they'll come from cache.
+  uint readAhead = 0;
+  auto storageLimit = adjustedLimit.map([&](uint adjusted) {
+    readAhead = kj::min(readAheadSize(KJ_ASSERT_NONNULL(limit), options),
+                        uint(kj::maxValue) - adjusted);
+    return adjusted + readAhead;
+  });
+
   auto paf = kj::newPromiseAndFulfiller<GetResultList>();
   auto streamServer = kj::heap<ForwardListStreamImpl>(
       *this, cloneKey(KJ_ASSERT_NONNULL(storageListStart)), kj::mv(endKey),
-      kj::mv(cachedEntries), kj::mv(paf.fulfiller), limit, adjustedLimit,
+      kj::mv(cachedEntries), kj::mv(paf.fulfiller), limit, adjustedLimit, storageLimit,
       storageListStartIsKnown, options);
   auto& streamServerRef = *streamServer;
 
+  if (readAhead > 0) {
+    streamServerRef.readingAhead = true;
+    streamServerRef.readCompletion = kj::addRef(*readCompletionChain);
+  }
+
   rpc::ActorStorage::ListStream::Client streamClient = kj::mv(streamServer);
 
   auto sendPromise = scheduleStorageRead(
@@ -1041,18 +1588,33 @@ kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
       req.setEnd(e.asBytes());
     }
 
-    KJ_IF_SOME(l, streamServerRef.adjustedLimit) {
-      if (streamServerRef.fetchedEntries.size() >= l) {
+    KJ_IF_SOME(l, streamServerRef.storageLimit) {
+      if (streamServerRef.fetchedCount >= l) {
         // Oh it turns out we actually satisfied the limit already so we don't actually have to
         // retry. The fulfiller would have already been fulfilled.
         return kj::READY_NOW;
       }
-      req.setLimit(l - streamServerRef.fetchedEntries.size());
+      req.setLimit(l - streamServerRef.fetchedCount);
     }
 
     req.setStream(streamClient);
     return req.send().ignoreResult();
-  });
+  }, readAhead == 0);
+
+  if (readAhead > 0) {
+    // The caller's results are ready as soon as the pages it asked for have streamed in, but the
+    // storage read must not be canceled along with the caller's promise, or we'd lose the pages
+    // read ahead. So we let a branch of it run to completion in the background.
+    auto forked = sendPromise.fork();
+    readAheadCanceler.wrap(forked.addBranch()
+        .attach(kj::defer([client = streamClient, &streamServerRef]() {
+      streamServerRef.readingAhead = false;
+    }))).detach([](kj::Exception&&) {
+      // Failing to read ahead only means the next list() will go to storage. If the caller is
+      // still waiting, it gets the exception from its own branch.
+    });
+    sendPromise = forked.addBranch();
+  }
 
   // Wait on the RPC only until stream.end() is called, then report the results. We prevent
   // `stream` from being destroyed until we have a result so that if the RPC throws an exception,
@@ -1095,6 +1657,7 @@ public:
     {
       auto lock = cache.lru.cleanList.lockExclusive();
       auto list = context.getParams().getList();
+      cache.hooks.storageCacheMisses(list.size());
 
       bool insertedAny = false;
 
@@ -1317,6 +1880,7 @@ kj::OneOf<ActorCache::GetResultList, kj::Promise<ActorCache::GetResultList>>
     nextKey = entry.key;
   }
 
+  if (cachedEntries.size() > 0) hooks.storageCacheHits(cachedEntries.size());
   if (storageListEnd == kj::none || knownSuffixSize >= limit.orDefault(kj::maxValue)) {
     // We fully satisfied the list operation from cache.
     return GetResultList(kj::mv(cachedEntries), {}, GetResultList::REVERSE, limit);
@@ -1430,7 +1994,7 @@ kj::Own<ActorCache::Entry> ActorCache::addReadResultToCache(
   if (options.noCache) {
     // We don't actually want to add this to the cache, just return the entry.
     KJ_IF_SOME(reader, maybeReader) {
-      return kj::atomicRefcounted<Entry>(kj::mv(key), kj::heapArray(reader));
+      return kj::atomicRefcounted<Entry>(Entry::copyPayload(key, reader));
     } else {
       return kj::atomicRefcounted<Entry>(kj::mv(key), EntryValueStatus::ABSENT);
     }
@@ -1440,7 +2004,7 @@ kj::Own<ActorCache::Entry> ActorCache::addReadResultToCache(
 
   kj::Own<Entry> entry;
   KJ_IF_SOME(reader, maybeReader) {
-    entry = kj::atomicRefcounted<Entry>(*this, kj::mv(key), kj::heapArray(reader));
+    entry = kj::atomicRefcounted<Entry>(*this, Entry::copyPayload(key, reader));
   } else {
     // Inserting a negative entry. Let's check if the new insertion is redundant due to the
     // previous entry having `gapIsKnownEmpty`.
@@ -1669,13 +2233,32 @@ void ActorCache::markGapsEmpty(Lock& lock, KeyPtr beginKey, kj::Maybe<KeyPtr> en
   }
 }
 
-ActorCache::GetResultList::GetResultList(kj::Vector<KeyValuePair> contents)
-    : entries(contents.size()), cacheStatuses(contents.size()) {
-  // TODO(perf): Allocating an `Entry` object for every key/value pair is lame but to avoid it
-  //   we'd have to make the common case worse...
+ActorCache::GetResultList::GetResultList(kj::Vector<KeyValuePair> contentsParam)
+    : pairs(contentsParam.size()), contents(kj::mv(contentsParam)) {
   for (auto& kv: contents) {
-    entries.add(kj::atomicRefcounted<Entry>(kj::mv(kv.key), kj::mv(kv.value)));
-    cacheStatuses.add(CacheStatus::UNCACHED);
+    pairs.add(kv, CacheStatus::UNCACHED);
+  }
+}
+
+ActorCache::GetResultList ActorCache::GetResultList::borrowed(Producer producer) {
+  GetResultList result;
+  result.producer = kj::mv(producer);
+  return result;
+}
+
+void ActorCache::GetResultList::forEach(
+    kj::FunctionParam<void(KeyValuePtrPairWithCache)> callback) {
+  KJ_IF_SOME(p, producer) {
+    // Moved out first so that a borrowed list can't be consumed twice.
+    auto ownProducer = kj::mv(p);
+    producer = kj::none;
+    ownProducer([&](KeyPtr key, ValuePtr value) {
+      callback(KeyValuePtrPairWithCache(key, value, CacheStatus::UNCACHED));
+    });
+  } else {
+    for (auto& pair: pairs) {
+      callback(pair);
+    }
   }
 }
 
@@ -1692,21 +2275,23 @@ ActorCache::GetResultList::GetResultList(
     kj::Vector<kj::Own<Entry>> cachedEntries, kj::Vector<kj::Own<Entry>> fetchedEntries,
     Order order, kj::Maybe<uint> maybeLimit) {
   uint limit = maybeLimit.orDefault(kj::maxValue);
-  entries.reserve(kj::min(cachedEntries.size() + fetchedEntries.size(), limit));
+  size_t capacity = kj::min(cachedEntries.size() + fetchedEntries.size(), limit);
+  pairs.reserve(capacity);
+  entries.reserve(capacity);
 
   auto cachedIter = cachedEntries.begin();
   auto fetchedIter = fetchedEntries.begin();
 
   auto add = [&](kj::Own<ActorCache::Entry>&& entry, CacheStatus status) {
     // Remove null values.
-    if (entry->valueStatus == ActorCache::EntryValueStatus::PRESENT) {
+    KJ_IF_SOME(value, entry->getValuePtr()) {
+      pairs.add(entry->key, value, status);
       entries.add(kj::mv(entry));
-      cacheStatuses.add(status);
     }
   };
 
   while ((cachedIter != cachedEntries.end() || fetchedIter != fetchedEntries.end()) &&
-        entries.size() < limit) {
+        pairs.size() < limit) {
     if (cachedIter == cachedEntries.end()) {
       add(kj::mv(*fetchedIter++), CacheStatus::UNCACHED);
     } else if (fetchedIter == fetchedEntries.end()) {
@@ -1729,28 +2314,30 @@ ActorCache::GetResultList::GetResultList(
 #ifdef KJ_DEBUG
   // Verify sort.
   kj::Maybe<KeyPtr> prev;
-  for (auto& entry: entries) {
+  for (auto& pair: pairs) {
     KJ_IF_SOME(p, prev) {
       if (order == REVERSE) {
-        KJ_ASSERT(entry->key < p);
+        KJ_ASSERT(pair.key < p);
       } else {
-        KJ_ASSERT(entry->key > p);
+        KJ_ASSERT(pair.key > p);
       }
     }
-    prev = entry->key;
+    prev = pair.key;
   }
 #endif
 }
 
 template <typename Func>
 kj::PromiseForResult<Func, rpc::ActorStorage::Operations::Client> ActorCache::scheduleStorageRead(
-    Func&& function) {
+    Func&& function, bool holdsReadCompletion) {
   // This is basically kj::retryOnDisconnect() except that we make the first call synchronously.
   // For our use case, this is safe, and I wanted to make sure reads get sent concurrently with
   // futher JavaScript execution if possible.
   auto promise = kj::evalNow([&]() mutable {
     return function(storage).attach(recordStorageRead(hooks, clock));
   });
+  kj::Maybe<kj::Own<ReadCompletionChain>> readCompletion;
+  if (holdsReadCompletion) readCompletion = kj::addRef(*readCompletionChain);
   return oomCanceler.wrap(promise.catch_(
       [this, function = kj::mv(function)](kj::Exception&& e) mutable
       -> kj::PromiseForResult<Func, rpc::ActorStorage::Operations::Client> {
@@ -1759,12 +2346,13 @@ kj::PromiseForResult<Func, rpc::ActorStorage::Operations::Client> ActorCache::sc
     } else {
       return kj::mv(e);
     }
-  }).attach(kj::addRef(*readCompletionChain)));
+  }).attach(kj::mv(readCompletion)));
 }
 
 kj::Promise<void> ActorCache::waitForPastReads() {
   if (!readCompletionChain->isShared()) {
     // No reads are in flight right now.
+    ++writesReleased;
     return kj::READY_NOW;
   }
 
@@ -1780,7 +2368,7 @@ kj::Promise<void> ActorCache::waitForPastReads() {
   // Make `next` the current link.
   readCompletionChain = kj::mv(next);
 
-  return kj::mv(paf.promise);
+  return paf.promise.then([this]() { ++writesReleased; });
 }
 
 ActorCache::ReadCompletionChain::~ReadCompletionChain() noexcept(false) {
@@ -1798,7 +2386,8 @@ kj::Maybe<kj::Promise<void>> ActorCache::put(Key key, Value value, WriteOptions
   {
     auto lock = lru.cleanList.lockExclusive();
     kj::Maybe<CountedDelete> maybeCountedDelete;
-    auto entry = kj::atomicRefcounted<Entry>(*this, kj::mv(key), kj::mv(value));
+    auto entry = kj::atomicRefcounted<Entry>(
+        *this, Entry::compactPayload(kj::mv(key), kj::mv(value)));
     putImpl(lock, kj::mv(entry), options, maybeCountedDelete);
     evictOrOomIfNeeded(lock);
   }
@@ -1812,7 +2401,8 @@ kj::Maybe<kj::Promise<void>> ActorCache::put(kj::Array<KeyValuePair> pairs, Writ
     auto lock = lru.cleanList.lockExclusive();
     for (auto& pair: pairs) {
       kj::Maybe<CountedDelete> maybeCountedDelete;
-      auto entry = kj::atomicRefcounted<Entry>(*this, kj::mv(pair.key), kj::mv(pair.value));
+      auto entry = kj::atomicRefcounted<Entry>(
+          *this, Entry::compactPayload(kj::mv(pair.key), kj::mv(pair.value)));
       putImpl(lock, kj::mv(entry), options, maybeCountedDelete);
     }
     evictOrOomIfNeeded(lock);
@@ -2244,6 +2834,8 @@ using RpcDeleteRequest = capnp::Request<rpc::ActorStorage::Operations::DeletePar
 }
 
 kj::Promise<void> ActorCache::flushImpl(uint retryCount) {
+  TRACE_EVENT("workerd", "ActorCache::flushImpl()", "retryCount", retryCount);
+
   KJ_IF_SOME(e, maybeTerminalException) {
     // If we have a terminal exception, throw here to break the output gate and prevent any calls
     // to storage. This does not use `requireNotTerminal()` so that we don't recursively schedule
@@ -2445,6 +3037,14 @@ kj::Promise<void> ActorCache::flushImpl(uint retryCount) {
     useTransactionToFlush();
   }
 
+  // The slice ends when the storage operations settle, or when they're canceled by OOM or by
+  // the cache being destroyed.
+  TRACE_EVENT_BEGIN("workerd", "ActorCache::flushImpl() waiting on storage",
+      PERFETTO_TRACK_FROM_POINTER(this));
+  flushProm = kj::mv(flushProm).attach(kj::defer([this]() {
+    TRACE_EVENT_END("workerd", PERFETTO_TRACK_FROM_POINTER(this));
+  }));
+
   return oomCanceler.wrap(kj::mv(flushProm)).then([this, deleteAllUpcoming]() -> kj::Promise<void> {
     // Success!
     KJ_SWITCH_ONEOF(currentAlarmTime) {
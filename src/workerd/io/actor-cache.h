@@ -257,6 +257,13 @@ public:
     virtual void storageReadCompleted(kj::Duration latency) {}
     virtual void storageWriteCompleted(kj::Duration latency) {}
 
+    // Used to track how well the cache is working. A hit is a key read from cache, a miss is a key
+    // that had to be read from storage, and evictions counts this cache's entries evicted to make
+    // room, whichever actor's operation caused it. Always called on the cache's own thread.
+    virtual void storageCacheHits(uint count) {}
+    virtual void storageCacheMisses(uint count) {}
+    virtual void storageCacheEvictions(uint count) {}
+
     static Hooks DEFAULT;
   };
 
@@ -299,6 +306,20 @@ public:
   // Check for inconsistencies in the cache, e.g. redundant entries.
   void verifyConsistencyForTest();
 
+  // Memory used by cache entries across all caches in the process.
+  struct EntryMemoryStats {
+    // Memory obtained from the system for slabs. Slabs are returned once empty, apart from a
+    // small number kept for reuse.
+    size_t slabBytes = 0;
+
+    // Bytes of slab blocks currently handed out.
+    size_t blockBytesInUse = 0;
+
+    // Entries and payloads too large for a slab block are allocated directly.
+    size_t largeBytesInUse = 0;
+  };
+  static EntryMemoryStats getEntryMemoryStats();
+
 private:
   // Backs the `kj::Own<void>` returned by `armAlarmHandler()`.
   class DeferredAlarmDeleter: public kj::Disposer {
@@ -385,13 +406,42 @@ private:
     // `lru.cleanList`. `key` and `value` are declared `const` so that they can safely be used
     // without a lock.
 
+    struct Payload;
+
     Entry(ActorCache& cache, Key key, Value value);
+    Entry(ActorCache& cache, Payload payload);
     Entry(ActorCache& cache, Key key, EntryValueStatus status);
     Entry(Key key, Value value);
+    Entry(Payload payload);
     Entry(Key key, EntryValueStatus status);
     ~Entry() noexcept(false);
     KJ_DISALLOW_COPY_AND_MOVE(Entry);
 
+    // Entries come from a process-wide slab allocator rather than straight from malloc(), since
+    // an actor may cache millions of them. See `EntrySlab` in actor-cache.c++.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
+    // A key and value to construct an entry from, as returned by copyPayload() and
+    // compactPayload().
+    struct Payload {
+      Key key;
+      Value value;
+
+      // Bytes of the block holding both `key` and `value`, or 0 if they are allocated separately.
+      size_t blockSize = 0;
+    };
+
+    // Copies a key and value read from storage into a single slab block, for use as the `key`
+    // and `value` of a new entry. Together with the entry itself, a cached pair then costs two
+    // slab blocks instead of three separate heap allocations, and the value sits next to its key.
+    static Payload copyPayload(KeyPtr key, ValuePtr value);
+
+    // Like copyPayload() but for a key and value that are already owned, as with put(). Small
+    // payloads are copied into a slab block and the originals freed; larger ones are returned as-is
+    // rather than copied.
+    static Payload compactPayload(Key key, Value value);
+
     kj::Maybe<ActorCache&> maybeCache;
     const Key key;
 
@@ -406,6 +456,9 @@ private:
     // from cache and needs to remember the original cached values even if they are overwritten
     // before the read completes.
     const Value value;
+
+    // See Payload::blockSize.
+    const size_t payloadBlockSize = 0;
   public:
     EntryValueStatus valueStatus;
     kj::Maybe<ValuePtr> getValuePtr() const {
@@ -443,6 +496,13 @@ private:
 
     bool isStale = false;
 
+    // If CLEAN, whether the entry is in the clean list's protected segment rather than probation.
+    bool isProtected = false;
+
+    // Whether the entry was read ahead of a list() scan and hasn't been read by the app yet. The
+    // first read of such an entry doesn't count towards promoting it out of probation.
+    bool isReadAhead = false;
+
     // If true, then a past list() operation covered the space between this entry and the following
     // entry, meaning that we know for sure that there are no other keys on disk between them.
     bool gapIsKnownEmpty = false;
@@ -472,9 +532,9 @@ private:
     // If DIRTY or FLUSHING, the entry will be in `dirtyList`.
     kj::ListLink<Entry> link;
 
-    size_t size() const {
-      return sizeof(*this) + key.size() + value.size();
-    }
+    // Memory charged to the SharedLru for this entry. Slab blocks count at their full, rounded-up
+    // size, so that the LRU's limits bound what the entries actually hold.
+    size_t size() const;
   };
 
   // Callbacks for a kj::TreeIndex for a kj::Table<kj::Own<Entry>>.
@@ -546,6 +606,57 @@ private:
   // FLUSHING entries are present, they always appear strictly before DIRTY entries.
   DirtyList dirtyList;
 
+  // The CLEAN entries of all caches sharing a SharedLru, as a segmented LRU.
+  //
+  // Entries that become clean start out in `probation`. An entry that is read again while in
+  // probation is promoted to `protected_`, and eviction takes entries from probation first. The
+  // protected segment is capped at `protectedLimit` bytes, demoting its least recently used
+  // entries back to probation when it overflows, and each cache may hold at most an even share of
+  // it among the caches that have protected entries. So a large list() by one actor streams its
+  // entries through probation without pushing other actors' frequently read keys out of cache,
+  // and no single actor can take over the protected segment.
+  //
+  // Both lists are ordered from least to most recently used.
+  class CleanList {
+  public:
+    explicit CleanList(size_t protectedLimit): protectedLimit(protectedLimit) {}
+
+    // Adds a newly clean entry to the back of probation.
+    void add(Entry& entry);
+    void remove(Entry& entry);
+
+    // Records a read of an entry in the list, promoting it if it is in probation.
+    void touch(Entry& entry);
+
+    bool empty() const { return probation.empty() && protected_.empty(); }
+
+    // Returns the entry to evict next. The list must not be empty.
+    Entry& front();
+
+    // Calls `func` on every entry. `func` may remove the entry it is given.
+    template <typename Func>
+    void forEach(Func&& func);
+
+  private:
+    kj::List<Entry, &Entry::link> probation;
+    kj::List<Entry, &Entry::link> protected_;
+    size_t protectedLimit;
+    size_t protectedSize = 0;
+
+    // Number of caches with at least one entry in `protected_`.
+    uint protectedCacheCount = 0;
+
+    void demote(Entry& entry);
+  };
+
+  // Bytes of this cache's entries in the clean list's protected segment. Protected by the
+  // SharedLru lock.
+  size_t protectedBytes = 0;
+
+  // This cache's entries evicted since they were last reported to `hooks`. Protected by the
+  // SharedLru lock, since other actors' operations may evict our entries.
+  uint unreportedEvictions = 0;
+
   // Map of current known values for keys. Searchable by key, including ordered iteration.
   //
   // This map is protected by the same lock as lru.cleanList. ExternalMutexGuarded helps enforce
@@ -586,6 +697,11 @@ private:
   // Used to implement waitForPastReads(). See that function to understand how it works...
   kj::Own<ReadCompletionChain> readCompletionChain = kj::refcounted<ReadCompletionChain>();
 
+  // Number of times waitForPastReads() has let a write go ahead. A list() reading ahead stops
+  // holding back writes once its caller has its results, and uses this to notice that a write may
+  // have reached storage before the rest of its read.
+  uint writesReleased = 0;
+
   // True if ensureFlushScheduled() has been called but the flush has not started yet.
   bool flushScheduled = false;
 
@@ -623,13 +739,61 @@ private:
   // Will be canceled if and when `oomException` becomes non-null.
   kj::Canceler oomCanceler;
 
+  // State of a forward list() scan that pages through the key space, each call with the same
+  // limit and end, starting just after the last key the previous call returned. Once a scan has
+  // been going for a few pages, list() reads further ahead than the page it needs, so that the
+  // next pages are served from cache. See `ActorCacheSharedLruOptions::maxListReadAheadKeys`.
+  struct ListScan {
+    // Last key of the previous page, if it was a full page (so the scan may continue).
+    kj::Maybe<Key> lastKey;
+    kj::Maybe<Key> endKey;
+    uint pageSize = 0;
+
+    // Number of pages so far that continued the scan.
+    uint pages = 0;
+
+    // Average cache footprint of the keys in the previous page.
+    size_t bytesPerKey = 0;
+
+    // Pages read ahead by the last list() of this scan that went to storage.
+    uint readAheadPages = 0;
+  };
+  ListScan listScan;
+
+  // Wraps the part of each list() storage read that continues after the caller's page has been
+  // delivered. Canceled on OOM, and on destruction so that no stream outlives the cache.
+  kj::Canceler readAheadCanceler;
+
+  // Start reading ahead once a scan has continued for this many pages.
+  static constexpr uint READ_AHEAD_AFTER_PAGES = 2;
+
+  // Read ahead at most this many pages. Each read-ahead from storage doubles the number of pages,
+  // up to this limit.
+  static constexpr uint MAX_READ_AHEAD_PAGES = 8;
+
+  // Read ahead at most this fraction of the SharedLru's remaining room under its soft limit.
+  static constexpr uint READ_AHEAD_ROOM_DIVISOR = 4;
+
+  // Updates `listScan` for a forward list() call about to be performed.
+  void startListPage(KeyPtr beginKey, kj::Maybe<KeyPtr> endKey, kj::Maybe<uint> limit);
+
+  // Updates `listScan` with the results of a forward list() call.
+  void finishListPage(const GetResultList& results, kj::Maybe<uint> limit);
+
+  // How many keys a forward list() call with the given limit should read from storage beyond
+  // what it needs.
+  uint readAheadSize(uint limit, const ReadOptions& options);
+
   // Type of a lock on `SharedLru::cleanList`. We use the same lock to protect `currentValues`.
-  typedef kj::Locked<kj::List<Entry, &Entry::link>> Lock;
+  typedef kj::Locked<CleanList> Lock;
 
-  // Indicate that an entry was observed by a read operation and so should be moved to the end of
-  // the LRU queue (unless the options say otherwise).
+  // Indicate that an entry was observed by a read operation and so should be moved towards the
+  // end of the LRU queue (unless the options say otherwise).
   void touchEntry(Lock& lock, Entry& entry, const ReadOptions& options);
 
+  // Reports `unreportedEvictions` to `hooks`.
+  void reportEvictions(Lock& lock);
+
   // TODO(soon) This function mostly belongs on the SharedLru, not the ActorCache. Notably,
   // `removeEntry()` has to do with the shared clean list but `evictEntry()` has to do with
   // the non-shared map. It is like this for now because generalizing the SharedLru into an
@@ -674,9 +838,12 @@ private:
   // Note that `function()` must return a plain `Promise`, not a `capnp::RemotePromise`, because
   // it is necessary to `.attach()` something to it. Use `.dropPipeline()` to convert a
   // `RemotePromise` to a plain `Promise`.
+  //
+  // If `holdsReadCompletion` is false, the caller takes care of holding a reference to
+  // `readCompletionChain` for as long as writes must wait for the read.
   template <typename Func>
   kj::PromiseForResult<Func, rpc::ActorStorage::Operations::Client> scheduleStorageRead(
-      Func&& function);
+      Func&& function, bool holdsReadCompletion = true);
 
   // Wait until all read operations that are currently in-flight have completed or failed
   // (including exhausting all retries). Does not propagate the read exception, if any. This is
@@ -739,46 +906,50 @@ private:
 class ActorCacheOps::GetResultList {
   using Entry = ActorCache::Entry;
 public:
-  class Iterator {
-  public:
-    KeyValuePtrPairWithCache operator*() {
-      KJ_IREQUIRE(ptr->get()->valueStatus == ActorCache::EntryValueStatus::PRESENT);
-      return { ptr->get()->key, ptr->get()->getValuePtr().orDefault({}), *statusPtr };
-    }
-    Iterator& operator++() {
-      ++ptr;
-      ++statusPtr;
-      return *this;
-    }
-    Iterator operator++(int) {
-      auto copy = *this;
-      ++ptr;
-      ++statusPtr;
-      return copy;
-    }
-    bool operator==(const Iterator& other) const {
-      return ptr == other.ptr && statusPtr == other.statusPtr;
-    }
-
-  private:
-    const kj::Own<Entry>* ptr;
-    const CacheStatus* statusPtr;
-
-    explicit Iterator(const kj::Own<Entry>* ptr, const CacheStatus* statusPtr)
-        : ptr(ptr), statusPtr(statusPtr) {}
-    friend class GetResultList;
-  };
-
-  Iterator begin() const { return Iterator(entries.begin(), cacheStatuses.begin()); }
-  Iterator end() const { return Iterator(entries.end(), cacheStatuses.end()); }
-  size_t size() const { return entries.size(); }
+  using Iterator = const KeyValuePtrPairWithCache*;
+
+  // Iteration and size() are only available on lists that own their entries, i.e. not on
+  // borrowed lists. Use forEach() to consume either kind.
+  Iterator begin() const {
+    KJ_REQUIRE(producer == kj::none, "borrowed GetResultList must be consumed with forEach()");
+    return pairs.begin();
+  }
+  Iterator end() const { return pairs.end(); }
+  size_t size() const {
+    KJ_REQUIRE(producer == kj::none, "borrowed GetResultList has no size until consumed");
+    return pairs.size();
+  }
+
+  // Calls `callback` with each key/value pair, in order. For a borrowed list, the key and value
+  // point into the underlying storage and are only valid during the call, and the list can only
+  // be consumed once.
+  void forEach(kj::FunctionParam<void(KeyValuePtrPairWithCache)> callback);
 
   // Construct a simple GetResultList from key-value pairs.
   explicit GetResultList(kj::Vector<KeyValuePair> contents);
 
+  // Reads the results on demand. The producer is called once, from forEach(), and calls its
+  // argument with each key/value pair in order, passing pointers that need only stay valid for
+  // the duration of that call. This lets a storage backend that can read synchronously (namely
+  // ActorSqlite) hand out pointers into its own buffers, so that the values can be parsed
+  // without being copied first.
+  //
+  // Since the read happens when the list is consumed rather than when it is created, a borrowed
+  // list must be consumed before any other operation is performed on the same storage.
+  using Producer = kj::Function<void(kj::FunctionParam<void(KeyPtr, ValuePtr)>)>;
+  static GetResultList borrowed(Producer producer);
+
 private:
+  // The results, in order, as one contiguous array of key/value spans. The bytes they point to
+  // are owned by `entries` (for results that passed through the cache) or `contents`.
+  kj::Vector<KeyValuePtrPairWithCache> pairs;
   kj::Vector<kj::Own<Entry>> entries;
-  kj::Vector<CacheStatus> cacheStatuses;
+  kj::Vector<KeyValuePair> contents;
+
+  // Non-null for a borrowed list that hasn't been consumed yet.
+  kj::Maybe<Producer> producer;
+
+  GetResultList() = default;
 
   enum Order {
     FORWARD,
@@ -832,6 +1003,11 @@ struct ActorCacheSharedLruOptions {
   // If true, don't actually flush anything. This is used in preview sessions, since they keep
   // state strictly in memory.
   bool neverFlush = false;
+
+  // Maximum number of keys a forward list() may read from storage beyond what it needs, when it
+  // continues a scan that pages through the key space, so that the next pages are served from
+  // cache. Zero disables read-ahead.
+  uint maxListReadAheadKeys = 0;
 };
 
 class ActorCache::SharedLru {
@@ -849,9 +1025,13 @@ public:
 private:
   Options options;
 
-  // List of clean values, across all caches, ordered from least-recently-used to
-  // most-recently-used.
-  kj::MutexGuarded<kj::List<Entry, &Entry::link>> cleanList;
+  // Clean values across all caches. See `CleanList` for the eviction policy.
+  kj::MutexGuarded<CleanList> cleanList;
+
+  // The share of the soft limit available to the clean list's protected segment. The rest is left
+  // to probation, i.e. entries read only once, such as those of a scan.
+  static constexpr size_t PROTECTED_NUMERATOR = 3;
+  static constexpr size_t PROTECTED_DENOMINATOR = 4;
 
   // Total byte size of everything that is cached, including dirty values that are not in `list`.
   mutable std::atomic<size_t> size = 0;
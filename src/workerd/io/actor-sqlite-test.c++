@@ -0,0 +1,91 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "actor-sqlite.h"
+#include "io-gate.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+struct ActorSqliteTest {
+  kj::EventLoop loop;
+  kj::WaitScope ws;
+  kj::Own<const kj::Directory> dir;
+  SqliteDatabase::Vfs vfs;
+  OutputGate gate;
+  ActorSqlite actor;
+
+  ActorSqliteTest()
+      : ws(loop),
+        dir(kj::newInMemoryDirectory(kj::nullClock())),
+        vfs(*dir),
+        actor(kj::heap<SqliteDatabase>(vfs, kj::Path({"foo"}),
+                                       kj::WriteMode::CREATE | kj::WriteMode::MODIFY),
+              gate, []() -> kj::Promise<void> { return kj::READY_NOW; }) {}
+
+  void put(kj::StringPtr key, kj::StringPtr value) {
+    KJ_EXPECT(actor.put(kj::str(key), kj::heapArray(value.asBytes()), {}) == kj::none);
+  }
+
+  // Consumes a borrowed list, the way DurableObjectStorage does.
+  static kj::String stringify(ActorCacheOps::GetResultList list) {
+    kj::Vector<kj::String> parts;
+    list.forEach([&](ActorCacheOps::KeyValuePtrPairWithCache pair) {
+      parts.add(kj::str(pair.key, "=", pair.value.asChars()));
+    });
+    return kj::strArray(parts, ", ");
+  }
+
+  static ActorCacheOps::GetResultList expectReady(
+      kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>> result) {
+    KJ_SWITCH_ONEOF(result) {
+      KJ_CASE_ONEOF(list, ActorCacheOps::GetResultList) {
+        return kj::mv(list);
+      }
+      KJ_CASE_ONEOF(promise, kj::Promise<ActorCacheOps::GetResultList>) {
+        KJ_FAIL_ASSERT("ActorSqlite reads should be synchronous");
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+};
+
+KJ_TEST("ActorSqlite get() and list() results are read through borrowed lists") {
+  ActorSqliteTest test;
+
+  test.put("foo", "abc");
+  test.put("bar", "def");
+  test.put("baz", "123");
+  test.put("qux", "321");
+
+  KJ_EXPECT(test.stringify(test.expectReady(test.actor.get(
+      kj::arr(kj::str("qux"), kj::str("corge"), kj::str("bar")), {}))) == "bar=def, qux=321");
+
+  KJ_EXPECT(test.stringify(test.expectReady(test.actor.list(
+      kj::str("bar"), kj::str("foo"), kj::none, {}))) == "bar=def, baz=123");
+  KJ_EXPECT(test.stringify(test.expectReady(test.actor.list(
+      kj::str(""), kj::none, 3u, {}))) == "bar=def, baz=123, foo=abc");
+  KJ_EXPECT(test.stringify(test.expectReady(test.actor.listReverse(
+      kj::str(""), kj::none, 2u, {}))) == "qux=321, foo=abc");
+
+  // Values written after the list was returned but before it was consumed are seen, since the
+  // query only runs in forEach().
+  auto list = test.expectReady(test.actor.list(kj::str("bar"), kj::str("baz"), kj::none, {}));
+  test.put("bar", "xyz");
+  KJ_EXPECT(test.stringify(kj::mv(list)) == "bar=xyz");
+}
+
+KJ_TEST("ActorSqlite borrowed lists can't be iterated directly") {
+  ActorSqliteTest test;
+
+  test.put("foo", "abc");
+
+  auto list = test.expectReady(test.actor.list(kj::str(""), kj::none, kj::none, {}));
+  KJ_EXPECT_THROW_MESSAGE("must be consumed with forEach()", list.begin());
+  KJ_EXPECT_THROW_MESSAGE("has no size until consumed", list.size());
+}
+
+}  // namespace
+}  // namespace workerd
@@ -196,15 +196,14 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
     ActorSqlite::get(kj::Array<Key> keys, ReadOptions options) {
   requireNotBroken();
 
-  kj::Vector<KeyValuePair> results;
-  for (auto& key: keys) {
-    kv.get(key, [&](ValuePtr value) {
-      results.add(KeyValuePair { kj::mv(key), kj::heapArray(value) });
-    });
-  }
-  std::sort(results.begin(), results.end(),
-      [](auto& a, auto& b) { return a.key < b.key; });
-  return GetResultList(kj::mv(results));
+  std::sort(keys.begin(), keys.end());
+  return GetResultList::borrowed(
+      [this, keys = kj::mv(keys)](kj::FunctionParam<void(KeyPtr, ValuePtr)> callback) {
+    requireNotBroken();
+    for (auto& key: keys) {
+      kv.get(key, [&](ValuePtr value) { callback(key, value); });
+    }
+  });
 }
 
 kj::OneOf<kj::Maybe<kj::Date>, kj::Promise<kj::Maybe<kj::Date>>> ActorSqlite::getAlarm(
@@ -218,13 +217,13 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
     ActorSqlite::list(Key begin, kj::Maybe<Key> end, kj::Maybe<uint> limit, ReadOptions options) {
   requireNotBroken();
 
-  kj::Vector<KeyValuePair> results;
-  kv.list(begin, end, limit, SqliteKv::FORWARD, [&](KeyPtr key, ValuePtr value) {
-    results.add(KeyValuePair { kj::str(key), kj::heapArray(value) });
-  });
-
   // Already guaranteed sorted.
-  return GetResultList(kj::mv(results));
+  return GetResultList::borrowed(
+      [this, begin = kj::mv(begin), end = kj::mv(end), limit]
+      (kj::FunctionParam<void(KeyPtr, ValuePtr)> callback) mutable {
+    requireNotBroken();
+    kv.list(begin, end, limit, SqliteKv::FORWARD, callback);
+  });
 }
 
 kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList>>
@@ -232,13 +231,13 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
                                ReadOptions options) {
   requireNotBroken();
 
-  kj::Vector<KeyValuePair> results;
-  kv.list(begin, end, limit, SqliteKv::REVERSE, [&](KeyPtr key, ValuePtr value) {
-    results.add(KeyValuePair { kj::str(key), kj::heapArray(value) });
-  });
-
   // Already guaranteed sorted (reversed).
-  return GetResultList(kj::mv(results));
+  return GetResultList::borrowed(
+      [this, begin = kj::mv(begin), end = kj::mv(end), limit]
+      (kj::FunctionParam<void(KeyPtr, ValuePtr)> callback) mutable {
+    requireNotBroken();
+    kv.list(begin, end, limit, SqliteKv::REVERSE, callback);
+  });
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::put(Key key, Value value, WriteOptions options) {
@@ -10,12 +10,12 @@
 namespace workerd {
 
 // An implementation of ActorCacheOps that is backed by SqliteKv.
+//
+// Multi-key get() and list() return borrowed GetResultLists: the query runs when the caller
+// consumes the list with forEach(), which receives pointers directly into SQLite's row buffers,
+// so `DurableObjectStorageOperations` deserializes each value without an intermediate copy.
 class ActorSqlite final: public ActorCacheInterface, private kj::TaskSet::ErrorHandler {
-  // TODO(perf): This interface is not designed ideally for wrapping SqliteKv. In particular, we
-  //   end up allocating extra copies of all the results. It would be nicer if we could actually
-  //   parse the V8-serialized values directly from the blob pointers that SQLite spits out.
-  //   However, that probably requires rewriting `DurableObjectStorageOperations`. For now, hooking
-  //   here is easier and not too costly.
+  // TODO(perf): Single-key get() still copies the value, since it returns a Maybe<Value>.
 
 public:
   // Hooks to configure ActorSqlite behavior, right now only used to allow plugging in a backend
@@ -9,6 +9,7 @@
 #include <workerd/jsg/jsg.h>
 #include <workerd/util/sentry.h>
 #include <workerd/util/uncaught-exception-source.h>
+#include <workerd/util/use-perfetto-categories.h>
 #include <map>
 
 namespace workerd {
@@ -1017,6 +1018,8 @@ void IoContext::runImpl(Runnable& runnable, bool takePendingEvent,
                         Worker::LockType lockType,
                         kj::Maybe<InputGate::Lock> inputLock,
                         bool allowPermanentException) {
+  TRACE_EVENT("workerd", "IoContext::runImpl()");
+
   KJ_IF_SOME(l, inputLock) {
     KJ_REQUIRE(l.isFor(KJ_ASSERT_NONNULL(actor).getInputGate()));
   }
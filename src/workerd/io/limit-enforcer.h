@@ -6,6 +6,7 @@
 
 #include <workerd/jsg/jsg.h>
 #include <workerd/io/observer.h>
+#include <workerd/util/shared-tee.h>
 
 namespace workerd {
 
@@ -14,6 +15,19 @@ class IoContext;
 
 static constexpr size_t DEFAULT_MAX_PBKDF2_ITERATIONS = 100'000;
 
+// Controls how small writes are coalesced when a JavaScript-backed ReadableStream is pumped to a
+// native sink, such as when a worker returns a Response whose body is a JS ReadableStream.
+struct WriteCoalescingOptions {
+  // Writes smaller than this are buffered and written together once this many bytes have
+  // accumulated. Zero disables coalescing.
+  size_t maxBytes = 16 * 1024;
+
+  // Buffered bytes are written no later than this long after the first of them arrived, even if
+  // the producer keeps the event loop busy. Regardless of this setting, buffered bytes are always
+  // written as soon as the event loop becomes idle.
+  kj::Duration maxDelay = 10 * kj::MILLISECONDS;
+};
+
 // Interface for an object that enforces resource limits on an Isolate level.
 //
 // See also LimitEnforcer, which enforces on a per-request level.
@@ -131,6 +145,18 @@ public:
   // data in C++ memory, such as reading an entire HTTP response into an `ArrayBuffer`.
   virtual size_t getBufferingLimit() = 0;
 
+  // Gets how many bytes one branch of a tee'd stream may fall behind another.
+  virtual size_t getTeeLagLimit() { return getBufferingLimit(); }
+
+  // Gets what tee() should do when one branch of a tee'd stream falls more than
+  // getTeeLagLimit() bytes behind another.
+  virtual TeeLagPolicy getTeeLagPolicy() { return TeeLagPolicy::ERROR_LAGGING_BRANCH; }
+
+  // Gets the options to use when coalescing writes of a JavaScript-backed ReadableStream that is
+  // being pumped to a native sink. Coalescing delays writes, so it's off unless the embedder
+  // turns it on.
+  virtual WriteCoalescingOptions getWriteCoalescingOptions() { return { .maxBytes = 0 }; }
+
   // If a limit has been exceeded which prevents further JavaScript execution, such as the CPU or
   // memory limit, returns a request status code indicating which one. Returns null if no limits
   // are exceeded.
@@ -146,6 +172,12 @@ public:
 
   // Report resource usage metrics to the given request metrics object.
   virtual void reportMetrics(RequestObserver& requestMetrics) = 0;
+
+  // Called when work done on another thread on behalf of this request, such as SubtleCrypto work
+  // on the crypto thread pool, has finished. `time` is the CPU time the work used, which
+  // enterJs() could not see. Implementations which limit CPU time should count it toward the
+  // limit.
+  virtual void chargeOffThreadCpu(kj::Duration time) {}
 };
 
 }  // namespace workerd
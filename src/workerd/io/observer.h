@@ -221,6 +221,11 @@ public:
   virtual void storageReadCompleted(kj::Duration latency) {}
   virtual void storageWriteCompleted(kj::Duration latency) {}
 
+  // Storage cache effectiveness. See ActorCache::Hooks.
+  virtual void storageCacheHits(uint32_t count) {}
+  virtual void storageCacheMisses(uint32_t count) {}
+  virtual void storageCacheEvictions(uint32_t count) {}
+
   virtual void inputGateLocked() {}
   virtual void inputGateReleased() {}
   virtual void inputGateWaiterAdded() {}
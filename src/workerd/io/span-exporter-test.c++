@@ -0,0 +1,190 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "span-exporter.h"
+#include <kj/compat/http.h>
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+class CountingEntropySource final: public kj::EntropySource {
+public:
+  void generate(kj::ArrayPtr<kj::byte> buffer) override {
+    for (auto& b: buffer) b = counter++;
+  }
+
+private:
+  kj::byte counter = 1;
+};
+
+// Records each batch written, and completes writes only when told to.
+struct Writes {
+  kj::Vector<kj::String> batches;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> pending;
+  bool autoComplete = true;
+
+  SpanExporter::WriteFunc func() {
+    return [this](kj::String batch) -> kj::Promise<void> {
+      batches.add(kj::mv(batch));
+      if (autoComplete) return kj::READY_NOW;
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pending.add(kj::mv(paf.fulfiller));
+      return kj::mv(paf.promise);
+    };
+  }
+
+  void completeAll() {
+    for (auto& fulfiller: pending) fulfiller->fulfill();
+    pending.clear();
+  }
+};
+
+size_t countOccurrences(kj::StringPtr haystack, kj::StringPtr needle) {
+  size_t count = 0;
+  for (auto i: kj::indices(haystack)) {
+    if (haystack.slice(i).startsWith(needle)) ++count;
+  }
+  return count;
+}
+
+KJ_TEST("SpanExporter writes spans as OTLP/JSON") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  CountingEntropySource entropy;
+
+  Writes writes;
+  SpanExporter exporter(timer, { .serviceName = kj::str("test"), .maxBatchSize = 2 },
+                        writes.func(), entropy);
+
+  // Counting entropy makes the IDs predictable: the trace ID takes bytes 1-16, the root span
+  // ID 17-24 and the child span ID 25-32.
+  {
+    auto start = kj::UNIX_EPOCH + 1 * kj::SECONDS;
+    SpanBuilder root(exporter.newTrace(), "request"_kjc, start);
+    auto child = root.newChild("fetch"_kjc, start + 1 * kj::MILLISECONDS);
+    child.setTag("http.status"_kjc, static_cast<int64_t>(200));
+    child.setTag("url"_kjc, kj::str("https://example.com/\"quoted\""));
+    child.addLog(start + 2 * kj::MILLISECONDS, "retry"_kjc, true);
+  }
+  ws.poll();
+
+  KJ_ASSERT(writes.batches.size() == 1);
+  auto& batch = writes.batches[0];
+  KJ_EXPECT(batch.startsWith(
+      "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\","
+      "\"value\":{\"stringValue\":\"test\"}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"workerd\"},"
+      "\"spans\":["), batch);
+  KJ_EXPECT(batch.endsWith("]}]}]}\n"), batch);
+  KJ_EXPECT(countOccurrences(batch, "\n") == 1);
+
+  // The child ends first, so it comes first.
+  KJ_EXPECT(batch.contains(
+      "{\"traceId\":\"0102030405060708090a0b0c0d0e0f10\",\"spanId\":\"191a1b1c1d1e1f20\","
+      "\"parentSpanId\":\"1112131415161718\",\"name\":\"fetch\","
+      "\"startTimeUnixNano\":\"1001000000\",\"endTimeUnixNano\":"), batch);
+  KJ_EXPECT(batch.contains(
+      "\"attributes\":[{\"key\":\"http.status\",\"value\":{\"intValue\":\"200\"}},"
+      "{\"key\":\"url\",\"value\":{\"stringValue\":\"https://example.com/\\\"quoted\\\"\"}}],"
+      "\"events\":[{\"timeUnixNano\":\"1002000000\",\"name\":\"retry\",\"attributes\":"
+      "[{\"key\":\"retry\",\"value\":{\"boolValue\":true}}]}]}"), batch);
+  KJ_EXPECT(batch.contains(
+      "{\"traceId\":\"0102030405060708090a0b0c0d0e0f10\",\"spanId\":\"1112131415161718\","
+      "\"name\":\"request\",\"startTimeUnixNano\":\"1000000000\""), batch);
+
+  KJ_EXPECT(exporter.getStats().batchesDelivered == 1);
+  KJ_EXPECT(exporter.getStats().itemsDelivered == 2);
+}
+
+KJ_TEST("SpanExporter writes partial batches after a delay") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  CountingEntropySource entropy;
+
+  Writes writes;
+  SpanExporter exporter(timer, { .maxBatchSize = 10 }, writes.func(), entropy);
+
+  SpanBuilder(exporter.newTrace(), "a"_kjc).end();
+  ws.poll();
+  KJ_EXPECT(writes.batches.size() == 0);
+
+  timer.advanceTo(timer.now() + 1 * kj::SECONDS);
+  ws.poll();
+  KJ_ASSERT(writes.batches.size() == 1);
+  KJ_EXPECT(countOccurrences(writes.batches[0], "\"traceId\"") == 1);
+}
+
+KJ_TEST("SpanExporter drops spans when the output falls behind") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  CountingEntropySource entropy;
+
+  Writes writes;
+  writes.autoComplete = false;
+  SpanExporter exporter(timer, { .maxBufferedSpans = 5, .maxBatchSize = 2 }, writes.func(),
+                        entropy);
+
+  // The first two go out in a batch but still count until the write finishes. The next three
+  // fill the buffer, and the rest are dropped.
+  for (auto i KJ_UNUSED: kj::zeroTo(7)) {
+    SpanBuilder(exporter.newTrace(), "span"_kjc).end();
+  }
+  KJ_EXPECT(writes.batches.size() == 1);
+  KJ_EXPECT(exporter.getStats().itemsDropped == 2);
+
+  // Flushing writes what's left, one batch at a time.
+  auto flushed = exporter.flush();
+  KJ_EXPECT(!flushed.poll(ws));
+  writes.completeAll();
+  ws.poll();
+  KJ_EXPECT(writes.batches.size() == 2);
+  writes.completeAll();
+  ws.poll();
+  KJ_EXPECT(writes.batches.size() == 3);
+  writes.completeAll();
+  flushed.wait(ws);
+
+  KJ_EXPECT(exporter.getStats().itemsDelivered == 5);
+  KJ_EXPECT(exporter.getStats().batchesDelivered == 3);
+}
+
+KJ_TEST("SpanExporter counts failed writes") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  CountingEntropySource entropy;
+
+  SpanExporter exporter(timer, { .maxBatchSize = 1 },
+      [](kj::String) -> kj::Promise<void> {
+    return KJ_EXCEPTION(DISCONNECTED, "socket closed");
+  }, entropy);
+
+  SpanBuilder(exporter.newTrace(), "span"_kjc).end();
+  exporter.flush().wait(ws);
+  KJ_EXPECT(exporter.getStats().batchesFailed == 1);
+  KJ_EXPECT(exporter.getStats().itemsFailed == 1);
+}
+
+KJ_TEST("SpanExporter observers may outlive the exporter") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  CountingEntropySource entropy;
+
+  Writes writes;
+  auto exporter = kj::heap<SpanExporter>(timer, SpanExporter::Options {}, writes.func(), entropy);
+  SpanBuilder span(exporter->newTrace(), "span"_kjc);
+  exporter = nullptr;
+
+  auto child = span.newChild("child"_kjc);
+  child.end();
+  span.end();
+  KJ_EXPECT(writes.batches.size() == 0);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,238 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "span-exporter.h"
+#include <kj/compat/http.h>
+#include <kj/debug.h>
+#include <cmath>
+
+namespace workerd {
+
+namespace {
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+void appendJsonString(kj::Vector<char>& out, kj::StringPtr text) {
+  out.add('"');
+  for (char c: text) {
+    switch (c) {
+      case '\"': out.addAll("\\\""_kj); break;
+      case '\\': out.addAll("\\\\"_kj); break;
+      case '\b': out.addAll("\\b"_kj); break;
+      case '\f': out.addAll("\\f"_kj); break;
+      case '\n': out.addAll("\\n"_kj); break;
+      case '\r': out.addAll("\\r"_kj); break;
+      case '\t': out.addAll("\\t"_kj); break;
+      default:
+        if (static_cast<uint8_t>(c) < 0x20) {
+          out.addAll("\\u00"_kj);
+          out.add(HEX_DIGITS[static_cast<uint8_t>(c) / 16]);
+          out.add(HEX_DIGITS[static_cast<uint8_t>(c) % 16]);
+        } else {
+          out.add(c);
+        }
+        break;
+    }
+  }
+  out.add('"');
+}
+
+// OTLP/JSON encodes trace and span IDs as lowercase hex rather than the base64 that the protobuf
+// JSON mapping would otherwise use for bytes fields.
+void appendJsonHex(kj::Vector<char>& out, kj::ArrayPtr<const kj::byte> bytes) {
+  out.add('"');
+  for (kj::byte b: bytes) {
+    out.add(HEX_DIGITS[b >> 4]);
+    out.add(HEX_DIGITS[b & 0xf]);
+  }
+  out.add('"');
+}
+
+// 64-bit integers are written as strings, per the protobuf JSON mapping.
+void appendJsonInt64(kj::Vector<char>& out, int64_t value) {
+  out.add('"');
+  out.addAll(kj::str(value));
+  out.add('"');
+}
+
+void appendUnixNanos(kj::Vector<char>& out, kj::Date date) {
+  appendJsonInt64(out, (date - kj::UNIX_EPOCH) / kj::NANOSECONDS);
+}
+
+void appendAnyValue(kj::Vector<char>& out, const Span::TagValue& value) {
+  KJ_SWITCH_ONEOF(value) {
+    KJ_CASE_ONEOF(b, bool) {
+      out.addAll(b ? "{\"boolValue\":true}"_kj : "{\"boolValue\":false}"_kj);
+    }
+    KJ_CASE_ONEOF(i, int64_t) {
+      out.addAll("{\"intValue\":"_kj);
+      appendJsonInt64(out, i);
+      out.add('}');
+    }
+    KJ_CASE_ONEOF(d, double) {
+      out.addAll("{\"doubleValue\":"_kj);
+      if (std::isnan(d)) {
+        out.addAll("\"NaN\""_kj);
+      } else if (std::isinf(d)) {
+        out.addAll(d > 0 ? "\"Infinity\""_kj : "\"-Infinity\""_kj);
+      } else {
+        out.addAll(kj::str(d));
+      }
+      out.add('}');
+    }
+    KJ_CASE_ONEOF(s, kj::String) {
+      out.addAll("{\"stringValue\":"_kj);
+      appendJsonString(out, s);
+      out.add('}');
+    }
+  }
+}
+
+void appendKeyValue(kj::Vector<char>& out, kj::StringPtr key, const Span::TagValue& value) {
+  out.addAll("{\"key\":"_kj);
+  appendJsonString(out, key);
+  out.addAll(",\"value\":"_kj);
+  appendAnyValue(out, value);
+  out.add('}');
+}
+
+kj::String finishString(kj::Vector<char>& out) {
+  out.add('\0');
+  return kj::String(out.releaseAsArray());
+}
+
+}  // namespace
+
+class SpanExporter::Observer final: public SpanObserver {
+public:
+  Observer(kj::Own<Link> link, TraceId traceId, kj::Maybe<SpanId> parentId, SpanId spanId)
+      : link(kj::mv(link)), traceId(traceId), parentId(parentId), spanId(spanId) {}
+
+  kj::Own<SpanObserver> newChild() override {
+    SpanId childId {};
+    KJ_IF_SOME(exporter, link->exporter) {
+      childId = exporter.newSpanId();
+    }
+    return kj::refcounted<Observer>(kj::addRef(*link), traceId, spanId, childId);
+  }
+
+  void report(const Span& span) override {
+    KJ_IF_SOME(exporter, link->exporter) {
+      exporter.batcher.add(serialize(span));
+    }
+  }
+
+private:
+  kj::Own<Link> link;
+  TraceId traceId;
+  kj::Maybe<SpanId> parentId;
+  SpanId spanId;
+
+  // Serializes a `Span` message.
+  kj::String serialize(const Span& span) {
+    kj::Vector<char> out(256);
+    out.addAll("{\"traceId\":"_kj);
+    appendJsonHex(out, traceId.asPtr());
+    out.addAll(",\"spanId\":"_kj);
+    appendJsonHex(out, spanId.asPtr());
+    KJ_IF_SOME(p, parentId) {
+      out.addAll(",\"parentSpanId\":"_kj);
+      appendJsonHex(out, p.asPtr());
+    }
+    out.addAll(",\"name\":"_kj);
+    appendJsonString(out, span.operationName);
+    out.addAll(",\"startTimeUnixNano\":"_kj);
+    appendUnixNanos(out, span.startTime);
+    out.addAll(",\"endTimeUnixNano\":"_kj);
+    appendUnixNanos(out, span.endTime);
+
+    out.addAll(",\"attributes\":["_kj);
+    bool first = true;
+    for (auto& tag: span.tags) {
+      if (!first) out.add(',');
+      first = false;
+      appendKeyValue(out, tag.key, tag.value);
+    }
+    out.add(']');
+
+    // Logs map to span events named after the log's key, with the value as a like-named
+    // attribute.
+    if (span.logs.size() > 0) {
+      out.addAll(",\"events\":["_kj);
+      first = true;
+      for (auto& log: span.logs) {
+        if (!first) out.add(',');
+        first = false;
+        out.addAll("{\"timeUnixNano\":"_kj);
+        appendUnixNanos(out, log.timestamp);
+        out.addAll(",\"name\":"_kj);
+        appendJsonString(out, log.tag.key);
+        out.addAll(",\"attributes\":["_kj);
+        appendKeyValue(out, log.tag.key, log.tag.value);
+        out.addAll("]}"_kj);
+      }
+      out.add(']');
+    }
+    if (span.droppedLogs > 0) {
+      out.addAll(",\"droppedEventsCount\":"_kj);
+      out.addAll(kj::str(span.droppedLogs));
+    }
+
+    out.add('}');
+    return finishString(out);
+  }
+};
+
+SpanExporter::SpanExporter(kj::Timer& timer, Options options, WriteFunc write,
+                           kj::EntropySource& entropySource)
+    : serviceName(kj::mv(options.serviceName)), write(kj::mv(write)),
+      entropySource(entropySource), link(kj::refcounted<Link>()),
+      batcher(timer, {
+          .maxBatchItems = options.maxBatchSize,
+          .maxDelay = options.maxDelay,
+          .maxBufferedItems = options.maxBufferedSpans,
+        },
+        [this](kj::Array<kj::String> spans) { return writeBatch(kj::mv(spans)); },
+        [](const kj::String& span) { return span.size(); }) {
+  KJ_REQUIRE(options.maxBufferedSpans > 0);
+  link->exporter = *this;
+}
+
+SpanExporter::~SpanExporter() noexcept(false) {
+  link->exporter = kj::none;
+}
+
+kj::Own<SpanObserver> SpanExporter::newTrace() {
+  TraceId traceId;
+  entropySource.generate(traceId.asPtr());
+  return kj::refcounted<Observer>(kj::addRef(*link), traceId, kj::none, newSpanId());
+}
+
+SpanExporter::SpanId SpanExporter::newSpanId() {
+  SpanId spanId;
+  entropySource.generate(spanId.asPtr());
+  return spanId;
+}
+
+kj::Promise<void> SpanExporter::writeBatch(kj::Array<kj::String> spans) {
+  // Build an `ExportTraceServiceRequest` with all of the spans in a single scope.
+  kj::Vector<char> out(spans.size() * 256);
+  out.addAll("{\"resourceSpans\":[{\"resource\":{\"attributes\":["_kj);
+  appendKeyValue(out, "service.name"_kj, kj::str(serviceName));
+  out.addAll("]},\"scopeSpans\":[{\"scope\":{\"name\":\"workerd\"},\"spans\":["_kj);
+  for (auto i: kj::indices(spans)) {
+    if (i > 0) out.add(',');
+    out.addAll(spans[i]);
+  }
+  out.addAll("]}]}]}\n"_kj);
+
+  auto count = spans.size();
+  return kj::evalNow([&]() { return write(finishString(out)); })
+      .catch_([count](kj::Exception&& exception) {
+    KJ_LOG(WARNING, "failed to write span batch", count, exception);
+    kj::throwFatalException(kj::mv(exception));
+  });
+}
+
+}  // namespace workerd
@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/trace.h>
+#include <workerd/util/batcher.h>
+#include <kj/async.h>
+#include <kj/function.h>
+#include <kj/timer.h>
+
+namespace workerd {
+
+// A SpanObserver back-end which writes spans out locally, in batches, using the OTLP/JSON
+// encoding of an `ExportTraceServiceRequest`:
+//
+//     https://opentelemetry.io/docs/specs/otlp/#json-protobuf-encoding
+//
+// Each batch is written as a single line, so the output can be appended to a file and read by
+// the OpenTelemetry Collector's `otlpjsonfile` receiver, or streamed to a socket.
+//
+// Spans are serialized when they are reported and held until they are written. If the output
+// falls behind and `maxBufferedSpans` are waiting or being written, new spans are dropped (and
+// counted) rather than applying backpressure to the requests being traced. The exporter and all
+// of its observers belong to the thread that created the exporter, so the buffer needs no
+// locking.
+class SpanExporter final {
+public:
+  struct Options {
+    // Reported as the `service.name` resource attribute.
+    kj::String serviceName = kj::str("workerd");
+
+    // Spans waiting or being written beyond which new spans are dropped.
+    size_t maxBufferedSpans = 4096;
+
+    // A batch is written as soon as this many spans are waiting...
+    size_t maxBatchSize = 512;
+
+    // ...or once the oldest waiting span has waited this long.
+    kj::Duration maxDelay = 1 * kj::SECONDS;
+  };
+
+  using Stats = BatcherStats;
+
+  // Writes one batch, including the trailing newline. Only one write is in flight at a time.
+  using WriteFunc = kj::Function<kj::Promise<void>(kj::String batch)>;
+
+  SpanExporter(kj::Timer& timer, Options options, WriteFunc write,
+               kj::EntropySource& entropySource);
+  ~SpanExporter() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(SpanExporter);
+
+  // Returns an observer for the root span of a new trace, with a fresh trace ID. Observers may
+  // outlive the exporter, in which case their spans are discarded.
+  kj::Own<SpanObserver> newTrace();
+
+  // Starts writing everything that is waiting without waiting for a full batch, and returns a
+  // promise that resolves once nothing is waiting or in flight.
+  kj::Promise<void> flush() { return batcher.flush(); }
+
+  const Stats& getStats() const { return batcher.getStats(); }
+
+private:
+  using TraceId = kj::FixedArray<kj::byte, 16>;
+  using SpanId = kj::FixedArray<kj::byte, 8>;
+
+  class Observer;
+
+  // Shared by the exporter and its observers, so that observers can tell when the exporter is
+  // gone.
+  struct Link: public kj::Refcounted {
+    kj::Maybe<SpanExporter&> exporter;
+  };
+
+  kj::String serviceName;
+  WriteFunc write;
+  kj::EntropySource& entropySource;
+  kj::Own<Link> link;
+
+  // Serialized spans. Declared last so that an in-flight write is canceled before anything it
+  // refers to is destroyed.
+  Batcher<kj::String> batcher;
+
+  SpanId newSpanId();
+  kj::Promise<void> writeBatch(kj::Array<kj::String> spans);
+};
+
+}  // namespace workerd
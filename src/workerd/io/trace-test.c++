@@ -0,0 +1,151 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "trace.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+kj::Own<Trace> makeTrace() {
+  return kj::refcounted<Trace>(kj::none, kj::none, kj::none, kj::none, nullptr, kj::none);
+}
+
+// Records each batch it's asked to deliver, and completes deliveries only when told to.
+struct Deliveries {
+  kj::Vector<size_t> batchSizes;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> pending;
+
+  TraceBatcher::DeliverFunc func() {
+    return [this](kj::Array<kj::Own<Trace>> batch) -> kj::Promise<void> {
+      batchSizes.add(batch.size());
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pending.add(kj::mv(paf.fulfiller));
+      return kj::mv(paf.promise);
+    };
+  }
+
+  void completeAll() {
+    for (auto& fulfiller: pending) fulfiller->fulfill();
+    pending.clear();
+  }
+};
+
+KJ_TEST("TraceBatcher delivers full batches right away") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  TraceBatcher batcher(timer, { .maxBatchSize = 3, .maxConcurrentDeliveries = 2 },
+                       deliveries.func());
+
+  for (int i = 0; i < 7; i++) {
+    KJ_EXPECT(batcher.add(makeTrace()));
+  }
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({3, 3}).asPtr());
+
+  deliveries.completeAll();
+  ws.poll();
+  KJ_EXPECT(batcher.getStats().batchesDelivered == 2);
+  KJ_EXPECT(batcher.getStats().itemsDelivered == 6);
+
+  // The leftover trace goes out once it has waited long enough.
+  timer.advanceTo(timer.now() + 500 * kj::MILLISECONDS);
+  ws.poll();
+  KJ_EXPECT(deliveries.batchSizes.size() == 2);
+  timer.advanceTo(timer.now() + 500 * kj::MILLISECONDS);
+  ws.poll();
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({3, 3, 1}).asPtr());
+}
+
+KJ_TEST("TraceBatcher limits concurrent deliveries") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  TraceBatcher batcher(timer, { .maxBatchSize = 2 }, deliveries.func());
+
+  batcher.addAll(kj::arr(makeTrace(), makeTrace(), makeTrace(), makeTrace(), makeTrace()));
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({2}).asPtr());
+
+  // The next full batch starts as soon as the first one finishes...
+  deliveries.completeAll();
+  ws.poll();
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({2, 2}).asPtr());
+
+  // ...and the partial one once it's due, even if that's while a delivery is in flight.
+  timer.advanceTo(timer.now() + 1 * kj::SECONDS);
+  ws.poll();
+  KJ_EXPECT(deliveries.batchSizes.size() == 2);
+  deliveries.completeAll();
+  ws.poll();
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({2, 2, 1}).asPtr());
+}
+
+KJ_TEST("TraceBatcher drops traces when the tail worker falls behind") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  TraceBatcher batcher(timer, { .maxBatchSize = 2, .maxBufferedTraces = 4 }, deliveries.func());
+
+  // Two in flight and two waiting fill the buffer.
+  for (int i = 0; i < 4; i++) {
+    KJ_EXPECT(batcher.add(makeTrace()));
+  }
+  KJ_EXPECT(!batcher.add(makeTrace()));
+  KJ_EXPECT(!batcher.add(makeTrace()));
+  KJ_EXPECT(batcher.getStats().itemsDropped == 2);
+
+  // Finishing a delivery makes room again.
+  deliveries.completeAll();
+  ws.poll();
+  KJ_EXPECT(batcher.add(makeTrace()));
+  KJ_EXPECT(batcher.getStats().itemsDropped == 2);
+}
+
+KJ_TEST("TraceBatcher counts failed deliveries") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  TraceBatcher batcher(timer, { .maxBatchSize = 2 },
+      [](kj::Array<kj::Own<Trace>>) -> kj::Promise<void> {
+    return KJ_EXCEPTION(FAILED, "tail worker is broken");
+  });
+
+  batcher.add(makeTrace());
+  batcher.add(makeTrace());
+  batcher.flush().wait(ws);
+  KJ_EXPECT(batcher.getStats().batchesFailed == 1);
+  KJ_EXPECT(batcher.getStats().itemsFailed == 2);
+  KJ_EXPECT(batcher.getStats().itemsDelivered == 0);
+}
+
+KJ_TEST("TraceBatcher flush() sends partial batches") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  TraceBatcher batcher(timer, { .maxBatchSize = 10 }, deliveries.func());
+
+  batcher.flush().wait(ws);
+
+  batcher.add(makeTrace());
+  batcher.add(makeTrace());
+  auto flushed = batcher.flush();
+  KJ_EXPECT(deliveries.batchSizes.asPtr() == kj::heapArray<size_t>({2}).asPtr());
+  KJ_EXPECT(!flushed.poll(ws));
+
+  deliveries.completeAll();
+  flushed.wait(ws);
+  KJ_EXPECT(batcher.getStats().itemsDelivered == 2);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -699,4 +699,31 @@ void WorkerTracer::setTrace(rpc::Trace::Reader reader) {
   trace->mergeFrom(reader, pipelineLogLevel);
 }
 
+// =======================================================================================
+// TraceBatcher
+
+TraceBatcher::TraceBatcher(kj::Timer& timer, Options options, DeliverFunc deliver)
+    : batcher(timer, {
+        .maxBatchItems = options.maxBatchSize,
+        .maxDelay = options.maxDelay,
+        .maxBufferedItems = options.maxBufferedTraces,
+        .maxBufferedBytes = options.maxBufferedBytes,
+        .maxConcurrentBatches = options.maxConcurrentDeliveries,
+      },
+      [deliver = kj::mv(deliver)](kj::Array<kj::Own<Trace>> batch) mutable {
+        auto count = batch.size();
+        return kj::evalNow([&]() { return deliver(kj::mv(batch)); })
+            .catch_([count](kj::Exception&& exception) {
+          KJ_LOG(WARNING, "tail worker batch delivery failed", count, exception);
+          kj::throwFatalException(kj::mv(exception));
+        });
+      },
+      [](const kj::Own<Trace>& trace) { return sizeof(Trace) + trace->bytesUsed; }) {}
+
+void TraceBatcher::addAll(kj::Array<kj::Own<Trace>> traces) {
+  for (auto& trace: traces) {
+    add(kj::mv(trace));
+  }
+}
+
 } // namespace workerd
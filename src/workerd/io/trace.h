@@ -9,10 +9,12 @@
 #include <kj/refcount.h>
 #include <kj/string.h>
 #include <kj/time.h>
+#include <kj/timer.h>
 #include <kj/vector.h>
 #include <kj/map.h>
 #include <workerd/io/outcome.capnp.h>
 #include <workerd/io/worker-interface.capnp.h>
+#include <workerd/util/batcher.h>
 #include <workerd/util/own-util.h>
 #include <workerd/jsg/memory.h>
 
@@ -404,6 +406,50 @@ private:
   kj::Maybe<kj::Own<PipelineTracer>> parentPipeline;
 };
 
+// Buffers completed traces bound for one tail worker and delivers them in batches, so that the
+// tail worker's handler runs once per batch instead of once per traced request. Whoever owns the
+// tail worker's dispatch (in workerd, the Worker service whose config lists `tails`) creates one
+// TraceBatcher per tail worker and feeds it the results of PipelineTracer::onComplete().
+//
+// A batch is delivered once `maxBatchSize` traces are waiting, or once the oldest waiting trace
+// has waited `maxDelay`, whichever comes first. Traces that are waiting or being delivered count
+// against `maxBufferedTraces` and `maxBufferedBytes`; if the tail worker can't keep up, new
+// traces are dropped and counted rather than letting the backlog grow without bound.
+class TraceBatcher final {
+public:
+  struct Options {
+    size_t maxBatchSize = 100;
+    kj::Duration maxDelay = 1 * kj::SECONDS;
+    size_t maxBufferedTraces = 1000;
+    size_t maxBufferedBytes = 16 * 1024 * 1024;
+
+    // Batches beyond this many in flight wait for an earlier one to finish.
+    uint maxConcurrentDeliveries = 1;
+  };
+
+  using Stats = BatcherStats;
+
+  // Delivers one batch, typically by dispatching a TraceCustomEventImpl to the tail worker.
+  using DeliverFunc = kj::Function<kj::Promise<void>(kj::Array<kj::Own<Trace>>)>;
+
+  TraceBatcher(kj::Timer& timer, Options options, DeliverFunc deliver);
+
+  // Queues a completed trace for delivery. Returns false if it was dropped instead.
+  bool add(kj::Own<Trace> trace) { return batcher.add(kj::mv(trace)); }
+
+  // Queues all of a pipeline's traces.
+  void addAll(kj::Array<kj::Own<Trace>> traces);
+
+  // Starts delivering everything that is waiting without waiting for the batch to fill up, and
+  // returns a promise that resolves once nothing is waiting or in flight. Used when draining.
+  kj::Promise<void> flush() { return batcher.flush(); }
+
+  const Stats& getStats() const { return batcher.getStats(); }
+
+private:
+  Batcher<kj::Own<Trace>> batcher;
+};
+
 // =======================================================================================
 
 // Helper function used when setting "truncated_script_id" tags. Truncates the scriptId to 10
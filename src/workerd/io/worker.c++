@@ -9,8 +9,10 @@
 #include <workerd/util/batch-queue.h>
 #include <workerd/util/color-util.h>
 #include <workerd/util/mimetype.h>
+#include <workerd/util/pprof.h>
 #include <workerd/util/stream-utils.h>
 #include <workerd/util/thread-scopes.h>
+#include <workerd/util/use-perfetto-categories.h>
 #include <workerd/util/xthreadnotifier.h>
 #include <workerd/api/actor-state.h>
 #include <workerd/api/global-scope.h>
@@ -489,6 +491,13 @@ struct Worker::Isolate::Impl {
   kj::Maybe<std::unique_ptr<v8_inspector::V8Inspector>> inspector;
   InspectorPolicy inspectorPolicy;
   kj::Maybe<kj::Own<v8::CpuProfiler>> profiler;
+
+  // Profiler used by Worker::Lock::startCpuProfile(), separate from the inspector's so that the
+  // two don't interfere. Only set while a profile is being recorded.
+  kj::Maybe<kj::Own<v8::CpuProfiler>> samplingProfiler;
+  kj::Duration samplingInterval = 0 * kj::MICROSECONDS;
+  kj::Date samplingStartTime = kj::UNIX_EPOCH;
+
   ActorCache::SharedLru actorCacheLru;
 
   // Notification messages to deliver to the next inspector client when it connects.
@@ -796,6 +805,83 @@ static void stopProfiling(jsg::Lock& js,
   });
 }
 
+static constexpr kj::StringPtr SAMPLING_PROFILE_NAME = "Sampling Profile"_kj;
+
+// Converts a profile recorded by V8 to pprof format. Each sample is attributed the time until the
+// next sample was taken, so the "cpu" values add up to the profile's duration.
+//
+// V8 only reports JavaScript frames, plus pseudo-frames for native code it runs on behalf of
+// JavaScript: API callbacks (such as the C++ implementations of runtime APIs), builtins, garbage
+// collection, and "(program)" for time spent outside of JavaScript altogether. The native frames
+// are given the file name "[native]" so they can be told apart.
+static kj::Array<kj::byte> cpuProfileToPprof(const v8::CpuProfile& profile,
+                                             kj::Duration samplingInterval, kj::Date startTime) {
+  PprofBuilder::ValueType sampleTypes[] = {{"samples", "count"}, {"cpu", "nanoseconds"}};
+  PprofBuilder builder(sampleTypes, {"cpu", "nanoseconds"},
+      samplingInterval / kj::NANOSECONDS);
+
+  // The location IDs making up the stack of each node seen so far, leaf first.
+  kj::HashMap<const v8::CpuProfileNode*, kj::Array<uint64_t>> stacks;
+  auto getStack = [&](auto& self, const v8::CpuProfileNode* node) -> kj::ArrayPtr<uint64_t> {
+    KJ_IF_SOME(stack, stacks.find(node)) {
+      return stack;
+    }
+
+    kj::ArrayPtr<uint64_t> parentStack;
+    auto parent = node->GetParent();
+    // The root node is a placeholder that doesn't correspond to any code.
+    if (parent != nullptr && parent->GetParent() != nullptr) {
+      parentStack = self(self, parent);
+    }
+
+    kj::StringPtr name = "(anonymous)"_kj;
+    if (auto str = node->GetFunctionNameStr(); str != nullptr && *str != '\0') {
+      name = str;
+    }
+    kj::StringPtr filename = ""_kj;
+    if (auto str = node->GetScriptResourceNameStr(); str != nullptr && *str != '\0') {
+      filename = str;
+    } else if (node->GetSourceType() != v8::CpuProfileNode::kScript) {
+      filename = "[native]"_kj;
+    }
+    int line = kj::max(node->GetLineNumber(), 0);
+    int column = kj::max(node->GetColumnNumber(), 0);
+
+    auto function = builder.addFunction(name, filename, line);
+    auto stack = kj::heapArray<uint64_t>(parentStack.size() + 1);
+    stack[0] = builder.addLocation(function, line, column);
+    for (auto i: kj::indices(parentStack)) {
+      stack[i + 1] = parentStack[i];
+    }
+    return stacks.insert(node, kj::mv(stack)).value;
+  };
+
+  kj::HashMap<const v8::CpuProfileNode*, std::pair<int64_t, int64_t>> totals;
+  auto sampleCount = profile.GetSamplesCount();
+  for (int i = 0; i < sampleCount; i++) {
+    auto node = profile.GetSample(i);
+    auto next = i + 1 < sampleCount ? profile.GetSampleTimestamp(i + 1) : profile.GetEndTime();
+    int64_t micros = kj::max(next - profile.GetSampleTimestamp(i), int64_t(0));
+    auto& total = totals.findOrCreate(node, [&]() -> decltype(totals)::Entry {
+      return { node, { 0, 0 } };
+    });
+    total.first += 1;
+    total.second += micros * 1000;
+  }
+
+  for (auto& entry: totals) {
+    if (entry.key->GetParent() == nullptr) continue;  // root; shouldn't happen
+    int64_t values[] = { entry.value.first, entry.value.second };
+    builder.addSample(getStack(getStack, entry.key), values);
+  }
+
+  // V8's timestamps come from a monotonic clock, so the wall-clock start time is recorded
+  // separately when profiling starts.
+  builder.setTime((startTime - kj::UNIX_EPOCH) / kj::NANOSECONDS,
+      (profile.GetEndTime() - profile.GetStartTime()) * 1000);
+  return builder.finish();
+}
+
 } // anonymous namespace
 
 struct Worker::Script::Impl {
@@ -1831,6 +1917,49 @@ void Worker::Lock::logErrorOnce(kj::StringPtr description) {
   const_cast<Isolate&>(worker.getIsolate()).logErrorOnce(description);
 }
 
+bool Worker::Lock::startCpuProfile(kj::Duration samplingInterval) {
+  // const_cast OK because we are a lock on this isolate.
+  auto& isolate = const_cast<Isolate&>(worker.getIsolate());
+  if (isolate.impl->samplingProfiler != kj::none) return false;
+
+  auto profiler = kj::Own<v8::CpuProfiler>(
+      v8::CpuProfiler::New(getIsolate(), v8::kDebugNaming, v8::kLazyLogging),
+      CpuProfilerDisposer::instance);
+  profiler->SetSamplingInterval(samplingInterval / kj::MICROSECONDS);
+
+  jsg::Lock& js = *this;
+  js.withinHandleScope([&] {
+    v8::CpuProfilingOptions options(
+      v8::kLeafNodeLineNumbers,
+      v8::CpuProfilingOptions::kNoSampleLimit
+    );
+    profiler->StartProfiling(jsg::v8StrIntern(js.v8Isolate, SAMPLING_PROFILE_NAME),
+                             kj::mv(options));
+  });
+
+  isolate.impl->samplingProfiler = kj::mv(profiler);
+  isolate.impl->samplingInterval = samplingInterval;
+  isolate.impl->samplingStartTime = kj::systemPreciseCalendarClock().now();
+  return true;
+}
+
+kj::Maybe<kj::Array<kj::byte>> Worker::Lock::stopCpuProfile() {
+  // const_cast OK because we are a lock on this isolate.
+  auto& isolate = const_cast<Isolate&>(worker.getIsolate());
+  auto profiler = kj::mv(KJ_UNWRAP_OR_RETURN(isolate.impl->samplingProfiler, kj::none));
+  isolate.impl->samplingProfiler = kj::none;
+
+  jsg::Lock& js = *this;
+  return js.withinHandleScope([&]() -> kj::Maybe<kj::Array<kj::byte>> {
+    auto cpuProfile = profiler->StopProfiling(
+        jsg::v8StrIntern(js.v8Isolate, SAMPLING_PROFILE_NAME));
+    if (cpuProfile == nullptr) return kj::none;
+    KJ_DEFER(cpuProfile->Delete());
+    return cpuProfileToPprof(*cpuProfile, isolate.impl->samplingInterval,
+                             isolate.impl->samplingStartTime);
+  });
+}
+
 void Worker::Lock::logUncaughtException(kj::StringPtr description) {
   // We don't add the exception to traces here, since it turns out that this path only gets hit by
   // intermediate exception handling.
@@ -2073,6 +2202,12 @@ kj::Promise<Worker::AsyncLock> Worker::Isolate::takeAsyncLockImpl(
     currentLoad = getCurrentLoad();
   }
 
+  // The slice is placed on a track of its own since other work runs on this thread while we wait.
+  TRACE_EVENT_BEGIN("workerd", "Worker::Isolate::takeAsyncLock() waiting",
+      PERFETTO_TRACK_FROM_POINTER(&lockTiming));
+  // Also ends the slice if we're canceled or throw while waiting.
+  KJ_DEFER(TRACE_EVENT_END("workerd", PERFETTO_TRACK_FROM_POINTER(&lockTiming)));
+
   for (uint threadWaitingDifferentLockCount = 0; ; ++threadWaitingDifferentLockCount) {
     AsyncWaiter* waiter = AsyncWaiter::threadCurrentWaiter;
 
@@ -2978,6 +3113,9 @@ struct Worker::Actor::Impl {
     void storageWriteCompleted(kj::Duration latency) override {
       metrics.storageWriteCompleted(latency);
     }
+    void storageCacheHits(uint count) override { metrics.storageCacheHits(count); }
+    void storageCacheMisses(uint count) override { metrics.storageCacheMisses(count); }
+    void storageCacheEvictions(uint count) override { metrics.storageCacheEvictions(count); }
 
   private:
     kj::Own<Loopback> loopback;    // only for updateAlarmInMemory()
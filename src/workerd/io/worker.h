@@ -530,6 +530,16 @@ public:
 
   void logErrorOnce(kj::StringPtr description);
 
+  // Starts recording a sampling CPU profile of all JavaScript running in this isolate. Unlike
+  // profiling through the inspector, this needs no debugger session and doesn't pause the
+  // isolate, so it can be used on production traffic. Returns false if a profile is already being
+  // recorded.
+  bool startCpuProfile(kj::Duration samplingInterval);
+
+  // Stops the profile started by startCpuProfile() and returns it in pprof format, or none if no
+  // profile was being recorded.
+  kj::Maybe<kj::Array<kj::byte>> stopCpuProfile();
+
   // Logs an exception to the debug console or trace, if active.
   void logUncaughtException(kj::StringPtr description);
 
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "jsg-test.h"
+
+namespace workerd::jsg::test {
+namespace {
+
+KJ_TEST("ArrayBufferAllocator reuses small buffers by size class") {
+  ArrayBufferAllocator allocator;
+
+  void* a = allocator.Allocate(20);
+  memset(a, 0xff, 20);
+  allocator.Free(a, 20);
+
+  // Any length in the same size class (17 to 32 bytes) gets the buffer back, zeroed.
+  auto b = static_cast<byte*>(allocator.Allocate(32));
+  KJ_EXPECT(b == a);
+  for (auto i: kj::zeroTo(32)) {
+    KJ_EXPECT(b[i] == 0);
+  }
+
+  // Other size classes don't.
+  void* c = allocator.Allocate(8);
+  KJ_EXPECT(c != a);
+
+  KJ_EXPECT(allocator.getStats().allocations == 3);
+  KJ_EXPECT(allocator.getStats().reused == 1);
+
+  allocator.Free(b, 32);
+  allocator.Free(c, 8);
+}
+
+KJ_TEST("ArrayBufferAllocator doesn't pool large buffers") {
+  ArrayBufferAllocator allocator;
+
+  constexpr size_t size = ArrayBufferAllocator::MAX_POOLED_SIZE + 1;
+  allocator.Free(allocator.Allocate(size), size);
+
+  // Large buffers come from calloc(), but are still zeroed.
+  auto data = static_cast<byte*>(allocator.Allocate(size));
+  for (auto i: kj::zeroTo(size)) {
+    KJ_EXPECT(data[i] == 0);
+  }
+  allocator.Free(data, size);
+
+  KJ_EXPECT(allocator.getStats().allocations == 2);
+  KJ_EXPECT(allocator.getStats().reused == 0);
+}
+
+KJ_TEST("ArrayBufferAllocator limits the buffers kept per size class") {
+  ArrayBufferAllocator allocator;
+
+  constexpr size_t count = ArrayBufferAllocator::MAX_FREE_PER_CLASS + 1;
+  void* buffers[count];
+  for (auto& buffer: buffers) buffer = allocator.AllocateUninitialized(64);
+  for (auto& buffer: buffers) allocator.Free(buffer, 64);
+  for (auto& buffer: buffers) buffer = allocator.AllocateUninitialized(64);
+  for (auto& buffer: buffers) allocator.Free(buffer, 64);
+
+  KJ_EXPECT(allocator.getStats().reused == ArrayBufferAllocator::MAX_FREE_PER_CLASS);
+}
+
+V8System v8System;
+
+struct BytesContext: public Object, public ContextGlobal {
+  kj::Array<byte> bytes(uint size) {
+    auto result = kj::heapArray<byte>(size);
+    for (auto i: kj::indices(result)) {
+      result[i] = i % 251;
+    }
+    return result;
+  }
+
+  JSG_RESOURCE_TYPE(BytesContext) {
+    JSG_METHOD(bytes);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(BytesIsolate, BytesContext);
+
+KJ_TEST("byte arrays of any size are wrapped as ArrayBuffers") {
+  Evaluator<BytesContext, BytesIsolate> e(v8System);
+
+  auto check = [&](uint size) {
+    e.expectEval(kj::str(
+        "const view = new Uint8Array(bytes(", size, "));\n"
+        "view.length === ", size, " && view.every((b, i) => b === i % 251)"),
+        "boolean", "true");
+  };
+
+  check(0);
+  check(16);
+  check(ArrayBufferAllocator::MAX_POOLED_SIZE);
+  check(ArrayBufferAllocator::MAX_POOLED_SIZE + 1);
+  check(100'000);
+}
+
+}  // namespace
+}  // namespace workerd::jsg::test
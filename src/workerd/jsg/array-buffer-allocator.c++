@@ -0,0 +1,99 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "array-buffer-allocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace workerd::jsg {
+
+ArrayBufferAllocator::ArrayBufferAllocator() {
+  // Reserve the free lists up front so that Free() never allocates.
+  auto lock = state.lockExclusive();
+  for (auto& freeList: lock->freeLists) {
+    freeList.reserve(MAX_FREE_PER_CLASS);
+  }
+}
+
+ArrayBufferAllocator::~ArrayBufferAllocator() {
+  auto lock = state.lockExclusive();
+  for (auto& freeList: lock->freeLists) {
+    for (void* data: freeList) {
+      free(data);
+    }
+  }
+}
+
+uint ArrayBufferAllocator::sizeClass(size_t length) {
+  uint result = 0;
+  size_t classSize = MIN_POOLED_SIZE;
+  while (classSize < length) {
+    classSize <<= 1;
+    ++result;
+  }
+  return result;
+}
+
+void* ArrayBufferAllocator::tryReuse(uint index) {
+  auto lock = state.lockExclusive();
+  auto& freeList = lock->freeLists[index];
+  if (freeList.empty()) return nullptr;
+
+  reused.fetch_add(1, std::memory_order_relaxed);
+  void* data = freeList.back();
+  freeList.removeLast();
+  return data;
+}
+
+void* ArrayBufferAllocator::AllocateUninitialized(size_t length) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (length > MAX_POOLED_SIZE) {
+    return malloc(length);
+  }
+
+  auto index = sizeClass(length);
+  void* data = tryReuse(index);
+  if (data != nullptr) return data;
+
+  // Allocate the whole size class so that the buffer can be reused for any length in it.
+  return malloc(MIN_POOLED_SIZE << index);
+}
+
+void* ArrayBufferAllocator::Allocate(size_t length) {
+  if (length > MAX_POOLED_SIZE) {
+    // calloc() can hand back pages the OS already zeroed, without touching them.
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return calloc(length, 1);
+  }
+
+  void* data = AllocateUninitialized(length);
+  if (data != nullptr) {
+    memset(data, 0, length);
+  }
+  return data;
+}
+
+void ArrayBufferAllocator::Free(void* data, size_t length) {
+  if (data == nullptr) return;
+
+  if (length <= MAX_POOLED_SIZE) {
+    auto lock = state.lockExclusive();
+    auto& freeList = lock->freeLists[sizeClass(length)];
+    if (freeList.size() < MAX_FREE_PER_CLASS) {
+      freeList.add(data);
+      return;
+    }
+  }
+
+  free(data);
+}
+
+ArrayBufferAllocator::Stats ArrayBufferAllocator::getStats() const {
+  return {
+    .allocations = allocations.load(std::memory_order_relaxed),
+    .reused = reused.load(std::memory_order_relaxed),
+  };
+}
+
+}  // namespace workerd::jsg
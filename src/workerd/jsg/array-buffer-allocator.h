@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <v8-array-buffer.h>
+#include <kj/common.h>
+#include <kj/mutex.h>
+#include <kj/vector.h>
+#include <atomic>
+
+namespace workerd::jsg {
+
+// The allocator for ArrayBuffer contents, one per isolate.
+//
+// Most ArrayBuffers that APIs hand to JavaScript are small and short-lived: digests, random
+// values, small chunks of a body. Rather than going back to malloc() for each one, this keeps
+// freed buffers of up to MAX_POOLED_SIZE bytes in free lists by size class (powers of two) and
+// hands them out again. Larger buffers are allocated and freed directly, with calloc() when they
+// must be zeroed so that fresh pages from the OS aren't touched up front.
+//
+// V8 may free buffers from its background threads, so the free lists are behind a mutex. Large
+// buffers never take it; the stats are atomics.
+class ArrayBufferAllocator final: public v8::ArrayBuffer::Allocator {
+public:
+  static constexpr size_t MIN_POOLED_SIZE = 16;
+  static constexpr size_t MAX_POOLED_SIZE = 1024;
+
+  // The most free buffers kept per size class. Up to 64 KiB in total.
+  static constexpr size_t MAX_FREE_PER_CLASS = 32;
+
+  struct Stats {
+    // Calls to Allocate() and AllocateUninitialized().
+    uint64_t allocations = 0;
+
+    // Allocations served from a free list rather than by malloc().
+    uint64_t reused = 0;
+  };
+
+  ArrayBufferAllocator();
+  ~ArrayBufferAllocator();
+  KJ_DISALLOW_COPY_AND_MOVE(ArrayBufferAllocator);
+
+  void* Allocate(size_t length) override;
+  void* AllocateUninitialized(size_t length) override;
+  void Free(void* data, size_t length) override;
+
+  Stats getStats() const;
+
+private:
+  static constexpr uint SIZE_CLASS_COUNT = 7;
+  static_assert(MIN_POOLED_SIZE << (SIZE_CLASS_COUNT - 1) == MAX_POOLED_SIZE);
+
+  struct State {
+    kj::Vector<void*> freeLists[SIZE_CLASS_COUNT];
+  };
+  kj::MutexGuarded<State> state;
+
+  std::atomic<uint64_t> allocations = 0;
+  std::atomic<uint64_t> reused = 0;
+
+  // Pops a buffer of the given size class off its free list, if there is one.
+  void* tryReuse(uint index);
+
+  static uint sizeClass(size_t length);
+};
+
+}  // namespace workerd::jsg
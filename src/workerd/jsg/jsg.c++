@@ -6,6 +6,7 @@
 #include "setup.h"
 #include "workerd/jsg/util.h"
 #include <workerd/util/thread-scopes.h>
+#include <workerd/util/utf8.h>
 
 namespace workerd::jsg {
 
@@ -148,6 +149,25 @@ Value Lock::parseJson(kj::ArrayPtr<const char> data) {
   });
 }
 
+Value Lock::parseJson(kj::String&& text) {
+  // Below this size, copying the text is cheaper than setting up an external string.
+  static constexpr size_t EXTERNAL_MIN_SIZE = 32 * 1024;
+
+  if (text.size() < EXTERNAL_MIN_SIZE || asciiPrefixLength(text.asBytes()) != text.size()) {
+    // Non-ASCII text has to be decoded from UTF-8, which V8 does as it copies.
+    return parseJson(text.asArray());
+  }
+
+  return withinHandleScope([&] {
+    return v8Ref(jsg::check(v8::JSON::Parse(v8Context(),
+        newExternalOneByteString(*this, kj::mv(text)))));
+  });
+}
+
+kj::Maybe<Url> Lock::tryParseUrl(kj::ArrayPtr<const char> input) {
+  return IsolateBase::from(v8Isolate).getUrlCache().tryParse(input);
+}
+
 Value Lock::parseJson(v8::Local<v8::String> text) {
   return withinHandleScope([&] {
     return v8Ref(jsg::check(v8::JSON::Parse(v8Context(), text)));
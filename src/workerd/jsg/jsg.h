@@ -201,6 +201,25 @@ namespace workerd::jsg {
     registry.template registerMethod<NAME, decltype(&Self::method), &Self::method>(); \
   } while (false)
 
+// Like JSG_METHOD, but also gives the method a V8 Fast API entry point, which optimized JavaScript
+// calls directly, skipping the usual argument checks and the FunctionCallbackInfo machinery. This
+// is worthwhile for small methods that are called in hot loops.
+//
+// The fast entry point is only available when every parameter is `bool`, `int`, `uint32_t`,
+// `double` or `kj::Array<(const) kj::byte>`, and the method returns one of the first four or
+// `void`. Otherwise, or on a global object, the method is registered exactly as with JSG_METHOD.
+// Arguments that the slow path would convert differently, e.g. out-of-range numbers or byte arrays
+// that aren't Uint8Arrays, are passed to the slow path, as are calls that throw. The method may
+// therefore run a second time after throwing, so it must not have side effects before it throws.
+// It also must not keep a byte array past the call, allocate JavaScript objects, or otherwise use
+// the isolate, as there is no HandleScope during a fast call. (This is also why strings and
+// `jsg::Lock&` aren't supported.)
+#define JSG_FAST_METHOD(name) \
+  do { \
+    static const char NAME[] = #name; \
+    registry.template registerFastMethod<NAME, decltype(&Self::name), &Self::name>(); \
+  } while (false)
+
 // Use inside a JSG_RESOURCE_TYPE block to declare that the given method should be callable from
 // JavaScript on the resource type's constructor.
 #define JSG_STATIC_METHOD(name) \
@@ -693,6 +712,7 @@ consteval size_t prefixLengthToStrip(const char (&s)[N]) {
 // These types can be used in C++ to represent various JavaScript idioms / Web IDL types.
 
 class Lock;
+class Url;
 
 // Arbitrary V8 data, wrapped for storage from C++. You can't do much with it, so instead you
 // should probably use V8Ref<T>, a version of this that's strongly typed.
@@ -1498,6 +1518,11 @@ class Promise;
 template <typename T>
 struct PromiseResolverPair;
 
+// A result that is often available immediately, such as a read served from a cache. JavaScript
+// always receives a Promise; see promise.h.
+template <typename T>
+class MaybeSync;
+
 // Convenience template to detect a `jsg::Promise` type.
 template <typename T> struct IsPromise_ { static constexpr bool value = false; };
 
@@ -1938,6 +1963,7 @@ class GeneratorContext;
 struct JsgConfig {
   bool noSubstituteNull = false;
   bool unwrapCustomThenables = false;
+  bool settledPromiseFastPath = false;
 };
 
 static JsgConfig DEFAULT_JSG_CONFIG = {};
@@ -2066,6 +2092,14 @@ public:
 
   Value parseJson(kj::ArrayPtr<const char> data);
   Value parseJson(v8::Local<v8::String> text);
+
+  // Like parseJson(ArrayPtr), but takes ownership of the text. If it is large and pure ASCII, the
+  // usual case for JSON, V8 parses it in place rather than copying it onto the V8 heap first.
+  Value parseJson(kj::String&& text);
+
+  // Parses a URL without a base, reusing the result of a recent parse of the same string in this
+  // isolate if there is one.
+  kj::Maybe<Url> tryParseUrl(kj::ArrayPtr<const char> input);
   template <typename T>
   kj::String serializeJson(V8Ref<T>& value) { return serializeJson(value.getHandle(*this)); }
   template <typename T>
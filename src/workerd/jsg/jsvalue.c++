@@ -1,6 +1,7 @@
 #include "jsvalue.h"
 #include "buffersource.h"
 #include "ser.h"
+#include <workerd/util/utf8.h>
 
 namespace workerd::jsg {
 
@@ -165,6 +166,28 @@ kj::String JsValue::toJson(Lock& js) const {
   return kj::str(check(v8::JSON::Stringify(js.v8Context(), inner)));
 }
 
+kj::Array<kj::byte> JsValue::toJsonBytes(Lock& js) const {
+  auto str = check(v8::JSON::Stringify(js.v8Context(), inner));
+
+  // JSON is usually pure ASCII, which V8 stores as a one-byte string whose contents are already
+  // valid UTF-8. Copying those out directly is much cheaper than WriteUtf8(), which needs a
+  // separate pass over the string just to size the output.
+  if (str->IsOneByte()) {
+    auto bytes = kj::heapArray<kj::byte>(str->Length());
+    str->WriteOneByte(js.v8Isolate, bytes.begin(), 0, bytes.size(),
+                      v8::String::NO_NULL_TERMINATION);
+    if (asciiPrefixLength(bytes) == bytes.size()) {
+      return bytes;
+    }
+    // Latin-1 characters above U+007F take two bytes in UTF-8.
+  }
+
+  auto bytes = kj::heapArray<kj::byte>(str->Utf8Length(js.v8Isolate));
+  str->WriteUtf8(js.v8Isolate, bytes.asChars().begin(), bytes.size(), nullptr,
+                 v8::String::NO_NULL_TERMINATION);
+  return bytes;
+}
+
 JsValue JsValue::fromJson(Lock& js, kj::ArrayPtr<const char> input) {
   return JsValue(check(v8::JSON::Parse(js.v8Context(), js.str(input))));
 }
@@ -145,6 +145,10 @@ public:
 #undef V
 
   kj::String toJson(Lock& js) const KJ_WARN_UNUSED_RESULT;
+
+  // Like toJson(), but returns the UTF-8 bytes without a NUL terminator, e.g. for use as an HTTP
+  // body.
+  kj::Array<kj::byte> toJsonBytes(Lock& js) const KJ_WARN_UNUSED_RESULT;
   static JsValue fromJson(Lock& js, kj::ArrayPtr<const char> input) KJ_WARN_UNUSED_RESULT;
   static JsValue fromJson(Lock& js, const JsValue& input) KJ_WARN_UNUSED_RESULT;
 
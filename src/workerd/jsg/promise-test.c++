@@ -98,6 +98,22 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
     return result;
   }
 
+  Promise<int> resolvedInt(jsg::Lock& js, int i) {
+    return js.resolvedPromise(kj::mv(i));
+  }
+
+  MaybeSync<int> readyInt(int i) {
+    return kj::mv(i);
+  }
+
+  kj::Maybe<int> consumeSettled(jsg::Lock& js, Promise<int> promise) {
+    return promise.tryConsumeResolved(js);
+  }
+
+  void drain(jsg::Lock& js) {
+    js.runMicrotasks();
+  }
+
   JSG_RESOURCE_TYPE(PromiseContext) {
     JSG_READONLY_PROTOTYPE_PROPERTY(promise, makePromise);
     JSG_METHOD(resolvePromise);
@@ -111,6 +127,11 @@ struct PromiseContext: public jsg::Object, public jsg::ContextGlobal {
     JSG_METHOD(whenResolved);
 
     JSG_METHOD(thenable);
+
+    JSG_METHOD(resolvedInt);
+    JSG_METHOD(readyInt);
+    JSG_METHOD(consumeSettled);
+    JSG_METHOD(drain);
   }
 
   kj::Maybe<Promise<int>::Resolver> resolver;
@@ -195,5 +216,51 @@ KJ_TEST("thenable") {
   e.expectEval("thenable({ then(res) { res(123) } })", "number", "123");
 }
 
+// Records whether the continuation on `promise` runs before one attached afterwards to an
+// already-resolved promise.
+constexpr kj::StringPtr ORDER_TEST =
+    "const order = [];\n"
+    "promise.then(v => order.push('value ' + v));\n"
+    "Promise.resolve().then(() => order.push('other'));\n"
+    "drain();\n"
+    "order.join(', ')"_kj;
+
+KJ_TEST("settled promises take the slow path by default") {
+  Evaluator<PromiseContext, PromiseIsolate> e(v8System);
+
+  e.expectEval(kj::str("var promise = resolvedInt(1);\n", ORDER_TEST),
+      "string", "other, value 1");
+  e.expectEval(kj::str("var promise = readyInt(2);\n", ORDER_TEST),
+      "string", "other, value 2");
+  e.expectEval("consumeSettled(Promise.resolve(3))", "object", "null");
+}
+
+KJ_TEST("settled promise fast path") {
+  static const auto config = JsgConfig {
+    .settledPromiseFastPath = true,
+  };
+
+  struct FastPathConfig {
+    operator const JsgConfig&() const { return config; }
+  };
+
+  Evaluator<PromiseContext, PromiseIsolate, FastPathConfig> e(v8System);
+
+  // Values already available are resolved by the time JavaScript sees the promise.
+  e.expectEval(kj::str("var promise = resolvedInt(1);\n", ORDER_TEST),
+      "string", "value 1, other");
+  e.expectEval(kj::str("var promise = readyInt(2);\n", ORDER_TEST),
+      "string", "value 2, other");
+
+  // A fulfilled promise from JavaScript is unwrapped right away.
+  e.expectEval("consumeSettled(Promise.resolve(3))", "number", "3");
+
+  // Pending and rejected promises behave as before.
+  e.expectEval("consumeSettled(new Promise(() => {}))", "object", "null");
+  e.expectEval("catchIt(Promise.reject('foo')); drain()", "undefined", "undefined");
+  KJ_EXPECT(catchTestResult == "Error: foo");
+  catchTestResult = nullptr;
+}
+
 }  // namespace
 }  // namespace workerd::jsg::test
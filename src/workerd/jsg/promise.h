@@ -622,6 +622,76 @@ PromiseForResult<Func, void, false> evalNow(v8::Isolate* isolate, Func&& func) {
 
 // -----------------------------------------------------------------------------
 
+// The result of an operation that can often complete without waiting, such as a storage read
+// served from a cache: native code provides either the value itself or a Promise for it.
+//
+// JavaScript always receives a Promise. When the value is already available and the
+// `settledPromiseFastPath` config flag is set, the value is converted to JavaScript immediately
+// and returned as an already-resolved promise. This skips the opaque wrapper, the intermediate
+// promise, and the `.then()` continuation that returning `js.resolvedPromise(value)` would cost.
+template <typename T>
+class MaybeSync {
+public:
+  static_assert(!isVoid<T>(), "use jsg::Promise<void> for operations without a result");
+  static_assert(!isPromise<T>(), "MaybeSync<Promise<T>> is invalid; use MaybeSync<T> instead");
+
+  MaybeSync(T&& value): state(kj::mv(value)) {}
+  MaybeSync(Promise<T>&& promise): state(kj::mv(promise)) {}
+
+  // True if the value is available now, without waiting.
+  bool isReady() const { return state.template is<T>(); }
+
+  // Converts to a Promise, e.g. to attach a continuation. Consumes the MaybeSync.
+  Promise<T> toPromise(Lock& js) {
+    KJ_SWITCH_ONEOF(state) {
+      KJ_CASE_ONEOF(value, T) {
+        return js.resolvedPromise(kj::mv(value));
+      }
+      KJ_CASE_ONEOF(promise, Promise<T>) {
+        return kj::mv(promise);
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+
+  void visitForGc(GcVisitor& visitor) {
+    KJ_SWITCH_ONEOF(state) {
+      KJ_CASE_ONEOF(value, T) {
+        if constexpr (isGcVisitable<T>()) {
+          visitor.visit(value);
+        }
+      }
+      KJ_CASE_ONEOF(promise, Promise<T>) {
+        visitor.visit(promise);
+      }
+    }
+  }
+
+  JSG_MEMORY_INFO(MaybeSync) {
+    KJ_SWITCH_ONEOF(state) {
+      KJ_CASE_ONEOF(value, T) {
+        if constexpr (MemoryRetainer<T>) {
+          tracker.trackField("value", value);
+        } else {
+          tracker.trackFieldWithSize("value", sizeof(T));
+        }
+      }
+      KJ_CASE_ONEOF(promise, Promise<T>) {
+        tracker.trackField("promise", promise);
+      }
+    }
+  }
+
+private:
+  kj::OneOf<T, Promise<T>> state;
+
+  template <typename TypeWrapper>
+  friend class PromiseWrapper;
+  friend class MemoryTracker;
+};
+
+// -----------------------------------------------------------------------------
+
 // Continuation function that converts a promised C++ value into a JavaScript value.
 template <typename TypeWrapper, typename Input>
 void thenWrap(const v8::FunctionCallbackInfo<v8::Value>& args) {
@@ -668,10 +738,41 @@ public:
   template <typename T>
   static constexpr const char* getName(Promise<T>*) { return "Promise"; }
 
+  template <typename T>
+  static constexpr const char* getName(MaybeSync<T>*) { return "Promise"; }
+
   template <typename T>
   v8::Local<v8::Promise> wrap(
       v8::Local<v8::Context> context, kj::Maybe<v8::Local<v8::Object>> creator,
       Promise<T>&& promise) {
+    auto& js = jsg::Lock::from(context->GetIsolate());
+
+    if (config.settledPromiseFastPath) {
+      auto handle = promise.getInner(js);
+      // Only a fulfilled promise is converted right away. A rejected one still gets the .then()
+      // below, since adding a handler is what tells the unhandled rejection tracking that the
+      // rejection was dealt with.
+      if (handle->State() == v8::Promise::kFulfilled) {
+        auto result = handle->Result();
+        auto markedAsHandled = promise.markedAsHandled;
+        promise.v8Promise = kj::none;
+        auto ret = wrapNow(js, [&]() -> v8::Local<v8::Value> {
+          if constexpr (isVoid<T>()) {
+            return js.v8Undefined();
+          } else if constexpr (isV8Ref<T>()) {
+            return result;
+          } else {
+            auto& wrapper = *static_cast<TypeWrapper*>(this);
+            return wrapper.wrap(context, kj::none, unwrapOpaque<T>(js.v8Isolate, result));
+          }
+        });
+        if (markedAsHandled) {
+          ret->MarkAsHandled();
+        }
+        return ret;
+      }
+    }
+
     // Add a .then() to unwrap the value (i.e. convert C++ value to JavaScript).
     //
     // We use `creator` as the `data` value for this continuation so that the creator object
@@ -682,7 +783,6 @@ public:
     auto then = check(v8::Function::New(context,
         &thenWrap<TypeWrapper, T>, creator.orDefault({}), 1, v8::ConstructorBehavior::kThrow));
 
-    auto& js = jsg::Lock::from(context->GetIsolate());
     auto ret = check(promise.consumeHandle(js)->Then(context, then));
     // Although we added a .then() to the promise to translate the value to JavaScript, we would
     // like things to behave as if the C++ code returned this Promise directly to JavaScript. In
@@ -695,6 +795,29 @@ public:
     return ret;
   }
 
+  template <typename T>
+  v8::Local<v8::Promise> wrap(
+      v8::Local<v8::Context> context, kj::Maybe<v8::Local<v8::Object>> creator,
+      MaybeSync<T>&& result) {
+    auto& js = jsg::Lock::from(context->GetIsolate());
+    KJ_SWITCH_ONEOF(result.state) {
+      KJ_CASE_ONEOF(value, T) {
+        if (config.settledPromiseFastPath) {
+          auto& wrapper = *static_cast<TypeWrapper*>(this);
+          return wrapNow(js, [&]() -> v8::Local<v8::Value> {
+            return wrapper.wrap(context, kj::none, kj::mv(value));
+          });
+        } else {
+          return wrap(context, creator, js.resolvedPromise(kj::mv(value)));
+        }
+      }
+      KJ_CASE_ONEOF(promise, Promise<T>) {
+        return wrap(context, creator, kj::mv(promise));
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+
   template <typename T>
   kj::Maybe<Promise<T>> tryUnwrap(
       v8::Local<v8::Context> context, v8::Local<v8::Value> handle,
@@ -702,13 +825,30 @@ public:
     if (handle->IsPromise()) {
       auto promise = handle.As<v8::Promise>();
       if constexpr (!isVoid<T>() && !isV8Ref<T>()) {
+        if (config.settledPromiseFastPath) {
+          switch (promise->State()) {
+            case v8::Promise::kFulfilled: {
+              // Unwrap the value now rather than in a continuation. As in thenUnwrap(), a value
+              // of the wrong type rejects the resulting promise rather than throwing.
+              auto& js = Lock::from(context->GetIsolate());
+              auto& wrapper = *static_cast<TypeWrapper*>(this);
+              auto result = promise->Result();
+              return js.evalNow([&]() {
+                return wrapper.template unwrap<T>(context, result,
+                    TypeErrorContext::promiseResolution());
+              });
+            }
+            case v8::Promise::kRejected:
+              // The exception isn't wrapped, so the promise can be used as is.
+              return Promise<T>(context->GetIsolate(), promise);
+            case v8::Promise::kPending:
+              break;
+          }
+        }
+
         // Add a .then() to unwrap the promise's resolution (i.e. convert it from JS to C++).
         // Note that we don't need to handle the rejection case here as there is no wrapping
         // applied to exception values, so we just let it propagate through.
-        //
-        // TODO(perf): We could in theory check if promise->State() is kFulfilled and, in that
-        //   case, pull out promise->Result(), unwrap it, and make a new immediate promise.
-        //   Similarly in `wrap()`. Not clear if the added complexity is worth it, though.
         auto then = check(v8::Function::New(context,
             &thenUnwrap<TypeWrapper, T>, {}, 1, v8::ConstructorBehavior::kThrow));
         promise = check(promise->Then(context, then));
@@ -760,6 +900,15 @@ public:
 private:
   const JsgConfig config;
 
+  // Returns a promise resolved with the JavaScript value returned by `func()`, or rejected with
+  // the exception it throws, just as the promise from a thenWrap() continuation would be.
+  template <typename Func>
+  static v8::Local<v8::Promise> wrapNow(Lock& js, Func&& func) {
+    return js.evalNow([&]() {
+      return js.v8Ref(func());
+    }).consumeHandle(js);
+  }
+
   static bool isThenable(v8::Local<v8::Context> context, v8::Local<v8::Value> handle) {
     if (handle->IsObject()) {
       auto obj = handle.As<v8::Object>();
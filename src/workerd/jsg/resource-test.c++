@@ -629,6 +629,78 @@ KJ_TEST("Methods can take Lock& as first parameter") {
 
 // ========================================================================================
 
+struct FastMethodContext: public ContextGlobalObject {
+  struct Counter: public Object {
+    static Ref<Counter> constructor() { return alloc<Counter>(); }
+
+    double total = 0;
+
+    double add(double value) { return total += value; }
+
+    uint32_t scale(uint32_t value, int factor, bool square) {
+      JSG_REQUIRE(factor != 0, RangeError, "factor must not be zero");
+      return (square ? value * value : value) * factor;
+    }
+
+    uint32_t sum(kj::Array<const kj::byte> bytes) {
+      uint32_t result = 0;
+      for (auto b: bytes) result += b;
+      return result;
+    }
+
+    // Not eligible for a fast call, so registered as a plain method.
+    kj::String describe(kj::String prefix) { return kj::str(prefix, total); }
+
+    JSG_RESOURCE_TYPE(Counter) {
+      JSG_FAST_METHOD(add);
+      JSG_FAST_METHOD(scale);
+      JSG_FAST_METHOD(sum);
+      JSG_FAST_METHOD(describe);
+    }
+  };
+
+  JSG_RESOURCE_TYPE(FastMethodContext) {
+    JSG_NESTED_TYPE(Counter);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(FastMethodIsolate, FastMethodContext, FastMethodContext::Counter);
+
+KJ_TEST("JSG_FAST_METHODs behave like JSG_METHODs") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+  e.expectEval("let c = new Counter; c.add(1); c.add(2.5)", "number", "3.5");
+  e.expectEval("new Counter().scale(3, 4, false)", "number", "12");
+  e.expectEval("new Counter().scale(3, 4, true)", "number", "36");
+  e.expectEval("new Counter().describe('total: ')", "string", "total: 0");
+
+  // Run enough calls for V8 to optimize the loop, and with it make fast calls.
+  e.expectEval(
+      "let c = new Counter;\n"
+      "let sum = 0;\n"
+      "for (let i = 0; i < 100000; i++) { sum += c.scale(i % 10, 2, false); c.add(1); }\n"
+      "sum + c.add(0)", "number", "1000000");
+  e.expectEval(
+      "let c = new Counter;\n"
+      "let bytes = new Uint8Array([1, 2, 3]);\n"
+      "let sum = 0;\n"
+      "for (let i = 0; i < 100000; i++) sum += c.sum(bytes) + c.sum(bytes.subarray(3));\n"
+      "sum", "number", "600000");
+
+  // Other byte arrays take the slow path.
+  e.expectEval("new Counter().sum(new Uint16Array([1, 256]))", "number", "2");
+  e.expectEval("new Counter().sum(new Uint8Array([1, 2]).buffer)", "number", "3");
+
+  // Conversions and errors are the slow path's.
+  e.expectEval("new Counter().scale('3', 4, false)", "number", "12");
+  e.expectEval("new Counter().scale(-1, 4, false)", "throws",
+      "TypeError: The value cannot be converted because it is negative and this API expects a "
+      "positive number.");
+  e.expectEval("new Counter().scale(3, 0, false)", "throws",
+      "RangeError: factor must not be zero");
+  e.expectEval("Counter.prototype.add.call({}, 1)", "throws", "TypeError: Illegal invocation");
+}
+
+// ========================================================================================
+
 struct JsBundleContext: public ContextGlobalObject {
   JSG_RESOURCE_TYPE(JsBundleContext) {
     JSG_CONTEXT_JS_BUNDLE(BUILTIN_BUNDLE);
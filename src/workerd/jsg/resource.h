@@ -14,6 +14,9 @@
 #include <kj/debug.h>
 #include <type_traits>
 #include <kj/map.h>
+#include <cmath>
+#include <tuple>
+#include <v8-fast-api-calls.h>
 #include "util.h"
 #include "wrappable.h"
 #include <typeindex>
@@ -273,6 +276,131 @@ struct MethodCallback<TypeWrapper, methodName, isContext,
   }
 };
 
+// Describes how a JSG_FAST_METHOD parameter of type T is received by the V8 Fast API callback.
+// `Type` is the type the callback receives, and `tryConvert()` converts it to T the way the slow
+// path's unwrap() would, or returns false if the slow path might behave differently (e.g. throw).
+template <typename T>
+struct FastApiArg {
+  static constexpr bool supported = false;
+};
+
+template <>
+struct FastApiArg<bool> {
+  static constexpr bool supported = true;
+  using Type = bool;
+  static bool tryConvert(bool in, bool& out) { out = in; return true; }
+};
+
+template <>
+struct FastApiArg<double> {
+  static constexpr bool supported = true;
+  using Type = double;
+  static bool tryConvert(double in, double& out) { out = in; return true; }
+};
+
+template <>
+struct FastApiArg<int> {
+  // Numbers are received as doubles so that out-of-range values reach the slow path, which throws,
+  // rather than being wrapped by V8.
+  static constexpr bool supported = true;
+  using Type = double;
+  static bool tryConvert(double in, int& out) {
+    if (!std::isfinite(in)) { out = 0; return true; }
+    if (in > int(kj::maxValue) || in < int(kj::minValue)) return false;
+    out = int(in);
+    return true;
+  }
+};
+
+template <>
+struct FastApiArg<uint32_t> {
+  static constexpr bool supported = true;
+  using Type = double;
+  static bool tryConvert(double in, uint32_t& out) {
+    if (!std::isfinite(in) || in < 0 || in > uint32_t(kj::maxValue)) return false;
+    out = uint32_t(in);
+    return true;
+  }
+};
+
+// Byte arrays are received as Uint8Arrays, of which the fast path sees only the contents. Other
+// ArrayBufferViews and ArrayBuffers, which the slow path also accepts, don't match the fast
+// signature, so V8 takes the slow path for them. Unlike the slow path's arrays, which keep the
+// backing store alive, these arrays are only valid for the duration of the call.
+template <typename Byte>
+struct FastApiByteArg {
+  static constexpr bool supported = true;
+  using Type = const v8::FastApiTypedArray<uint8_t>&;
+  static bool tryConvert(Type in, kj::Array<Byte>& out) {
+    uint8_t* data;
+    if (!in.getStorageIfAligned(&data)) return false;
+    if (in.length() == 0) {
+      // Like asBytes(), avoid handing the method a null pointer.
+      static kj::byte empty = 0;
+      data = &empty;
+    }
+    out = kj::Array<Byte>(data, in.length(), kj::NullArrayDisposer::instance);
+    return true;
+  }
+};
+
+template <>
+struct FastApiArg<kj::Array<kj::byte>>: public FastApiByteArg<kj::byte> {};
+template <>
+struct FastApiArg<kj::Array<const kj::byte>>: public FastApiByteArg<const kj::byte> {};
+
+template <typename T>
+constexpr bool isFastApiReturn = kj::isSameType<T, void>() || kj::isSameType<T, bool>() ||
+    kj::isSameType<T, int>() || kj::isSameType<T, uint32_t>() || kj::isSameType<T, double>();
+
+// Implements the V8 Fast API callback for a method registered with JSG_FAST_METHOD. If
+// `supported` is false, the method only gets the usual MethodCallback.
+template <typename T, typename Method, Method method>
+struct FastMethodCallback {
+  static constexpr bool supported = false;
+};
+
+template <typename T, typename U, typename Ret, typename... Args, Ret (U::*method)(Args...)>
+struct FastMethodCallback<T, Ret (U::*)(Args...), method> {
+  static constexpr bool supported =
+      isFastApiReturn<Ret> && (FastApiArg<Args>::supported && ...);
+
+  static Ret callback(v8::Local<v8::Object> receiver,
+                      typename FastApiArg<Args>::Type... args,
+                      v8::FastApiCallbackOptions& options) {
+    // V8 only makes fast calls on receivers which match the method's signature, but check that
+    // this is a wrapped object anyway, since the cost is negligible.
+    if (receiver->InternalFieldCount() != Wrappable::INTERNAL_FIELD_COUNT) {
+      options.fallback = true;
+      return Ret();
+    }
+    auto& self = *reinterpret_cast<T*>(receiver->GetAlignedPointerFromInternalField(
+        Wrappable::WRAPPED_OBJECT_FIELD_INDEX));
+
+    bool ok = true;
+    std::tuple<Args...> converted;
+    std::apply([&](Args&... out) {
+      ((ok = ok && FastApiArg<Args>::tryConvert(args, out)), ...);
+    }, converted);
+    if (!ok) {
+      options.fallback = true;
+      return Ret();
+    }
+
+    try {
+      return std::apply([&](Args&... in) { return (self.*method)(kj::fwd<Args>(in)...); },
+                        converted);
+    } catch (...) {
+      // We can't throw from a fast call. Let the slow path call the method again and report the
+      // error.
+      options.fallback = true;
+      return Ret();
+    }
+  }
+
+  static inline const v8::CFunction cFunction = v8::CFunction::Make(callback);
+};
+
 // Implements the V8 callback function for calling a static method of the C++ class.
 //
 // This is separate from MethodCallback<> because we need to know the interface type, T, and it
@@ -788,6 +916,20 @@ struct ResourceTypeBuilder {
         v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow));
   }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    using Fast = FastMethodCallback<Self, Method, method>;
+    if constexpr (Fast::supported && !isContext) {
+      prototype->Set(isolate, name, v8::FunctionTemplate::New(isolate,
+          &MethodCallback<TypeWrapper, name, isContext, Self, Method, method,
+                          ArgumentIndexes<Method>>::callback,
+          v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow,
+          v8::SideEffectType::kHasSideEffect, &Fast::cFunction));
+    } else {
+      registerMethod<name, Method, method>();
+    }
+  }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() {
     // Notably, we specify an empty signature because a static method invocation will have no holder
@@ -1069,6 +1211,9 @@ struct JsSetup {
   template<const char* name, typename Method, Method method>
   inline void registerMethod() { }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() { }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() { }
 
@@ -422,6 +422,13 @@ struct BuildRtti<Configuration, jsg::Promise<T>> {
   }
 };
 
+template<typename Configuration, typename T>
+struct BuildRtti<Configuration, jsg::MaybeSync<T>> {
+  static void build(Type::Builder builder, Builder<Configuration>& rtti) {
+    BuildRtti<Configuration, T>::build(builder.initPromise().initValue(), rtti);
+  }
+};
+
 template<typename Configuration>
 struct BuildRtti<Configuration, v8::Promise> {
   static void build(Type::Builder builder, Builder<Configuration>& rtti) {
@@ -554,6 +561,9 @@ struct MemberCounter {
   template<const char* name, typename Method, Method method>
   inline void registerMethod() { ++members; }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() { ++members; }
+
   template<typename Method, Method method>
   inline void registerCallable() { /* not a member */ }
 
@@ -754,6 +764,11 @@ struct MembersBuilder {
     TupleRttiBuilder<Configuration, Args>::build(method.initArgs(std::tuple_size_v<Args>), rtti);
   }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    registerMethod<name, Method, method>();
+  }
+
   template<typename Method, Method method>
   inline void registerCallable() {
     auto func = structure.initCallable();
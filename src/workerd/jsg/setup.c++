@@ -178,6 +178,7 @@ void IsolateBase::buildEmbedderGraph(v8::Isolate* isolate,
 void IsolateBase::jsgGetMemoryInfo(MemoryTracker& tracker) const {
   tracker.trackField("uuid", uuid);
   tracker.trackField("heapTracer", heapTracer);
+  tracker.trackField("urlCache", urlCache);
 }
 
 void IsolateBase::deferDestruction(Item item) {
@@ -276,9 +277,19 @@ bool HeapTracer::TryResetRoot(const v8::TracedReference<v8::Value>& handle) {
 }
 
 namespace {
+  static std::shared_ptr<ArrayBufferAllocator> newArrayBufferAllocator(
+      const v8::Isolate::CreateParams& params) {
+    if (params.array_buffer_allocator == nullptr &&
+        params.array_buffer_allocator_shared == nullptr) {
+      return std::make_shared<ArrayBufferAllocator>();
+    }
+    return nullptr;
+  }
+
   static v8::Isolate* newIsolate(
       V8PlatformWrapper* system,
-      v8::Isolate::CreateParams&& params) {
+      v8::Isolate::CreateParams&& params,
+      std::shared_ptr<ArrayBufferAllocator> arrayBufferAllocator) {
     return jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) -> v8::Isolate* {
       v8::CppHeapCreateParams heapParams {
         {},
@@ -303,10 +314,8 @@ namespace {
       // v8 takes ownership of the v8::CppHeap when passed this way.
       params.cpp_heap = v8::CppHeap::Create(system, heapParams).release();
 
-      if (params.array_buffer_allocator == nullptr &&
-          params.array_buffer_allocator_shared == nullptr) {
-        params.array_buffer_allocator_shared = std::shared_ptr<v8::ArrayBuffer::Allocator>(
-            v8::ArrayBuffer::Allocator::NewDefaultAllocator());
+      if (arrayBufferAllocator != nullptr) {
+        params.array_buffer_allocator_shared = kj::mv(arrayBufferAllocator);
       }
       return v8::Isolate::New(params);
     });
@@ -316,8 +325,9 @@ namespace {
 IsolateBase::IsolateBase(const V8System& system, v8::Isolate::CreateParams&& createParams,
                          kj::Own<IsolateObserver> observer)
     : system(system),
+      arrayBufferAllocator(newArrayBufferAllocator(createParams)),
       ptr(newIsolate(const_cast<V8PlatformWrapper*>(&system.platformWrapper),
-                     kj::mv(createParams))),
+                     kj::mv(createParams), arrayBufferAllocator)),
       heapTracer(ptr),
       observer(kj::mv(observer)) {
   jsg::runInV8Stack([&](jsg::V8StackScope& stackScope) {
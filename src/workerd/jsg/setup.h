@@ -6,6 +6,7 @@
 // Public API for setting up JavaScript context. Only high-level code needs to include this file.
 
 #include "jsg.h"
+#include "array-buffer-allocator.h"
 #include "async-context.h"
 #include "type-wrapper.h"
 #include "v8-platform-wrapper.h"
@@ -132,6 +133,14 @@ public:
 
   IsolateObserver& getObserver() { return *observer; }
 
+  UrlCache& getUrlCache() { return urlCache; }
+
+  // Returns the allocator for ArrayBuffer contents, unless the embedder supplied its own.
+  kj::Maybe<const ArrayBufferAllocator&> getArrayBufferAllocator() const {
+    if (arrayBufferAllocator == nullptr) return kj::none;
+    return *arrayBufferAllocator;
+  }
+
   // Implementation of MemoryRetainer
   void jsgGetMemoryInfo(MemoryTracker& tracker) const;
   kj::StringPtr jsgGetMemoryName() const { return "IsolateBase"_kjc; }
@@ -176,6 +185,10 @@ private:
   using Item = kj::OneOf<v8::Global<v8::Data>, RefToDelete>;
 
   const V8System& system;
+
+  // Null if the embedder passed its own allocator in the CreateParams. Initialized before `ptr`.
+  std::shared_ptr<ArrayBufferAllocator> arrayBufferAllocator;
+
   v8::Isolate* ptr;
   kj::Maybe<kj::String> uuid;
   bool evalAllowed = false;
@@ -192,6 +205,8 @@ private:
   kj::Maybe<kj::Function<Logger>> maybeLogger;
   kj::Maybe<kj::Function<ModuleFallbackCallback>> maybeModuleFallbackCallback;
 
+  UrlCache urlCache;
+
   // FunctionTemplate used by Wrappable::attachOpaqueWrapper(). Just a constructor for an empty
   // object with 2 internal fields.
   v8::Global<v8::FunctionTemplate> opaqueTemplate;
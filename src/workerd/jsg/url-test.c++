@@ -60,6 +60,33 @@ KJ_TEST("Non-special URL") {
   KJ_ASSERT(url.getProtocol() == "abc:"_kj);
 }
 
+KJ_TEST("UrlCache") {
+  UrlCache cache;
+
+  auto a = KJ_ASSERT_NONNULL(cache.tryParse("https://example.org/a?x=1"_kj));
+  KJ_ASSERT(a.getHref() == "https://example.org/a?x=1"_kj);
+
+  // A hit returns an independent copy.
+  auto b = KJ_ASSERT_NONNULL(cache.tryParse("https://example.org/a?x=1"_kj));
+  KJ_ASSERT(b == a);
+  KJ_ASSERT(b.setPathname("/b"_kj));
+  auto c = KJ_ASSERT_NONNULL(cache.tryParse("https://example.org/a?x=1"_kj));
+  KJ_ASSERT(c.getPathname() == "/a"_kj);
+
+  // Invalid input is never cached.
+  KJ_ASSERT(cache.tryParse("not a url"_kj) == kj::none);
+  KJ_ASSERT(cache.tryParse("not a url"_kj) == kj::none);
+
+  // Evicted entries are simply parsed again.
+  for (auto i: kj::zeroTo(8)) {
+    auto input = kj::str("https://example.org/", i);
+    auto url = KJ_ASSERT_NONNULL(cache.tryParse(input));
+    KJ_ASSERT(url.getPathname() == kj::str("/", i).asArray());
+  }
+  auto d = KJ_ASSERT_NONNULL(cache.tryParse("https://example.org/a?x=1"_kj));
+  KJ_ASSERT(d.getSearch() == "?x=1"_kj);
+}
+
 KJ_TEST("Invalid Urls") {
   struct TestCase {
     kj::StringPtr input;
@@ -170,6 +170,36 @@ kj::Maybe<Url> Url::resolve(kj::ArrayPtr<const char> input) {
   return tryParse(input, getHref());
 }
 
+kj::Maybe<Url> UrlCache::tryParse(kj::ArrayPtr<const char> input) {
+  for (auto i: kj::indices(entries)) {
+    if (entries[i].input.asArray() == input) {
+      // Move the hit to the back, so that it is evicted last.
+      if (i + 1 < entries.size()) {
+        auto entry = kj::mv(entries[i]);
+        for (auto j = i; j + 1 < entries.size(); j++) {
+          entries[j] = kj::mv(entries[j + 1]);
+        }
+        entries.back() = kj::mv(entry);
+      }
+      return entries.back().url.clone();
+    }
+  }
+
+  auto result = Url::tryParse(input);
+  KJ_IF_SOME(url, result) {
+    if (input.size() <= MAX_INPUT_SIZE) {
+      if (entries.size() == CAPACITY) {
+        for (auto j: kj::zeroTo(entries.size() - 1)) {
+          entries[j] = kj::mv(entries[j + 1]);
+        }
+        entries.removeLast();
+      }
+      entries.add(Entry { .input = kj::str(input), .url = url.clone() });
+    }
+  }
+  return result;
+}
+
 kj::ArrayPtr<const char> Url::getHref() const {
   ada_string href = ada_get_href(getInner<ada_url>(inner));
   return kj::ArrayPtr<const char>(href.data, href.length);
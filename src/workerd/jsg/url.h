@@ -2,6 +2,7 @@
 #include <kj/string.h>
 #include <kj/common.h>
 #include <kj/one-of.h>
+#include <kj/vector.h>
 #include <workerd/jsg/memory.h>
 
 namespace workerd::jsg {
@@ -129,6 +130,40 @@ private:
   kj::Own<void> inner;
 };
 
+// Remembers the last few URLs parsed without a base, so that parsing the same string again costs
+// a copy of the already-parsed URL (its serialization plus component offsets) rather than a full
+// parse. Routing code tends to do `new URL(request.url)` several times per request.
+class UrlCache final {
+public:
+  UrlCache() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(UrlCache);
+
+  // Like Url::tryParse(input), but consults the cache first.
+  kj::Maybe<Url> tryParse(kj::ArrayPtr<const char> input) KJ_WARN_UNUSED_RESULT;
+
+  JSG_MEMORY_INFO(UrlCache) {
+    size_t size = 0;
+    for (auto& entry: entries) {
+      size += entry.input.size() + entry.url.getHref().size();
+    }
+    tracker.trackFieldWithSize("entries", size);
+  }
+
+private:
+  static constexpr size_t CAPACITY = 4;
+
+  // Longer inputs are rare and not worth holding on to.
+  static constexpr size_t MAX_INPUT_SIZE = 4096;
+
+  struct Entry {
+    kj::String input;
+    Url url;
+  };
+
+  // Least recently used first.
+  kj::Vector<Entry> entries;
+};
+
 constexpr Url::EquivalenceOption operator|(Url::EquivalenceOption a, Url::EquivalenceOption b) {
   return static_cast<Url::EquivalenceOption>(static_cast<int>(a) | static_cast<int>(b));
 }
@@ -718,6 +718,55 @@ v8::Local<v8::String> newExternalOneByteString(Lock& js, kj::ArrayPtr<const char
   return check(ExternOneByteString::createExtern(js.v8Isolate, buf));
 }
 
+namespace {
+
+// Reports its buffer to V8 as external memory for as long as the string lives, so that the GC
+// knows how much collecting the string would free.
+class OwnedExternOneByteString final: public v8::String::ExternalOneByteStringResource {
+public:
+  OwnedExternOneByteString(v8::Isolate* isolate, kj::String text)
+      : isolate(isolate), text(kj::mv(text)) {}
+
+  const char* data() const override { return text.begin(); }
+  size_t length() const override { return text.size(); }
+
+  void reportAllocated() {
+    isolate->AdjustAmountOfExternalAllocatedMemory(text.size());
+    reported = true;
+  }
+
+  void Dispose() override {
+    if (reported) {
+      isolate->AdjustAmountOfExternalAllocatedMemory(-static_cast<int64_t>(text.size()));
+    }
+    delete this;
+  }
+
+private:
+  v8::Isolate* isolate;
+  kj::String text;
+  bool reported = false;
+};
+
+}  // namespace
+
+v8::Local<v8::String> newExternalOneByteString(Lock& js, kj::String&& text) {
+  if (text.size() == 0) {
+    return v8::String::Empty(js.v8Isolate);
+  }
+
+  // V8 deletes the resource when the string is collected.
+  auto resource = new OwnedExternOneByteString(js.v8Isolate, kj::mv(text));
+  v8::MaybeLocal<v8::String> str = v8::String::NewExternalOneByte(js.v8Isolate, resource);
+  if (str.IsEmpty()) {
+    // This should happen only if the string is too long
+    delete resource;
+  } else {
+    resource->reportAllocated();
+  }
+  return check(str);
+}
+
 v8::Local<v8::String> newExternalTwoByteString(Lock& js, kj::ArrayPtr<const uint16_t> buf) {
   return check(ExternTwoByteString::createExtern(js.v8Isolate, buf));
 }
@@ -438,6 +438,11 @@ class Lock;
 // that are not owned by the v8 heap.
 v8::Local<v8::String> newExternalOneByteString(Lock& js, kj::ArrayPtr<const char> buf);
 
+// Like the above, but takes ownership of `text`, which is freed once V8 garbage-collects the
+// string. This lets a large buffer be handed to V8 without copying it onto the V8 heap. As above,
+// the text is interpreted as latin-1, so in practice it should be checked to be ASCII first.
+v8::Local<v8::String> newExternalOneByteString(Lock& js, kj::String&& text);
+
 // Creates v8 Strings from buffers not on the v8 heap. These do not copy and do not
 // take ownership of the buf. The buf *must* point to a static constant with infinite
 // lifetime.
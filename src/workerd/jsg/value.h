@@ -8,6 +8,7 @@
 // Handling of various basic value types: numbers, booleans, strings, optionals, maybes, variants,
 // arrays, buffers, dicts.
 
+#include "array-buffer-allocator.h"
 #include "util.h"
 #include "wrappable.h"
 #include "web-idl.h"
@@ -881,19 +882,30 @@ public:
     return "ArrayBuffer or ArrayBufferView";
   }
 
+  // Arrays up to this size are copied into a buffer from the isolate's ArrayBufferAllocator,
+  // which recycles small buffers, rather than handed to V8 along with a heap-allocated owner.
+  static constexpr size_t MAX_COPIED_ARRAY_SIZE = ArrayBufferAllocator::MAX_POOLED_SIZE;
+
   v8::Local<v8::ArrayBuffer> wrap(
       v8::Isolate* isolate, kj::Maybe<v8::Local<v8::Object>> creator,
       kj::Array<byte> value) {
+    if (value.size() <= MAX_COPIED_ARRAY_SIZE) {
+      // For a small array, a copy costs less than the allocation of the owner below, and the
+      // array itself can be freed right away.
+      auto buffer = v8::ArrayBuffer::New(isolate, value.size());
+      if (value.size() > 0) {
+        memcpy(buffer->Data(), value.begin(), value.size());
+      }
+      return buffer;
+    }
+
     // We need to construct a BackingStore that owns the byte array. We use the version of
     // v8::ArrayBuffer::NewBackingStore() that accepts a deleter callback, and arrange for it to
     // delete an Array<byte> placed on the heap.
     //
-    // TODO(perf): We could avoid an allocation here, perhaps, by decomposing the kj::Array<byte>
-    //   into its component pointer and disposer, and then pass the disposer pointer as the
-    //   "deleter_data" for NewBackingStore. However, KJ doesn't give us any way to decompose an
-    //   Array<T> this way, and it might not want to, as this could make it impossible to support
-    //   unifying Array<T> and Vector<T> in the future (i.e. making all Array<T>s growable). So
-    //   it may be best to stick with allocating an Array<byte> on the heap after all...
+    // KJ doesn't give us any way to decompose an Array<T> into its pointer and disposer, which
+    // we could otherwise pass as the "deleter_data", so the owner costs an allocation. For
+    // arrays this large, that's small next to the array itself.
     byte* begin = value.begin();
     size_t size = value.size();
     auto ownerPtr = new kj::Array<byte>(kj::mv(value));
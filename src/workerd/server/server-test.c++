@@ -1265,6 +1265,86 @@ KJ_TEST("Server: capability bindings") {
   )"_blockquote);
 }
 
+KJ_TEST("Server: KV bulk get through cache") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          compatibilityFlags = ["kv_bulk_get"],
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    await env.kv.get("a");
+                `    let map = await env.kv.get(["a", "b", "c", "b"]);
+                `    return new Response([...map].map(([k, v]) => k + "=" + v).join(","));
+                `  }
+                `}
+            )
+          ],
+          bindings = [
+            ( name = "kv",
+              kvNamespace = "kv-outbound",
+              kvCache = ()
+            )
+          ]
+        )
+      ),
+      ( name = "kv-outbound", external = "kv-host" )
+    ],
+    sockets = [
+      ( name = "main",
+        address = "test-addr",
+        service = "hello"
+      )
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  conn.sendHttpGet("/");
+
+  {
+    auto subreq = test.receiveSubrequest("kv-host");
+    subreq.recv(R"(
+      GET /a?urlencoded=true HTTP/1.1
+      Host: fake-host
+      CF-KV-FLPROD-405: https://fake-host/a?urlencoded=true
+
+    )"_blockquote);
+    subreq.send(R"(
+      HTTP/1.1 200 OK
+      Content-Length: 1
+
+      A)"_blockquote);
+  }
+
+  // `a` is served from the cache, and `b` is only requested once.
+  {
+    auto subreq = test.receiveSubrequest("kv-host");
+    subreq.recv(R"(
+      POST /bulk/get?urlencoded=true HTTP/1.1
+      Content-Length: 18
+      Host: fake-host
+      Content-Type: application/json
+      CF-KV-FLPROD-405: https://fake-host/bulk/get?urlencoded=true
+
+      {"keys":["b","c"]})"_blockquote);
+    // `z` wasn't requested, so it's left out of the result.
+    subreq.send(R"(
+      HTTP/1.1 200 OK
+      Content-Length: 48
+
+      {"key":"b","value":"B"}
+      {"key":"z","value":"Z"}
+    )"_blockquote);
+  }
+
+  conn.recvHttp200("a=A,b=B,c=null");
+}
+
 KJ_TEST("Server: cyclic bindings") {
   TestServer test(R"((
     services = [
@@ -3289,6 +3369,105 @@ KJ_TEST("Server: disk service allow dotfiles") {
   KJ_EXPECT(test.root->openFile(kj::Path({"secret"}))->readAllText() == "this is super-secret");
 }
 
+KJ_TEST("Server: tracing admin service") {
+  TestServer test(R"((
+    services = [
+      (name = "tracing", tracingAdmin = ())
+    ],
+    sockets = [
+      (name = "main", address = "test-addr", service = "tracing")
+    ]
+  ))"_kj);
+
+  test.start();
+
+  auto conn = test.connect("test-addr");
+
+  // Profiles need a Worker service to profile.
+  conn.sendHttpGet("/profile?duration=1");
+  conn.recv(R"(
+    HTTP/1.1 400 Bad Request
+    Content-Length: 11
+
+    Bad Request)"_blockquote);
+  // Sampling intervals below 50us are rejected.
+  conn.sendHttpGet("/profile?service=tracing&duration=1&interval=10");
+  conn.recv(R"(
+    HTTP/1.1 400 Bad Request
+    Content-Length: 11
+
+    Bad Request)"_blockquote);
+  conn.sendHttpGet("/profile?service=tracing&duration=1");
+  conn.recv(R"(
+    HTTP/1.1 404 Not Found
+    Content-Length: 9
+
+    Not Found)"_blockquote);
+
+  // Likewise for admission control stats.
+  conn.sendHttpGet("/admission?service=tracing");
+  conn.recv(R"(
+    HTTP/1.1 404 Not Found
+    Content-Length: 9
+
+    Not Found)"_blockquote);
+  conn.sendHttpGet("/batchers?service=tracing");
+  conn.recv(R"(
+    HTTP/1.1 404 Not Found
+    Content-Length: 9
+
+    Not Found)"_blockquote);
+
+#if defined(WORKERD_USE_PERFETTO)
+  // Nothing to stop yet.
+  conn.send(R"(
+    POST /stop HTTP/1.1
+    Host: foo
+    Content-Length: 0
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 404 Not Found
+    Content-Length: 9
+
+    Not Found)"_blockquote);
+
+  // Durations must be positive and no longer than the configured maximum.
+  conn.sendHttpGet("/trace?duration=3600");
+  conn.recv(R"(
+    HTTP/1.1 400 Bad Request
+    Content-Length: 11
+
+    Bad Request)"_blockquote);
+
+  conn.send(R"(
+    POST /start?categories=workerd HTTP/1.1
+    Host: foo
+    Content-Length: 0
+
+  )"_blockquote);
+  conn.recv(R"(
+    HTTP/1.1 204 No Content
+
+    )"_blockquote);
+
+  // Only one session at a time.
+  conn.sendHttpGet("/trace?duration=1");
+  conn.recv(R"(
+    HTTP/1.1 409 Conflict
+    Content-Length: 8
+
+    Conflict)"_blockquote);
+#else
+  conn.sendHttpGet("/trace?duration=1");
+  conn.recv(R"(
+    HTTP/1.1 501 Not Implemented
+    Content-Length: 15
+
+    Not Implemented)"_blockquote);
+#endif
+}
+
 // =======================================================================================
 // Test Cache API
 
@@ -3589,6 +3768,369 @@ KJ_TEST("Server: JS RPC over HTTP connections") {
   conn.httpGet200("/", "got: 35");
 }
 
+KJ_TEST("Server: tail Workers receive batched traces") {
+  TestServer test(R"((
+    services = [
+      ( name = "main",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request) {
+                `    return new Response("ok");
+                `  }
+                `}
+            )
+          ],
+          tails = ["tail"],
+          tailBatching = (maxTraces = 2, maxDelayMs = 1000)
+        )
+      ),
+      ( name = "tail",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `let batches = [];
+                `export default {
+                `  async fetch(request) {
+                `    return new Response(JSON.stringify(batches));
+                `  },
+                `  tail(events) {
+                `    batches.push(events.map(event => event.scriptName));
+                `  }
+                `}
+            )
+          ]
+        )
+      ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "main" ),
+      ( name = "tail", address = "tail-addr", service = "tail" ),
+    ]
+  ))"_kj);
+
+  test.start();
+  auto conn = test.connect("test-addr");
+  auto tailConn = test.connect("tail-addr");
+
+  // Nothing is delivered until the batch is full...
+  conn.httpGet200("/", "ok");
+  tailConn.httpGet200("/", "[]");
+  conn.httpGet200("/", "ok");
+  tailConn.httpGet200("/", R"([["main","main"]])");
+
+  // ...or the first trace in it has waited long enough.
+  conn.httpGet200("/", "ok");
+  tailConn.httpGet200("/", R"([["main","main"]])");
+  test.wait(1);
+  tailConn.httpGet200("/", R"([["main","main"],["main"]])");
+}
+
+KJ_TEST("Server: batched traces are delivered when draining") {
+  TestServer test(R"((
+    services = [
+      ( name = "main",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request) {
+                `    return new Response("ok");
+                `  }
+                `}
+            )
+          ],
+          tails = ["tail"],
+          tailBatching = (maxTraces = 10, maxDelayMs = 60000)
+        )
+      ),
+      ( name = "tail",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async tail(events, env) {
+                `    let names = events.map(event => event.scriptName).join(",");
+                `    await env.SINK.fetch("http://sink/" + names);
+                `  }
+                `}
+            )
+          ],
+          bindings = [ ( name = "SINK", service = "sink" ) ]
+        )
+      ),
+      ( name = "sink", external = (address = "sink-addr", http = ()) ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "main" ),
+    ]
+  ))"_kj);
+
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  test.start(kj::mv(paf.promise));
+
+  {
+    auto conn = test.connect("test-addr");
+    conn.httpGet200("/", "ok");
+  }
+
+  // The batch is far from full and far from due, but draining the server delivers it anyway.
+  test.ws.poll();
+  paf.fulfiller->fulfill();
+  test.ws.poll();
+
+  auto subreq = test.receiveSubrequest("sink-addr");
+  subreq.recv(R"(
+    GET /main HTTP/1.1
+    Host: sink
+
+  )"_blockquote);
+  subreq.send(R"(
+    HTTP/1.1 204 No Content
+
+  )"_blockquote);
+
+  // Once the tail Worker is done, the server finishes shutting down.
+  KJ_ASSERT(KJ_ASSERT_NONNULL(test.runTask).poll(test.ws));
+}
+
+KJ_TEST("Server: Analytics Engine events are sent in batches") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let n = Number(new URL(request.url).searchParams.get("n"));
+                `    env.AE.writeDataPoint({ doubles: [n] });
+                `    return new Response("ok");
+                `  }
+                `}
+            )
+          ],
+          bindings = [ ( name = "AE", analyticsEngine = "sink" ) ],
+          analyticsEngineBatching = (maxEvents = 2)
+        )
+      ),
+      ( name = "sink", external = (address = "sink-addr", http = ()) ),
+      ( name = "tracing", tracingAdmin = () ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+      ( name = "admin", address = "admin-addr", service = "tracing" ),
+    ]
+  ))"_kj);
+
+  test.server.allowExperimental();
+  test.start();
+  auto conn = test.connect("test-addr");
+
+  // Both events go out in a single request once the batch is full.
+  conn.httpGet200("/?n=1.5", "ok");
+  conn.httpGet200("/?n=2.5", "ok");
+
+  auto subreq = test.receiveSubrequest("sink-addr");
+  subreq.recvRegex(
+      "POST / HTTP/1\\.1\n"
+      "[\\s\\S]*Content-Type: application/x-ndjson\n"
+      "[\\s\\S]*\n\n"
+      "\\{[^\n]*\"double1\":1\\.5[^\n]*\\}\n"
+      "\\{[^\n]*\"double1\":2\\.5[^\n]*\\}\n");
+  subreq.send(R"(
+    HTTP/1.1 204 No Content
+
+  )"_blockquote);
+  test.ws.poll();
+
+  // The tracing admin service reports the batcher's counters.
+  auto admin = test.connect("admin-addr");
+  admin.sendHttpGet("/batchers?service=hello");
+  admin.recvRegex(
+      "HTTP/1\\.1 200 OK\n"
+      "Content-Length: \\d+\n"
+      "Content-Type: application/json\n\n"
+      "\\{\"tails\":\\[\\],\"analyticsEngine\":\\[\\{\"itemsAdded\":2,\"itemsDropped\":0,"
+      "\"batchesDelivered\":1,\"itemsDelivered\":2,\"batchesFailed\":0,\"itemsFailed\":0,"
+      "\"batchesInFlight\":0\\}\\]\\}\n");
+}
+
+KJ_TEST("Server: admission control sheds requests with a 503") {
+  TestServer test(R"((
+    services = [
+      ( name = "hello",
+        worker = (
+          compatibilityDate = "2022-08-17",
+          modules = [
+            ( name = "main.js",
+              esModule =
+                `export default {
+                `  async fetch(request, env) {
+                `    let response = await env.SINK.fetch("http://sink/held");
+                `    return new Response(await response.text());
+                `  }
+                `}
+            )
+          ],
+          bindings = [ ( name = "SINK", service = "sink" ) ],
+          admissionControl = (maxConcurrentRequests = 1, maxQueuedRequests = 0)
+        )
+      ),
+      ( name = "sink", external = (address = "sink-addr", http = ()) ),
+      ( name = "tracing", tracingAdmin = () ),
+    ],
+    sockets = [
+      ( name = "main", address = "test-addr", service = "hello" ),
+      ( name = "admin", address = "admin-addr", service = "tracing" ),
+    ]
+  ))"_kj);
+
+  test.start();
+
+  // The first request is admitted, and stays in flight until the sink answers.
+  auto held = test.connect("test-addr");
+  held.sendHttpGet("/");
+  auto subreq = test.receiveSubrequest("sink-addr");
+  subreq.recv(R"(
+    GET /held HTTP/1.1
+    Host: sink
+
+  )"_blockquote);
+
+  // With no room to queue, the second request is shed before it reaches the Worker.
+  {
+    KJ_EXPECT_LOG(WARNING, "shedding requests");
+    auto conn = test.connect("test-addr");
+    conn.sendHttpGet("/");
+    conn.recv(R"(
+      HTTP/1.1 503 Service Unavailable
+      Content-Length: 19
+
+      Service Unavailable)"_blockquote);
+  }
+
+  auto admin = test.connect("admin-addr");
+  admin.sendHttpGet("/admission?service=hello");
+  admin.recvRegex(
+      "HTTP/1\\.1 200 OK\n"
+      "Content-Length: \\d+\n"
+      "Content-Type: application/json\n\n"
+      "\\{\"admitted\":1,\"queued\":0,\"shed\":1,\"inFlight\":1,\"queueDepth\":0,"
+      "\"lockWaitMs\":\\d+,\"eventLoopLagMs\":\\d+\\}\n");
+
+  // Once the first request finishes, its permit is released.
+  subreq.send(R"(
+    HTTP/1.1 200 OK
+    Content-Length: 4
+
+    done)"_blockquote);
+  held.recvHttp200("done");
+
+  admin.sendHttpGet("/admission?service=hello");
+  admin.recvRegex(
+      "HTTP/1\\.1 200 OK\n"
+      "Content-Length: \\d+\n"
+      "Content-Type: application/json\n\n"
+      "\\{\"admitted\":1,\"queued\":0,\"shed\":1,\"inFlight\":0,[^\n]*\\}\n");
+}
+
+KJ_TEST("Server: CPU limit terminates runaway requests") {
+  TestServer test(singleWorker(R"((
+    compatibilityDate = "2022-08-17",
+    modules = [
+      ( name = "main.js",
+        esModule =
+          `export default {
+          `  async fetch(request) {
+          `    if (request.url.endsWith("/spin")) {
+          `      for (;;) {}
+          `    }
+          `    return new Response("still alive");
+          `  }
+          `}
+      )
+    ],
+    limits = (cpuMs = 50)
+  ))"_kj));
+  test.start();
+
+  {
+    KJ_EXPECT_LOG(WARNING, "Worker exceeded CPU time limit.");
+    auto conn = test.connect("test-addr");
+    conn.send(R"(
+      GET /spin HTTP/1.1
+      Host: foo
+
+    )"_blockquote);
+    conn.recv(R"(
+      HTTP/1.1 503 Service Unavailable
+      Content-Length: 19
+
+      Service Unavailable)"_blockquote);
+  }
+
+  // The isolate is still usable afterwards.
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "still alive");
+}
+
+KJ_TEST("Server: CPU limit counts crypto work done off the isolate thread") {
+  // PBKDF2 with this many iterations runs on the crypto thread pool and takes far longer than the
+  // limit, while the JavaScript itself uses almost no CPU time.
+  TestServer test(singleWorker(R"((
+    compatibilityDate = "2022-08-17",
+    modules = [
+      ( name = "main.js",
+        esModule =
+          `export default {
+          `  async fetch(request) {
+          `    if (request.url.endsWith("/derive")) {
+          `      let key = await crypto.subtle.importKey(
+          `          "raw", new Uint8Array(16), "PBKDF2", false, ["deriveBits"]);
+          `      await crypto.subtle.deriveBits(
+          `          {name: "PBKDF2", hash: "SHA-256", salt: new Uint8Array(16),
+          `           iterations: 10000000}, key, 256);
+          `    }
+          `    return new Response("still alive");
+          `  }
+          `}
+      )
+    ],
+    limits = (cpuMs = 50)
+  ))"_kj));
+  test.start();
+
+  {
+    KJ_EXPECT_LOG(WARNING, "Worker exceeded CPU time limit.");
+    auto conn = test.connect("test-addr");
+    conn.send(R"(
+      GET /derive HTTP/1.1
+      Host: foo
+
+    )"_blockquote);
+    conn.recv(R"(
+      HTTP/1.1 503 Service Unavailable
+      Content-Length: 19
+
+      Service Unavailable)"_blockquote);
+  }
+
+  auto conn = test.connect("test-addr");
+  conn.httpGet200("/", "still alive");
+}
+
 // =======================================================================================
 
 // TODO(beta): Test TLS (send and receive)
@@ -26,13 +26,19 @@
 #include <workerd/io/actor-cache.h>
 #include <workerd/io/actor-sqlite.h>
 #include <workerd/io/request-tracker.h>
+#include <workerd/io/span-exporter.h>
 #include <workerd/util/http-util.h>
 #include <workerd/api/actor-state.h>
+#include <workerd/api/trace.h>
+#include <workerd/util/admission-control.h>
+#include <workerd/util/cpu-watchdog.h>
+#include <workerd/util/event-batcher.h>
 #include <workerd/util/mimetype.h>
 #include <workerd/util/uuid.h>
 #include <workerd/util/use-perfetto-categories.h>
 #include <workerd/api/worker-rpc.h>
 #include "workerd-api.h"
+#include "workerd-limit-enforcer.h"
 #include "workerd/io/hibernation-manager.h"
 #include <stdlib.h>
 
@@ -130,7 +136,8 @@ Server::Server(kj::Filesystem& fs, kj::Timer& timer, kj::Network& network,
                kj::Function<void(kj::String)> reportConfigError)
     : fs(fs), timer(timer), network(network), entropySource(entropySource),
       reportConfigError(kj::mv(reportConfigError)), consoleMode(consoleMode),
-      memoryCacheProvider(kj::heap<api::MemoryCacheProvider>()), tasks(*this) {}
+      memoryCacheProvider(kj::heap<api::MemoryCacheProvider>()),
+      kvCacheProvider(kj::heap<api::KvCacheProvider>()), tasks(*this) {}
 
 Server::~Server() noexcept(false) {
   // lingh: "internet"_kj service should destruct after worker service
@@ -1132,6 +1139,339 @@ kj::Own<Server::Service> Server::makeDiskDirectoryService(
 
 // =======================================================================================
 
+// Service used when the service is configured as a tracing admin service.
+class Server::TracingAdminService final: public Service, private WorkerInterface {
+public:
+  using FindWorkerFunc = kj::Function<kj::Maybe<kj::Own<const Worker>>(kj::StringPtr)>;
+  using FindAdmissionControllerFunc =
+      kj::Function<kj::Maybe<kj::Own<AdmissionController>>(kj::StringPtr)>;
+  using FindBatcherStatsFunc = kj::Function<kj::Maybe<kj::String>(kj::StringPtr)>;
+
+  TracingAdminService(config::TracingAdmin::Reader conf, kj::Timer& timer,
+                      kj::HttpHeaderTable::Builder& headerTableBuilder, FindWorkerFunc findWorker,
+                      FindAdmissionControllerFunc findAdmissionController,
+                      FindBatcherStatsFunc findBatcherStats)
+      : timer(timer), headerTable(headerTableBuilder.getFutureTable()),
+        findWorker(kj::mv(findWorker)), findAdmissionController(kj::mv(findAdmissionController)),
+        findBatcherStats(kj::mv(findBatcherStats)),
+        defaultCategories(kj::str(conf.getDefaultCategories())),
+        maxDuration(conf.getMaxDurationSeconds() * kj::SECONDS),
+        bufferSizeKb(conf.getBufferSizeKb()) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  kj::Timer& timer;
+  kj::HttpHeaderTable& headerTable;
+  FindWorkerFunc findWorker;
+  FindAdmissionControllerFunc findAdmissionController;
+  FindBatcherStatsFunc findBatcherStats;
+  kj::String defaultCategories;
+  kj::Duration maxDuration;
+  uint bufferSizeKb;
+
+  // V8 can't sample much faster than this, and trying to makes the sampler thread compete with
+  // the isolate for CPU.
+  static constexpr kj::Duration MIN_PROFILE_INTERVAL = 50 * kj::MICROSECONDS;
+
+  // Records a CPU profile of the worker's isolate for `duration` and returns it in pprof format,
+  // or none if the isolate is already being profiled.
+  kj::Promise<kj::Maybe<kj::Array<kj::byte>>> profile(
+      kj::Own<const Worker> worker, kj::Duration duration, kj::Duration samplingInterval) {
+    {
+      auto asyncLock = co_await worker->takeAsyncLockWithoutRequest(nullptr);
+      bool started = worker->runInLockScope(asyncLock, [&](Worker::Lock& lock) {
+        return lock.startCpuProfile(samplingInterval);
+      });
+      if (!started) co_return kj::none;
+    }
+
+    // If we're canceled, the profile must still be stopped, and there's no chance to wait for the
+    // lock asynchronously then.
+    bool stopped = false;
+    KJ_DEFER(if (!stopped) {
+      worker->runInLockScope(Worker::Lock::TakeSynchronously(kj::none), [](Worker::Lock& lock) {
+        lock.stopCpuProfile();
+      });
+    });
+
+    co_await timer.afterDelay(duration);
+
+    auto asyncLock = co_await worker->takeAsyncLockWithoutRequest(nullptr);
+    stopped = true;
+    co_return worker->runInLockScope(asyncLock, [](Worker::Lock& lock) {
+      return lock.stopCpuProfile();
+    });
+  }
+
+  // Parses a positive duration no longer than `maxDuration` given in `unit`s.
+  kj::Maybe<kj::Duration> parseDuration(kj::Maybe<kj::StringPtr> param, kj::Duration unit) {
+    auto str = KJ_UNWRAP_OR_RETURN(param, kj::none);
+    auto value = KJ_UNWRAP_OR_RETURN(str.tryParseAs<double>(), kj::none);
+    // Compare in nanoseconds so that NaN and absurdly large values are rejected before being
+    // converted to a Duration.
+    double nanos = value * (unit / kj::NANOSECONDS);
+    if (!(nanos >= 1 && nanos <= maxDuration / kj::NANOSECONDS)) return kj::none;
+    return static_cast<int64_t>(nanos) * kj::NANOSECONDS;
+  }
+
+  kj::String admissionStatsJson(const AdmissionController& controller) {
+    auto& stats = controller.getStats();
+    return kj::str(
+        "{\"admitted\":", stats.admitted,
+        ",\"queued\":", stats.queued,
+        ",\"shed\":", stats.shed,
+        ",\"inFlight\":", stats.inFlight,
+        ",\"queueDepth\":", stats.queueDepth,
+        ",\"lockWaitMs\":", controller.getLockWait() / kj::MILLISECONDS,
+        ",\"eventLoopLagMs\":", controller.getEventLoopLag() / kj::MILLISECONDS,
+        "}\n");
+  }
+
+  kj::Promise<void> sendFile(kj::HttpService::Response& response, kj::Array<kj::byte> data) {
+    kj::HttpHeaders headers(headerTable);
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::OCTET_STREAM.toString());
+    headers.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(data.size()));
+    auto out = response.send(200, "OK", headers, data.size());
+    co_await out->write(data.begin(), data.size());
+  }
+
+#if defined(WORKERD_USE_PERFETTO)
+  // True while a `/trace` request is recording.
+  bool timedSessionActive = false;
+
+  // Session started by `/start`, if it is still recording.
+  kj::Maybe<PerfettoSession> startedSession;
+
+  // Stops `startedSession` once it has been recording for `maxDuration`.
+  kj::Promise<void> autoStop = nullptr;
+
+  // Trace from a session that `autoStop` stopped, waiting to be collected by `/stop`. Resolves
+  // once Perfetto has handed it over.
+  kj::Maybe<kj::Promise<kj::Array<kj::byte>>> stoppedTrace;
+
+  bool isRecording() {
+    return timedSessionActive || startedSession != kj::none;
+  }
+
+  kj::Promise<kj::Array<kj::byte>> recordFor(kj::StringPtr categories, kj::Duration duration) {
+    auto session = PerfettoSession::inMemory(categories, bufferSizeKb);
+    timedSessionActive = true;
+    KJ_DEFER(timedSessionActive = false);
+    co_await timer.afterDelay(duration);
+    co_return co_await session.stopAndRead();
+  }
+
+  void start(kj::StringPtr categories) {
+    startedSession = PerfettoSession::inMemory(categories, bufferSizeKb);
+    stoppedTrace = kj::none;
+    autoStop = timer.afterDelay(maxDuration).then([this]() {
+      // Errors reading the trace are reported to whoever collects it.
+      stoppedTrace = KJ_ASSERT_NONNULL(startedSession).stopAndRead().eagerlyEvaluate(nullptr);
+      startedSession = kj::none;
+    }).eagerlyEvaluate([](kj::Exception&& e) {
+      KJ_LOG(ERROR, "failed to stop tracing session", e);
+    });
+  }
+
+  kj::Maybe<kj::Promise<kj::Array<kj::byte>>> stop() {
+    KJ_IF_SOME(session, startedSession) {
+      autoStop = nullptr;
+      auto trace = session.stopAndRead();
+      startedSession = kj::none;
+      return kj::mv(trace);
+    }
+    auto result = kj::mv(stoppedTrace);
+    stoppedTrace = kj::none;
+    return result;
+  }
+
+#endif  // defined(WORKERD_USE_PERFETTO)
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr urlStr, const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    TRACE_EVENT("workerd", "TracingAdminService::request()", "url", urlStr.cStr());
+    auto url = kj::Url::parse(urlStr, kj::Url::HTTP_REQUEST);
+
+    kj::StringPtr categories = defaultCategories;
+    kj::Maybe<kj::StringPtr> durationParam;
+    kj::Maybe<kj::StringPtr> serviceParam;
+    kj::Maybe<kj::StringPtr> intervalParam;
+    for (auto& param: url.query) {
+      if (param.name == "categories") {
+        categories = param.value;
+      } else if (param.name == "duration") {
+        durationParam = param.value;
+      } else if (param.name == "service") {
+        serviceParam = param.value;
+      } else if (param.name == "interval") {
+        intervalParam = param.value;
+      }
+    }
+
+    kj::StringPtr endpoint = url.path.size() == 1 ? kj::StringPtr(url.path[0]) : ""_kj;
+
+    if (endpoint == "profile") {
+      if (method != kj::HttpMethod::GET) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+
+      auto duration = KJ_UNWRAP_OR(parseDuration(durationParam, kj::SECONDS), {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+      kj::Duration interval = 1 * kj::MILLISECONDS;
+      if (intervalParam != kj::none) {
+        interval = KJ_UNWRAP_OR(parseDuration(intervalParam, kj::MICROSECONDS), {
+          co_return co_await response.sendError(400, "Bad Request", headerTable);
+        });
+        if (interval < MIN_PROFILE_INTERVAL) {
+          co_return co_await response.sendError(400, "Bad Request", headerTable);
+        }
+      }
+      auto serviceName = KJ_UNWRAP_OR(serviceParam, {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+      auto maybeWorker = findWorker(serviceName);
+      auto& worker = KJ_UNWRAP_OR(maybeWorker, {
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      });
+
+      auto maybeProfile = co_await profile(kj::mv(worker), duration, interval);
+      KJ_IF_SOME(data, maybeProfile) {
+        co_return co_await sendFile(response, kj::mv(data));
+      } else {
+        co_return co_await response.sendError(409, "Conflict", headerTable);
+      }
+    }
+
+    if (endpoint == "admission") {
+      if (method != kj::HttpMethod::GET) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+
+      auto serviceName = KJ_UNWRAP_OR(serviceParam, {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+      auto maybeController = findAdmissionController(serviceName);
+      auto& controller = KJ_UNWRAP_OR(maybeController, {
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      });
+
+      auto body = admissionStatsJson(*controller);
+      kj::HttpHeaders headers(headerTable);
+      headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
+      auto out = response.send(200, "OK", headers, body.size());
+      co_return co_await out->write(body.begin(), body.size());
+    }
+
+    if (endpoint == "batchers") {
+      if (method != kj::HttpMethod::GET) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+
+      auto serviceName = KJ_UNWRAP_OR(serviceParam, {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+      auto body = KJ_UNWRAP_OR(findBatcherStats(serviceName), {
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      });
+
+      kj::HttpHeaders headers(headerTable);
+      headers.set(kj::HttpHeaderId::CONTENT_TYPE, MimeType::JSON.toString());
+      auto out = response.send(200, "OK", headers, body.size());
+      co_return co_await out->write(body.begin(), body.size());
+    }
+
+#if defined(WORKERD_USE_PERFETTO)
+    if (endpoint == "trace") {
+      if (method != kj::HttpMethod::GET) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+
+      auto duration = KJ_UNWRAP_OR(parseDuration(durationParam, kj::SECONDS), {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+
+      if (isRecording()) {
+        co_return co_await response.sendError(409, "Conflict", headerTable);
+      }
+
+      auto trace = co_await recordFor(categories, duration);
+      co_return co_await sendFile(response, kj::mv(trace));
+    } else if (endpoint == "start") {
+      if (method != kj::HttpMethod::POST) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+      if (isRecording()) {
+        co_return co_await response.sendError(409, "Conflict", headerTable);
+      }
+
+      start(categories);
+      kj::HttpHeaders headers(headerTable);
+      response.send(204, "No Content", headers);
+      co_return;
+    } else if (endpoint == "stop") {
+      if (method != kj::HttpMethod::POST) {
+        co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+      }
+
+      auto maybeTrace = stop();
+      KJ_IF_SOME(trace, maybeTrace) {
+        co_return co_await sendFile(response, co_await kj::mv(trace));
+      } else {
+        co_return co_await response.sendError(404, "Not Found", headerTable);
+      }
+    } else {
+      co_return co_await response.sendError(404, "Not Found", headerTable);
+    }
+#else
+    if (endpoint == "trace" || endpoint == "start" || endpoint == "stop") {
+      co_return co_await response.sendError(501, "Not Implemented", headerTable);
+    } else {
+      co_return co_await response.sendError(404, "Not Found", headerTable);
+    }
+#endif  // defined(WORKERD_USE_PERFETTO)
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Tracing admin services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeTracingAdminService(
+    config::TracingAdmin::Reader conf, kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  TRACE_EVENT("workerd", "Server::makeTracingAdminService()");
+  return kj::heap<TracingAdminService>(conf, timer, headerTableBuilder,
+      [this](kj::StringPtr serviceName) { return findWorker(serviceName); },
+      [this](kj::StringPtr serviceName) { return findAdmissionController(serviceName); },
+      [this](kj::StringPtr serviceName) { return findBatcherStats(serviceName); });
+}
+
+// =======================================================================================
+
 // This class exists to update the InspectorService's table of isolates when a config
 // has multiple services. The InspectorService exists on the stack of it's own thread and
 // initializes state that is bound to the thread, e.g. a http server and an event loop.
@@ -1376,6 +1716,23 @@ void Server::InspectorServiceIsolateRegistrar::registerIsolate(kj::StringPtr nam
 
 // =======================================================================================
 
+// Used when span export is enabled. Each request starts a new trace, rooted at a span which
+// lasts as long as the request.
+class SpanExportingRequestObserver final: public RequestObserver {
+public:
+  SpanExportingRequestObserver(SpanExporter& exporter, kj::Maybe<kj::StringPtr> entrypointName)
+      : span(exporter.newTrace(), "worker_request"_kjc) {
+    KJ_IF_SOME(name, entrypointName) {
+      span.setTag("entrypoint"_kjc, kj::str(name));
+    }
+  }
+
+  SpanParent getSpan() override { return SpanParent(span); }
+
+private:
+  SpanBuilder span;
+};
+
 class Server::WorkerService final: public Service, private kj::TaskSet::ErrorHandler,
                                    private IoChannelFactory, private TimerChannel,
                                    private LimitEnforcer {
@@ -1389,6 +1746,14 @@ public:
     kj::Maybe<Service&> cache;
     kj::Maybe<kj::Own<SqliteDatabase::Vfs>> actorStorage;
     AlarmScheduler& alarmScheduler;
+    kj::Array<Service*> tails;
+  };
+
+  // Where traces of this Worker's requests are sent, if anywhere.
+  struct TailOptions {
+    // Reported to tail Workers as the traced script's name.
+    kj::String scriptName;
+    TraceBatcher::Options batching;
   };
   using LinkCallback = kj::Function<LinkedIoChannels(WorkerService&)>;
   using AbortActorsCallback = kj::Function<void()>;
@@ -1397,12 +1762,20 @@ public:
                 kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers,
                 kj::HashMap<kj::String, kj::HashSet<kj::String>> namedEntrypointsParam,
                 const kj::HashMap<kj::String, ActorConfig>& actorClasses,
-                LinkCallback linkCallback, AbortActorsCallback abortActorsCallback)
+                LinkCallback linkCallback, AbortActorsCallback abortActorsCallback,
+                kj::Maybe<SpanExporter&> spanExporter,
+                kj::Maybe<kj::Own<AdmissionController>> admissionController,
+                const WorkerdIsolateLimitEnforcer& isolateLimits,
+                kj::Maybe<EventBatcher::Limits> analyticsEngineBatching,
+                kj::Maybe<TailOptions> tailOptions)
       : threadContext(threadContext),
         ioChannels(kj::mv(linkCallback)),
+        isolateLimits(isolateLimits),
         worker(kj::mv(worker)),
         defaultEntrypointHandlers(kj::mv(defaultEntrypointHandlers)),
-        waitUntilTasks(*this), abortActorsCallback(kj::mv(abortActorsCallback)) {
+        waitUntilTasks(*this), abortActorsCallback(kj::mv(abortActorsCallback)),
+        spanExporter(spanExporter), admissionController(kj::mv(admissionController)),
+        analyticsEngineBatching(analyticsEngineBatching), tailOptions(kj::mv(tailOptions)) {
 
     namedEntrypoints.reserve(namedEntrypointsParam.size());
     for (auto& ep: namedEntrypointsParam) {
@@ -1429,6 +1802,19 @@ public:
     LinkCallback callback = kj::mv(KJ_REQUIRE_NONNULL(
         ioChannels.tryGet<LinkCallback>(), "already called link()"));
     ioChannels = callback(*this);
+
+    KJ_IF_SOME(options, tailOptions) {
+      auto& channels = ioChannels.get<LinkedIoChannels>();
+      tailBatchers = KJ_MAP(tail, channels.tails) {
+        return kj::heap<TraceBatcher>(threadContext.getUnsafeTimer(), options.batching,
+            [this, tail](kj::Array<kj::Own<Trace>> traces) -> kj::Promise<void> {
+          auto worker = tail->startRequest({});
+          auto event = kj::heap<api::TraceCustomEventImpl>(
+              api::TraceCustomEventImpl::EVENT_TYPE, waitUntilTasks, kj::mv(traces));
+          return worker->customEvent(kj::mv(event)).ignoreResult().attach(kj::mv(worker));
+        });
+      };
+    }
   }
 
   kj::Maybe<ActorNamespace&> getActorNamespace(kj::StringPtr name) {
@@ -1443,6 +1829,41 @@ public:
     return actorNamespaces;
   }
 
+  const Worker& getWorker() { return *worker; }
+
+  // Delivers the traces and Analytics Engine events still waiting in the batchers. Resolves once
+  // every batch has been delivered or has failed.
+  kj::Promise<void> flushBatchers() {
+    kj::Vector<kj::Promise<void>> flushes;
+    for (auto& batcher: tailBatchers) {
+      flushes.add(batcher->flush());
+    }
+    for (auto& entry: logfwdrBatchers) {
+      flushes.add(entry.value->flush());
+    }
+    return kj::joinPromises(flushes.releaseAsArray());
+  }
+
+  // Reports the stats of the tail batchers, one per tail Worker, and of the Analytics Engine
+  // batchers, one per destination that has been written to.
+  kj::String getBatcherStatsJson() {
+    auto tails = KJ_MAP(batcher, tailBatchers) { return statsJson(batcher->getStats()); };
+    kj::Vector<kj::String> analyticsEngine;
+    for (auto& entry: logfwdrBatchers) {
+      analyticsEngine.add(statsJson(entry.value->getStats()));
+    }
+    return kj::str(
+        "{\"tails\":[", kj::strArray(tails, ","),
+        "],\"analyticsEngine\":[", kj::strArray(analyticsEngine, ","),
+        "]}\n");
+  }
+
+  kj::Maybe<AdmissionController&> getAdmissionController() {
+    return admissionController.map([](kj::Own<AdmissionController>& c) -> AdmissionController& {
+      return *c;
+    });
+  }
+
   kj::Own<WorkerInterface> startRequest(
       IoChannelFactory::SubrequestMetadata metadata) override {
     return startRequest(kj::mv(metadata), kj::none);
@@ -1460,21 +1881,74 @@ public:
       IoChannelFactory::SubrequestMetadata metadata, kj::Maybe<kj::StringPtr> entrypointName,
       kj::Maybe<kj::Own<Worker::Actor>> actor = kj::none) {
     TRACE_EVENT("workerd", "Server::WorkerService::startRequest()");
+
+    // Actors are not subject to admission control, since a request to an actor can't be
+    // served by any other instance anyway.
+    if (actor == kj::none) {
+      KJ_IF_SOME(controller, admissionController) {
+        // Don't start the request until it is admitted, so that queued requests haven't yet
+        // created an IoContext. The permit is held until the request is done with the Worker.
+        return newPromisedWorkerInterface(waitUntilTasks, controller->admit()
+            .then([this, metadata = kj::mv(metadata), entrypointName]
+                  (kj::Own<AdmissionController::Permit> permit) mutable
+                  -> kj::Own<WorkerInterface> {
+          return startAdmittedRequest(kj::mv(metadata), entrypointName, kj::none)
+              .attach(kj::mv(permit));
+        }));
+      }
+    }
+
+    return startAdmittedRequest(kj::mv(metadata), entrypointName, kj::mv(actor));
+  }
+
+  kj::Own<WorkerInterface> startAdmittedRequest(
+      IoChannelFactory::SubrequestMetadata metadata, kj::Maybe<kj::StringPtr> entrypointName,
+      kj::Maybe<kj::Own<Worker::Actor>> actor) {
+    kj::Own<RequestObserver> observer;
+    KJ_IF_SOME(exporter, spanExporter) {
+      observer = kj::refcounted<SpanExportingRequestObserver>(exporter, entrypointName);
+    } else {
+      observer = kj::refcounted<RequestObserver>();  // default observer makes no observations
+    }
+    // When the Worker has no CPU or memory limits, we enforce no limits ourselves.
+    auto limitEnforcer = isolateLimits.tryMakeRequestLimitEnforcer()
+        .orDefault(kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance));
     return newWorkerEntrypoint(
         threadContext,
         kj::atomicAddRef(*worker),
         entrypointName,
         kj::mv(actor),
-        kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
+        kj::mv(limitEnforcer),
         {},                        // ioContextDependency
         kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance),
-        kj::refcounted<RequestObserver>(),  // default observer makes no observations
+        kj::mv(observer),
         waitUntilTasks,
         true,                      // tunnelExceptions
-        kj::none,                  // workerTracer
+        makeWorkerTracer(entrypointName),
         kj::mv(metadata.cfBlobJson));
   }
 
+  // Returns a tracer for a new request if the Worker has tails. Its trace is handed to the tails'
+  // batchers once the request is done with it.
+  kj::Maybe<kj::Own<WorkerTracer>> makeWorkerTracer(kj::Maybe<kj::StringPtr> entrypointName) {
+    if (tailBatchers.size() == 0) return kj::none;
+
+    auto& options = KJ_ASSERT_NONNULL(tailOptions);
+    auto pipeline = kj::refcounted<PipelineTracer>();
+    waitUntilTasks.add(pipeline->onComplete().then([this](kj::Array<kj::Own<Trace>> traces) {
+      for (auto& batcher: tailBatchers) {
+        batcher->addAll(KJ_MAP(trace, traces) { return kj::addRef(*trace); });
+      }
+    }));
+    return pipeline->makeWorkerTracer(PipelineLogLevel::FULL,
+        kj::none,                  // stableId
+        kj::str(options.scriptName),
+        kj::none,                  // scriptVersion
+        kj::none,                  // dispatchNamespace
+        nullptr,                   // scriptTags
+        entrypointName.map([](kj::StringPtr name) { return kj::str(name); }));
+  }
+
   class ActorNamespace final {
   public:
     ActorNamespace(WorkerService& service,kj::StringPtr className, const ActorConfig& config,
@@ -1978,12 +2452,27 @@ private:
   // LinkedIoChannels owns the SqliteDatabase::Vfs, so make sure it is destroyed last.
   kj::OneOf<LinkCallback, LinkedIoChannels> ioChannels;
 
+  // Owned by the Worker's isolate.
+  const WorkerdIsolateLimitEnforcer& isolateLimits;
+
   kj::Own<const Worker> worker;
   kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers;
   kj::HashMap<kj::String, EntrypointService> namedEntrypoints;
   kj::HashMap<kj::StringPtr, kj::Own<ActorNamespace>> actorNamespaces;
   kj::TaskSet waitUntilTasks;
   AbortActorsCallback abortActorsCallback;
+  kj::Maybe<SpanExporter&> spanExporter;
+  kj::Maybe<kj::Own<AdmissionController>> admissionController;
+
+  // If set, Analytics Engine events are sent in batches, using one EventBatcher per logfwdr
+  // channel, created on first use.
+  kj::Maybe<EventBatcher::Limits> analyticsEngineBatching;
+  kj::HashMap<uint, kj::Own<EventBatcher>> logfwdrBatchers;
+
+  // If set, traces of each request are delivered to the tail Workers in `tailBatchers`, one per
+  // tail Worker, created by link().
+  kj::Maybe<TailOptions> tailOptions;
+  kj::Array<kj::Own<TraceBatcher>> tailBatchers;
 
   class ActorChannelImpl final: public IoChannelFactory::ActorChannel {
   public:
@@ -2096,11 +2585,6 @@ private:
       kj::FunctionParam<void(capnp::AnyPointer::Builder)> buildMessage) override {
     auto& context = IoContext::current();
 
-    auto headers = kj::HttpHeaders(context.getHeaderTable());
-    auto client = context.getHttpClient(channel, true, kj::none, "writeLogfwdr"_kjc);
-
-    auto urlStr = kj::str("https://fake-host");
-
     capnp::MallocMessageBuilder requestMessage;
     auto requestBuilder = requestMessage.initRoot<capnp::AnyPointer>();
 
@@ -2108,6 +2592,16 @@ private:
     capnp::JsonCodec json;
     auto requestJson = json.encode(requestBuilder.getAs<api::AnalyticsEngineEvent>());
 
+    KJ_IF_SOME(limits, analyticsEngineBatching) {
+      co_await context.waitForOutputLocks();
+      co_return co_await getLogfwdrBatcher(channel, limits).add(requestJson.asBytes());
+    }
+
+    auto headers = kj::HttpHeaders(context.getHeaderTable());
+    auto client = context.getHttpClient(channel, true, kj::none, "writeLogfwdr"_kjc);
+
+    auto urlStr = kj::str("https://fake-host");
+
     co_await context.waitForOutputLocks();
 
     auto innerReq = client->request(kj::HttpMethod::POST, urlStr, headers, requestJson.size());
@@ -2128,6 +2622,51 @@ private:
     co_return;
   }
 
+  static kj::String statsJson(const BatcherStats& stats) {
+    return kj::str(
+        "{\"itemsAdded\":", stats.itemsAdded,
+        ",\"itemsDropped\":", stats.itemsDropped,
+        ",\"batchesDelivered\":", stats.batchesDelivered,
+        ",\"itemsDelivered\":", stats.itemsDelivered,
+        ",\"batchesFailed\":", stats.batchesFailed,
+        ",\"itemsFailed\":", stats.itemsFailed,
+        ",\"batchesInFlight\":", stats.batchesInFlight,
+        "}");
+  }
+
+  EventBatcher& getLogfwdrBatcher(uint channel, EventBatcher::Limits limits) {
+    return *logfwdrBatchers.findOrCreate(channel, [&]() -> decltype(logfwdrBatchers)::Entry {
+      return { channel, kj::heap<EventBatcher>(threadContext.getUnsafeTimer(), limits,
+          [this, channel](kj::Array<kj::byte> body, uint) {
+        return sendLogfwdrBatch(channel, kj::mv(body));
+      }) };
+    });
+  }
+
+  // Sends a batch of newline-delimited JSON events. Unlike writeLogfwdr(), this doesn't run
+  // within any one request's IoContext, since the batch holds events from many requests.
+  kj::Promise<void> sendLogfwdrBatch(uint channel, kj::Array<kj::byte> body) {
+    auto& channels = KJ_REQUIRE_NONNULL(ioChannels.tryGet<LinkedIoChannels>(),
+        "link() has not been called");
+    KJ_REQUIRE(channel < channels.subrequest.size(), "invalid subrequest channel number");
+
+    auto worker = channels.subrequest[channel]->startRequest({});
+    auto client = kj::newHttpClient(*worker);
+
+    kj::HttpHeaders headers(threadContext.getHeaderTable());
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE, "application/x-ndjson");
+    auto request = client->request(kj::HttpMethod::POST, "https://fake-host", headers,
+                                   body.size());
+
+    co_await request.body->write(body.begin(), body.size());
+    request.body = nullptr;
+    auto response = co_await request.response;
+
+    KJ_REQUIRE(response.statusCode >= 200 && response.statusCode < 300,
+        "writeLogfwdr request returned an error", response.statusCode);
+    co_await response.body->readAllBytes().ignoreResult();
+  }
+
   kj::Own<ActorChannel> getGlobalActor(uint channel, const ActorIdFactory::ActorId& id,
       kj::Maybe<kj::String> locationHint, ActorGetMode mode, SpanParent parentSpan) override {
     JSG_REQUIRE(mode == ActorGetMode::GET_OR_CREATE, Error,
@@ -2180,7 +2719,8 @@ private:
   // ---------------------------------------------------------------------------
   // implements LimitEnforcer
   //
-  // No limits are enforced.
+  // No limits are enforced. Used for requests to Workers that have no CPU or memory limits; see
+  // WorkerdIsolateLimitEnforcer for the others.
 
   kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) override { return {}; }
   void topUpActor() override {}
@@ -2191,6 +2731,13 @@ private:
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   kj::Duration getAlarmLimit() override { return 0 * kj::MILLISECONDS; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  size_t getTeeLagLimit() override {
+    return isolateLimits.getLimits().teeLagLimit.orDefault(kj::maxValue);
+  }
+  TeeLagPolicy getTeeLagPolicy() override { return isolateLimits.getLimits().teeLagPolicy; }
+  WriteCoalescingOptions getWriteCoalescingOptions() override {
+    return isolateLimits.getLimits().writeCoalescing;
+  }
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return kj::none; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
@@ -2215,6 +2762,7 @@ static kj::Maybe<WorkerdApi::Global> createBinding(
     kj::Vector<FutureSubrequestChannel>& subrequestChannels,
     kj::Vector<FutureActorChannel>& actorChannels,
     kj::HashMap<kj::String, kj::HashMap<kj::String, Server::ActorConfig>>& actorConfigs,
+    const api::KvCacheProvider& kvCacheProvider,
     bool experimental) {
   // creates binding object or returns null and reports an error
   using Global = WorkerdApi::Global;
@@ -2228,6 +2776,11 @@ static kj::Maybe<WorkerdApi::Global> createBinding(
 
   auto errorContext = kj::str("Worker \"", workerName , "\"'s binding \"", bindingName, "\"");
 
+  if (binding.hasKvCache() && binding.which() != config::Worker::Binding::KV_NAMESPACE) {
+    errorReporter.addError(kj::str(errorContext, " specifies kvCache, but isn't a KV namespace."));
+    return kj::none;
+  }
+
   switch (binding.which()) {
     case config::Worker::Binding::UNSPECIFIED:
       errorReporter.addError(kj::str(errorContext, " does not specify any binding value."));
@@ -2410,13 +2963,42 @@ static kj::Maybe<WorkerdApi::Global> createBinding(
     }
 
     case config::Worker::Binding::KV_NAMESPACE: {
+      kj::Maybe<kj::Own<const api::KvCache>> cache;
+      uint32_t defaultCacheTtlSeconds = 0;
+      if (binding.hasKvCache()) {
+        auto cacheConf = binding.getKvCache();
+        auto kvNamespace = binding.getKvNamespace();
+        auto instance = kvCacheProvider.getInstance(
+            cacheConf.hasId() ? kj::Maybe<kj::StringPtr>(cacheConf.getId()) : kj::none,
+            kj::str(kvNamespace.getName(), "#", kvNamespace.getEntrypoint()),
+            {
+              .maxKeys = cacheConf.getMaxKeys(),
+              .maxValueSize = cacheConf.getMaxValueSize(),
+              .maxTotalSize = cacheConf.getMaxTotalValueSize(),
+            });
+        KJ_SWITCH_ONEOF(instance) {
+          KJ_CASE_ONEOF(c, kj::Own<const api::KvCache>) {
+            cache = kj::mv(c);
+          }
+          KJ_CASE_ONEOF(error, kj::String) {
+            errorReporter.addError(kj::str(errorContext, ": ", error));
+            return kj::none;
+          }
+        }
+        defaultCacheTtlSeconds = cacheConf.getDefaultTtlSeconds();
+      }
+
       uint channel = (uint)subrequestChannels.size() + IoContext::SPECIAL_SUBREQUEST_CHANNEL_COUNT;
       subrequestChannels.add(FutureSubrequestChannel {
         binding.getKvNamespace(),
         kj::mv(errorContext)
       });
 
-      return makeGlobal(Global::KvNamespace{.subrequestChannel = channel});
+      return makeGlobal(Global::KvNamespace{
+        .subrequestChannel = channel,
+        .cache = kj::mv(cache),
+        .defaultCacheTtlSeconds = defaultCacheTtlSeconds,
+      });
     }
 
     case config::Worker::Binding::R2_BUCKET: {
@@ -2452,7 +3034,8 @@ static kj::Maybe<WorkerdApi::Global> createBinding(
       kj::Vector<Global> innerGlobals;
       for (const auto& innerBinding: wrapped.getInnerBindings()) {
         KJ_IF_SOME(global, createBinding(workerName, conf, innerBinding,
-            errorReporter, subrequestChannels, actorChannels, actorConfigs, experimental)) {
+            errorReporter, subrequestChannels, actorChannels, actorConfigs, kvCacheProvider,
+            experimental)) {
           innerGlobals.add(kj::mv(global));
         } else {
           // we've already communicated the error
@@ -2553,6 +3136,33 @@ static kj::Maybe<WorkerdApi::Global> createBinding(
 
 uint startInspector(kj::StringPtr inspectorAddress, Server::InspectorServiceIsolateRegistrar& registrar);
 
+kj::Maybe<kj::Own<const Worker>> Server::findWorker(kj::StringPtr serviceName) {
+  auto& service = KJ_UNWRAP_OR_RETURN(services.find(serviceName), kj::none);
+  if (WorkerService* worker = dynamic_cast<WorkerService*>(service.get())) {
+    return kj::atomicAddRef(worker->getWorker());
+  }
+  return kj::none;
+}
+
+kj::Maybe<kj::String> Server::findBatcherStats(kj::StringPtr serviceName) {
+  auto& service = KJ_UNWRAP_OR_RETURN(services.find(serviceName), kj::none);
+  if (WorkerService* worker = dynamic_cast<WorkerService*>(service.get())) {
+    return worker->getBatcherStatsJson();
+  }
+  return kj::none;
+}
+
+kj::Maybe<kj::Own<AdmissionController>> Server::findAdmissionController(
+    kj::StringPtr serviceName) {
+  auto& service = KJ_UNWRAP_OR_RETURN(services.find(serviceName), kj::none);
+  if (WorkerService* worker = dynamic_cast<WorkerService*>(service.get())) {
+    return worker->getAdmissionController().map([](AdmissionController& controller) {
+      return kj::addRef(controller);
+    });
+  }
+  return kj::none;
+}
+
 void Server::abortAllActors() {
   for (auto& service: services) {
     if (WorkerService* worker = dynamic_cast<WorkerService*>(&*service.value)) {
@@ -2635,56 +3245,130 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     errorReporter.addError(kj::str("Worker must specify compatibilityDate."));
   }
 
-  // IsolateLimitEnforcer that enforces no limits.
-  class NullIsolateLimitEnforcer final: public IsolateLimitEnforcer {
+  // Reports how long each request waited for the isolate lock to the admission controller. The
+  // wait is measured from when the LockTiming is created, since for async locks `start()` is
+  // only called once the wait is over.
+  class AdmissionLockTiming final: public IsolateObserver::LockTiming {
   public:
-    v8::Isolate::CreateParams getCreateParams() override { return {}; }
-    void customizeIsolate(v8::Isolate* isolate) override {}
-    ActorCacheSharedLruOptions getActorCacheLruOptions() override {
-      // TODO(someday): Make this configurable?
-      return {
-        .softLimit = 16 * (1ull << 20), // 16 MiB
-        .hardLimit = 128 * (1ull << 20), // 128 MiB
-        .staleTimeout = 30 * kj::SECONDS,
-        .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
-        .maxKeysPerRpc = 128,
-
-        // For now, we use `neverFlush` to implement in-memory-only actors.
-        // See WorkerService::getActor().
-        .neverFlush = true
-      };
-    }
-    kj::Own<void> enterStartupJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
+    explicit AdmissionLockTiming(AdmissionController& controller)
+        : controller(controller), created(kj::systemPreciseMonotonicClock().now()) {}
+
+    void locked() override {
+      controller.reportLockWait(kj::systemPreciseMonotonicClock().now() - created);
     }
-    kj::Own<void> enterStartupPython(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
+
+  private:
+    AdmissionController& controller;
+    kj::TimePoint created;
+  };
+
+  class AdmissionIsolateObserver final: public IsolateObserver {
+  public:
+    explicit AdmissionIsolateObserver(kj::Own<AdmissionController> controllerParam)
+        : controller(*controllerParam), ownController(kj::mv(controllerParam)) {}
+
+    kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+        kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override {
+      return kj::Own<LockTiming>(kj::heap<AdmissionLockTiming>(controller));
     }
-    kj::Own<void> enterDynamicImportJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
+
+  private:
+    AdmissionController& controller;
+    kj::Own<AdmissionController> ownController;
+  };
+
+  kj::Maybe<kj::Own<AdmissionController>> admissionController;
+  kj::Own<IsolateObserver> observer;
+  if (conf.hasAdmissionControl()) {
+    auto admissionConf = conf.getAdmissionControl();
+    auto msOrNone = [](uint32_t ms) -> kj::Maybe<kj::Duration> {
+      if (ms == 0) return kj::none;
+      return ms * kj::MILLISECONDS;
+    };
+    auto controller = kj::refcounted<AdmissionController>(timer, AdmissionController::Limits {
+      .maxConcurrentRequests = admissionConf.getMaxConcurrentRequests(),
+      .maxQueuedRequests = admissionConf.getMaxQueuedRequests(),
+      .maxQueueTime = msOrNone(admissionConf.getMaxQueueTimeMs()),
+      .maxLockWait = msOrNone(admissionConf.getMaxLockWaitMs()),
+      .maxEventLoopLag = msOrNone(admissionConf.getMaxEventLoopLagMs()),
+    });
+    observer = kj::atomicRefcounted<AdmissionIsolateObserver>(kj::addRef(*controller));
+    admissionController = kj::mv(controller);
+  } else {
+    observer = kj::atomicRefcounted<IsolateObserver>();
+  }
+
+  WorkerdLimits limits;
+  if (conf.hasLimits()) {
+    auto limitsConf = conf.getLimits();
+    if (limitsConf.getCpuMs() > 0) {
+      limits.cpuTime = limitsConf.getCpuMs() * kj::MILLISECONDS;
     }
-    kj::Own<void> enterLoggingJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
+    if (limitsConf.getHeapMb() > 0) {
+      limits.heapSize = size_t(limitsConf.getHeapMb()) << 20;
     }
-    kj::Own<void> enterInspectorJs(
-        jsg::Lock& loc, kj::Maybe<kj::Exception>& error) const override {
-      return {};
+  }
+  if (conf.hasTeeLag()) {
+    auto teeLagConf = conf.getTeeLag();
+    limits.teeLagLimit = teeLagConf.getMaxBytes();
+    switch (teeLagConf.getPolicy()) {
+      case config::Worker::TeeLag::Policy::ERROR_LAGGING_BRANCH:
+        limits.teeLagPolicy = TeeLagPolicy::ERROR_LAGGING_BRANCH;
+        break;
+      case config::Worker::TeeLag::Policy::WAIT_FOR_LAGGING_BRANCH:
+        limits.teeLagPolicy = TeeLagPolicy::WAIT_FOR_LAGGING_BRANCH;
+        break;
     }
-    void completedRequest(kj::StringPtr id) const override {}
-    bool exitJs(jsg::Lock& lock) const override { return false; }
-    void reportMetrics(IsolateObserver& isolateMetrics) const override {}
-    kj::Maybe<size_t> checkPbkdfIterations(jsg::Lock& lock, size_t iterations) const override {
-      // No limit on the number of iterations in workerd
-      return kj::none;
+  }
+  if (conf.hasWriteCoalescing()) {
+    auto coalescingConf = conf.getWriteCoalescing();
+    limits.writeCoalescing = {
+      .maxBytes = coalescingConf.getMaxBytes(),
+      .maxDelay = coalescingConf.getMaxDelayMs() * kj::MILLISECONDS,
+    };
+  }
+  kj::Maybe<EventBatcher::Limits> analyticsEngineBatching;
+  if (conf.hasAnalyticsEngineBatching()) {
+    auto batchingConf = conf.getAnalyticsEngineBatching();
+    analyticsEngineBatching = EventBatcher::Limits {
+      .maxEvents = kj::max(batchingConf.getMaxEvents(), 1u),
+      .maxBytes = batchingConf.getMaxBytes(),
+      .flushInterval = batchingConf.getFlushIntervalMs() * kj::MILLISECONDS,
+      .maxPendingBatches = kj::max(batchingConf.getMaxPendingBatches(), 1u),
+    };
+  }
+  kj::Maybe<WorkerService::TailOptions> tailOptions;
+  if (conf.hasTails() && conf.getTails().size() > 0) {
+    TraceBatcher::Options batching {
+      // Unless asked to batch, deliver each trace on its own as soon as it's complete.
+      .maxBatchSize = 1,
+      .maxDelay = 0 * kj::MILLISECONDS,
+    };
+    if (conf.hasTailBatching()) {
+      auto batchingConf = conf.getTailBatching();
+      batching = {
+        .maxBatchSize = kj::max(batchingConf.getMaxTraces(), 1u),
+        .maxDelay = batchingConf.getMaxDelayMs() * kj::MILLISECONDS,
+        .maxBufferedTraces = batchingConf.getMaxBufferedTraces(),
+        .maxBufferedBytes = batchingConf.getMaxBufferedBytes(),
+        .maxConcurrentDeliveries = kj::max(batchingConf.getMaxConcurrentDeliveries(), 1u),
+      };
     }
-  };
+    tailOptions = WorkerService::TailOptions {
+      .scriptName = kj::str(name),
+      .batching = batching,
+    };
+  }
 
-  auto observer = kj::atomicRefcounted<IsolateObserver>();
-  auto limitEnforcer = kj::heap<NullIsolateLimitEnforcer>();
+  kj::Maybe<const CpuWatchdog&> watchdog;
+  if (limits.cpuTime != kj::none) {
+    if (cpuWatchdog == kj::none) {
+      cpuWatchdog = kj::heap<CpuWatchdog>();
+    }
+    watchdog = *KJ_ASSERT_NONNULL(cpuWatchdog);
+  }
+  auto limitEnforcer = kj::heap<WorkerdIsolateLimitEnforcer>(limits, watchdog);
+  auto& isolateLimits = *limitEnforcer;
   auto api = kj::heap<WorkerdApi>(globalContext->v8System,
                                   featureFlags.asReader(),
                                   *limitEnforcer,
@@ -2897,7 +3581,7 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
   for (auto binding: confBindings) {
     KJ_IF_SOME(global, createBinding(name, conf, binding, errorReporter,
                                      subrequestChannels, actorChannels, actorConfigs,
-                                     experimental)) {
+                                     *kvCacheProvider, experimental)) {
       globals.add(kj::mv(global));
     }
   }
@@ -2966,6 +3650,10 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
                                    kj::str("Worker \"", name, "\"'s cacheApiOutbound"));
     }
 
+    result.tails = KJ_MAP(tail, conf.getTails()) -> Service* {
+      return &lookupService(tail, kj::str("Worker \"", name, "\"'s tails"));
+    };
+
     auto actorStorageConf = conf.getDurableObjectStorage();
     if (actorStorageConf.isLocalDisk()) {
       kj::StringPtr diskName = actorStorageConf.getLocalDisk();
@@ -3004,7 +3692,11 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
   return kj::heap<WorkerService>(globalContext->threadContext, kj::mv(worker),
                                  kj::mv(errorReporter.defaultEntrypoint),
                                  kj::mv(errorReporter.namedEntrypoints), localActorConfigs,
-                                 kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors));
+                                 kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors),
+                                 spanExporter.map([](kj::Own<SpanExporter>& e) -> SpanExporter& {
+    return *e;
+  }), kj::mv(admissionController), isolateLimits, analyticsEngineBatching,
+      kj::mv(tailOptions));
 }
 
 // =======================================================================================
@@ -3032,6 +3724,9 @@ kj::Own<Server::Service> Server::makeService(
 
     case config::Service::DISK:
       return makeDiskDirectoryService(name, conf.getDisk(), headerTableBuilder);
+
+    case config::Service::TRACING_ADMIN:
+      return makeTracingAdminService(conf.getTracingAdmin(), headerTableBuilder);
   }
 
   reportConfigError(kj::str(
@@ -3346,8 +4041,21 @@ private:
 
     kj::Promise<void> handleApplicationError(
         kj::Exception exception, kj::Maybe<kj::HttpService::Response&> response) override {
+      if (AdmissionController::isShed(exception)) {
+        // The admission controller already logged that it is shedding.
+        KJ_IF_SOME(r, response) {
+          co_return co_await r.sendError(503, "Service Unavailable", parent.headerTable);
+        }
+        co_return;
+      }
+
       KJ_LOG(ERROR, kj::str("Uncaught exception: ", exception));
       KJ_IF_SOME(r, response) {
+        // Like WorkerEntrypoint, report other overload errors (e.g. exceeded resource limits) as
+        // 503s too, so that clients know to back off.
+        if (exception.getType() == kj::Exception::Type::OVERLOADED) {
+          co_return co_await r.sendError(503, "Service Unavailable", parent.headerTable);
+        }
         co_return co_await r.sendError(500, "Internal Server Error", parent.headerTable);
       }
     }
@@ -3400,7 +4108,26 @@ kj::Promise<void> Server::run(jsg::V8System& v8System, config::Config::Reader co
   // services take longer to get ready.
   auto ownHeaderTable = headerTableBuilder.build();
 
-  co_return co_await listenPromise.exclusiveJoin(kj::mv(fatalPromise));
+  co_await listenPromise.exclusiveJoin(kj::mv(fatalPromise));
+
+  // Give the traces and spans from the requests that just drained a chance to be delivered,
+  // without letting a stuck tail Worker or export socket hold up shutdown.
+  co_await flushBatchers().exclusiveJoin(timer.afterDelay(5 * kj::SECONDS));
+}
+
+kj::Promise<void> Server::flushBatchers() {
+  // Tail Workers run before the exporter is flushed, so that their own spans are written too.
+  kj::Vector<kj::Promise<void>> flushes;
+  for (auto& service: services) {
+    if (WorkerService* worker = dynamic_cast<WorkerService*>(&*service.value)) {
+      flushes.add(worker->flushBatchers());
+    }
+  }
+  co_await kj::joinPromises(flushes.releaseAsArray());
+
+  KJ_IF_SOME(exporter, spanExporter) {
+    co_await exporter->flush();
+  }
 }
 
 void Server::startAlarmScheduler(config::Config::Reader config) {
@@ -3414,6 +4141,139 @@ void Server::startAlarmScheduler(config::Config::Reader config) {
       .attach(kj::mv(vfs));
 }
 
+namespace {
+
+// Writes span batches to a Unix socket, connecting on the first write and again after any write
+// fails.
+class SpanSocketWriter {
+public:
+  SpanSocketWriter(kj::Network& network, kj::String address)
+      : network(network), address(kj::mv(address)) {}
+
+  kj::Promise<void> write(kj::String batch) {
+    kj::Own<kj::AsyncIoStream> stream;
+    KJ_IF_SOME(c, connection) {
+      stream = kj::mv(c);
+    } else {
+      auto addr = co_await network.parseAddress(address);
+      stream = co_await addr->connect();
+    }
+
+    // `connection` stays empty until the write succeeds, so a broken connection is dropped.
+    connection = kj::none;
+    co_await stream->write(batch.begin(), batch.size());
+    connection = kj::mv(stream);
+  }
+
+private:
+  kj::Network& network;
+  kj::String address;
+  kj::Maybe<kj::Own<kj::AsyncIoStream>> connection;
+};
+
+// Appends span batches to a file from a thread of its own, since a busy or networked disk can
+// block a write for as long as it likes and we don't want the event loop waiting on it. The
+// exporter keeps only one write in flight, so there's at most one batch waiting for the thread.
+class SpanFileWriter {
+public:
+  explicit SpanFileWriter(kj::Own<kj::AppendableFile> file)
+      : thread([this, file = kj::mv(file)]() mutable { run(*file); }) {}
+
+  ~SpanFileWriter() noexcept(false) {
+    // A batch still waiting is dropped, which rejects its promise. kj::Thread's destructor then
+    // waits for the thread to exit.
+    state.lockExclusive()->shuttingDown = true;
+  }
+
+  kj::Promise<void> write(kj::String batch) {
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<void>();
+    auto lock = state.lockExclusive();
+    KJ_REQUIRE(lock->pending == kj::none, "only one span batch may be written at a time");
+    lock->pending = Pending { kj::mv(batch), kj::mv(paf.fulfiller) };
+    return kj::mv(paf.promise);
+  }
+
+private:
+  struct Pending {
+    kj::String batch;
+    kj::Own<kj::CrossThreadPromiseFulfiller<void>> fulfiller;
+  };
+
+  struct State {
+    kj::Maybe<Pending> pending;
+    bool shuttingDown = false;
+  };
+
+  kj::MutexGuarded<State> state;
+
+  // Declared last so that the thread exits before anything it uses is destroyed.
+  kj::Thread thread;
+
+  void run(kj::AppendableFile& file) {
+    for (;;) {
+      kj::Maybe<Pending> next;
+      {
+        auto lock = state.when([](const State& s) {
+          return s.pending != kj::none || s.shuttingDown;
+        });
+        if (lock->shuttingDown) return;
+        next = kj::mv(lock->pending);
+        lock->pending = kj::none;
+      }
+
+      auto& pending = KJ_ASSERT_NONNULL(next);
+      KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+        file.write(pending.batch.begin(), pending.batch.size());
+      })) {
+        pending.fulfiller->reject(kj::mv(exception));
+      } else {
+        pending.fulfiller->fulfill();
+      }
+    }
+  }
+};
+
+}  // namespace
+
+void Server::startSpanExport(config::SpanExport::Reader conf) {
+  SpanExporter::WriteFunc write;
+  switch (conf.which()) {
+    case config::SpanExport::FILE: {
+      auto path = fs.getCurrentPath().evalNative(conf.getFile());
+      auto mode = kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT;
+      KJ_IF_SOME(file, fs.getRoot().tryAppendFile(path, mode)) {
+        auto writer = kj::heap<SpanFileWriter>(kj::mv(file));
+        write = [writer = kj::mv(writer)](kj::String batch) mutable {
+          return writer->write(kj::mv(batch));
+        };
+      } else {
+        reportConfigError(kj::str("Couldn't open span export file: ", conf.getFile()));
+        return;
+      }
+      break;
+    }
+    case config::SpanExport::UNIX_SOCKET: {
+      auto writer = kj::heap<SpanSocketWriter>(network, kj::str("unix:", conf.getUnixSocket()));
+      write = [writer = kj::mv(writer)](kj::String batch) mutable {
+        return writer->write(kj::mv(batch));
+      };
+      break;
+    }
+    default:
+      reportConfigError(kj::str(
+          "Encountered unknown spanExport type. Was the config compiled with a newer version of "
+          "the schema?"));
+      return;
+  }
+
+  spanExporter = kj::heap<SpanExporter>(timer, SpanExporter::Options {
+    .serviceName = kj::str(conf.getServiceName()),
+    .maxBufferedSpans = kj::max(conf.getMaxBufferedSpans(), 1u),
+    .maxBatchSize = kj::max(conf.getMaxBatchSize(), 1u),
+    .maxDelay = conf.getMaxDelayMs() * kj::MILLISECONDS,
+  }, kj::mv(write), entropySource);
+}
+
 // Configure and start the inspector socket, returning the port the socket started on.
 uint startInspector(kj::StringPtr inspectorAddress,
                     Server::InspectorServiceIsolateRegistrar& registrar) {
@@ -3469,6 +4329,12 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
   // ---------------------------------------------------------------------------
   // Configure services
   TRACE_EVENT("workerd", "startServices");
+
+  // Workers capture the span exporter when they are created, so it must exist first.
+  if (config.hasSpanExport()) {
+    startSpanExport(config.getSpanExport());
+  }
+
   // First pass: Extract actor namespace configs.
   for (auto serviceConf: config.getServices()) {
     kj::StringPtr name = serviceConf.getName();
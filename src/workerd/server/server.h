@@ -10,6 +10,7 @@
 #include <kj/async-io.h>
 #include <workerd/io/worker.h>
 #include <workerd/api/memory-cache.h>
+#include <workerd/api/kv-cache.h>
 #include <workerd/server/workerd.capnp.h>
 #include <workerd/util/sqlite.h>
 #include <workerd/server/alarm-scheduler.h>
@@ -19,6 +20,12 @@ namespace kj {
   class TlsContext;
 }
 
+namespace workerd {
+  class AdmissionController;
+  class CpuWatchdog;
+  class SpanExporter;
+}
+
 namespace workerd::jsg {
   class V8System;
 }
@@ -100,6 +107,7 @@ private:
   Worker::ConsoleMode consoleMode;
 
   kj::Own<api::MemoryCacheProvider> memoryCacheProvider;
+  kj::Own<api::KvCacheProvider> kvCacheProvider;
 
   kj::HashMap<kj::String, kj::OneOf<kj::String, kj::Own<kj::ConnectionReceiver>>> socketOverrides;
   kj::HashMap<kj::String, kj::String> directoryOverrides;
@@ -126,6 +134,14 @@ private:
   // correctly construct dependent services.
   kj::HashMap<kj::String, kj::HashMap<kj::String, ActorConfig>> actorConfigs;
 
+  // Set if the config asks for trace spans to be exported. Declared before `services` so that it
+  // outlives the Workers whose requests it records.
+  kj::Maybe<kj::Own<SpanExporter>> spanExporter;
+
+  // Started when the first Worker with a CPU limit is created, and shared by all such Workers.
+  // Also declared before `services`, since the Workers' isolates refer to it.
+  kj::Maybe<kj::Own<CpuWatchdog>> cpuWatchdog;
+
   kj::HashMap<kj::String, kj::Own<Service>> services;
 
   kj::Own<kj::PromiseFulfiller<void>> fatalFulfiller;
@@ -163,6 +179,10 @@ private:
   // request in flight.
   kj::Promise<void> handleDrain(kj::Promise<void> drainWhen);
 
+  // Delivers whatever the Workers' tail and Analytics Engine batchers and the span exporter are
+  // still holding back, once the sockets have drained.
+  kj::Promise<void> flushBatchers();
+
   kj::Own<kj::TlsContext> makeTlsContext(config::TlsOptions::Reader conf);
   kj::Promise<kj::Own<kj::NetworkAddress>> makeTlsNetworkAddress(
       config::TlsOptions::Reader conf, kj::StringPtr addrStr,
@@ -178,6 +198,8 @@ private:
   kj::Own<Service> makeDiskDirectoryService(
       kj::StringPtr name, config::DiskDirectory::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeTracingAdminService(
+      config::TracingAdmin::Reader conf, kj::HttpHeaderTable::Builder& headerTableBuilder);
   kj::Own<Service> makeWorker(kj::StringPtr name, config::Worker::Reader conf,
       capnp::List<config::Extension>::Reader extensions);
   kj::Own<Service> makeService(
@@ -188,6 +210,17 @@ private:
   // Aborts all actors in this server except those in namespaces marked with `preventEviction`.
   void abortAllActors();
 
+  // Returns the Worker backing the named service, if it is a Worker service.
+  kj::Maybe<kj::Own<const Worker>> findWorker(kj::StringPtr serviceName);
+
+  // Returns the admission controller of the named service, if it is a Worker service with
+  // admission control configured.
+  kj::Maybe<kj::Own<AdmissionController>> findAdmissionController(kj::StringPtr serviceName);
+
+  // Returns the named service's tail and Analytics Engine batcher stats as JSON, if it is a
+  // Worker service.
+  kj::Maybe<kj::String> findBatcherStats(kj::StringPtr serviceName);
+
   // Can only be called in the link stage.
   Service& lookupService(config::ServiceDesignator::Reader designator, kj::String errorContext);
 
@@ -199,6 +232,7 @@ private:
   class ExternalTcpService;
   class NetworkService;
   class DiskDirectoryService;
+  class TracingAdminService;
   class WorkerService;
   class WorkerEntrypointService;
   class HttpListener;
@@ -210,6 +244,8 @@ private:
   // Must be called after startServices!
   void startAlarmScheduler(config::Config::Reader config);
 
+  void startSpanExport(config::SpanExport::Reader conf);
+
   kj::Promise<void> listenOnSockets(config::Config::Reader config,
                                     kj::HttpHeaderTable::Builder& headerTableBuilder,
                                     kj::ForkedPromise<void>& forkedDrainWhen,
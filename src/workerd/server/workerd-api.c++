@@ -118,6 +118,7 @@ struct WorkerdApi::Impl {
           jsgConfig(jsg::JsgConfig {
             .noSubstituteNull = features.getNoSubstituteNull(),
             .unwrapCustomThenables = features.getUnwrapCustomThenables(),
+            .settledPromiseFastPath = features.getSettledPromiseFastPath(),
           }) {}
     operator const CompatibilityFlags::Reader() const { return features; }
     operator const jsg::JsgConfig&() const { return jsgConfig; }
@@ -653,8 +654,12 @@ static v8::Local<v8::Value> createBindingValue(
     }
 
     KJ_CASE_ONEOF(ns, Global::KvNamespace) {
-      value = lock.wrap(context, jsg::alloc<api::KvNamespace>(
-          kj::Array<api::KvNamespace::AdditionalHeader>{}, ns.subrequestChannel));
+      auto kv = jsg::alloc<api::KvNamespace>(
+          kj::Array<api::KvNamespace::AdditionalHeader>{}, ns.subrequestChannel);
+      KJ_IF_SOME(cache, ns.cache) {
+        kv->setCache(kj::atomicAddRef(*cache), ns.defaultCacheTtlSeconds * kj::SECONDS);
+      }
+      value = lock.wrap(context, kj::mv(kv));
     }
 
     KJ_CASE_ONEOF(r2, Global::R2Bucket) {
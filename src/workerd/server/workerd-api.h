@@ -5,6 +5,7 @@
 #pragma once
 
 #include <workerd/io/worker.h>
+#include <workerd/api/kv-cache.h>
 #include <workerd/server/workerd.capnp.h>
 #include <workerd/jsg/setup.h>
 
@@ -68,9 +69,15 @@ public:
     };
     struct KvNamespace {
       uint subrequestChannel;
+      kj::Maybe<kj::Own<const api::KvCache>> cache;
+      uint32_t defaultCacheTtlSeconds = 0;
 
       KvNamespace clone() const {
-        return *this;
+        return KvNamespace {
+          .subrequestChannel = subrequestChannel,
+          .cache = cache.map([](auto& c) { return kj::atomicAddRef(*c); }),
+          .defaultCacheTtlSeconds = defaultCacheTtlSeconds,
+        };
       }
     };
     struct R2Bucket {
@@ -0,0 +1,327 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "workerd-limit-enforcer.h"
+#include <workerd/io/actor-cache.h>
+#include <workerd/io/io-context.h>
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+namespace {
+
+kj::Exception makeLimitException(EventOutcome outcome) {
+  switch (outcome) {
+    case EventOutcome::EXCEEDED_CPU:
+      return KJ_EXCEPTION(OVERLOADED,
+          "broken.exceededCpu; jsg.Error: Worker exceeded CPU time limit.");
+    case EventOutcome::EXCEEDED_MEMORY:
+      return KJ_EXCEPTION(OVERLOADED,
+          "broken.exceededMemory; jsg.Error: Worker exceeded memory limit.");
+    default:
+      KJ_FAIL_ASSERT("not a resource limit", outcome);
+  }
+}
+
+}  // namespace
+
+// Enforces limits on one stretch of JavaScript execution, i.e. one acquisition of the isolate
+// lock.
+class WorkerdIsolateLimitEnforcer::JsScope {
+public:
+  JsScope(const WorkerdIsolateLimitEnforcer& enforcer, v8::Isolate* isolate,
+          kj::Maybe<kj::Duration> cpuBudget)
+      : enforcer(enforcer), isolate(isolate), heapLimitHits(enforcer.heapLimitHits),
+        cpuStart(CpuWatchdog::threadCpuTime()) {
+    KJ_IF_SOME(budget, cpuBudget) {
+      watch = KJ_ASSERT_NONNULL(enforcer.watchdog).watch(budget, [isolate]() {
+        // Safe to call from any thread.
+        isolate->TerminateExecution();
+      });
+    }
+  }
+
+  // Stops enforcing, and returns which limit was exceeded, if any.
+  kj::Maybe<EventOutcome> end() {
+    bool cpuExceeded = false;
+    KJ_IF_SOME(w, watch) {
+      cpuExceeded = w->isExpired();
+    }
+    watch = kj::none;
+
+    bool heapExceeded = enforcer.heapLimitHits != heapLimitHits;
+
+    if (cpuExceeded || heapExceeded) {
+      // The termination might have been requested just after JavaScript returned, in which case
+      // nothing consumed it. Make sure it doesn't hit whatever runs next in the isolate.
+      isolate->CancelTerminateExecution();
+    }
+
+    if (heapExceeded) return EventOutcome::EXCEEDED_MEMORY;
+    if (cpuExceeded) return EventOutcome::EXCEEDED_CPU;
+    return kj::none;
+  }
+
+  kj::Duration getCpuTime() const { return CpuWatchdog::threadCpuTime() - cpuStart; }
+
+private:
+  const WorkerdIsolateLimitEnforcer& enforcer;
+  v8::Isolate* isolate;
+  uint heapLimitHits;
+  kj::Duration cpuStart;
+  kj::Maybe<kj::Own<CpuWatchdog::Watch>> watch;
+};
+
+// Reports exceeded limits through the `error` out-parameter of the enterStartupJs() family.
+class WorkerdIsolateLimitEnforcer::StartupScope {
+public:
+  StartupScope(const WorkerdIsolateLimitEnforcer& enforcer, v8::Isolate* isolate,
+               kj::Maybe<kj::Exception>& error)
+      : scope(enforcer, isolate, enforcer.limits.cpuTime), error(error) {}
+
+  ~StartupScope() noexcept(false) {
+    KJ_IF_SOME(outcome, scope.end()) {
+      error = makeLimitException(outcome);
+    }
+  }
+
+private:
+  JsScope scope;
+  kj::Maybe<kj::Exception>& error;
+};
+
+// LimitEnforcer for one request, or for one actor across all of its requests. Only CPU and
+// memory are limited.
+class RequestLimitEnforcer final: public LimitEnforcer {
+public:
+  explicit RequestLimitEnforcer(const WorkerdIsolateLimitEnforcer& isolateLimits)
+      : isolateLimits(isolateLimits),
+        exceededPaf(kj::newPromiseAndFulfiller<void>()),
+        exceededPromise(kj::mv(exceededPaf.promise).fork()) {
+    if (isolateLimits.isCondemned()) {
+      setExceeded(EventOutcome::EXCEEDED_MEMORY);
+    }
+  }
+
+  kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) override {
+    kj::Maybe<kj::Duration> budget;
+    KJ_IF_SOME(limit, getCpuLimit()) {
+      budget = cpuTime < limit ? limit - cpuTime : 0 * kj::NANOSECONDS;
+    }
+    return kj::heap<JsScope>(*this, lock, context, budget);
+  }
+
+  void topUpActor() override {
+    cpuTime = 0 * kj::NANOSECONDS;
+    if (isolateLimits.isCondemned()) {
+      setExceeded(EventOutcome::EXCEEDED_MEMORY);
+    }
+  }
+
+  void newSubrequest(bool isInHouse) override {}
+  void newKvRequest(KvOpType op) override {}
+  void newAnalyticsEngineRequest() override {}
+  kj::Promise<void> limitDrain() override { return kj::NEVER_DONE; }
+  kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
+  kj::Duration getAlarmLimit() override { return 0 * kj::MILLISECONDS; }
+  size_t getBufferingLimit() override { return kj::maxValue; }
+
+  size_t getTeeLagLimit() override {
+    return isolateLimits.limits.teeLagLimit.orDefault(kj::maxValue);
+  }
+  TeeLagPolicy getTeeLagPolicy() override { return isolateLimits.limits.teeLagPolicy; }
+
+  WriteCoalescingOptions getWriteCoalescingOptions() override {
+    return isolateLimits.limits.writeCoalescing;
+  }
+
+  kj::Maybe<EventOutcome> getLimitsExceeded() override { return exceeded; }
+
+  kj::Promise<void> onLimitsExceeded() override { return exceededPromise.addBranch(); }
+
+  void requireLimitsNotExceeded() override {
+    KJ_IF_SOME(outcome, exceeded) {
+      kj::throwFatalException(makeLimitException(outcome));
+    }
+  }
+
+  void reportMetrics(RequestObserver& requestMetrics) override {}
+
+  void chargeOffThreadCpu(kj::Duration time) override {
+    cpuTime += time;
+    KJ_IF_SOME(limit, getCpuLimit()) {
+      if (cpuTime > limit) {
+        setExceeded(EventOutcome::EXCEEDED_CPU);
+      }
+    }
+  }
+
+private:
+  using IsolateJsScope = WorkerdIsolateLimitEnforcer::JsScope;
+
+  class JsScope {
+  public:
+    JsScope(RequestLimitEnforcer& enforcer, jsg::Lock& lock, IoContext& context,
+            kj::Maybe<kj::Duration> budget)
+        : enforcer(enforcer), context(context),
+          scope(enforcer.isolateLimits, lock.v8Isolate, budget) {}
+
+    ~JsScope() noexcept(false) {
+      auto outcome = scope.end();
+      enforcer.cpuTime += scope.getCpuTime();
+
+      KJ_IF_SOME(tracer, context.getWorkerTracer()) {
+        tracer.setCPUTime(enforcer.cpuTime);
+      }
+
+      KJ_IF_SOME(o, outcome) {
+        enforcer.setExceeded(o);
+      } else KJ_IF_SOME(limit, enforcer.getCpuLimit()) {
+        // Catches overruns too small for the watchdog to have noticed before we returned.
+        if (enforcer.cpuTime > limit) {
+          enforcer.setExceeded(EventOutcome::EXCEEDED_CPU);
+        }
+      }
+    }
+
+  private:
+    RequestLimitEnforcer& enforcer;
+    IoContext& context;
+    IsolateJsScope scope;
+  };
+
+  const WorkerdIsolateLimitEnforcer& isolateLimits;
+  kj::Duration cpuTime = 0 * kj::NANOSECONDS;
+  kj::Maybe<EventOutcome> exceeded;
+  kj::PromiseFulfillerPair<void> exceededPaf;
+  kj::ForkedPromise<void> exceededPromise;
+
+  kj::Maybe<kj::Duration> getCpuLimit() const { return isolateLimits.limits.cpuTime; }
+
+  void setExceeded(EventOutcome outcome) {
+    if (exceeded != kj::none) return;
+    exceeded = outcome;
+    auto exception = makeLimitException(outcome);
+    // The client only sees a 503 and the Worker's own logs only see a terminated script, so this
+    // is the one place the operator learns which limit was hit.
+    KJ_LOG(WARNING, "NOSENTRY request terminated", exception.getDescription(), cpuTime);
+    exceededPaf.fulfiller->reject(kj::mv(exception));
+  }
+};
+
+WorkerdIsolateLimitEnforcer::WorkerdIsolateLimitEnforcer(
+    WorkerdLimits limits, kj::Maybe<const CpuWatchdog&> watchdog)
+    : limits(limits), watchdog(watchdog) {
+  KJ_REQUIRE(limits.cpuTime == kj::none || watchdog != kj::none,
+      "CPU limit requires a watchdog");
+}
+
+kj::Maybe<kj::Own<LimitEnforcer>> WorkerdIsolateLimitEnforcer::tryMakeRequestLimitEnforcer()
+    const {
+  if (limits.cpuTime == kj::none && limits.heapSize == kj::none) return kj::none;
+  return kj::Own<LimitEnforcer>(kj::heap<RequestLimitEnforcer>(*this));
+}
+
+v8::Isolate::CreateParams WorkerdIsolateLimitEnforcer::getCreateParams() {
+  v8::Isolate::CreateParams params;
+  KJ_IF_SOME(size, limits.heapSize) {
+    params.constraints.ConfigureDefaultsFromHeapSize(0, size);
+  }
+  return params;
+}
+
+void WorkerdIsolateLimitEnforcer::customizeIsolate(v8::Isolate* isolateParam) {
+  isolate = isolateParam;
+  if (limits.heapSize != kj::none) {
+    isolate->AddNearHeapLimitCallback(&nearHeapLimit, this);
+
+    // Undo the extra room that nearHeapLimit() grants once the heap has shrunk again.
+    isolate->AutomaticallyRestoreInitialHeapLimit();
+  }
+}
+
+ActorCacheSharedLruOptions workerdActorCacheLruOptions() {
+  // TODO(someday): Make this configurable?
+  return {
+    .softLimit = 16 * (1ull << 20), // 16 MiB
+    .hardLimit = 128 * (1ull << 20), // 128 MiB
+    .staleTimeout = 30 * kj::SECONDS,
+    .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
+    .maxKeysPerRpc = 128,
+
+    // For now, we use `neverFlush` to implement in-memory-only actors.
+    // See WorkerService::getActor().
+    .neverFlush = true
+  };
+}
+
+ActorCacheSharedLruOptions WorkerdIsolateLimitEnforcer::getActorCacheLruOptions() {
+  return workerdActorCacheLruOptions();
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterStartupJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterLimitedJs(lock, error);
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterStartupPython(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterLimitedJs(lock, error);
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterDynamicImportJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterLimitedJs(lock, error);
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterLoggingJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterLimitedJs(lock, error);
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterInspectorJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterLimitedJs(lock, error);
+}
+
+kj::Own<void> WorkerdIsolateLimitEnforcer::enterLimitedJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  if (limits.cpuTime == kj::none && limits.heapSize == kj::none) return {};
+  return kj::heap<StartupScope>(*this, lock.v8Isolate, error);
+}
+
+bool WorkerdIsolateLimitEnforcer::exitJs(jsg::Lock& lock) const {
+  if (condemned || heapLimitHits == heapLimitHitsChecked) return false;
+  heapLimitHitsChecked = heapLimitHits;
+
+  // Terminating the JavaScript that was allocating should have made its garbage collectable. If
+  // a full collection doesn't get the heap well below the limit, the memory is reachable from
+  // the isolate's global state, and the next request would only hit the limit again.
+  lock.v8Isolate->LowMemoryNotification();
+  v8::HeapStatistics stats;
+  lock.v8Isolate->GetHeapStatistics(&stats);
+
+  auto limit = KJ_ASSERT_NONNULL(limits.heapSize);
+  if (stats.used_heap_size() >= limit / 10 * 9) {
+    condemned = true;
+    KJ_LOG(ERROR, "NOSENTRY isolate exceeded its memory limit and can't recover; requests to "
+        "this Worker will fail until workerd is restarted", stats.used_heap_size(), limit);
+    return true;
+  }
+
+  return false;
+}
+
+size_t WorkerdIsolateLimitEnforcer::nearHeapLimit(
+    void* data, size_t currentHeapLimit, size_t initialHeapLimit) {
+  auto& self = *reinterpret_cast<WorkerdIsolateLimitEnforcer*>(data);
+  ++self.heapLimitHits;
+  self.isolate->TerminateExecution();
+
+  // Without more room, V8's only option would be to crash the whole process. The terminated
+  // JavaScript needs a little to unwind.
+  return currentHeapLimit + initialHeapLimit / 4;
+}
+
+}  // namespace workerd::server
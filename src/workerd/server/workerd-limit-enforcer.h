@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/limit-enforcer.h>
+#include <workerd/util/cpu-watchdog.h>
+
+namespace workerd::server {
+
+// Resource limits applied to a Worker. Limits which aren't set are not enforced.
+struct WorkerdLimits {
+  // CPU time each request may spend running JavaScript. Script startup gets the same budget.
+  kj::Maybe<kj::Duration> cpuTime;
+
+  // Size of the isolate's JavaScript heap, in bytes.
+  kj::Maybe<size_t> heapSize;
+
+  // How far one branch of a tee'd stream may fall behind another, and what happens when it does.
+  kj::Maybe<size_t> teeLagLimit;
+  TeeLagPolicy teeLagPolicy = TeeLagPolicy::ERROR_LAGGING_BRANCH;
+
+  // Not a limit, but reported through the LimitEnforcer like one. Off unless the Worker's config
+  // asks for it.
+  WriteCoalescingOptions writeCoalescing { .maxBytes = 0 };
+};
+
+// Options for the actor cache LRU of every isolate workerd creates.
+ActorCacheSharedLruOptions workerdActorCacheLruOptions();
+
+class RequestLimitEnforcer;
+
+// IsolateLimitEnforcer for workerd.
+//
+// The CPU limit is enforced by a CpuWatchdog, which terminates JavaScript execution once it has
+// used up its budget. The heap limit is enforced by V8 itself: when the heap nears its limit, we
+// terminate the JavaScript that is running, and give V8 a little more room so that it can unwind
+// rather than crash the process.
+//
+// If garbage collection can't bring the heap back down afterwards, the memory is held by the
+// isolate's global state, and the isolate is condemned. Requests already running are left to
+// finish, but new requests fail immediately. Since workerd never replaces an isolate, the
+// Worker stays unavailable until workerd is restarted.
+class WorkerdIsolateLimitEnforcer final: public IsolateLimitEnforcer {
+public:
+  // `watchdog` is required if `limits.cpuTime` is set.
+  WorkerdIsolateLimitEnforcer(WorkerdLimits limits, kj::Maybe<const CpuWatchdog&> watchdog);
+
+  // Returns the LimitEnforcer for a new request, or kj::none if no per-request limits apply.
+  kj::Maybe<kj::Own<LimitEnforcer>> tryMakeRequestLimitEnforcer() const;
+
+  bool isCondemned() const { return condemned; }
+
+  const WorkerdLimits& getLimits() const { return limits; }
+
+  v8::Isolate::CreateParams getCreateParams() override;
+  void customizeIsolate(v8::Isolate* isolate) override;
+  ActorCacheSharedLruOptions getActorCacheLruOptions() override;
+  kj::Own<void> enterStartupJs(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterStartupPython(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterDynamicImportJs(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterLoggingJs(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterInspectorJs(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  void completedRequest(kj::StringPtr id) const override {}
+  bool exitJs(jsg::Lock& lock) const override;
+  void reportMetrics(IsolateObserver& isolateMetrics) const override {}
+  kj::Maybe<size_t> checkPbkdfIterations(jsg::Lock& lock, size_t iterations) const override {
+    // No limit on the number of iterations in workerd
+    return kj::none;
+  }
+
+private:
+  class JsScope;
+  class StartupScope;
+  friend class RequestLimitEnforcer;
+
+  WorkerdLimits limits;
+  kj::Maybe<const CpuWatchdog&> watchdog;
+  v8::Isolate* isolate = nullptr;
+
+  // Incremented each time V8 reports the heap nearing its limit.
+  uint heapLimitHits = 0;
+
+  // `heapLimitHits` as of the last time exitJs() looked.
+  mutable uint heapLimitHitsChecked = 0;
+
+  mutable bool condemned = false;
+
+  kj::Own<void> enterLimitedJs(jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const;
+
+  static size_t nearHeapLimit(void* data, size_t currentHeapLimit, size_t initialHeapLimit);
+};
+
+}  // namespace workerd::server
@@ -0,0 +1,301 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/io/actor-cache.h>
+#include <workerd/io/io-gate.h>
+#include <kj/filesystem.h>
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+// Replays a trace of reads by several actors sharing one SharedLru, with storage answered by an
+// in-process fake, and reports how well the cache did: `hitRate` is the fraction of keys read from
+// cache, `evictionsPerOp` the entries evicted per trace operation, and `storageReadsPerOp` the
+// storage calls made per trace operation. The argument is the SharedLru's soft limit in KiB.
+//
+// By default the trace is synthetic: actors reading their own small, skewed sets of hot keys while
+// actor 0 also pages through its whole key space (each page starting at the last key of the
+// previous one), which a plain LRU handles badly. To replay a recorded trace instead, set
+// ACTOR_CACHE_TRACE to a file with one operation per line, either `<actor> get <key>` or
+// `<actor> list <start> <limit>`.
+
+namespace workerd {
+namespace {
+
+constexpr uint KEY_COUNT = 20'000;
+constexpr size_t VALUE_SIZE = 64;
+
+constexpr uint SYNTHETIC_ACTORS = 8;
+constexpr uint SYNTHETIC_OPS = 50'000;
+constexpr uint SYNTHETIC_HOT_KEYS = 64;
+constexpr uint SYNTHETIC_SCAN_EVERY = 50;
+constexpr uint SYNTHETIC_SCAN_LIMIT = 256;
+
+static const byte VALUE[VALUE_SIZE] = {};
+
+static kj::String makeKey(uint i) {
+  // Zero-padded so that keys sort numerically.
+  auto digits = kj::str(i);
+  return kj::str("key:", kj::repeat('0', 8 - digits.size()), digits);
+}
+
+// Answers get(), getMultiple() and list() for the keys makeKey(0) to makeKey(KEY_COUNT - 1).
+class FakeStorage final: public rpc::ActorStorage::Stage::Server {
+public:
+  FakeStorage(kj::ArrayPtr<const kj::String> keys, uint64_t& reads): keys(keys), reads(reads) {}
+
+  kj::Promise<void> get(GetContext context) override {
+    ++reads;
+    auto key = kj::heapString(context.getParams().getKey().asChars());
+    if (std::binary_search(keys.begin(), keys.end(), key)) {
+      context.getResults().setValue(VALUE);
+    }
+    return kj::READY_NOW;
+  }
+
+  kj::Promise<void> getMultiple(GetMultipleContext context) override {
+    ++reads;
+    auto params = context.getParams();
+    kj::Vector<kj::StringPtr> found;
+    for (auto key: params.getKeys()) {
+      auto str = kj::heapString(key.asChars());
+      auto iter = std::lower_bound(keys.begin(), keys.end(), str);
+      if (iter != keys.end() && *iter == str) {
+        found.add(*iter);
+      }
+    }
+    return sendValues(params.getStream(), kj::mv(found));
+  }
+
+  kj::Promise<void> list(ListContext context) override {
+    ++reads;
+    auto params = context.getParams();
+    KJ_REQUIRE(!params.getReverse() && !params.hasPrefix(), "not supported by FakeStorage");
+
+    auto begin = std::lower_bound(keys.begin(), keys.end(),
+                                  kj::heapString(params.getStart().asChars()));
+    auto end = keys.end();
+    if (params.hasEnd()) {
+      end = std::lower_bound(begin, end, kj::heapString(params.getEnd().asChars()));
+    }
+    if (params.getLimit() > 0) {
+      end = begin + kj::min(end - begin, params.getLimit());
+    }
+
+    kj::Vector<kj::StringPtr> found;
+    for (auto iter = begin; iter != end; ++iter) {
+      found.add(*iter);
+    }
+    return sendValues(params.getStream(), kj::mv(found));
+  }
+
+private:
+  kj::ArrayPtr<const kj::String> keys;
+  uint64_t& reads;
+
+  static kj::Promise<void> sendValues(
+      rpc::ActorStorage::ListStream::Client stream, kj::Vector<kj::StringPtr> found) {
+    auto req = stream.valuesRequest();
+    auto list = req.initList(found.size());
+    for (auto i: kj::indices(found)) {
+      list[i].setKey(found[i].asBytes());
+      list[i].setValue(VALUE);
+    }
+    co_await req.send();
+    co_await stream.endRequest().send().ignoreResult();
+  }
+};
+
+struct TraceOp {
+  uint actor;
+  enum { GET, LIST } type;
+  kj::String key;
+  uint limit = 0;
+};
+
+struct Trace {
+  kj::Array<TraceOp> ops;
+  uint actorCount;
+};
+
+static Trace syntheticTrace() {
+  std::mt19937 rng(1234);
+  kj::Vector<TraceOp> ops(SYNTHETIC_OPS);
+  uint scanPosition = 0;
+
+  for (auto i: kj::zeroTo(SYNTHETIC_OPS)) {
+    if (i % SYNTHETIC_SCAN_EVERY == 0) {
+      ops.add(TraceOp {
+        .actor = 0,
+        .type = TraceOp::LIST,
+        .key = makeKey(scanPosition),
+        .limit = SYNTHETIC_SCAN_LIMIT,
+      });
+      uint lastKey = scanPosition + SYNTHETIC_SCAN_LIMIT - 1;
+      scanPosition = lastKey < KEY_COUNT - 1 ? lastKey : 0;
+    } else {
+      // The product of two uniform picks favors low indices, so a few keys are read most often.
+      uint hot = (rng() % SYNTHETIC_HOT_KEYS) * (rng() % SYNTHETIC_HOT_KEYS) / SYNTHETIC_HOT_KEYS;
+      ops.add(TraceOp {
+        .actor = uint(rng() % SYNTHETIC_ACTORS),
+        .type = TraceOp::GET,
+        .key = makeKey(hot * (KEY_COUNT / SYNTHETIC_HOT_KEYS)),
+      });
+    }
+  }
+
+  return { ops.releaseAsArray(), SYNTHETIC_ACTORS };
+}
+
+static Trace loadTrace(kj::StringPtr path) {
+  auto fs = kj::newDiskFilesystem();
+  auto text = fs->getRoot().openFile(fs->getCurrentPath().eval(path))->readAllText();
+
+  kj::Vector<TraceOp> ops;
+  uint actorCount = 0;
+  kj::StringPtr rest = text;
+  while (rest.size() > 0) {
+    auto lineEnd = rest.findFirst('\n').orDefault(rest.size());
+    auto line = kj::str(rest.slice(0, lineEnd));
+    rest = rest.slice(kj::min(lineEnd + 1, rest.size()));
+    if (line.size() == 0) continue;
+
+    kj::Vector<kj::String> fields;
+    kj::StringPtr remaining = line;
+    for (;;) {
+      KJ_IF_SOME(space, remaining.findFirst(' ')) {
+        fields.add(kj::str(remaining.slice(0, space)));
+        remaining = remaining.slice(space + 1);
+      } else {
+        fields.add(kj::str(remaining));
+        break;
+      }
+    }
+
+    TraceOp op { .actor = KJ_ASSERT_NONNULL(fields[0].tryParseAs<uint>(), line) };
+    if (fields.size() == 3 && fields[1] == "get") {
+      op.type = TraceOp::GET;
+    } else if (fields.size() == 4 && fields[1] == "list") {
+      op.type = TraceOp::LIST;
+      op.limit = KJ_ASSERT_NONNULL(fields[3].tryParseAs<uint>(), line);
+    } else {
+      KJ_FAIL_REQUIRE("invalid trace line", line);
+    }
+    op.key = kj::mv(fields[2]);
+    actorCount = kj::max(actorCount, op.actor + 1);
+    ops.add(kj::mv(op));
+  }
+
+  return { ops.releaseAsArray(), actorCount };
+}
+
+static const Trace& getTrace() {
+  static const Trace trace = []() {
+    const char* path = getenv("ACTOR_CACHE_TRACE");
+    if (path != nullptr) {
+      return loadTrace(path);
+    } else {
+      return syntheticTrace();
+    }
+  }();
+  return trace;
+}
+
+static kj::ArrayPtr<const kj::String> getKeys() {
+  static const kj::Array<kj::String> keys = KJ_MAP(i, kj::zeroTo(KEY_COUNT)) {
+    return makeKey(i);
+  };
+  return keys;
+}
+
+struct CountingHooks: public ActorCache::Hooks {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  void storageCacheHits(uint count) override { hits += count; }
+  void storageCacheMisses(uint count) override { misses += count; }
+  void storageCacheEvictions(uint count) override { evictions += count; }
+};
+
+struct Replay {
+  kj::EventLoop loop;
+  kj::WaitScope ws;
+  ActorCache::SharedLru lru;
+  OutputGate gate;
+  CountingHooks hooks;
+  uint64_t storageReads = 0;
+  kj::Array<kj::Own<ActorCache>> caches;
+
+  Replay(size_t softLimit, uint actorCount)
+      : ws(loop),
+        lru({
+          .softLimit = softLimit,
+          .hardLimit = softLimit * 2,
+          .staleTimeout = 1 * kj::DAYS,
+          .dirtyListByteLimit = softLimit,
+          .maxKeysPerRpc = 128,
+          .maxListReadAheadKeys = 1024,
+        }),
+        caches(KJ_MAP(i, kj::zeroTo(actorCount)) {
+          return kj::heap<ActorCache>(
+              kj::heap<FakeStorage>(getKeys(), storageReads), lru, gate, hooks);
+        }) {}
+
+  void run(kj::ArrayPtr<const TraceOp> ops) {
+    for (auto& op: ops) {
+      auto& cache = *caches[op.actor];
+      switch (op.type) {
+        case TraceOp::GET: {
+          auto result = cache.get(kj::str(op.key), {});
+          KJ_IF_SOME(promise, result.tryGet<kj::Promise<kj::Maybe<ActorCache::Value>>>()) {
+            promise.wait(ws);
+          }
+          break;
+        }
+        case TraceOp::LIST: {
+          auto result = cache.list(kj::str(op.key), kj::none, op.limit, {});
+          KJ_IF_SOME(promise, result.tryGet<kj::Promise<ActorCache::GetResultList>>()) {
+            promise.wait(ws);
+          }
+          break;
+        }
+      }
+    }
+  }
+};
+
+static void ActorCache_Replay(benchmark::State& state) {
+  auto& trace = getTrace();
+  CountingHooks totals;
+  uint64_t storageReads = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      Replay replay(state.range(0) * 1024, trace.actorCount);
+      state.ResumeTiming();
+      replay.run(trace.ops);
+      state.PauseTiming();
+
+      totals.hits += replay.hooks.hits;
+      totals.misses += replay.hooks.misses;
+      totals.evictions += replay.hooks.evictions;
+      storageReads += replay.storageReads;
+    }
+    state.ResumeTiming();
+  }
+
+  double ops = state.iterations() * trace.ops.size();
+  state.counters["hitRate"] = double(totals.hits) / kj::max(totals.hits + totals.misses, 1);
+  state.counters["evictionsPerOp"] = totals.evictions / ops;
+  state.counters["storageReadsPerOp"] = storageReads / ops;
+  state.SetItemsProcessed(state.iterations() * trace.ops.size());
+}
+
+WD_BENCHMARK(ActorCache_Replay)->Arg(64)->Arg(256)->Arg(1024);
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,113 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/io/actor-cache.h>
+#include <workerd/io/io-gate.h>
+
+// An in-memory ActorCache (as in a Durable Object that never flushes) holding many small keys.
+// The argument is the value size. `Populate` reports memory per key: `slabBytesPerKey` is what the
+// entry allocator obtained from malloc(), and `accountedBytesPerKey` is what the SharedLru counts
+// against its limits. `List` reports list() throughput over the fully-cached key space.
+
+namespace workerd {
+namespace {
+
+constexpr uint KEY_COUNT = 100'000;
+constexpr uint LIST_LIMIT = 1000;
+
+struct InMemoryCache {
+  kj::EventLoop loop;
+  kj::WaitScope ws;
+  ActorCache::SharedLru lru;
+  OutputGate gate;
+  ActorCache cache;
+
+  InMemoryCache()
+      : ws(loop),
+        lru({
+          .softLimit = size_t(1) << 32,
+          .hardLimit = size_t(1) << 32,
+          .staleTimeout = 1 * kj::DAYS,
+          .dirtyListByteLimit = size_t(1) << 32,
+          .maxKeysPerRpc = 128,
+          .neverFlush = true,
+        }),
+        cache(rpc::ActorStorage::Stage::Client(KJ_EXCEPTION(FAILED, "no storage in benchmark")),
+              lru, gate) {
+    // Start from a known-empty key space so that list() is answered entirely from cache.
+    cache.deleteAll({});
+  }
+
+  void populate(size_t valueSize) {
+    for (auto i: kj::zeroTo(KEY_COUNT)) {
+      auto value = kj::heapArray<byte>(valueSize);
+      value.asPtr().fill(byte(i % 251));
+      cache.put(makeKey(i), kj::mv(value), {});
+    }
+  }
+
+  static kj::String makeKey(uint i) {
+    // Zero-padded so that keys sort numerically.
+    auto digits = kj::str(i);
+    return kj::str("key:", kj::repeat('0', 8 - digits.size()), digits);
+  }
+};
+
+static void ActorCache_Populate(benchmark::State& state) {
+  double slabBytes = 0;
+  double accountedBytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto before = ActorCache::getEntryMemoryStats();
+    {
+      InMemoryCache test;
+      state.ResumeTiming();
+      test.populate(state.range(0));
+      state.PauseTiming();
+
+      auto after = ActorCache::getEntryMemoryStats();
+      slabBytes += (after.slabBytes - before.slabBytes) +
+                   (after.largeBytesInUse - before.largeBytesInUse);
+      accountedBytes += test.lru.currentSize();
+    }
+    state.ResumeTiming();
+  }
+
+  double keys = state.iterations() * KEY_COUNT;
+  state.counters["slabBytesPerKey"] = slabBytes / keys;
+  state.counters["accountedBytesPerKey"] = accountedBytes / keys;
+  state.SetItemsProcessed(state.iterations() * KEY_COUNT);
+}
+
+static void ActorCache_List(benchmark::State& state) {
+  InMemoryCache test;
+  test.populate(state.range(0));
+
+  size_t listed = 0;
+  for (auto _ : state) {
+    // Page through the whole key space.
+    kj::String start = kj::str("");
+    for (;;) {
+      auto result = test.cache.list(kj::mv(start), kj::none, LIST_LIMIT, {});
+      auto& list = KJ_ASSERT_NONNULL(result.tryGet<ActorCache::GetResultList>());
+      size_t bytes = 0;
+      for (auto entry: list) {
+        bytes += entry.key.size() + entry.value.size();
+      }
+      benchmark::DoNotOptimize(bytes);
+      listed += list.size();
+      if (list.size() < LIST_LIMIT) break;
+      start = kj::str(list.end()[-1].key, '\0');
+    }
+  }
+
+  state.SetItemsProcessed(listed);
+}
+
+WD_BENCHMARK(ActorCache_Populate)->Arg(16)->Arg(128)->Arg(2048);
+WD_BENCHMARK(ActorCache_List)->Arg(16)->Arg(128)->Arg(2048);
+
+}  // namespace
+}  // namespace workerd
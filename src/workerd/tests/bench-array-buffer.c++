@@ -0,0 +1,80 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/jsg/jsg-test.h>
+#include <atomic>
+#include <new>
+
+// Returning a kj::Array<byte> to JavaScript as an ArrayBuffer, as response body reads and crypto
+// results do. The argument is the array size. Besides time, reports allocations per call:
+// `heapAllocs` counts operator new (the arrays themselves and any owner objects), and
+// `bufferMallocs` counts ArrayBuffer contents that the isolate's allocator couldn't recycle.
+
+namespace {
+
+std::atomic<uint64_t> heapAllocs;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  heapAllocs.fetch_add(1, std::memory_order_relaxed);
+  void* result = malloc(size);
+  if (result == nullptr) throw std::bad_alloc();
+  return result;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  free(ptr);
+}
+
+namespace workerd::jsg::test {
+namespace {
+
+V8System v8System;
+
+constexpr uint CALLS = 10'000;
+
+struct BytesContext: public Object, public ContextGlobal {
+  kj::Array<byte> bytes(uint size) {
+    return kj::heapArray<byte>(size);
+  }
+
+  JSG_RESOURCE_TYPE(BytesContext) {
+    JSG_METHOD(bytes);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(BytesIsolate, BytesContext);
+
+static void ArrayBuffer_Wrap(benchmark::State& state) {
+  Evaluator<BytesContext, BytesIsolate> e(v8System);
+  auto script = kj::str(
+      "let total = 0;\n"
+      "for (let i = 0; i < ", CALLS, "; i++) total += bytes(", state.range(0), ").byteLength;\n"
+      "total > 0");
+
+  auto& allocator = KJ_ASSERT_NONNULL(e.getIsolate().getArrayBufferAllocator());
+  auto statsBefore = allocator.getStats();
+  auto heapAllocsBefore = heapAllocs.load();
+
+  for (auto _ : state) {
+    e.expectEval(script, "boolean", "true");
+  }
+
+  auto statsAfter = allocator.getStats();
+  double calls = state.iterations() * CALLS;
+  state.counters["heapAllocs"] = (heapAllocs.load() - heapAllocsBefore) / calls;
+  state.counters["bufferMallocs"] = ((statsAfter.allocations - statsBefore.allocations) -
+                                     (statsAfter.reused - statsBefore.reused)) / calls;
+  state.SetItemsProcessed(state.iterations() * CALLS);
+}
+
+WD_BENCHMARK(ArrayBuffer_Wrap)->Arg(32)->Arg(1024)->Arg(4096);
+
+}  // namespace
+}  // namespace workerd::jsg::test
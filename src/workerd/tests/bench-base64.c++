@@ -0,0 +1,100 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/base64.h>
+
+// Throughput of the vectorized base64 and hex codecs in util/base64.h against the scalar kj
+// implementations that atob()/btoa(), Buffer and Queue used before. The argument is the size of
+// the unencoded data, covering short tokens, typical message bodies and large payloads.
+
+namespace workerd {
+namespace {
+
+kj::Array<kj::byte> makeData(size_t size) {
+  auto data = kj::heapArray<kj::byte>(size);
+  for (auto i: kj::indices(data)) {
+    data[i] = i * 31 + (i >> 8);
+  }
+  return data;
+}
+
+static void Base64Encode_Kj(benchmark::State& state) {
+  auto data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kj::encodeBase64(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void Base64Encode_Fast(benchmark::State& state) {
+  auto data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fastEncodeBase64(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void Base64Decode_Kj(benchmark::State& state) {
+  auto encoded = kj::encodeBase64(makeData(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kj::decodeBase64(encoded));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+
+static void Base64Decode_Fast(benchmark::State& state) {
+  auto encoded = kj::encodeBase64(makeData(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fastDecodeBase64(encoded));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+
+static void HexEncode_Kj(benchmark::State& state) {
+  auto data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kj::encodeHex(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void HexEncode_Fast(benchmark::State& state) {
+  auto data = makeData(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fastEncodeHex(data));
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void HexDecode_Kj(benchmark::State& state) {
+  auto encoded = kj::encodeHex(makeData(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kj::decodeHex(encoded));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+
+static void HexDecode_Fast(benchmark::State& state) {
+  auto encoded = kj::encodeHex(makeData(state.range(0)));
+  auto output = kj::heapArray<kj::byte>(encoded.size() / 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decodeHexPrefix(encoded, output));
+  }
+  state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+
+#define SIZES Arg(48)->Arg(4096)->Arg(1024 * 1024)
+
+WD_BENCHMARK(Base64Encode_Kj)->SIZES;
+WD_BENCHMARK(Base64Encode_Fast)->SIZES;
+WD_BENCHMARK(Base64Decode_Kj)->SIZES;
+WD_BENCHMARK(Base64Decode_Fast)->SIZES;
+WD_BENCHMARK(HexEncode_Kj)->SIZES;
+WD_BENCHMARK(HexEncode_Fast)->SIZES;
+WD_BENCHMARK(HexDecode_Kj)->SIZES;
+WD_BENCHMARK(HexDecode_Fast)->SIZES;
+
+}  // namespace
+}  // namespace workerd
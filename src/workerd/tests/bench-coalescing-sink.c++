@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/api/streams/internal.h>
+#include <kj/io.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Writing a body made of many tiny chunks, as produced by a streaming SSR framework that enqueues
+// each rendered fragment separately, to a sink that makes one syscall per write. Compares writing
+// each chunk directly against going through a CoalescingWritableStreamSink.
+
+namespace workerd::api {
+namespace {
+
+constexpr size_t CHUNK_COUNT = 100'000;
+
+// Writes everything to /dev/null, so each write costs one syscall and nothing else.
+class DevNullSink final: public WritableStreamSink {
+public:
+  DevNullSink(): fd(open("/dev/null", O_WRONLY | O_CLOEXEC)) {
+    KJ_ASSERT(fd.get() >= 0);
+  }
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    KJ_SYSCALL(::write(fd, buffer, size));
+    ++writeCount;
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    for (auto& piece: pieces) {
+      KJ_SYSCALL(::write(fd, piece.begin(), piece.size()));
+    }
+    ++writeCount;
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> end() override { return kj::READY_NOW; }
+  void abort(kj::Exception reason) override {}
+
+  size_t writeCount = 0;
+
+private:
+  kj::AutoCloseFd fd;
+};
+
+kj::Promise<void> writeChunks(WritableStreamSink& sink, kj::ArrayPtr<const kj::byte> chunk) {
+  for (auto i KJ_UNUSED: kj::zeroTo(CHUNK_COUNT)) {
+    co_await sink.write(chunk.begin(), chunk.size());
+  }
+  co_await sink.end();
+}
+
+static void SmallChunks_Direct(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto chunk = kj::heapArray<kj::byte>(state.range(0));
+  chunk.asPtr().fill('x');
+
+  size_t writes = 0;
+  for (auto _ : state) {
+    DevNullSink sink;
+    writeChunks(sink, chunk).wait(ws);
+    writes += sink.writeCount;
+  }
+  state.SetBytesProcessed(state.iterations() * CHUNK_COUNT * chunk.size());
+  state.counters["writes"] = benchmark::Counter(writes, benchmark::Counter::kAvgIterations);
+}
+
+static void SmallChunks_Coalesced(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto chunk = kj::heapArray<kj::byte>(state.range(0));
+  chunk.asPtr().fill('x');
+
+  size_t writes = 0;
+  for (auto _ : state) {
+    auto inner = kj::heap<DevNullSink>();
+    auto& devNull = *inner;
+    CoalescingWritableStreamSink sink(kj::mv(inner), {});
+    writeChunks(sink, chunk).wait(ws);
+    writes += devNull.writeCount;
+  }
+  state.SetBytesProcessed(state.iterations() * CHUNK_COUNT * chunk.size());
+  state.counters["writes"] = benchmark::Counter(writes, benchmark::Counter::kAvgIterations);
+}
+
+WD_BENCHMARK(SmallChunks_Direct)->Arg(16)->Arg(128)->Arg(1024);
+WD_BENCHMARK(SmallChunks_Coalesced)->Arg(16)->Arg(128)->Arg(1024);
+
+}  // namespace
+}  // namespace workerd::api
@@ -0,0 +1,104 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/encoding.h>
+#include <workerd/jsg/buffersource.h>
+#include <kj/vector.h>
+
+// TextDecoder and TextEncoder throughput for UTF-8. Decoding compares the dedicated Utf8Decoder
+// with the ICU converter that handled UTF-8 before; encoding compares TextEncoder.encode() with
+// the previous approach of measuring the UTF-8 length first and then encoding. The argument
+// selects the corpus: ASCII, Latin-1 (mostly ASCII with accented letters) or CJK.
+
+namespace workerd {
+namespace {
+
+constexpr size_t CORPUS_SIZE = 64 * 1024;
+
+kj::String makeCorpus(int kind) {
+  kj::StringPtr unit;
+  switch (kind) {
+    case 0: unit = "The quick brown fox jumps over the lazy dog. "_kj; break;
+    case 1: unit = "Le cur déçu mais l'âme plutôt naïve, Louÿs rêva de crapaüter. "_kj; break;
+    default: unit = "敏捷的棕色狐狸跳过了懒狗。素早い茶色の狐がのろまな犬を飛び越える。"_kj; break;
+  }
+
+  kj::Vector<char> result(CORPUS_SIZE + unit.size() + 1);
+  while (result.size() < CORPUS_SIZE) result.addAll(unit);
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+static void Decode_Icu(benchmark::State& state) {
+  auto corpus = makeCorpus(state.range(0));
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto maybeDecoder = api::IcuDecoder::create(api::Encoding::Utf8, false, false);
+    auto& decoder = KJ_ASSERT_NONNULL(maybeDecoder);
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      benchmark::DoNotOptimize(decoder.decode(env.js, corpus.asBytes(), true));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+static void Decode_Utf8(benchmark::State& state) {
+  auto corpus = makeCorpus(state.range(0));
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    api::Utf8Decoder decoder(false, false);
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      benchmark::DoNotOptimize(decoder.decode(env.js, corpus.asBytes(), true));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+static void Encode_TwoPass(benchmark::State& state) {
+  auto corpus = makeCorpus(state.range(0));
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    v8::HandleScope outer(env.isolate);
+    auto str = js.str(corpus);
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      auto view = KJ_ASSERT_NONNULL(jsg::BufferSource::tryAlloc(js, str.utf8Length(js)));
+      benchmark::DoNotOptimize(str.writeInto(js, view.asArrayPtr().asChars(),
+          static_cast<jsg::JsString::WriteOptions>(
+              jsg::JsString::NO_NULL_TERMINATION | jsg::JsString::REPLACE_INVALID_UTF8)));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+static void Encode_OnePass(benchmark::State& state) {
+  auto corpus = makeCorpus(state.range(0));
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    v8::HandleScope outer(env.isolate);
+    auto str = js.str(corpus);
+    auto encoder = jsg::alloc<api::TextEncoder>();
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      benchmark::DoNotOptimize(encoder->encode(js, str));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+#define CORPORA Arg(0)->Arg(1)->Arg(2)
+
+WD_BENCHMARK(Decode_Icu)->CORPORA;
+WD_BENCHMARK(Decode_Utf8)->CORPORA;
+WD_BENCHMARK(Encode_TwoPass)->CORPORA;
+WD_BENCHMARK(Encode_OnePass)->CORPORA;
+
+}  // namespace
+}  // namespace workerd
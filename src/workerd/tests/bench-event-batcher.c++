@@ -0,0 +1,120 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/api/analytics-engine.capnp.h>
+#include <workerd/util/event-batcher.h>
+#include <capnp/compat/json.h>
+#include <capnp/message.h>
+#include <kj/compat/http.h>
+
+// Analytics Engine data points per second, from encoding each event to its delivery to an
+// in-process HTTP service. Compares one POST per data point with batches built by EventBatcher.
+
+namespace workerd {
+namespace {
+
+constexpr uint EVENT_COUNT = 10'000;
+
+// Accepts any request, reading the whole body.
+class SinkService final: public kj::HttpService {
+public:
+  explicit SinkService(const kj::HttpHeaderTable& table): table(table) {}
+
+  kj::Promise<void> request(kj::HttpMethod method, kj::StringPtr url,
+      const kj::HttpHeaders& headers, kj::AsyncInputStream& requestBody,
+      Response& response) override {
+    co_await requestBody.readAllBytes();
+    ++requestCount;
+    kj::HttpHeaders responseHeaders(table);
+    response.send(204, "No Content", responseHeaders, uint64_t(0));
+  }
+
+  uint requestCount = 0;
+
+private:
+  const kj::HttpHeaderTable& table;
+};
+
+kj::String encodeEvent(capnp::JsonCodec& json, uint i) {
+  capnp::MallocMessageBuilder message;
+  auto event = message.initRoot<api::AnalyticsEngineEvent>();
+  event.setAccountId(123);
+  event.setTimestamp(1700000000000 + i);
+  event.setDataset("bench"_kj.asBytes());
+  event.setSchemaVersion(1);
+  event.setIndex1("route-a"_kj.asBytes());
+  event.setBlob1("GET"_kj.asBytes());
+  event.setBlob2("/api/items"_kj.asBytes());
+  event.setDouble1(i);
+  event.setDouble2(200);
+  return json.encode(event.asReader());
+}
+
+kj::Promise<void> post(kj::HttpClient& client, const kj::HttpHeaderTable& table,
+                       kj::ArrayPtr<const kj::byte> body) {
+  kj::HttpHeaders headers(table);
+  auto request = client.request(kj::HttpMethod::POST, "https://fake-host", headers, body.size());
+  co_await request.body->write(body.begin(), body.size());
+  request.body = nullptr;
+  auto response = co_await request.response;
+  KJ_ASSERT(response.statusCode == 204);
+  co_await response.body->readAllBytes();
+}
+
+static void Events_PostEach(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::HttpHeaderTable table;
+  SinkService service(table);
+  auto client = kj::newHttpClient(service);
+  capnp::JsonCodec json;
+
+  for (auto _ : state) {
+    for (auto i: kj::zeroTo(EVENT_COUNT)) {
+      auto event = encodeEvent(json, i);
+      post(*client, table, event.asBytes()).wait(ws);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * EVENT_COUNT);
+  state.counters["requests"] = service.requestCount / state.iterations();
+}
+
+static void Events_Batched(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  kj::HttpHeaderTable table;
+  SinkService service(table);
+  auto client = kj::newHttpClient(service);
+  capnp::JsonCodec json;
+
+  // Events are added faster than batches are sent, so don't limit the batches in flight.
+  EventBatcher::Limits limits {
+    .maxEvents = static_cast<uint>(state.range(0)),
+    .maxPendingBatches = EVENT_COUNT,
+  };
+  EventBatcher batcher(timer, limits, [&](kj::Array<kj::byte> body, uint) {
+    return post(*client, table, body).attach(kj::mv(body));
+  });
+
+  for (auto _ : state) {
+    kj::Vector<kj::Promise<void>> delivered(EVENT_COUNT);
+    for (auto i: kj::zeroTo(EVENT_COUNT)) {
+      auto event = encodeEvent(json, i);
+      delivered.add(batcher.add(event.asBytes()));
+    }
+    batcher.flush().wait(ws);
+    kj::joinPromises(delivered.releaseAsArray()).wait(ws);
+  }
+  KJ_ASSERT(batcher.getStats().itemsDropped == 0);
+  state.SetItemsProcessed(state.iterations() * EVENT_COUNT);
+  state.counters["requests"] = service.requestCount / state.iterations();
+}
+
+WD_BENCHMARK(Events_PostEach);
+WD_BENCHMARK(Events_Batched)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,122 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <kj/test.h>
+
+// Small native methods called from a hot JavaScript loop, where call overhead dominates.
+// performance.now() and Buffer.compare() use JSG_FAST_METHODs, which optimized code calls through
+// the V8 Fast API; Date.now() is a V8 builtin, for reference. The others go through the usual
+// JSG_METHOD path.
+
+namespace workerd {
+namespace {
+
+struct FastApiBenchmark: public benchmark::Fixture {
+  virtual ~FastApiBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    auto flags = flagsMessage.initRoot<CompatibilityFlags>();
+    flags.setNodeJsCompat(true);
+
+    TestFixture::SetupParams params = {
+      .featureFlags = flags.asReader(),
+      .mainModuleSource = R"(
+        import { Buffer } from "node:buffer";
+
+        const CALLS = 100000;
+        const loops = {
+          "/performance-now"() {
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += performance.now();
+            return x;
+          },
+          "/date-now"() {
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += Date.now();
+            return x;
+          },
+          "/get-random-values"() {
+            const bytes = new Uint8Array(16);
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += crypto.getRandomValues(bytes)[0];
+            return x;
+          },
+          "/encode-into"() {
+            const encoder = new TextEncoder();
+            const out = new Uint8Array(64);
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += encoder.encodeInto("hello world", out).written;
+            return x;
+          },
+          "/headers-get"() {
+            const headers = new Headers({"content-type": "text/plain"});
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += headers.get("content-type").length;
+            return x;
+          },
+          "/buffer-compare"() {
+            const a = Buffer.from("hello world");
+            const b = Buffer.from("hello there");
+            let x = 0;
+            for (let i = 0; i < CALLS; i++) x += Buffer.compare(a, b);
+            return x;
+          },
+        };
+
+        export default {
+          async fetch(request) {
+            const loop = loops[new URL(request.url).pathname];
+            return new Response(String(loop()));
+          }
+        };
+      )"_kj
+    };
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr path) {
+    auto url = kj::str("http://www.example.com", path);
+    for (auto _ : state) {
+      auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+      KJ_EXPECT(result.statusCode == 200);
+    }
+    state.SetItemsProcessed(state.iterations() * 100000);
+  }
+
+  capnp::MallocMessageBuilder flagsMessage;
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(FastApiBenchmark, PerformanceNow)(benchmark::State& state) {
+  run(state, "/performance-now");
+}
+
+BENCHMARK_F(FastApiBenchmark, DateNow)(benchmark::State& state) {
+  run(state, "/date-now");
+}
+
+BENCHMARK_F(FastApiBenchmark, GetRandomValues)(benchmark::State& state) {
+  run(state, "/get-random-values");
+}
+
+BENCHMARK_F(FastApiBenchmark, EncodeInto)(benchmark::State& state) {
+  run(state, "/encode-into");
+}
+
+BENCHMARK_F(FastApiBenchmark, HeadersGet)(benchmark::State& state) {
+  run(state, "/headers-get");
+}
+
+BENCHMARK_F(FastApiBenchmark, BufferCompare)(benchmark::State& state) {
+  run(state, "/buffer-compare");
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,87 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/api/streams/internal.h>
+
+// Throughput of proxying a large body through an IdentityTransformStream (or FixedLengthStream),
+// as when a worker forwards an upload. Compares pumping, which forwards writes directly to the
+// output, against a read loop, which copies each chunk through an intermediate buffer.
+
+namespace workerd::api {
+namespace {
+
+constexpr size_t TOTAL_BYTES = 1024ull * 1024 * 1024;
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+class NullSink final: public WritableStreamSink {
+public:
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    benchmark::DoNotOptimize(buffer);
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> end() override { return kj::READY_NOW; }
+  void abort(kj::Exception reason) override {}
+};
+
+kj::Promise<void> writeAll(IdentityTransformStreamImpl& stream, kj::ArrayPtr<const kj::byte> chunk) {
+  for (size_t written = 0; written < TOTAL_BYTES; written += chunk.size()) {
+    co_await stream.write(chunk.begin(), chunk.size());
+  }
+  co_await stream.end();
+}
+
+kj::Promise<void> readAll(IdentityTransformStreamImpl& stream, kj::ArrayPtr<kj::byte> buffer,
+                          WritableStreamSink& sink) {
+  for (;;) {
+    auto amount = co_await stream.tryRead(buffer.begin(), buffer.size(), buffer.size());
+    if (amount == 0) break;
+    co_await sink.write(buffer.begin(), amount);
+  }
+  co_await sink.end();
+}
+
+static void IdentityStream_Pump(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto chunk = kj::heapArray<kj::byte>(CHUNK_SIZE);
+  chunk.asPtr().fill(0xab);
+
+  for (auto _ : state) {
+    auto stream = kj::refcounted<IdentityTransformStreamImpl>(uint64_t(TOTAL_BYTES));
+    NullSink sink;
+    auto pump = stream->pumpTo(sink, true);
+    writeAll(*stream, chunk).wait(ws);
+    pump.wait(ws).proxyTask.wait(ws);
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+
+static void IdentityStream_ReadLoop(benchmark::State& state) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto chunk = kj::heapArray<kj::byte>(CHUNK_SIZE);
+  chunk.asPtr().fill(0xab);
+  auto buffer = kj::heapArray<kj::byte>(state.range(0));
+
+  for (auto _ : state) {
+    auto stream = kj::refcounted<IdentityTransformStreamImpl>(uint64_t(TOTAL_BYTES));
+    NullSink sink;
+    auto reader = readAll(*stream, buffer, sink);
+    writeAll(*stream, chunk).wait(ws);
+    reader.wait(ws);
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+
+WD_BENCHMARK(IdentityStream_Pump);
+// Read buffers smaller than, equal to and larger than the write size. With the larger buffer,
+// each read (minBytes == maxBytes) collects several writes.
+WD_BENCHMARK(IdentityStream_ReadLoop)->Arg(16 * 1024)->Arg(CHUNK_SIZE)->Arg(1024 * 1024);
+
+}  // namespace
+}  // namespace workerd::api
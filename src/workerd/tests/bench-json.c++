@@ -4,10 +4,12 @@
 
 #include <benchmark/benchmark.h>
 #include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
 #include <workerd/api/r2-api.capnp.h>
 #include "capnp/compat/json.h"
 #include <kj/string.h>
 #include <kj/test.h>
+#include <kj/vector.h>
 
 // Example test, derived from capnproto's json test.
 static void Test_JSON_ENC(benchmark::State& state) {
@@ -46,6 +48,91 @@ static void Test_JSON_DEC(benchmark::State& state) {
   }
 }
 
+// Body-sized JSON documents, as produced by Response.json() and consumed by Body::json(). The
+// argument is the approximate document size in KiB.
+namespace workerd {
+namespace {
+
+kj::String makeJsonDocument(size_t size) {
+  kj::Vector<char> result(size + 128);
+  result.add('[');
+  for (uint i = 0; result.size() < size; i++) {
+    if (i > 0) result.add(',');
+    result.addAll(kj::str("{\"id\":", i, ",\"name\":\"item-", i,
+        "\",\"tags\":[\"alpha\",\"beta\"],\"score\":", i * 0.25, ",\"active\":true}"));
+  }
+  result.add(']');
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+static void Body_ParseCopy(benchmark::State& state) {
+  auto doc = makeJsonDocument(state.range(0) * 1024);
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      // What Body::json() did before: the text is transcoded into a V8 string, then parsed.
+      auto text = kj::str(doc);
+      benchmark::DoNotOptimize(env.js.parseJson(text.asArray()));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void Body_ParseInPlace(benchmark::State& state) {
+  auto doc = makeJsonDocument(state.range(0) * 1024);
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      // The copy stands in for reading the body; parseJson() then parses it where it lies.
+      benchmark::DoNotOptimize(env.js.parseJson(kj::str(doc)));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void Body_StringifyString(benchmark::State& state) {
+  auto doc = makeJsonDocument(state.range(0) * 1024);
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    v8::HandleScope outer(env.isolate);
+    auto value = jsg::JsValue(js.parseJson(doc.asArray()).getHandle(js));
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      benchmark::DoNotOptimize(value.toJson(js));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void Body_StringifyBytes(benchmark::State& state) {
+  auto doc = makeJsonDocument(state.range(0) * 1024);
+  TestFixture fixture;
+  fixture.runInIoContext([&](const TestFixture::Environment& env) {
+    auto& js = env.js;
+    v8::HandleScope outer(env.isolate);
+    auto value = jsg::JsValue(js.parseJson(doc.asArray()).getHandle(js));
+    for (auto _ : state) {
+      v8::HandleScope scope(env.isolate);
+      benchmark::DoNotOptimize(value.toJsonBytes(js));
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+#define BODY_SIZES Arg(16)->Arg(256)->Arg(4096)
+
+WD_BENCHMARK(Body_ParseCopy)->BODY_SIZES;
+WD_BENCHMARK(Body_ParseInPlace)->BODY_SIZES;
+WD_BENCHMARK(Body_StringifyString)->BODY_SIZES;
+WD_BENCHMARK(Body_StringifyBytes)->BODY_SIZES;
+
+}  // namespace
+}  // namespace workerd
+
 WD_BENCHMARK(Test_JSON_ENC);
 WD_BENCHMARK(Test_JSON_DEC);
 // Register both functions as benchmarks – we link benchmark_main so there's no need for a main
@@ -0,0 +1,101 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/jsg/jsg-test.h>
+#include <kj/map.h>
+
+// Awaiting many reads that are answered from a cache, as with storage.get() on cached keys.
+// `getPromise()` returns `js.resolvedPromise(value)`, as storage did before; `get()` returns a
+// jsg::MaybeSync. Each runs with and without the `settledPromiseFastPath` config flag.
+
+namespace workerd::jsg::test {
+namespace {
+
+V8System v8System;
+
+constexpr uint READS = 10'000;
+
+struct CachedReadContext: public Object, public ContextGlobal {
+  CachedReadContext() {
+    for (auto i: kj::zeroTo(100)) {
+      values.insert(kj::str("key", i), kj::str("value of key ", i, " from the cache"));
+    }
+  }
+
+  MaybeSync<kj::String> get(kj::String key) {
+    return kj::str(KJ_ASSERT_NONNULL(values.find(key)));
+  }
+
+  Promise<kj::String> getPromise(Lock& js, kj::String key) {
+    return js.resolvedPromise(kj::str(KJ_ASSERT_NONNULL(values.find(key))));
+  }
+
+  void drain(Lock& js) {
+    js.runMicrotasks();
+  }
+
+  JSG_RESOURCE_TYPE(CachedReadContext) {
+    JSG_METHOD(get);
+    JSG_METHOD(getPromise);
+    JSG_METHOD(drain);
+  }
+
+  kj::HashMap<kj::String, kj::String> values;
+};
+JSG_DECLARE_ISOLATE_TYPE(CachedReadIsolate, CachedReadContext);
+
+const JsgConfig FAST_PATH_CONFIG = {
+  .settledPromiseFastPath = true,
+};
+
+struct FastPathConfig {
+  operator const JsgConfig&() const { return FAST_PATH_CONFIG; }
+};
+
+kj::String makeScript(kj::StringPtr method) {
+  return kj::str(
+      "let total = 0;\n"
+      "(async () => {\n"
+      "  for (let i = 0; i < ", READS, "; i++) {\n"
+      "    total += (await ", method, "('key' + (i % 100))).length;\n"
+      "  }\n"
+      "})();\n"
+      "drain();\n"
+      "total > 0");
+}
+
+template <typename Config>
+void run(benchmark::State& state, kj::StringPtr method) {
+  Evaluator<CachedReadContext, CachedReadIsolate, Config> e(v8System);
+  auto script = makeScript(method);
+  for (auto _ : state) {
+    e.expectEval(script, "boolean", "true");
+  }
+  state.SetItemsProcessed(state.iterations() * READS);
+}
+
+static void Reads_Promise(benchmark::State& state) {
+  run<decltype(nullptr)>(state, "getPromise");
+}
+
+static void Reads_MaybeSync(benchmark::State& state) {
+  run<decltype(nullptr)>(state, "get");
+}
+
+static void Reads_Promise_FastPath(benchmark::State& state) {
+  run<FastPathConfig>(state, "getPromise");
+}
+
+static void Reads_MaybeSync_FastPath(benchmark::State& state) {
+  run<FastPathConfig>(state, "get");
+}
+
+WD_BENCHMARK(Reads_Promise);
+WD_BENCHMARK(Reads_MaybeSync);
+WD_BENCHMARK(Reads_Promise_FastPath);
+WD_BENCHMARK(Reads_MaybeSync_FastPath);
+
+}  // namespace
+}  // namespace workerd::jsg::test
@@ -0,0 +1,67 @@
+// Copyright (c) 2023 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/thread-pool.h>
+#include <kj/time.h>
+#include <openssl/evp.h>
+
+// Measures how long a cheap request waits on the event loop while another request is running an
+// expensive PBKDF2 derivation, with the derivation run inline (as SubtleCrypto used to) versus on
+// a ThreadPool (as SubtleCrypto now does for expensive work). With the derivation inline, the
+// cheap request's latency is the full derivation time; with the pool it should stay flat.
+
+namespace workerd {
+namespace {
+
+constexpr int PBKDF2_ITERATIONS = 100000;
+
+kj::Array<kj::byte> derive() {
+  static const kj::byte password[] = "hunter2";
+  static const kj::byte salt[] = "saltysalt";
+  auto output = kj::heapArray<kj::byte>(32);
+  KJ_ASSERT(PKCS5_PBKDF2_HMAC(reinterpret_cast<const char*>(password), sizeof(password),
+      salt, sizeof(salt), PBKDF2_ITERATIONS, EVP_sha256(), output.size(), output.begin()) == 1);
+  return kj::mv(output);
+}
+
+// Runs one iteration: start a PBKDF2-heavy "request", then measure how long a trivial "request"
+// queued behind it takes to complete. The heavy request is awaited outside of the timed region.
+template <typename StartHeavy>
+void measureLatency(benchmark::State& state, StartHeavy&& startHeavy) {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto& clock = kj::systemPreciseMonotonicClock();
+
+  for (auto _ : state) {
+    auto heavy = startHeavy();
+
+    auto start = clock.now();
+    kj::evalLater([]() {}).wait(ws);
+    auto latency = clock.now() - start;
+
+    heavy.wait(ws);
+    state.SetIterationTime((latency / kj::NANOSECONDS) / 1e9);
+  }
+}
+
+static void Pbkdf2Inline(benchmark::State& state) {
+  measureLatency(state, []() -> kj::Promise<kj::Array<kj::byte>> {
+    return kj::evalLater([]() { return derive(); });
+  });
+}
+
+static void Pbkdf2OnThreadPool(benchmark::State& state) {
+  ThreadPool pool({ .threadCount = 1 });
+  measureLatency(state, [&]() -> kj::Promise<kj::Array<kj::byte>> {
+    kj::Function<kj::Array<kj::byte>()> func = []() { return derive(); };
+    return KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(func)));
+  });
+}
+
+WD_BENCHMARK(Pbkdf2Inline)->UseManualTime();
+WD_BENCHMARK(Pbkdf2OnThreadPool)->UseManualTime();
+
+}  // namespace
+}  // namespace workerd
@@ -15,6 +15,7 @@
 #include <workerd/jsg/modules.h>
 #include <workerd/server/server.h>
 #include <workerd/server/workerd-api.h>
+#include <workerd/server/workerd-limit-enforcer.h>
 #include <workerd/util/stream-utils.h>
 
 #include "test-fixture.h"
@@ -144,14 +145,7 @@ struct MockIsolateLimitEnforcer final: public IsolateLimitEnforcer {
    v8::Isolate::CreateParams getCreateParams() override { return {}; }
     void customizeIsolate(v8::Isolate* isolate) override {}
     ActorCacheSharedLruOptions getActorCacheLruOptions() override {
-      return {
-        .softLimit = 16 * (1ull << 20), // 16 MiB
-        .hardLimit = 128 * (1ull << 20), // 128 MiB
-        .staleTimeout = 30 * kj::SECONDS,
-        .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
-        .maxKeysPerRpc = 128,
-        .neverFlush = true
-      };
+      return server::workerdActorCacheLruOptions();
     }
     kj::Own<void> enterStartupJs(
         jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
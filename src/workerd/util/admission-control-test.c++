@@ -0,0 +1,144 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "admission-control.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+using Permit = kj::Own<AdmissionController::Permit>;
+
+void expectShed(kj::Promise<Permit>& promise, kj::WaitScope& ws) {
+  KJ_ASSERT(promise.poll(ws));
+  kj::mv(promise).then([](Permit) {
+    KJ_FAIL_EXPECT("request should have been shed");
+  }, [](kj::Exception&& e) {
+    KJ_EXPECT(e.getType() == kj::Exception::Type::OVERLOADED, e);
+    KJ_EXPECT(AdmissionController::isShed(e), e);
+  }).wait(ws);
+}
+
+KJ_TEST("AdmissionController queues beyond the concurrency limit") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  auto controller = kj::refcounted<AdmissionController>(timer, AdmissionController::Limits {
+    .maxConcurrentRequests = 2,
+    .maxQueuedRequests = 1,
+  });
+
+  auto first = controller->admit().wait(ws);
+  auto second = controller->admit().wait(ws);
+
+  auto third = controller->admit();
+  KJ_EXPECT(!third.poll(ws));
+  KJ_EXPECT(controller->getStats().queueDepth == 1);
+
+  // The queue is full.
+  auto fourth = controller->admit();
+  expectShed(fourth, ws);
+
+  // Finishing a request lets the queued one in.
+  first = nullptr;
+  auto thirdPermit = third.wait(ws);
+
+  auto& stats = controller->getStats();
+  KJ_EXPECT(stats.admitted == 3);
+  KJ_EXPECT(stats.queued == 1);
+  KJ_EXPECT(stats.shed == 1);
+  KJ_EXPECT(stats.inFlight == 2);
+  KJ_EXPECT(stats.queueDepth == 0);
+
+  // Other OVERLOADED errors aren't mistaken for sheds.
+  KJ_EXPECT(!AdmissionController::isShed(KJ_EXCEPTION(OVERLOADED, "exceeded CPU time limit")));
+}
+
+KJ_TEST("AdmissionController sheds requests that wait too long") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  auto controller = kj::refcounted<AdmissionController>(timer, AdmissionController::Limits {
+    .maxConcurrentRequests = 1,
+    .maxQueuedRequests = 10,
+    .maxQueueTime = 100 * kj::MILLISECONDS,
+  });
+
+  auto permit = controller->admit().wait(ws);
+  auto queued = controller->admit();
+  KJ_EXPECT(!queued.poll(ws));
+
+  timer.advanceTo(timer.now() + 100 * kj::MILLISECONDS);
+  expectShed(queued, ws);
+  KJ_EXPECT(controller->getStats().queueDepth == 0);
+  KJ_EXPECT(controller->getStats().shed == 1);
+
+  // A queued request that is canceled leaves the queue too.
+  {
+    auto canceled = controller->admit();
+    KJ_EXPECT(controller->getStats().queueDepth == 1);
+  }
+  KJ_EXPECT(controller->getStats().queueDepth == 0);
+}
+
+KJ_TEST("AdmissionController sheds while the isolate lock is contended") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  auto controller = kj::refcounted<AdmissionController>(timer, AdmissionController::Limits {
+    .maxLockWait = 50 * kj::MILLISECONDS,
+  });
+
+  auto permit = controller->admit().wait(ws);
+  controller->reportLockWait(200 * kj::MILLISECONDS);
+  KJ_EXPECT(controller->getLockWait() == 200 * kj::MILLISECONDS);
+
+  auto shed = controller->admit();
+  expectShed(shed, ws);
+
+  // A request is always admitted when nothing else is running...
+  {
+    auto p = kj::mv(permit);
+  }
+  permit = controller->admit().wait(ws);
+
+  // ...and once lock waits stop being reported, the old ones are forgotten.
+  timer.advanceTo(timer.now() + AdmissionController::LOCK_WAIT_EXPIRY + 1 * kj::MILLISECONDS);
+  KJ_EXPECT(controller->getLockWait() == 0 * kj::NANOSECONDS);
+  controller->admit().wait(ws);
+}
+
+KJ_TEST("AdmissionController sheds while the event loop is lagging") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  auto controller = kj::refcounted<AdmissionController>(timer, AdmissionController::Limits {
+    .maxEventLoopLag = 50 * kj::MILLISECONDS,
+  });
+  auto permit = controller->admit().wait(ws);
+
+  // The loop was busy for half a second past the sample point.
+  auto sampleTime = timer.now() + AdmissionController::LAG_SAMPLE_INTERVAL;
+  timer.advanceTo(sampleTime + 500 * kj::MILLISECONDS);
+  ws.poll();
+  KJ_EXPECT(controller->getEventLoopLag() == 250 * kj::MILLISECONDS);
+
+  auto shed = controller->admit();
+  expectShed(shed, ws);
+
+  // Samples taken on time bring the lag back down.
+  for (auto i KJ_UNUSED: kj::zeroTo(5)) {
+    timer.advanceTo(timer.now() + AdmissionController::LAG_SAMPLE_INTERVAL);
+    ws.poll();
+  }
+  KJ_EXPECT(controller->getEventLoopLag() < 50 * kj::MILLISECONDS);
+  controller->admit().wait(ws);
+}
+
+}  // namespace
+}  // namespace workerd
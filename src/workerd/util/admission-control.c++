@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "admission-control.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+AdmissionController::AdmissionController(kj::Timer& timer, Limits limits)
+    : timer(timer), limits(limits) {
+  if (limits.maxEventLoopLag != kj::none) {
+    lagMonitor = monitorEventLoopLag().eagerlyEvaluate([](kj::Exception&& e) {
+      KJ_LOG(ERROR, "event loop lag monitor failed", e);
+    });
+  }
+}
+
+AdmissionController::~AdmissionController() noexcept(false) {
+  // Every queued request holds a reference to us through its promise, so the queue must be empty.
+  KJ_ASSERT(queue.empty());
+}
+
+AdmissionController::Permit::~Permit() noexcept(false) {
+  controller->release();
+}
+
+AdmissionController::Waiter::~Waiter() noexcept(false) {
+  // Removes requests which gave up waiting, e.g. because the client disconnected or the queue
+  // timeout elapsed.
+  if (link.isLinked()) {
+    controller.queue.remove(*this);
+    --controller.stats.queueDepth;
+  }
+}
+
+kj::Promise<kj::Own<AdmissionController::Permit>> AdmissionController::admit() {
+  if (stats.inFlight > 0 && overloaded()) {
+    return shed("worker is overloaded");
+  }
+
+  if (queue.empty() &&
+      (limits.maxConcurrentRequests == 0 || stats.inFlight < limits.maxConcurrentRequests)) {
+    return newPermit();
+  }
+
+  if (queue.size() >= limits.maxQueuedRequests) {
+    return shed("too many requests are waiting");
+  }
+
+  ++stats.queued;
+  ++stats.queueDepth;
+  auto paf = kj::newPromiseAndFulfiller<kj::Own<Permit>>();
+  auto waiter = kj::heap<Waiter>(*this, kj::mv(paf.fulfiller));
+  queue.add(*waiter);
+  auto promise = kj::mv(paf.promise).attach(kj::mv(waiter), kj::addRef(*this));
+
+  KJ_IF_SOME(maxQueueTime, limits.maxQueueTime) {
+    promise = kj::mv(promise).exclusiveJoin(timer.afterDelay(maxQueueTime)
+        .then([this, self = kj::addRef(*this)]() -> kj::Promise<kj::Own<Permit>> {
+      return shed("request waited too long");
+    }));
+  }
+
+  return kj::mv(promise);
+}
+
+void AdmissionController::reportLockWait(kj::Duration wait) {
+  // An exponentially-weighted moving average, so that one slow lock acquisition doesn't trigger
+  // shedding, but a sustained backlog does within a few requests.
+  if (getLockWait() == 0 * kj::NANOSECONDS) {
+    lockWait = wait;
+  } else {
+    lockWait += (wait - lockWait) / 4;
+  }
+  lastLockWaitReport = timer.now();
+}
+
+kj::Duration AdmissionController::getLockWait() const {
+  if (timer.now() - lastLockWaitReport > LOCK_WAIT_EXPIRY) {
+    return 0 * kj::NANOSECONDS;
+  }
+  return lockWait;
+}
+
+bool AdmissionController::overloaded() {
+  KJ_IF_SOME(max, limits.maxLockWait) {
+    if (getLockWait() > max) return true;
+  }
+  KJ_IF_SOME(max, limits.maxEventLoopLag) {
+    if (eventLoopLag > max) return true;
+  }
+  return false;
+}
+
+kj::Exception AdmissionController::shed(kj::StringPtr reason) {
+  ++stats.shed;
+
+  // Log once per episode of shedding rather than once per request.
+  if (!shedding) {
+    shedding = true;
+    KJ_LOG(WARNING, "NOSENTRY shedding requests", reason, stats.inFlight, stats.queueDepth,
+           getLockWait(), eventLoopLag);
+  }
+
+  auto exception =
+      KJ_EXCEPTION(OVERLOADED, kj::str("Request shed by admission control: ", reason, "."));
+  exception.setDetail(SHED_DETAIL_ID, kj::heapArray<kj::byte>(0));
+  return exception;
+}
+
+bool AdmissionController::isShed(const kj::Exception& exception) {
+  return exception.getDetail(SHED_DETAIL_ID) != kj::none;
+}
+
+kj::Own<AdmissionController::Permit> AdmissionController::newPermit() {
+  ++stats.admitted;
+  ++stats.inFlight;
+  shedding = false;
+  return kj::heap<Permit>(kj::addRef(*this));
+}
+
+void AdmissionController::release() {
+  --stats.inFlight;
+
+  if (!queue.empty()) {
+    auto& waiter = queue.front();
+    queue.remove(waiter);
+    --stats.queueDepth;
+    waiter.fulfiller->fulfill(newPermit());
+  }
+}
+
+kj::Promise<void> AdmissionController::monitorEventLoopLag() {
+  for (;;) {
+    auto expected = timer.now() + LAG_SAMPLE_INTERVAL;
+    co_await timer.atTime(expected);
+
+    // The timer can only fire once the event loop gets around to checking it, so anything past
+    // the expected time is time the loop spent busy. Smoothed like the lock wait time, but
+    // weighting new samples more heavily since they are taken less often.
+    auto lag = timer.now() - expected;
+    eventLoopLag += (lag - eventLoopLag) / 2;
+  }
+}
+
+}  // namespace workerd
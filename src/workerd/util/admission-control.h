@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/list.h>
+#include <kj/refcount.h>
+#include <kj/timer.h>
+
+namespace workerd {
+
+using kj::uint;
+
+// Decides whether requests to a Worker may start running, may wait for a slot, or should be
+// rejected ("shed") right away, so that a traffic spike produces fast errors rather than
+// unbounded queueing behind the isolate lock.
+//
+// Requests are admitted up to a concurrency limit, beyond which they wait in a bounded FIFO
+// queue. Independently of those limits, while the Worker is measurably overloaded -- requests
+// have recently been waiting too long for the isolate lock, or the event loop is lagging --
+// new requests are shed, unless nothing is running at all.
+//
+// Not thread-safe; belongs to the thread running the Worker's requests.
+class AdmissionController final: public kj::Refcounted {
+public:
+  struct Limits {
+    // Requests allowed to run at once. Zero means no limit.
+    uint maxConcurrentRequests = 0;
+
+    // Requests allowed to wait for a slot once the concurrency limit is reached. Requests
+    // arriving when the queue is full are shed.
+    uint maxQueuedRequests = 0;
+
+    // A queued request which hasn't been admitted after this long is shed.
+    kj::Maybe<kj::Duration> maxQueueTime;
+
+    // New requests are shed while the smoothed time requests have spent waiting for the isolate
+    // lock exceeds this.
+    kj::Maybe<kj::Duration> maxLockWait;
+
+    // New requests are shed while the smoothed event loop lag exceeds this. Lag is measured by
+    // how late a periodic timer fires.
+    kj::Maybe<kj::Duration> maxEventLoopLag;
+  };
+
+  struct Stats {
+    // Requests allowed to run, including those that waited in the queue first.
+    uint64_t admitted = 0;
+
+    // Requests that had to wait in the queue.
+    uint64_t queued = 0;
+
+    // Requests rejected, whether on arrival or after waiting in the queue too long.
+    uint64_t shed = 0;
+
+    uint inFlight = 0;
+    uint queueDepth = 0;
+  };
+
+  AdmissionController(kj::Timer& timer, Limits limits);
+  ~AdmissionController() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(AdmissionController);
+
+  // Held by an admitted request for as long as it runs. Dropping it lets the next queued request
+  // in.
+  class Permit {
+  public:
+    explicit Permit(kj::Own<AdmissionController> controller): controller(kj::mv(controller)) {}
+    ~Permit() noexcept(false);
+    KJ_DISALLOW_COPY_AND_MOVE(Permit);
+
+  private:
+    kj::Own<AdmissionController> controller;
+  };
+
+  // Resolves once the request may run. Rejects with an OVERLOADED exception if the request is
+  // shed, either right away or after waiting in the queue for too long.
+  kj::Promise<kj::Own<Permit>> admit();
+
+  // True if the exception is one that admit() rejected with. Other OVERLOADED exceptions, such as
+  // a request exceeding its resource limits, are errors worth logging; sheds are not, since the
+  // controller logs each episode of shedding itself.
+  static bool isShed(const kj::Exception& exception);
+
+  // Reports how long a request waited for the isolate lock. Fed from the isolate's
+  // `IsolateObserver::LockTiming`.
+  void reportLockWait(kj::Duration wait);
+
+  // The smoothed measurements that drive shedding.
+  kj::Duration getLockWait() const;
+  kj::Duration getEventLoopLag() const { return eventLoopLag; }
+
+  const Stats& getStats() const { return stats; }
+
+  // How often the event loop lag is sampled.
+  static constexpr kj::Duration LAG_SAMPLE_INTERVAL = 100 * kj::MILLISECONDS;
+
+  // Lock wait times older than this are ignored. Without it, a Worker that is shedding every
+  // request would never take the lock again, and would never notice that it had recovered.
+  static constexpr kj::Duration LOCK_WAIT_EXPIRY = 1 * kj::SECONDS;
+
+  // Exception detail marking an exception as a shed. See isShed().
+  static constexpr kj::Exception::DetailTypeId SHED_DETAIL_ID = 0xb1e5c4a7d1f3e02aull;
+
+private:
+  struct Waiter {
+    Waiter(AdmissionController& controller,
+           kj::Own<kj::PromiseFulfiller<kj::Own<Permit>>> fulfiller)
+        : controller(controller), fulfiller(kj::mv(fulfiller)) {}
+    ~Waiter() noexcept(false);
+
+    AdmissionController& controller;
+    kj::Own<kj::PromiseFulfiller<kj::Own<Permit>>> fulfiller;
+    kj::ListLink<Waiter> link;
+  };
+
+  kj::Timer& timer;
+  Limits limits;
+  Stats stats;
+
+  kj::List<Waiter, &Waiter::link> queue;
+
+  kj::Duration lockWait = 0 * kj::NANOSECONDS;
+  kj::TimePoint lastLockWaitReport = kj::origin<kj::TimePoint>();
+  kj::Duration eventLoopLag = 0 * kj::NANOSECONDS;
+
+  bool shedding = false;
+
+  kj::Maybe<kj::Promise<void>> lagMonitor;
+
+  bool overloaded();
+  kj::Exception shed(kj::StringPtr reason);
+  kj::Own<Permit> newPermit();
+  void release();
+  kj::Promise<void> monitorEventLoopLag();
+};
+
+}  // namespace workerd
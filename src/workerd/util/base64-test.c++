@@ -0,0 +1,156 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "base64.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+kj::Array<kj::byte> makeData(size_t size) {
+  auto data = kj::heapArray<kj::byte>(size);
+  uint32_t state = size + 1;
+  for (auto& b: data) {
+    state = state * 1103515245 + 12345;
+    b = state >> 16;
+  }
+  return data;
+}
+
+// Sizes around every block size used by the vectorized paths.
+constexpr size_t MAX_SIZE = 300;
+
+KJ_TEST("fastEncodeBase64 matches kj") {
+  for (size_t size = 0; size < MAX_SIZE; size++) {
+    auto data = makeData(size);
+    KJ_EXPECT(fastEncodeBase64(data) == kj::encodeBase64(data), size);
+    KJ_EXPECT(fastEncodeBase64(data, Base64Alphabet::URL) == kj::encodeBase64Url(data), size);
+  }
+}
+
+KJ_TEST("encodeBase64Into writes into a larger buffer") {
+  auto data = makeData(100);
+  auto size = base64EncodedSize(data.size());
+  auto buffer = kj::heapArray<char>(size + 2);
+  buffer[0] = '[';
+  buffer[size + 1] = ']';
+  encodeBase64Into(data, buffer.slice(1, size + 1));
+  KJ_EXPECT(kj::str(buffer.slice(1, size + 1)) == kj::encodeBase64(data));
+  KJ_EXPECT(buffer[0] == '[');
+  KJ_EXPECT(buffer[size + 1] == ']');
+
+  KJ_EXPECT_THROW_MESSAGE("wrong output size", encodeBase64Into(data, buffer));
+}
+
+KJ_TEST("fastDecodeBase64 matches kj") {
+  for (size_t size = 0; size < MAX_SIZE; size++) {
+    auto data = makeData(size);
+    auto encoded = kj::encodeBase64(data);
+    auto decoded = fastDecodeBase64(encoded);
+    KJ_EXPECT(!decoded.hadErrors, size);
+    KJ_EXPECT(decoded.asPtr() == data.asPtr(), size);
+  }
+
+  // Whitespace, padding and errors in different places are all handed to kj, which should see
+  // exactly what it would have seen had it decoded the whole input itself.
+  kj::StringPtr cases[] = {
+    "",
+    "QUJD",
+    "QUJDRA==",
+    "QUJDRA=",
+    "QUJDRA",
+    "QUJDR",
+    "QUJD RA==",
+    "QUJDRA== ",
+    " QUJDRA==",
+    "QUJDRA==QUJD",
+    "QUJDRA=a",
+    "QUJD\nRA\n==",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5eg==",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlq\na2xtbm9wcXJzdHV2d3h5eg==",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5eg=",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5e",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5eg-_",
+    "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5eg*=",
+  };
+  for (auto input: cases) {
+    auto expected = kj::decodeBase64(input);
+    auto actual = fastDecodeBase64(input);
+    KJ_EXPECT(actual.hadErrors == expected.hadErrors, input);
+    KJ_EXPECT(actual.asPtr() == expected.asPtr(), input);
+  }
+}
+
+KJ_TEST("decodeBase64Prefix stops at the first group it can't decode on its own") {
+  auto data = makeData(200);
+  auto encoded = kj::str(kj::encodeBase64(data));
+  auto output = kj::heapArray<kj::byte>(data.size());
+
+  // Everything but the padded final group.
+  auto result = decodeBase64Prefix(encoded, output);
+  KJ_EXPECT(result.consumed == encoded.size() - 4);
+  KJ_EXPECT(result.written == data.size() - 2);
+  KJ_EXPECT(output.first(result.written) == data.first(result.written));
+
+  // An invalid character stops decoding at the start of its group.
+  encoded[101] = '*';
+  result = decodeBase64Prefix(encoded, output);
+  KJ_EXPECT(result.consumed == 100);
+  KJ_EXPECT(result.written == 75);
+  KJ_EXPECT(output.first(75) == data.first(75));
+
+  // So does running out of output space.
+  result = decodeBase64Prefix(encoded, output.first(40));
+  KJ_EXPECT(result.consumed == 52);
+  KJ_EXPECT(result.written == 39);
+
+  // The URL alphabet is only accepted when asked for.
+  auto url = kj::encodeBase64Url(data);
+  size_t firstUrlChar = 0;
+  while (firstUrlChar < url.size() && url[firstUrlChar] != '-' && url[firstUrlChar] != '_') {
+    firstUrlChar++;
+  }
+  result = decodeBase64Prefix(url, output);
+  KJ_EXPECT(result.consumed == firstUrlChar / 4 * 4);
+  result = decodeBase64Prefix(url, output, true);
+  KJ_EXPECT(result.consumed == url.size() / 4 * 4);
+  KJ_EXPECT(output.first(result.written) == data.first(result.written));
+}
+
+KJ_TEST("fastEncodeHex matches kj") {
+  for (size_t size = 0; size < MAX_SIZE; size++) {
+    auto data = makeData(size);
+    KJ_EXPECT(fastEncodeHex(data) == kj::encodeHex(data), size);
+  }
+}
+
+KJ_TEST("decodeHexPrefix stops at the first invalid pair") {
+  auto data = makeData(100);
+  auto encoded = kj::str(kj::encodeHex(data));
+  // Mixed case is fine.
+  for (size_t i = 0; i < encoded.size(); i += 3) {
+    if ('a' <= encoded[i] && encoded[i] <= 'f') encoded[i] += 'A' - 'a';
+  }
+  auto output = kj::heapArray<kj::byte>(data.size());
+
+  auto result = decodeHexPrefix(encoded, output);
+  KJ_EXPECT(result.consumed == encoded.size());
+  KJ_EXPECT(result.written == data.size());
+  KJ_EXPECT(output.asPtr() == data.asPtr());
+
+  encoded[77] = 'g';
+  result = decodeHexPrefix(encoded, output);
+  KJ_EXPECT(result.consumed == 76);
+  KJ_EXPECT(result.written == 38);
+  KJ_EXPECT(output.first(38) == data.first(38));
+
+  // A trailing odd character is left alone.
+  result = decodeHexPrefix("abc"_kj, output);
+  KJ_EXPECT(result.consumed == 2);
+  KJ_EXPECT(result.written == 1);
+  KJ_EXPECT(output[0] == 0xab);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,689 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "base64.h"
+#include <kj/debug.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(_WIN32)
+// Vector paths are compiled with function-level target attributes and chosen at runtime, since we
+// don't assume anything beyond the baseline instruction set at build time.
+#define WORKERD_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define WORKERD_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+constexpr char STANDARD_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr char URL_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+const char* alphabetChars(Base64Alphabet alphabet) {
+  return alphabet == Base64Alphabet::STANDARD ? STANDARD_CHARS : URL_CHARS;
+}
+
+// Maps each character to its 6-bit value, or 0xff if it's not in the alphabet.
+struct DecodeTable {
+  kj::byte values[256];
+
+  constexpr explicit DecodeTable(bool acceptUrlAlphabet): values() {
+    for (auto& value: values) value = 0xff;
+    for (kj::byte i = 0; i < 64; i++) {
+      values[static_cast<kj::byte>(STANDARD_CHARS[i])] = i;
+    }
+    if (acceptUrlAlphabet) {
+      values['-'] = 62;
+      values['_'] = 63;
+    }
+  }
+};
+
+constexpr DecodeTable STANDARD_DECODE_TABLE(false);
+constexpr DecodeTable EITHER_DECODE_TABLE(true);
+
+inline int hexValue(char c) {
+  if ('0' <= c && c <= '9') return c - '0';
+  if ('a' <= c && c <= 'f') return c - ('a' - 10);
+  if ('A' <= c && c <= 'F') return c - ('A' - 10);
+  return -1;
+}
+
+// =======================================================================================
+// x86: SSSE3 and AVX2
+//
+// The base64 kernels follow Wojciech Muła's and Daniel Lemire's "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions". Each 12 bytes are spread across 16 lanes by a byte shuffle
+// and a couple of multiplies, then a small lookup table gives the offset from each 6-bit value to
+// its character. Decoding classifies characters with range checks rather than a lookup table so
+// that the same code handles the standard and URL alphabets, then packs the values back together
+// with two multiply-adds and a shuffle.
+
+#if WORKERD_BASE64_X86
+
+#define WORKERD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define WORKERD_TARGET_AVX2 __attribute__((target("avx2")))
+
+enum class SimdLevel { NONE, SSSE3, AVX2 };
+
+SimdLevel getSimdLevel() {
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return SimdLevel::SSSE3;
+    return SimdLevel::NONE;
+  }();
+  return level;
+}
+
+// Offsets from a 6-bit value to its character, indexed as computed in sextetsToChars().
+constexpr int8_t STANDARD_SHIFTS[16] = {
+  'a' - 26,
+  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+  '+' - 62, '/' - 63, 'A', 0, 0,
+};
+constexpr int8_t URL_SHIFTS[16] = {
+  'a' - 26,
+  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+  '-' - 62, '_' - 63, 'A', 0, 0,
+};
+
+inline const __m128i* loadAddress(const void* p) { return reinterpret_cast<const __m128i*>(p); }
+inline __m128i* storeAddress(void* p) { return reinterpret_cast<__m128i*>(p); }
+inline const __m256i* loadAddress256(const void* p) {
+  return reinterpret_cast<const __m256i*>(p);
+}
+inline __m256i* storeAddress256(void* p) { return reinterpret_cast<__m256i*>(p); }
+
+inline __m128i set1(int c) { return _mm_set1_epi8(static_cast<char>(c)); }
+WORKERD_TARGET_AVX2 inline __m256i set1x2(int c) {
+  return _mm256_set1_epi8(static_cast<char>(c));
+}
+
+// Spreads the first 12 bytes of `in` into 16 lanes holding one 6-bit value each.
+WORKERD_TARGET_SSSE3 inline __m128i splitSextets(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i sextetsToChars(__m128i values, __m128i shifts) {
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12.
+  auto index = _mm_subs_epu8(values, set1(51));
+  auto upper = _mm_cmpgt_epi8(set1(26), values);
+  index = _mm_or_si128(index, _mm_and_si128(upper, set1(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(shifts, index), values);
+}
+
+WORKERD_TARGET_AVX2 inline __m256i splitSextets(__m256i in) {
+  in = _mm256_shuffle_epi8(in, _mm256_broadcastsi128_si256(
+      _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1)));
+  auto t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+  auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+  auto t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+  auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+  return _mm256_or_si256(t1, t3);
+}
+
+WORKERD_TARGET_AVX2 inline __m256i sextetsToChars(__m256i values, __m256i shifts) {
+  auto index = _mm256_subs_epu8(values, set1x2(51));
+  auto upper = _mm256_cmpgt_epi8(set1x2(26), values);
+  index = _mm256_or_si256(index, _mm256_and_si256(upper, set1x2(13)));
+  return _mm256_add_epi8(_mm256_shuffle_epi8(shifts, index), values);
+}
+
+// Each of these returns how many input bytes it encoded, always a multiple of three; the caller
+// encodes the rest.
+
+WORKERD_TARGET_SSSE3 size_t encodeBase64Ssse3(
+    const kj::byte* in, size_t size, char* out, const int8_t* shiftTable) {
+  auto shifts = _mm_loadu_si128(loadAddress(shiftTable));
+  size_t done = 0;
+  // Each step loads 16 bytes but only encodes the first 12.
+  for (; size - done >= 16; done += 12) {
+    auto chars = sextetsToChars(splitSextets(_mm_loadu_si128(loadAddress(in + done))), shifts);
+    _mm_storeu_si128(storeAddress(out + done / 3 * 4), chars);
+  }
+  return done;
+}
+
+WORKERD_TARGET_AVX2 size_t encodeBase64Avx2(
+    const kj::byte* in, size_t size, char* out, const int8_t* shiftTable) {
+  auto shifts = _mm256_broadcastsi128_si256(_mm_loadu_si128(loadAddress(shiftTable)));
+  size_t done = 0;
+  for (; size - done >= 28; done += 24) {
+    auto lo = _mm_loadu_si128(loadAddress(in + done));
+    auto hi = _mm_loadu_si128(loadAddress(in + done + 12));
+    auto bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    _mm256_storeu_si256(storeAddress256(out + done / 3 * 4),
+                        sextetsToChars(splitSextets(bytes), shifts));
+  }
+  return done;
+}
+
+size_t encodeBase64Simd(const kj::byte* in, size_t size, char* out, Base64Alphabet alphabet) {
+  auto shifts = alphabet == Base64Alphabet::STANDARD ? STANDARD_SHIFTS : URL_SHIFTS;
+  size_t done = 0;
+  switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      done = encodeBase64Avx2(in, size, out, shifts);
+      // The SSSE3 loop picks up a last block that's too small for AVX2.
+      [[fallthrough]];
+    case SimdLevel::SSSE3:
+      done += encodeBase64Ssse3(in + done, size - done, out + done / 3 * 4, shifts);
+      break;
+    case SimdLevel::NONE:
+      break;
+  }
+  return done;
+}
+
+// Lanes where `c` is in [lo, lo + count) are set to 0xff.
+WORKERD_TARGET_SSSE3 inline __m128i inRange(__m128i c, char lo, int count) {
+  auto offset = _mm_sub_epi8(c, set1(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(offset, set1(count - 1)), offset);
+}
+
+WORKERD_TARGET_AVX2 inline __m256i inRange(__m256i c, char lo, int count) {
+  auto offset = _mm256_sub_epi8(c, set1x2(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, set1x2(count - 1)), offset);
+}
+
+// Converts base64 characters to their 6-bit values. Lanes of `valid` are cleared where the
+// character isn't in the alphabet.
+WORKERD_TARGET_SSSE3 inline __m128i base64Values(
+    __m128i c, bool acceptUrlAlphabet, __m128i& valid) {
+  auto upper = inRange(c, 'A', 26);
+  auto lower = inRange(c, 'a', 26);
+  auto digit = inRange(c, '0', 10);
+  auto plus = _mm_cmpeq_epi8(c, set1('+'));
+  auto slash = _mm_cmpeq_epi8(c, set1('/'));
+  valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+  auto shift = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(upper, set1(-'A')), _mm_and_si128(lower, set1(26 - 'a'))),
+      _mm_or_si128(_mm_and_si128(digit, set1(52 - '0')),
+          _mm_or_si128(_mm_and_si128(plus, set1(62 - '+')), _mm_and_si128(slash, set1(63 - '/')))));
+  if (acceptUrlAlphabet) {
+    auto dash = _mm_cmpeq_epi8(c, set1('-'));
+    auto underscore = _mm_cmpeq_epi8(c, set1('_'));
+    valid = _mm_or_si128(valid, _mm_or_si128(dash, underscore));
+    shift = _mm_or_si128(shift, _mm_or_si128(
+        _mm_and_si128(dash, set1(62 - '-')), _mm_and_si128(underscore, set1(63 - '_'))));
+  }
+  return _mm_add_epi8(c, shift);
+}
+
+WORKERD_TARGET_AVX2 inline __m256i base64Values(
+    __m256i c, bool acceptUrlAlphabet, __m256i& valid) {
+  auto upper = inRange(c, 'A', 26);
+  auto lower = inRange(c, 'a', 26);
+  auto digit = inRange(c, '0', 10);
+  auto plus = _mm256_cmpeq_epi8(c, set1x2('+'));
+  auto slash = _mm256_cmpeq_epi8(c, set1x2('/'));
+  valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                          _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+  auto shift = _mm256_or_si256(
+      _mm256_or_si256(_mm256_and_si256(upper, set1x2(-'A')),
+                      _mm256_and_si256(lower, set1x2(26 - 'a'))),
+      _mm256_or_si256(_mm256_and_si256(digit, set1x2(52 - '0')),
+          _mm256_or_si256(_mm256_and_si256(plus, set1x2(62 - '+')),
+                          _mm256_and_si256(slash, set1x2(63 - '/')))));
+  if (acceptUrlAlphabet) {
+    auto dash = _mm256_cmpeq_epi8(c, set1x2('-'));
+    auto underscore = _mm256_cmpeq_epi8(c, set1x2('_'));
+    valid = _mm256_or_si256(valid, _mm256_or_si256(dash, underscore));
+    shift = _mm256_or_si256(shift, _mm256_or_si256(
+        _mm256_and_si256(dash, set1x2(62 - '-')),
+        _mm256_and_si256(underscore, set1x2(63 - '_'))));
+  }
+  return _mm256_add_epi8(c, shift);
+}
+
+// Packs 16 6-bit values into 12 bytes, left in the low lanes.
+WORKERD_TARGET_SSSE3 inline __m128i packSextets(__m128i values) {
+  auto pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  auto triples = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(triples,
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+// Packs 32 6-bit values into 24 bytes, left in the low lanes.
+WORKERD_TARGET_AVX2 inline __m256i packSextets(__m256i values) {
+  auto pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+  auto triples = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+  auto packed = _mm256_shuffle_epi8(triples, _mm256_broadcastsi128_si256(
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+  return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+
+// Each of these stops at the first block containing a character outside the alphabet, or when
+// fewer than a full store's worth of output space remains, and returns how far it got.
+
+WORKERD_TARGET_SSSE3 DecodedPrefix decodeBase64Ssse3(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize, bool acceptUrlAlphabet) {
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 16 && outSize - k >= 16; i += 16, k += 12) {
+    __m128i valid;
+    auto values = base64Values(_mm_loadu_si128(loadAddress(in + i)), acceptUrlAlphabet, valid);
+    if (_mm_movemask_epi8(valid) != 0xffff) break;
+    _mm_storeu_si128(storeAddress(out + k), packSextets(values));
+  }
+  return { i, k };
+}
+
+WORKERD_TARGET_AVX2 DecodedPrefix decodeBase64Avx2(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize, bool acceptUrlAlphabet) {
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 32 && outSize - k >= 32; i += 32, k += 24) {
+    __m256i valid;
+    auto values = base64Values(
+        _mm256_loadu_si256(loadAddress256(in + i)), acceptUrlAlphabet, valid);
+    if (_mm256_movemask_epi8(valid) != -1) break;
+    _mm256_storeu_si256(storeAddress256(out + k), packSextets(values));
+  }
+  return { i, k };
+}
+
+DecodedPrefix decodeBase64Simd(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize, bool acceptUrlAlphabet) {
+  DecodedPrefix result = { 0, 0 };
+  switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      result = decodeBase64Avx2(in, inSize, out, outSize, acceptUrlAlphabet);
+      [[fallthrough]];
+    case SimdLevel::SSSE3: {
+      auto more = decodeBase64Ssse3(in + result.consumed, inSize - result.consumed,
+          out + result.written, outSize - result.written, acceptUrlAlphabet);
+      result.consumed += more.consumed;
+      result.written += more.written;
+      break;
+    }
+    case SimdLevel::NONE:
+      break;
+  }
+  return result;
+}
+
+WORKERD_TARGET_SSSE3 size_t encodeHexSsse3(const kj::byte* in, size_t size, char* out) {
+  auto digits = _mm_loadu_si128(loadAddress(HEX_DIGITS));
+  auto mask = set1(0x0f);
+  size_t done = 0;
+  for (; size - done >= 16; done += 16) {
+    auto bytes = _mm_loadu_si128(loadAddress(in + done));
+    auto hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    auto lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+    _mm_storeu_si128(storeAddress(out + done * 2), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(storeAddress(out + done * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  return done;
+}
+
+WORKERD_TARGET_AVX2 size_t encodeHexAvx2(const kj::byte* in, size_t size, char* out) {
+  auto digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(loadAddress(HEX_DIGITS)));
+  auto mask = set1x2(0x0f);
+  size_t done = 0;
+  for (; size - done >= 32; done += 32) {
+    auto bytes = _mm256_loadu_si256(loadAddress256(in + done));
+    auto hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+    auto lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+    // The unpacks work within 128-bit lanes, so put the lanes back in order afterwards.
+    auto first = _mm256_unpacklo_epi8(hi, lo);
+    auto second = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(storeAddress256(out + done * 2),
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256(storeAddress256(out + done * 2 + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  return done;
+}
+
+size_t encodeHexSimd(const kj::byte* in, size_t size, char* out) {
+  size_t done = 0;
+  switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      done = encodeHexAvx2(in, size, out);
+      [[fallthrough]];
+    case SimdLevel::SSSE3:
+      done += encodeHexSsse3(in + done, size - done, out + done * 2);
+      break;
+    case SimdLevel::NONE:
+      break;
+  }
+  return done;
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i hexValues(__m128i c, __m128i& valid) {
+  auto digit = inRange(c, '0', 10);
+  auto lower = inRange(c, 'a', 6);
+  auto upper = inRange(c, 'A', 6);
+  valid = _mm_or_si128(digit, _mm_or_si128(lower, upper));
+  auto shift = _mm_or_si128(_mm_and_si128(digit, set1(-'0')),
+      _mm_or_si128(_mm_and_si128(lower, set1(10 - 'a')), _mm_and_si128(upper, set1(10 - 'A'))));
+  return _mm_add_epi8(c, shift);
+}
+
+WORKERD_TARGET_AVX2 inline __m256i hexValues(__m256i c, __m256i& valid) {
+  auto digit = inRange(c, '0', 10);
+  auto lower = inRange(c, 'a', 6);
+  auto upper = inRange(c, 'A', 6);
+  valid = _mm256_or_si256(digit, _mm256_or_si256(lower, upper));
+  auto shift = _mm256_or_si256(_mm256_and_si256(digit, set1x2(-'0')),
+      _mm256_or_si256(_mm256_and_si256(lower, set1x2(10 - 'a')),
+                      _mm256_and_si256(upper, set1x2(10 - 'A'))));
+  return _mm256_add_epi8(c, shift);
+}
+
+WORKERD_TARGET_SSSE3 DecodedPrefix decodeHexSsse3(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize) {
+  // Multiplying each pair of nibbles by (16, 1) and adding gives the byte as a 16-bit lane.
+  auto weights = _mm_set1_epi16(0x0110);
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 32 && outSize - k >= 16; i += 32, k += 16) {
+    __m128i valid0, valid1;
+    auto values0 = hexValues(_mm_loadu_si128(loadAddress(in + i)), valid0);
+    auto values1 = hexValues(_mm_loadu_si128(loadAddress(in + i + 16)), valid1);
+    if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff) break;
+    _mm_storeu_si128(storeAddress(out + k), _mm_packus_epi16(
+        _mm_maddubs_epi16(values0, weights), _mm_maddubs_epi16(values1, weights)));
+  }
+  return { i, k };
+}
+
+WORKERD_TARGET_AVX2 DecodedPrefix decodeHexAvx2(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize) {
+  auto weights = _mm256_set1_epi16(0x0110);
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 64 && outSize - k >= 32; i += 64, k += 32) {
+    __m256i valid0, valid1;
+    auto values0 = hexValues(_mm256_loadu_si256(loadAddress256(in + i)), valid0);
+    auto values1 = hexValues(_mm256_loadu_si256(loadAddress256(in + i + 32)), valid1);
+    if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) break;
+    // The pack works within 128-bit lanes, leaving the 64-bit quarters out of order.
+    auto packed = _mm256_packus_epi16(
+        _mm256_maddubs_epi16(values0, weights), _mm256_maddubs_epi16(values1, weights));
+    _mm256_storeu_si256(storeAddress256(out + k), _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+  return { i, k };
+}
+
+DecodedPrefix decodeHexSimd(const char* in, size_t inSize, kj::byte* out, size_t outSize) {
+  DecodedPrefix result = { 0, 0 };
+  switch (getSimdLevel()) {
+    case SimdLevel::AVX2:
+      result = decodeHexAvx2(in, inSize, out, outSize);
+      [[fallthrough]];
+    case SimdLevel::SSSE3: {
+      auto more = decodeHexSsse3(in + result.consumed, inSize - result.consumed,
+          out + result.written, outSize - result.written);
+      result.consumed += more.consumed;
+      result.written += more.written;
+      break;
+    }
+    case SimdLevel::NONE:
+      break;
+  }
+  return result;
+}
+
+// =======================================================================================
+// ARM64: NEON
+//
+// The structured loads and stores (vld3/vst4 and friends) do the (de)interleaving for us, so each
+// lane only ever deals with one position within a group.
+
+#elif WORKERD_BASE64_NEON
+
+size_t encodeBase64Simd(const kj::byte* in, size_t size, char* out, Base64Alphabet alphabet) {
+  auto chars = reinterpret_cast<const uint8_t*>(alphabetChars(alphabet));
+  uint8x16x4_t table;
+  for (auto i: kj::zeroTo(4)) table.val[i] = vld1q_u8(chars + i * 16);
+  auto mask = vdupq_n_u8(0x3f);
+
+  size_t done = 0;
+  for (; size - done >= 48; done += 48) {
+    auto bytes = vld3q_u8(in + done);
+    uint8x16x4_t result;
+    result.val[0] = vqtbl4q_u8(table, vshrq_n_u8(bytes.val[0], 2));
+    result.val[1] = vqtbl4q_u8(table, vandq_u8(
+        vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), mask));
+    result.val[2] = vqtbl4q_u8(table, vandq_u8(
+        vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), mask));
+    result.val[3] = vqtbl4q_u8(table, vandq_u8(bytes.val[2], mask));
+    vst4q_u8(reinterpret_cast<uint8_t*>(out + done / 3 * 4), result);
+  }
+  return done;
+}
+
+// Lanes where `c` is in [lo, lo + count) are set to 0xff.
+inline uint8x16_t inRange(uint8x16_t c, char lo, int count) {
+  return vcltq_u8(vsubq_u8(c, vdupq_n_u8(lo)), vdupq_n_u8(count));
+}
+
+inline uint8x16_t select(uint8x16_t mask, int value) {
+  return vandq_u8(mask, vdupq_n_u8(static_cast<uint8_t>(value)));
+}
+
+// Converts base64 characters to their 6-bit values. Lanes of `invalid` are set where the
+// character isn't in the alphabet.
+inline uint8x16_t base64Values(uint8x16_t c, bool acceptUrlAlphabet, uint8x16_t& invalid) {
+  auto upper = inRange(c, 'A', 26);
+  auto lower = inRange(c, 'a', 26);
+  auto digit = inRange(c, '0', 10);
+  auto plus = vceqq_u8(c, vdupq_n_u8('+'));
+  auto slash = vceqq_u8(c, vdupq_n_u8('/'));
+  auto valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash)));
+  auto shift = vorrq_u8(vorrq_u8(select(upper, -'A'), select(lower, 26 - 'a')),
+      vorrq_u8(select(digit, 52 - '0'), vorrq_u8(select(plus, 62 - '+'), select(slash, 63 - '/'))));
+  if (acceptUrlAlphabet) {
+    auto dash = vceqq_u8(c, vdupq_n_u8('-'));
+    auto underscore = vceqq_u8(c, vdupq_n_u8('_'));
+    valid = vorrq_u8(valid, vorrq_u8(dash, underscore));
+    shift = vorrq_u8(shift, vorrq_u8(select(dash, 62 - '-'), select(underscore, 63 - '_')));
+  }
+  invalid = vorrq_u8(invalid, vmvnq_u8(valid));
+  return vaddq_u8(c, shift);
+}
+
+DecodedPrefix decodeBase64Simd(
+    const char* in, size_t inSize, kj::byte* out, size_t outSize, bool acceptUrlAlphabet) {
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 64 && outSize - k >= 48; i += 64, k += 48) {
+    auto chars = vld4q_u8(reinterpret_cast<const uint8_t*>(in + i));
+    auto invalid = vdupq_n_u8(0);
+    auto a = base64Values(chars.val[0], acceptUrlAlphabet, invalid);
+    auto b = base64Values(chars.val[1], acceptUrlAlphabet, invalid);
+    auto c = base64Values(chars.val[2], acceptUrlAlphabet, invalid);
+    auto d = base64Values(chars.val[3], acceptUrlAlphabet, invalid);
+    if (vmaxvq_u8(invalid) != 0) break;
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(out + k, bytes);
+  }
+  return { i, k };
+}
+
+size_t encodeHexSimd(const kj::byte* in, size_t size, char* out) {
+  auto digits = vld1q_u8(reinterpret_cast<const uint8_t*>(HEX_DIGITS));
+  size_t done = 0;
+  for (; size - done >= 16; done += 16) {
+    auto bytes = vld1q_u8(in + done);
+    uint8x16x2_t chars;
+    chars.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4));
+    chars.val[1] = vqtbl1q_u8(digits, vandq_u8(bytes, vdupq_n_u8(0x0f)));
+    vst2q_u8(reinterpret_cast<uint8_t*>(out + done * 2), chars);
+  }
+  return done;
+}
+
+inline uint8x16_t hexValues(uint8x16_t c, uint8x16_t& invalid) {
+  auto digit = inRange(c, '0', 10);
+  auto lower = inRange(c, 'a', 6);
+  auto upper = inRange(c, 'A', 6);
+  invalid = vorrq_u8(invalid, vmvnq_u8(vorrq_u8(digit, vorrq_u8(lower, upper))));
+  auto shift = vorrq_u8(select(digit, -'0'),
+      vorrq_u8(select(lower, 10 - 'a'), select(upper, 10 - 'A')));
+  return vaddq_u8(c, shift);
+}
+
+DecodedPrefix decodeHexSimd(const char* in, size_t inSize, kj::byte* out, size_t outSize) {
+  size_t i = 0, k = 0;
+  for (; inSize - i >= 32 && outSize - k >= 16; i += 32, k += 16) {
+    auto chars = vld2q_u8(reinterpret_cast<const uint8_t*>(in + i));
+    auto invalid = vdupq_n_u8(0);
+    auto hi = hexValues(chars.val[0], invalid);
+    auto lo = hexValues(chars.val[1], invalid);
+    if (vmaxvq_u8(invalid) != 0) break;
+    vst1q_u8(out + k, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+  }
+  return { i, k };
+}
+
+// =======================================================================================
+// Everything else: the scalar code below does all the work.
+
+#else
+
+size_t encodeBase64Simd(const kj::byte*, size_t, char*, Base64Alphabet) { return 0; }
+DecodedPrefix decodeBase64Simd(const char*, size_t, kj::byte*, size_t, bool) { return { 0, 0 }; }
+size_t encodeHexSimd(const kj::byte*, size_t, char*) { return 0; }
+DecodedPrefix decodeHexSimd(const char*, size_t, kj::byte*, size_t) { return { 0, 0 }; }
+
+#endif
+
+}  // namespace
+
+void encodeBase64Into(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output,
+                      Base64Alphabet alphabet) {
+  KJ_REQUIRE(output.size() == base64EncodedSize(input.size(), alphabet),
+      "wrong output size for base64", input.size(), output.size());
+
+  auto in = input.begin();
+  auto out = output.begin();
+  size_t remaining = input.size();
+
+  size_t done = encodeBase64Simd(in, remaining, out, alphabet);
+  in += done;
+  out += done / 3 * 4;
+  remaining -= done;
+
+  auto chars = alphabetChars(alphabet);
+  for (; remaining >= 3; in += 3, out += 4, remaining -= 3) {
+    out[0] = chars[in[0] >> 2];
+    out[1] = chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+    out[2] = chars[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+    out[3] = chars[in[2] & 0x3f];
+  }
+
+  bool pad = alphabet == Base64Alphabet::STANDARD;
+  if (remaining == 1) {
+    out[0] = chars[in[0] >> 2];
+    out[1] = chars[(in[0] & 0x03) << 4];
+    if (pad) {
+      out[2] = '=';
+      out[3] = '=';
+    }
+  } else if (remaining == 2) {
+    out[0] = chars[in[0] >> 2];
+    out[1] = chars[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+    out[2] = chars[(in[1] & 0x0f) << 2];
+    if (pad) {
+      out[3] = '=';
+    }
+  }
+}
+
+kj::String fastEncodeBase64(kj::ArrayPtr<const kj::byte> input, Base64Alphabet alphabet) {
+  auto result = kj::heapString(base64EncodedSize(input.size(), alphabet));
+  encodeBase64Into(input, kj::arrayPtr(result.begin(), result.size()), alphabet);
+  return result;
+}
+
+DecodedPrefix decodeBase64Prefix(kj::ArrayPtr<const char> input, kj::ArrayPtr<kj::byte> output,
+                                 bool acceptUrlAlphabet) {
+  auto in = input.begin();
+  auto out = output.begin();
+  auto result = decodeBase64Simd(in, input.size(), out, output.size(), acceptUrlAlphabet);
+  size_t i = result.consumed, k = result.written;
+
+  auto& table = acceptUrlAlphabet ? EITHER_DECODE_TABLE : STANDARD_DECODE_TABLE;
+  for (; input.size() - i >= 4 && output.size() - k >= 3; i += 4, k += 3) {
+    uint a = table.values[static_cast<kj::byte>(in[i])];
+    uint b = table.values[static_cast<kj::byte>(in[i + 1])];
+    uint c = table.values[static_cast<kj::byte>(in[i + 2])];
+    uint d = table.values[static_cast<kj::byte>(in[i + 3])];
+    if ((a | b | c | d) & 0x80) break;
+    uint group = (a << 18) | (b << 12) | (c << 6) | d;
+    out[k] = group >> 16;
+    out[k + 1] = group >> 8;
+    out[k + 2] = group;
+  }
+  return { i, k };
+}
+
+kj::EncodingResult<kj::Array<kj::byte>> fastDecodeBase64(kj::ArrayPtr<const char> input) {
+  // Enough for the prefix plus whatever kj decodes from the rest.
+  auto output = kj::heapArray<kj::byte>((input.size() * 3 + 3) / 4);
+  auto prefix = decodeBase64Prefix(input, output);
+  size_t size = prefix.written;
+  bool hadErrors = false;
+
+  if (prefix.consumed < input.size()) {
+    // We stopped at padding, whitespace or an invalid character. The prefix ended on a group
+    // boundary, so kj's decoder can pick up from there as though it had decoded the prefix itself,
+    // and will flag exactly the errors it would have flagged for the whole input.
+    auto rest = kj::decodeBase64(input.slice(prefix.consumed, input.size()));
+    output.slice(size, size + rest.size()).copyFrom(rest.asPtr());
+    size += rest.size();
+    hadErrors = rest.hadErrors;
+  }
+
+  if (size < output.size()) {
+    auto trimmed = output.first(size).attach(kj::mv(output));
+    return kj::EncodingResult<kj::Array<kj::byte>>(kj::mv(trimmed), hadErrors);
+  }
+  return kj::EncodingResult<kj::Array<kj::byte>>(kj::mv(output), hadErrors);
+}
+
+void encodeHexInto(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output) {
+  KJ_REQUIRE(output.size() == hexEncodedSize(input.size()),
+      "wrong output size for hex", input.size(), output.size());
+
+  size_t done = encodeHexSimd(input.begin(), input.size(), output.begin());
+  for (size_t i = done; i < input.size(); i++) {
+    output[i * 2] = HEX_DIGITS[input[i] >> 4];
+    output[i * 2 + 1] = HEX_DIGITS[input[i] & 0x0f];
+  }
+}
+
+kj::String fastEncodeHex(kj::ArrayPtr<const kj::byte> input) {
+  auto result = kj::heapString(hexEncodedSize(input.size()));
+  encodeHexInto(input, kj::arrayPtr(result.begin(), result.size()));
+  return result;
+}
+
+DecodedPrefix decodeHexPrefix(kj::ArrayPtr<const char> input, kj::ArrayPtr<kj::byte> output) {
+  auto result = decodeHexSimd(input.begin(), input.size(), output.begin(), output.size());
+  size_t i = result.consumed, k = result.written;
+  for (; input.size() - i >= 2 && k < output.size(); i += 2, k++) {
+    int hi = hexValue(input[i]);
+    int lo = hexValue(input[i + 1]);
+    if (hi < 0 || lo < 0) break;
+    output[k] = (hi << 4) | lo;
+  }
+  return { i, k };
+}
+
+}  // namespace workerd
@@ -0,0 +1,74 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+#include <kj/encoding.h>
+#include <kj/string.h>
+
+namespace workerd {
+
+// Base64 and hex codecs for the places where we encode or decode bulk data: atob() and btoa(),
+// Node's Buffer, and Queue message bodies. Output is identical to kj::encodeBase64(),
+// kj::encodeBase64Url() and kj::encodeHex(), but the bulk of the work is done 12 to 48 bytes at a
+// time using SSSE3 or AVX2 (chosen at runtime) on x86, or NEON on ARM64, with a scalar fallback
+// elsewhere. The *Into() variants write into a caller-provided buffer, so that the encoded data
+// can be placed directly where it's needed.
+
+enum class Base64Alphabet {
+  STANDARD,  // '+' and '/', padded with '=' to a multiple of four characters.
+  URL,       // '-' and '_', unpadded, like kj::encodeBase64Url() and Node's "base64url".
+};
+
+constexpr size_t base64EncodedSize(size_t size,
+                                   Base64Alphabet alphabet = Base64Alphabet::STANDARD) {
+  if (alphabet == Base64Alphabet::STANDARD) {
+    return (size + 2) / 3 * 4;
+  } else {
+    return size / 3 * 4 + (size % 3 == 0 ? 0 : size % 3 + 1);
+  }
+}
+
+// Writes the base64 encoding of `input` to `output`, which must be exactly
+// base64EncodedSize(input.size(), alphabet) characters long.
+void encodeBase64Into(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output,
+                      Base64Alphabet alphabet = Base64Alphabet::STANDARD);
+
+// Equivalent to kj::encodeBase64() (without line breaks) or kj::encodeBase64Url().
+kj::String fastEncodeBase64(kj::ArrayPtr<const kj::byte> input,
+                            Base64Alphabet alphabet = Base64Alphabet::STANDARD);
+
+struct DecodedPrefix {
+  size_t consumed;  // characters of input
+  size_t written;   // bytes of output
+};
+
+// Decodes the longest prefix of `input` made of whole four-character groups of alphabet
+// characters, stopping early once `output` has no room for another three bytes. Padding,
+// whitespace and invalid characters are left to the caller, since callers disagree on what to do
+// with them (atob() rejects what Node's Buffer silently skips). Because the prefix ends on a group
+// boundary, the caller can decode the rest of the input on its own and append the result.
+//
+// If `acceptUrlAlphabet` is true, '-' and '_' are accepted alongside '+' and '/'.
+DecodedPrefix decodeBase64Prefix(kj::ArrayPtr<const char> input, kj::ArrayPtr<kj::byte> output,
+                                 bool acceptUrlAlphabet = false);
+
+// Equivalent to kj::decodeBase64(), including which inputs set `hadErrors`.
+kj::EncodingResult<kj::Array<kj::byte>> fastDecodeBase64(kj::ArrayPtr<const char> input);
+
+constexpr size_t hexEncodedSize(size_t size) { return size * 2; }
+
+// Writes the lower-case hex encoding of `input` to `output`, which must be exactly
+// hexEncodedSize(input.size()) characters long.
+void encodeHexInto(kj::ArrayPtr<const kj::byte> input, kj::ArrayPtr<char> output);
+
+// Equivalent to kj::encodeHex().
+kj::String fastEncodeHex(kj::ArrayPtr<const kj::byte> input);
+
+// Decodes the longest prefix of `input` made of pairs of hex digits (in either case), stopping
+// early if `output` is full. A trailing odd character is never consumed.
+DecodedPrefix decodeHexPrefix(kj::ArrayPtr<const char> input, kj::ArrayPtr<kj::byte> output);
+
+}  // namespace workerd
@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "batcher.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// Records each batch it's asked to deliver, and completes deliveries only when told to.
+struct Deliveries {
+  kj::Vector<kj::String> batches;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> pending;
+
+  Batcher<kj::String>::DeliverFunc func() {
+    return [this](kj::Array<kj::String> batch) -> kj::Promise<void> {
+      batches.add(kj::strArray(batch, ","));
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pending.add(kj::mv(paf.fulfiller));
+      return kj::mv(paf.promise);
+    };
+  }
+
+  void completeAll() {
+    for (auto& fulfiller: pending) fulfiller->fulfill();
+    pending.clear();
+  }
+};
+
+size_t stringSize(const kj::String& item) {
+  return item.size();
+}
+
+KJ_TEST("Batcher splits batches at the byte limit") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  Batcher<kj::String> batcher(timer, { .maxBatchBytes = 4, .maxConcurrentBatches = 4 },
+                              deliveries.func(), stringSize);
+
+  // "ab" and "cd" make a full batch on their own. "efghij" is over the limit, so it goes out
+  // alone rather than waiting for company.
+  batcher.add(kj::str("ab"));
+  KJ_EXPECT(deliveries.batches.size() == 0);
+  batcher.add(kj::str("cd"));
+  batcher.add(kj::str("efghij"));
+  KJ_ASSERT(deliveries.batches.size() == 2);
+  KJ_EXPECT(deliveries.batches[0] == "ab,cd");
+  KJ_EXPECT(deliveries.batches[1] == "efghij");
+
+  // A batch that would go over the limit is cut short, and the rest waits for the delay.
+  batcher.add(kj::str("kl"));
+  batcher.add(kj::str("mno"));
+  KJ_ASSERT(deliveries.batches.size() == 3);
+  KJ_EXPECT(deliveries.batches[2] == "kl");
+  timer.advanceTo(timer.now() + 1 * kj::SECONDS);
+  ws.poll();
+  KJ_ASSERT(deliveries.batches.size() == 4);
+  KJ_EXPECT(deliveries.batches[3] == "mno");
+
+  deliveries.completeAll();
+  batcher.flush().wait(ws);
+  KJ_EXPECT(batcher.getStats().batchesDelivered == 4);
+  KJ_EXPECT(batcher.getStats().itemsDelivered == 5);
+}
+
+KJ_TEST("Batcher accepts an oversized item only when nothing else is buffered") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  Deliveries deliveries;
+  Batcher<kj::String> batcher(timer, { .maxBatchItems = 1, .maxBufferedBytes = 4 },
+                              deliveries.func(), stringSize);
+
+  KJ_EXPECT(batcher.add(kj::str("abcdefgh")));
+  KJ_EXPECT(!batcher.add(kj::str("i")));
+  KJ_EXPECT(batcher.getStats().itemsDropped == 1);
+
+  deliveries.completeAll();
+  ws.poll();
+  KJ_EXPECT(batcher.add(kj::str("jk")));
+  KJ_EXPECT(batcher.add(kj::str("lm")));
+  KJ_EXPECT(!batcher.add(kj::str("n")));
+  KJ_EXPECT(batcher.getStats().itemsAdded == 3);
+  KJ_EXPECT(batcher.getStats().batchesInFlight == 1);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,251 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/debug.h>
+#include <kj/function.h>
+#include <kj/timer.h>
+#include <kj/vector.h>
+
+namespace workerd {
+
+using kj::uint;
+
+struct BatcherOptions {
+  // A batch is delivered as soon as this many items, or this many bytes, are waiting...
+  size_t maxBatchItems = 100;
+  size_t maxBatchBytes = kj::maxValue;
+
+  // ...or once the oldest waiting item has waited this long.
+  kj::Duration maxDelay = 1 * kj::SECONDS;
+
+  // Items that are waiting or being delivered count against these limits. Once either is
+  // reached, add() drops new items until a delivery finishes. An item larger than
+  // `maxBufferedBytes` is still accepted if nothing else is buffered.
+  size_t maxBufferedItems = kj::maxValue;
+  size_t maxBufferedBytes = kj::maxValue;
+
+  // Batches beyond this many in flight wait for an earlier one to finish.
+  uint maxConcurrentBatches = 1;
+};
+
+struct BatcherStats {
+  // Items accepted by add(), and items it rejected because the buffer limits were reached.
+  uint64_t itemsAdded = 0;
+  uint64_t itemsDropped = 0;
+
+  uint64_t batchesDelivered = 0;
+  uint64_t itemsDelivered = 0;
+
+  // Batches whose delivery threw, and the items in them.
+  uint64_t batchesFailed = 0;
+  uint64_t itemsFailed = 0;
+
+  // Batches currently being delivered.
+  uint batchesInFlight = 0;
+};
+
+// Buffers items and hands them to a delivery function in batches, so that the destination sees
+// one call per batch rather than one per item. This is the common core of TraceBatcher,
+// SpanExporter, and EventBatcher, which differ only in what they batch and how a batch is
+// delivered.
+//
+// A batch never holds more than `maxBatchItems` items, nor more than `maxBatchBytes` bytes
+// unless it's a single item larger than that. Delivery starts synchronously from add() or
+// flush(); a delivery function that must not run on the caller's stack should defer itself.
+//
+// Not thread-safe; belongs to the thread whose event loop delivers the batches.
+template <typename T>
+class Batcher final: private kj::TaskSet::ErrorHandler {
+public:
+  using DeliverFunc = kj::Function<kj::Promise<void>(kj::Array<T> batch)>;
+
+  // Returns the number of bytes an item counts for.
+  using SizeFunc = kj::Function<size_t(const T& item)>;
+
+  Batcher(kj::Timer& timer, BatcherOptions options, DeliverFunc deliver, SizeFunc sizeOf);
+  KJ_DISALLOW_COPY_AND_MOVE(Batcher);
+
+  // Queues an item for delivery. Returns false if it was dropped instead.
+  bool add(T item);
+
+  // Starts delivering everything that is waiting without waiting for a full batch, and returns a
+  // promise that resolves once nothing is waiting or in flight. Failed deliveries are counted in
+  // the stats rather than propagated.
+  kj::Promise<void> flush();
+
+  const BatcherStats& getStats() const { return stats; }
+
+private:
+  struct Item {
+    T value;
+    size_t size;
+  };
+
+  kj::Timer& timer;
+  BatcherOptions options;
+  DeliverFunc deliver;
+  SizeFunc sizeOf;
+  BatcherStats stats;
+
+  kj::Vector<Item> waiting;
+  size_t waitingBytes = 0;
+  size_t bufferedItems = 0;  // Waiting plus in flight.
+  size_t bufferedBytes = 0;
+
+  // Set once the oldest waiting item has waited `maxDelay`, or flush() was called, so that
+  // whatever is waiting should go out without waiting for a full batch.
+  bool partialBatchDue = false;
+
+  bool timerArmed = false;
+  kj::Canceler timerCanceler;
+
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> flushWaiters;
+
+  // Declared last so that in-flight deliveries are canceled before anything they refer to is
+  // destroyed.
+  kj::TaskSet tasks;
+
+  bool hasFullBatch() const {
+    return waiting.size() >= options.maxBatchItems || waitingBytes >= options.maxBatchBytes;
+  }
+
+  void startDeliveries();
+  void deliverBatch();
+  void armTimer();
+  void disarmTimer();
+  void taskFailed(kj::Exception&& exception) override;
+};
+
+// =======================================================================================
+// inline implementation details
+
+template <typename T>
+Batcher<T>::Batcher(kj::Timer& timer, BatcherOptions options, DeliverFunc deliver,
+                    SizeFunc sizeOf)
+    : timer(timer), options(options), deliver(kj::mv(deliver)), sizeOf(kj::mv(sizeOf)),
+      tasks(*this) {
+  KJ_REQUIRE(options.maxBatchItems > 0);
+  KJ_REQUIRE(options.maxConcurrentBatches > 0);
+}
+
+template <typename T>
+bool Batcher<T>::add(T item) {
+  auto size = sizeOf(item);
+  if (bufferedItems >= options.maxBufferedItems ||
+      (bufferedItems > 0 && bufferedBytes + size > options.maxBufferedBytes)) {
+    ++stats.itemsDropped;
+    return false;
+  }
+
+  ++stats.itemsAdded;
+  ++bufferedItems;
+  bufferedBytes += size;
+  waitingBytes += size;
+  waiting.add(Item { kj::mv(item), size });
+  startDeliveries();
+  return true;
+}
+
+template <typename T>
+kj::Promise<void> Batcher<T>::flush() {
+  if (waiting.empty() && stats.batchesInFlight == 0) return kj::READY_NOW;
+
+  partialBatchDue = true;
+  startDeliveries();
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  flushWaiters.add(kj::mv(paf.fulfiller));
+  return kj::mv(paf.promise);
+}
+
+template <typename T>
+void Batcher<T>::startDeliveries() {
+  while (!waiting.empty() && stats.batchesInFlight < options.maxConcurrentBatches &&
+         (hasFullBatch() || partialBatchDue)) {
+    deliverBatch();
+  }
+
+  if (waiting.empty()) {
+    partialBatchDue = false;
+    disarmTimer();
+  } else if (!partialBatchDue) {
+    armTimer();
+  }
+}
+
+template <typename T>
+void Batcher<T>::deliverBatch() {
+  // Take the longest prefix that fits, but always at least one item.
+  size_t count = 0;
+  size_t bytes = 0;
+  while (count < waiting.size() && count < options.maxBatchItems &&
+         (count == 0 || bytes + waiting[count].size <= options.maxBatchBytes)) {
+    bytes += waiting[count++].size;
+  }
+
+  auto builder = kj::heapArrayBuilder<T>(count);
+  kj::Vector<Item> rest(waiting.size() - count);
+  for (auto i: kj::indices(waiting)) {
+    if (i < count) {
+      builder.add(kj::mv(waiting[i].value));
+    } else {
+      rest.add(kj::mv(waiting[i]));
+    }
+  }
+  waiting = kj::mv(rest);
+  waitingBytes -= bytes;
+
+  ++stats.batchesInFlight;
+  tasks.add(kj::evalNow([&]() { return deliver(builder.finish()); })
+      .then([this, count]() {
+    ++stats.batchesDelivered;
+    stats.itemsDelivered += count;
+  }, [this, count](kj::Exception&&) {
+    ++stats.batchesFailed;
+    stats.itemsFailed += count;
+  }).then([this, count, bytes]() {
+    --stats.batchesInFlight;
+    bufferedItems -= count;
+    bufferedBytes -= bytes;
+    startDeliveries();
+
+    if (waiting.empty() && stats.batchesInFlight == 0) {
+      for (auto& fulfiller: flushWaiters) {
+        fulfiller->fulfill();
+      }
+      flushWaiters.clear();
+    }
+  }));
+}
+
+template <typename T>
+void Batcher<T>::armTimer() {
+  if (timerArmed) return;
+  timerArmed = true;
+  tasks.add(timerCanceler.wrap(timer.afterDelay(options.maxDelay)).then([this]() {
+    timerArmed = false;
+    partialBatchDue = true;
+    startDeliveries();
+  }, [](kj::Exception&&) {
+    // Canceled because the waiting items went out with a full batch.
+  }));
+}
+
+template <typename T>
+void Batcher<T>::disarmTimer() {
+  if (!timerArmed) return;
+  timerArmed = false;
+  timerCanceler.cancel("batch already delivered");
+}
+
+template <typename T>
+void Batcher<T>::taskFailed(kj::Exception&& exception) {
+  // Both delivery and timer failures are handled where they happen, so this is unreachable in
+  // practice.
+  KJ_LOG(ERROR, "batcher task failed", exception);
+}
+
+}  // namespace workerd
@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cpu-watchdog.h"
+#include <kj/test.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace workerd {
+namespace {
+
+// Burns CPU until `done` is set or `limit` of CPU time has passed.
+void spin(std::atomic<bool>& done, kj::Duration limit) {
+  auto start = CpuWatchdog::threadCpuTime();
+  while (!done.load(std::memory_order_relaxed)) {
+    if (CpuWatchdog::threadCpuTime() - start > limit) break;
+  }
+}
+
+KJ_TEST("CpuWatchdog interrupts a thread that runs out of CPU time") {
+  CpuWatchdog watchdog;
+  std::atomic<bool> done = false;
+
+  auto watch = watchdog.watch(20 * kj::MILLISECONDS, [&]() {
+    done.store(true, std::memory_order_relaxed);
+  });
+  spin(done, 10 * kj::SECONDS);
+
+  KJ_EXPECT(done.load());
+  KJ_EXPECT(watch->isExpired());
+  KJ_EXPECT(watch->getCpuTime() >= 20 * kj::MILLISECONDS);
+}
+
+KJ_TEST("CpuWatchdog doesn't count time the thread spends idle") {
+  CpuWatchdog watchdog;
+  std::atomic<bool> expired = false;
+
+  auto watch = watchdog.watch(50 * kj::MILLISECONDS, [&]() {
+    expired.store(true, std::memory_order_relaxed);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Elsewhere, the watchdog can't see another thread's CPU time, so it goes by wall time.
+#if __linux__
+  KJ_EXPECT(!expired.load());
+  KJ_EXPECT(!watch->isExpired());
+#endif
+}
+
+KJ_TEST("CpuWatchdog doesn't fire after the watch is dropped") {
+  CpuWatchdog watchdog;
+  std::atomic<bool> expired = false;
+
+  {
+    auto watch = watchdog.watch(10 * kj::MILLISECONDS, [&]() {
+      expired.store(true, std::memory_order_relaxed);
+    });
+  }
+
+  std::atomic<bool> never = false;
+  spin(never, 50 * kj::MILLISECONDS);
+  KJ_EXPECT(!expired.load());
+}
+
+}  // namespace
+}  // namespace workerd
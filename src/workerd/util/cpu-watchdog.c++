@@ -0,0 +1,161 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cpu-watchdog.h"
+#include <kj/debug.h>
+
+#if _WIN32
+#include <kj/win32-api-version.h>
+#include <windows.h>
+#include <kj/windows-sanity.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+#if !_WIN32
+kj::Duration toDuration(const struct timespec& ts) {
+  return ts.tv_sec * kj::SECONDS + ts.tv_nsec * kj::NANOSECONDS;
+}
+#endif
+
+}  // namespace
+
+CpuWatchdog::CpuWatchdog()
+    : thread(kj::heap<kj::Thread>([this]() { threadMain(); })) {}
+
+CpuWatchdog::~CpuWatchdog() noexcept(false) {
+  {
+    auto lock = state.lockExclusive();
+    KJ_ASSERT(lock->watches.empty(), "CpuWatchdog destroyed while threads are being watched");
+    lock->shuttingDown = true;
+  }
+
+  // Joins the thread.
+  thread = nullptr;
+}
+
+kj::Own<CpuWatchdog::Watch> CpuWatchdog::watch(
+    kj::Duration budget, kj::Function<void()> onExpired) const {
+  return kj::heap<Watch>(*this, budget, kj::mv(onExpired));
+}
+
+kj::Duration CpuWatchdog::threadCpuTime() {
+#if _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  KJ_WIN32(GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime));
+  auto toTicks = [](const FILETIME& ft) {
+    return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+  };
+  // FILETIME counts 100-nanosecond ticks.
+  return (toTicks(kernelTime) + toTicks(userTime)) * 100 * kj::NANOSECONDS;
+#else
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts));
+  return toDuration(ts);
+#endif
+}
+
+void CpuWatchdog::threadMain() const {
+  uint64_t seenGeneration = 0;
+  kj::Maybe<kj::Duration> sleep;
+  for (;;) {
+    bool running = state.when([&](const State& s) {
+      return s.shuttingDown || s.generation != seenGeneration;
+    }, [&](State& s) {
+      // We get here either because a watch was added or because the sleep timed out. Either way,
+      // look at all the watches, since that's cheap.
+      seenGeneration = s.generation;
+      sleep = checkWatches(s);
+      return !s.shuttingDown;
+    }, sleep);
+
+    if (!running) return;
+  }
+}
+
+kj::Maybe<kj::Duration> CpuWatchdog::checkWatches(State& s) const {
+  auto now = kj::systemPreciseMonotonicClock().now();
+  kj::Maybe<kj::Duration> result;
+
+  for (auto watch: s.watches) {
+    if (watch->expired) continue;
+
+    if (now >= watch->deadline) {
+      KJ_IF_SOME(cpuTime, watch->getCpuTimeFromOtherThread()) {
+        if (cpuTime < watch->budget) {
+          // The thread wasn't running the whole time. It can't run out of budget any sooner than
+          // if it runs continuously from now on.
+          watch->deadline = now + (watch->budget - cpuTime);
+        }
+      }
+
+      if (now >= watch->deadline) {
+        watch->expired = true;
+        watch->onExpired();
+        continue;
+      }
+    }
+
+    auto remaining = watch->deadline - now;
+    KJ_IF_SOME(r, result) {
+      result = kj::min(r, remaining);
+    } else {
+      result = remaining;
+    }
+  }
+
+  return result;
+}
+
+CpuWatchdog::Watch::Watch(
+    const CpuWatchdog& watchdog, kj::Duration budget, kj::Function<void()> onExpired)
+    : watchdog(watchdog), budget(budget), cpuStart(threadCpuTime()),
+      onExpired(kj::mv(onExpired)) {
+#if __linux__
+  KJ_REQUIRE(pthread_getcpuclockid(pthread_self(), &cpuClock) == 0);
+#endif
+
+  // CPU time can't pass faster than wall time, so this is the earliest the budget could run out.
+  deadline = kj::systemPreciseMonotonicClock().now() + budget;
+
+  auto lock = watchdog.state.lockExclusive();
+  lock->watches.add(this);
+  ++lock->generation;
+}
+
+CpuWatchdog::Watch::~Watch() noexcept(false) {
+  // Once we hold the lock, `onExpired` can't be running, and after we remove ourselves it can't
+  // start.
+  auto lock = watchdog.state.lockExclusive();
+  auto& watches = lock->watches;
+  for (auto i: kj::indices(watches)) {
+    if (watches[i] == this) {
+      watches[i] = watches.back();
+      watches.removeLast();
+      break;
+    }
+  }
+}
+
+bool CpuWatchdog::Watch::isExpired() const {
+  auto lock = watchdog.state.lockExclusive();
+  return expired;
+}
+
+kj::Maybe<kj::Duration> CpuWatchdog::Watch::getCpuTimeFromOtherThread() const {
+#if __linux__
+  struct timespec ts;
+  if (clock_gettime(cpuClock, &ts) == 0) {
+    return toDuration(ts) - cpuStart;
+  }
+#endif
+  return kj::none;
+}
+
+}  // namespace workerd
@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/function.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <kj/time.h>
+#include <kj/vector.h>
+
+#if __linux__
+#include <time.h>
+#endif
+
+namespace workerd {
+
+// Runs a background thread which notices when some other thread has spent too much CPU time in a
+// stretch of code, such as a call into JavaScript, and invokes a callback which can interrupt it
+// (e.g. `v8::Isolate::TerminateExecution()`). This is how runaway code gets stopped: the thread
+// running it is, by definition, too busy to check for itself.
+//
+// The watchdog sleeps until the earliest point at which a watched thread could possibly have
+// used up its budget, based on wall time. On Linux it then checks the thread's actual CPU time,
+// and goes back to sleep if the thread was descheduled for part of that time. Elsewhere, wall
+// time stands in for CPU time, which is never less.
+class CpuWatchdog {
+public:
+  CpuWatchdog();
+  ~CpuWatchdog() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(CpuWatchdog);
+
+  class Watch;
+
+  // Starts watching the calling thread, until the returned Watch is dropped. If the thread spends
+  // `budget` of CPU time before then, `onExpired` is called. It runs on the watchdog's thread, so
+  // it must be thread-safe. It is called at most once, and never after the Watch is destroyed.
+  kj::Own<Watch> watch(kj::Duration budget, kj::Function<void()> onExpired) const;
+
+  // CPU time consumed so far by the calling thread.
+  static kj::Duration threadCpuTime();
+
+private:
+  struct State {
+    kj::Vector<Watch*> watches;
+
+    // Incremented when a watch is added, to wake the watchdog thread.
+    uint64_t generation = 0;
+
+    bool shuttingDown = false;
+  };
+
+  kj::MutexGuarded<State> state;
+  kj::Own<kj::Thread> thread;
+
+  void threadMain() const;
+
+  // Fires expired watches, returning how long to sleep until the next one could expire.
+  kj::Maybe<kj::Duration> checkWatches(State& state) const;
+};
+
+class CpuWatchdog::Watch {
+public:
+  Watch(const CpuWatchdog& watchdog, kj::Duration budget, kj::Function<void()> onExpired);
+  ~Watch() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(Watch);
+
+  // Whether `onExpired` has been called.
+  bool isExpired() const;
+
+  // CPU time the watched thread has spent since the watch started. Must be called on the watched
+  // thread.
+  kj::Duration getCpuTime() const { return threadCpuTime() - cpuStart; }
+
+private:
+  const CpuWatchdog& watchdog;
+  kj::Duration budget;
+  kj::Duration cpuStart;
+  kj::Function<void()> onExpired;
+
+#if __linux__
+  // Lets the watchdog thread read the watched thread's CPU time.
+  clockid_t cpuClock;
+#endif
+
+  // Protected by the watchdog's mutex.
+  kj::TimePoint deadline;
+  bool expired = false;
+
+  // Returns the CPU time the watched thread has spent since the watch started, or kj::none if
+  // that can't be measured from another thread. Called on the watchdog thread.
+  kj::Maybe<kj::Duration> getCpuTimeFromOtherThread() const;
+
+  friend class CpuWatchdog;
+};
+
+}  // namespace workerd
@@ -0,0 +1,149 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "event-batcher.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// Records each batch sent. Sends complete when `release()` is called, in order.
+struct MockDestination {
+  kj::Vector<kj::String> batches;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> pending;
+
+  EventBatcher::SendFunc sender() {
+    return [this](kj::Array<kj::byte> body, uint count) {
+      batches.add(kj::str(body.asChars()));
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      pending.add(kj::mv(paf.fulfiller));
+      return kj::mv(paf.promise);
+    };
+  }
+
+  void release() {
+    for (auto& fulfiller: pending) fulfiller->fulfill();
+    pending.clear();
+  }
+};
+
+kj::ArrayPtr<const kj::byte> bytes(kj::StringPtr text) {
+  return text.asBytes();
+}
+
+KJ_TEST("EventBatcher sends a batch once it holds maxEvents records") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  MockDestination dest;
+
+  EventBatcher batcher(timer, { .maxEvents = 3 }, dest.sender());
+
+  auto a = batcher.add(bytes("{\"a\":1}"));
+  auto b = batcher.add(bytes("{\"b\":2}"));
+  ws.poll();
+  KJ_EXPECT(dest.batches.size() == 0);
+
+  auto c = batcher.add(bytes("{\"c\":3}"));
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 1);
+  KJ_EXPECT(dest.batches[0] == "{\"a\":1}\n{\"b\":2}\n{\"c\":3}\n");
+
+  // Callers wait for the batch to be delivered.
+  KJ_EXPECT(!a.poll(ws));
+  dest.release();
+  a.wait(ws);
+  b.wait(ws);
+  c.wait(ws);
+
+  KJ_EXPECT(batcher.getStats().itemsAdded == 3);
+  KJ_EXPECT(batcher.getStats().batchesDelivered == 1);
+}
+
+KJ_TEST("EventBatcher sends a batch before it exceeds maxBytes") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  MockDestination dest;
+
+  EventBatcher batcher(timer, { .maxBytes = 16 }, dest.sender());
+
+  auto a = batcher.add(bytes("0123456789"));
+  auto b = batcher.add(bytes("abcdefghij"));
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 1);
+  KJ_EXPECT(dest.batches[0] == "0123456789\n");
+
+  // A record larger than the limit is sent on its own.
+  auto c = batcher.add(bytes("this record is longer than sixteen bytes"));
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 3);
+  KJ_EXPECT(dest.batches[1] == "abcdefghij\n");
+  KJ_EXPECT(dest.batches[2] == "this record is longer than sixteen bytes\n");
+}
+
+KJ_TEST("EventBatcher sends a partial batch after the flush interval") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  MockDestination dest;
+
+  EventBatcher batcher(timer, { .flushInterval = 100 * kj::MILLISECONDS }, dest.sender());
+
+  auto a = batcher.add(bytes("x"));
+  timer.advanceTo(timer.now() + 50 * kj::MILLISECONDS);
+  ws.poll();
+  KJ_EXPECT(dest.batches.size() == 0);
+
+  timer.advanceTo(timer.now() + 50 * kj::MILLISECONDS);
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 1);
+  KJ_EXPECT(dest.batches[0] == "x\n");
+}
+
+KJ_TEST("EventBatcher drops records while too many batches are being sent") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+  MockDestination dest;
+
+  EventBatcher batcher(timer, { .maxEvents = 1, .maxPendingBatches = 1 }, dest.sender());
+
+  auto a = batcher.add(bytes("a"));
+  auto b = batcher.add(bytes("b"));
+
+  // `c` doesn't fit: `a` is being sent and `b` fills the current batch.
+  auto c = batcher.add(bytes("c"));
+  KJ_EXPECT(c.poll(ws));
+  c.wait(ws);
+  KJ_EXPECT(batcher.getStats().itemsDropped == 1);
+
+  // Once `a` is delivered, `b` goes out.
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 1);
+  dest.release();
+  a.wait(ws);
+  ws.poll();
+  KJ_ASSERT(dest.batches.size() == 2);
+  KJ_EXPECT(dest.batches[1] == "b\n");
+}
+
+KJ_TEST("EventBatcher reports send failures to callers") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  kj::TimerImpl timer(kj::origin<kj::TimePoint>());
+
+  EventBatcher batcher(timer, {}, [](kj::Array<kj::byte>, uint) -> kj::Promise<void> {
+    return KJ_EXCEPTION(DISCONNECTED, "destination unavailable");
+  });
+
+  auto a = batcher.add(bytes("a"));
+  batcher.flush().wait(ws);
+  KJ_EXPECT_THROW_MESSAGE("destination unavailable", a.wait(ws));
+  KJ_EXPECT(batcher.getStats().batchesFailed == 1);
+  KJ_EXPECT(batcher.getStats().batchesInFlight == 0);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "event-batcher.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+EventBatcher::EventBatcher(kj::Timer& timer, Limits limits, SendFunc send)
+    : send(kj::mv(send)), maxPendingBatches(limits.maxPendingBatches),
+      // Besides the batches being sent, only one more batch's worth of records may wait.
+      batcher(timer, {
+          .maxBatchItems = limits.maxEvents,
+          .maxBatchBytes = limits.maxBytes,
+          .maxDelay = limits.flushInterval,
+          .maxBufferedItems = size_t(limits.maxEvents) * (limits.maxPendingBatches + 1),
+          .maxBufferedBytes = limits.maxBytes * (limits.maxPendingBatches + 1),
+          .maxConcurrentBatches = limits.maxPendingBatches,
+        },
+        [this](kj::Array<Event> events) {
+          // Deferred so that the batch is sent from the event loop, never from within the
+          // caller's stack, which might be running a request.
+          return kj::evalLater([this, events = kj::mv(events)]() mutable {
+            return sendBatch(kj::mv(events));
+          });
+        },
+        [](const Event& event) { return event.record.size() + 1; }) {}
+
+kj::Promise<void> EventBatcher::add(kj::ArrayPtr<const kj::byte> record) {
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  if (!batcher.add(Event { kj::heapArray(record), kj::mv(paf.fulfiller) })) {
+    if (!dropping) {
+      dropping = true;
+      KJ_LOG(WARNING, "dropping events because too many batches are still being sent",
+          maxPendingBatches);
+    }
+    return kj::READY_NOW;
+  }
+
+  dropping = false;
+  return kj::mv(paf.promise);
+}
+
+kj::Promise<void> EventBatcher::sendBatch(kj::Array<Event> events) {
+  size_t size = 0;
+  for (auto& event: events) {
+    size += event.record.size() + 1;
+  }
+  auto body = kj::heapArrayBuilder<kj::byte>(size);
+  for (auto& event: events) {
+    body.addAll(event.record);
+    body.add('\n');
+  }
+
+  kj::Maybe<kj::Exception> error;
+  try {
+    co_await send(body.finish(), events.size());
+  } catch (...) {
+    error = kj::getCaughtExceptionAsKj();
+  }
+
+  KJ_IF_SOME(e, error) {
+    for (auto& event: events) {
+      event.fulfiller->reject(kj::cp(e));
+    }
+    // Rethrown so that the batch is counted as failed.
+    kj::throwFatalException(kj::mv(e));
+  }
+
+  for (auto& event: events) {
+    event.fulfiller->fulfill();
+  }
+}
+
+}  // namespace workerd
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/util/batcher.h>
+
+namespace workerd {
+
+// Collects small records, such as telemetry events, into newline-delimited batches so that they
+// can be delivered with one request per batch rather than one request per record.
+//
+// A batch is sent once it holds `maxEvents` records or `maxBytes` of data, or once
+// `flushInterval` has passed since its first record was added, whichever comes first. At most
+// `maxPendingBatches` batches are sent at once. If another full batch is waiting while that many
+// are still being sent, further records are dropped until one of them completes, so that a slow
+// or unavailable destination can't make memory use grow without bound.
+//
+// Not thread-safe; belongs to the thread whose event loop sends the batches.
+class EventBatcher final {
+public:
+  struct Limits {
+    uint maxEvents = 100;
+    size_t maxBytes = 1024 * 1024;
+    kj::Duration flushInterval = 1 * kj::SECONDS;
+    uint maxPendingBatches = 4;
+  };
+
+  using Stats = BatcherStats;
+
+  // Sends one batch: `count` records, each terminated by '\n'.
+  using SendFunc = kj::Function<kj::Promise<void>(kj::Array<kj::byte> body, uint count)>;
+
+  EventBatcher(kj::Timer& timer, Limits limits, SendFunc send);
+
+  // Adds a record, which must not contain '\n', to the current batch. The promise resolves once
+  // the batch has been sent, or rejects if sending it failed. If the record is dropped, the
+  // promise resolves right away.
+  kj::Promise<void> add(kj::ArrayPtr<const kj::byte> record);
+
+  // Sends whatever is waiting without waiting for a full batch, and returns a promise that
+  // resolves once nothing is waiting or being sent.
+  kj::Promise<void> flush() { return batcher.flush(); }
+
+  const Stats& getStats() const { return batcher.getStats(); }
+
+private:
+  struct Event {
+    kj::Array<kj::byte> record;
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+
+  SendFunc send;
+  uint maxPendingBatches;
+
+  // Whether records are being dropped, so that we only log when that starts.
+  bool dropping = false;
+
+  // Declared last so that in-flight sends are canceled before anything they refer to is
+  // destroyed.
+  Batcher<Event> batcher;
+
+  kj::Promise<void> sendBatch(kj::Array<Event> events);
+};
+
+}  // namespace workerd
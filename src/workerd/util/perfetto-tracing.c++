@@ -5,6 +5,7 @@
 #include <kj/debug.h>
 #include <kj/filesystem.h>
 #include <kj/memory.h>
+#include <kj/thread.h>
 #include <kj/vector.h>
 #include <fcntl.h>
 #include <perfetto/tracing/track_event_legacy.h>
@@ -30,7 +31,9 @@ void initializePerfettoOnce() {
   PerfettoSession::registerWorkerdTracks();
 }
 
-std::unique_ptr<perfetto::TracingSession> createTracingSession(int fd, kj::StringPtr categories) {
+// Records into `fd`, or into memory if `fd` is negative.
+std::unique_ptr<perfetto::TracingSession> createTracingSession(
+    int fd, kj::StringPtr categories, size_t bufferSizeKb) {
   initializePerfettoOnce();
   perfetto::protos::gen::TrackEventConfig track_event_cfg;
   track_event_cfg.add_disabled_categories("*");
@@ -43,13 +46,17 @@ std::unique_ptr<perfetto::TracingSession> createTracingSession(int fd, kj::Strin
   }
 
   perfetto::TraceConfig cfg;
-  cfg.add_buffers()->set_size_kb(1024);  // Record up to 1 MiB.
+  cfg.add_buffers()->set_size_kb(bufferSizeKb);
   auto* ds_cfg = cfg.add_data_sources()->mutable_config();
   ds_cfg->set_name("track_event");
   ds_cfg->set_track_event_config_raw(track_event_cfg.SerializeAsString());
   std::unique_ptr<perfetto::TracingSession> tracing_session(
       perfetto::Tracing::NewTrace());
-  tracing_session->Setup(cfg, fd);
+  if (fd >= 0) {
+    tracing_session->Setup(cfg, fd);
+  } else {
+    tracing_session->Setup(cfg);
+  }
   return kj::mv(tracing_session);
 }
 }  // namespace
@@ -81,8 +88,8 @@ struct PerfettoSession::Impl {
   kj::AutoCloseFd fd;
   std::unique_ptr<perfetto::TracingSession> session;
 
-  Impl(kj::AutoCloseFd dest, kj::StringPtr categories)
-      : fd(kj::mv(dest)), session(createTracingSession(fd.get(), categories)) {
+  Impl(kj::AutoCloseFd dest, kj::StringPtr categories, size_t bufferSizeKb = 1024)
+      : fd(kj::mv(dest)), session(createTracingSession(fd.get(), categories, bufferSizeKb)) {
     session->StartBlocking();
   }
 };
@@ -93,13 +100,46 @@ PerfettoSession::PerfettoSession(kj::StringPtr path, kj::StringPtr categories)
 PerfettoSession::PerfettoSession(int fd, kj::StringPtr categories)
     : impl(kj::heap<Impl>(kj::AutoCloseFd(fd), categories)) {}
 
+PerfettoSession::PerfettoSession(kj::Own<Impl> impl): impl(kj::mv(impl)) {}
+
+PerfettoSession PerfettoSession::inMemory(kj::StringPtr categories, size_t bufferSizeKb) {
+  return PerfettoSession(kj::heap<Impl>(kj::AutoCloseFd(), categories, bufferSizeKb));
+}
+
 PerfettoSession::~PerfettoSession() noexcept(false) {
-  if (impl) {
+  if (impl.get() == nullptr) {
+    // Moved away, or consumed by stopAndRead().
+  } else if (impl->fd.get() < 0) {
+    // Nobody is going to read the in-memory trace, so there's nothing to flush. In-memory sessions
+    // are stopped from the event loop, so don't wait for Perfetto there.
+    kj::Thread([impl = kj::mv(impl)]() { impl->session->StopBlocking(); }).detach();
+  } else {
     impl->session->FlushBlocking();
     impl->session->StopBlocking();
   }
 }
 
+kj::Promise<kj::Array<kj::byte>> PerfettoSession::stopAndRead() {
+  KJ_REQUIRE(impl.get() != nullptr, "session has already been stopped");
+  KJ_REQUIRE(impl->fd.get() < 0, "stopAndRead() requires an in-memory session");
+
+  // Flushing, stopping and reading each wait on Perfetto's own threads, for longer the bigger the
+  // buffer is, so we do them on a thread of our own. The thread owns the session until it's done.
+  auto paf = kj::newPromiseAndCrossThreadFulfiller<kj::Array<kj::byte>>();
+  kj::Thread([impl = kj::mv(impl), fulfiller = kj::mv(paf.fulfiller)]() mutable {
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      impl->session->FlushBlocking();
+      impl->session->StopBlocking();
+      std::vector<char> data = impl->session->ReadTraceBlocking();
+      fulfiller->fulfill(
+          kj::heapArray<kj::byte>(reinterpret_cast<const kj::byte*>(data.data()), data.size()));
+    })) {
+      fulfiller->reject(kj::mv(exception));
+    }
+  }).detach();
+  return kj::mv(paf.promise);
+}
+
 void PerfettoSession::flush() {
   if (impl) {
     impl->session->FlushBlocking();
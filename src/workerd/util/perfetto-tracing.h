@@ -1,6 +1,7 @@
 #pragma once
 
 #if defined(WORKERD_USE_PERFETTO)
+#include <kj/async.h>
 #include <kj/memory.h>
 #include <kj/string.h>
 #define PERFETTO_ENABLE_LEGACY_TRACE_EVENTS 1
@@ -22,6 +23,11 @@ public:
   // Create a PerfettoSession on an existing fd (the constructor will handle
   // wrapping the fd in kj::AutocloseFd)
   explicit PerfettoSession(int fd, kj::StringPtr categories);
+
+  // Create a PerfettoSession that records into an in-memory ring buffer of the given size. The
+  // trace is retrieved with stopAndRead().
+  static PerfettoSession inMemory(kj::StringPtr categories, size_t bufferSizeKb);
+
   PerfettoSession(PerfettoSession&&) = default;
   PerfettoSession& operator=(PerfettoSession&&) = default;
   KJ_DISALLOW_COPY(PerfettoSession);
@@ -29,6 +35,11 @@ public:
 
   void flush();
 
+  // Stops the session and returns the recorded trace. Only valid for sessions created with
+  // inMemory(). Perfetto collects the buffered events on a thread of our own, so the calling
+  // thread isn't blocked meanwhile. The session can't be used for anything else afterwards.
+  kj::Promise<kj::Array<kj::byte>> stopAndRead();
+
   // Receives a comma-separated list of trace categories and returns an array.
   static kj::Array<kj::ArrayPtr<const char>> parseCategories(kj::StringPtr categories);
 
@@ -39,6 +50,8 @@ private:
   struct Impl;
   kj::Own<Impl> impl;
 
+  explicit PerfettoSession(kj::Own<Impl> impl);
+
   friend constexpr bool _kj_internal_isPolymorphic(PerfettoSession::Impl*);
 };
 
@@ -0,0 +1,146 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pprof.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// A minimal protobuf reader, enough to check the structure of the output.
+struct Field {
+  uint number;
+  uint64_t varint = 0;                  // For varint fields.
+  kj::ArrayPtr<const kj::byte> bytes;   // For length-delimited fields.
+};
+
+uint64_t readVarint(kj::ArrayPtr<const kj::byte>& in) {
+  uint64_t result = 0;
+  for (uint shift = 0; ; shift += 7) {
+    KJ_ASSERT(in.size() > 0);
+    kj::byte b = in[0];
+    in = in.slice(1, in.size());
+    result |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if (!(b & 0x80)) return result;
+  }
+}
+
+kj::Array<Field> parse(kj::ArrayPtr<const kj::byte> in) {
+  kj::Vector<Field> fields;
+  while (in.size() > 0) {
+    auto tag = readVarint(in);
+    Field field { .number = static_cast<uint>(tag >> 3) };
+    switch (tag & 7) {
+      case 0:
+        field.varint = readVarint(in);
+        break;
+      case 2: {
+        auto size = readVarint(in);
+        field.bytes = in.first(size);
+        in = in.slice(size, in.size());
+        break;
+      }
+      default:
+        KJ_FAIL_ASSERT("unexpected wire type", tag & 7);
+    }
+    fields.add(field);
+  }
+  return fields.releaseAsArray();
+}
+
+kj::Array<Field> fieldsNumbered(kj::ArrayPtr<const Field> fields, uint number) {
+  kj::Vector<Field> result;
+  for (auto& field: fields) {
+    if (field.number == number) result.add(field);
+  }
+  return result.releaseAsArray();
+}
+
+uint64_t varintField(kj::ArrayPtr<const kj::byte> message, uint number) {
+  for (auto& field: parse(message)) {
+    if (field.number == number) return field.varint;
+  }
+  return 0;
+}
+
+kj::Array<uint64_t> packedField(kj::ArrayPtr<const kj::byte> message, uint number) {
+  kj::Vector<uint64_t> result;
+  for (auto& field: parse(message)) {
+    if (field.number == number) {
+      auto in = field.bytes;
+      while (in.size() > 0) result.add(readVarint(in));
+    }
+  }
+  return result.releaseAsArray();
+}
+
+KJ_TEST("PprofBuilder") {
+  PprofBuilder::ValueType sampleTypes[] = {{"samples", "count"}, {"cpu", "nanoseconds"}};
+  PprofBuilder builder(sampleTypes, {"cpu", "nanoseconds"}, 1000000);
+
+  auto outer = builder.addFunction("outer", "worker.js", 1);
+  auto inner = builder.addFunction("inner", "worker.js", 10);
+  KJ_EXPECT(builder.addFunction("outer", "worker.js", 1) == outer);
+  KJ_EXPECT(outer != inner);
+
+  auto outerLoc = builder.addLocation(outer, 3);
+  auto innerLoc = builder.addLocation(inner, 12, 5);
+  KJ_EXPECT(builder.addLocation(inner, 12, 5) == innerLoc);
+
+  uint64_t stack[] = {innerLoc, outerLoc};
+  int64_t values[] = {2, 2000000};
+  builder.addSample(stack, values);
+  builder.setTime(1700000000000000000, 5000000000);
+  builder.addComment("hello");
+
+  auto output = builder.finish();
+  auto fields = parse(output);
+
+  auto strings = KJ_MAP(f, fieldsNumbered(fields, 6)) {
+    return kj::str(f.bytes.asChars());
+  };
+  KJ_ASSERT(strings.size() > 0);
+  KJ_EXPECT(strings[0] == "");
+  auto str = [&](uint64_t index) -> kj::StringPtr {
+    KJ_ASSERT(index < strings.size());
+    return strings[index];
+  };
+
+  auto sampleTypeFields = fieldsNumbered(fields, 1);
+  KJ_ASSERT(sampleTypeFields.size() == 2);
+  KJ_EXPECT(str(varintField(sampleTypeFields[1].bytes, 1)) == "cpu");
+  KJ_EXPECT(str(varintField(sampleTypeFields[1].bytes, 2)) == "nanoseconds");
+
+  auto samples = fieldsNumbered(fields, 2);
+  KJ_ASSERT(samples.size() == 1);
+  KJ_EXPECT(packedField(samples[0].bytes, 1).asPtr() == kj::arrayPtr(stack));
+  auto sampleValues = packedField(samples[0].bytes, 2);
+  KJ_ASSERT(sampleValues.size() == 2);
+  KJ_EXPECT(sampleValues[0] == 2);
+  KJ_EXPECT(sampleValues[1] == 2000000);
+
+  auto functions = fieldsNumbered(fields, 5);
+  KJ_ASSERT(functions.size() == 2);
+  KJ_EXPECT(varintField(functions[1].bytes, 1) == inner);
+  KJ_EXPECT(str(varintField(functions[1].bytes, 2)) == "inner");
+  KJ_EXPECT(str(varintField(functions[1].bytes, 4)) == "worker.js");
+  KJ_EXPECT(varintField(functions[1].bytes, 5) == 10);
+
+  auto locations = fieldsNumbered(fields, 4);
+  KJ_ASSERT(locations.size() == 2);
+  KJ_EXPECT(varintField(locations[1].bytes, 1) == innerLoc);
+  auto lines = fieldsNumbered(parse(locations[1].bytes), 4);
+  KJ_ASSERT(lines.size() == 1);
+  KJ_EXPECT(varintField(lines[0].bytes, 1) == inner);
+  KJ_EXPECT(varintField(lines[0].bytes, 2) == 12);
+  KJ_EXPECT(varintField(lines[0].bytes, 3) == 5);
+
+  KJ_EXPECT(varintField(output, 9) == 1700000000000000000);
+  KJ_EXPECT(varintField(output, 10) == 5000000000);
+  KJ_EXPECT(varintField(output, 12) == 1000000);
+  KJ_EXPECT(str(varintField(output, 13)) == "hello");
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "pprof.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+namespace {
+
+// Just enough of the protobuf wire format to write a Profile.
+
+enum WireType {
+  VARINT = 0,
+  LENGTH_DELIMITED = 2,
+};
+
+void writeVarint(kj::Vector<kj::byte>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.add(static_cast<kj::byte>(value | 0x80));
+    value >>= 7;
+  }
+  out.add(static_cast<kj::byte>(value));
+}
+
+void writeTag(kj::Vector<kj::byte>& out, uint field, WireType type) {
+  writeVarint(out, (field << 3) | type);
+}
+
+// Writes an integer field, omitting it if it has the default value of zero. Negative values are
+// encoded as ten-byte varints, as for the protobuf `int64` type.
+void writeInt(kj::Vector<kj::byte>& out, uint field, int64_t value) {
+  if (value == 0) return;
+  writeTag(out, field, VARINT);
+  writeVarint(out, static_cast<uint64_t>(value));
+}
+
+void writeBytes(kj::Vector<kj::byte>& out, uint field, kj::ArrayPtr<const kj::byte> bytes) {
+  writeTag(out, field, LENGTH_DELIMITED);
+  writeVarint(out, bytes.size());
+  out.addAll(bytes);
+}
+
+template <typename T>
+void writePacked(kj::Vector<kj::byte>& out, uint field, kj::ArrayPtr<const T> values) {
+  if (values.size() == 0) return;
+  kj::Vector<kj::byte> packed(values.size());
+  for (auto value: values) {
+    writeVarint(packed, static_cast<uint64_t>(value));
+  }
+  writeBytes(out, field, packed.asPtr());
+}
+
+// Field numbers from profile.proto.
+enum ProfileField: uint {
+  PROFILE_SAMPLE_TYPE = 1,
+  PROFILE_SAMPLE = 2,
+  PROFILE_LOCATION = 4,
+  PROFILE_FUNCTION = 5,
+  PROFILE_STRING_TABLE = 6,
+  PROFILE_TIME_NANOS = 9,
+  PROFILE_DURATION_NANOS = 10,
+  PROFILE_PERIOD_TYPE = 11,
+  PROFILE_PERIOD = 12,
+  PROFILE_COMMENT = 13,
+};
+
+enum ValueTypeField: uint {
+  VALUE_TYPE_TYPE = 1,
+  VALUE_TYPE_UNIT = 2,
+};
+
+enum SampleField: uint {
+  SAMPLE_LOCATION_ID = 1,
+  SAMPLE_VALUE = 2,
+};
+
+enum LocationField: uint {
+  LOCATION_ID = 1,
+  LOCATION_LINE = 4,
+};
+
+enum LineField: uint {
+  LINE_FUNCTION_ID = 1,
+  LINE_LINE = 2,
+  LINE_COLUMN = 3,
+};
+
+enum FunctionField: uint {
+  FUNCTION_ID = 1,
+  FUNCTION_NAME = 2,
+  FUNCTION_SYSTEM_NAME = 3,
+  FUNCTION_FILENAME = 4,
+  FUNCTION_START_LINE = 5,
+};
+
+}  // namespace
+
+PprofBuilder::PprofBuilder(kj::ArrayPtr<const ValueType> sampleTypes, ValueType periodType,
+                           int64_t period)
+    : sampleTypeCount(sampleTypes.size()) {
+  // The string table must start with the empty string.
+  intern(""_kj);
+
+  auto writeValueType = [this](uint field, ValueType valueType) {
+    kj::Vector<kj::byte> message;
+    writeInt(message, VALUE_TYPE_TYPE, intern(valueType.type));
+    writeInt(message, VALUE_TYPE_UNIT, intern(valueType.unit));
+    writeBytes(out, field, message.asPtr());
+  };
+
+  for (auto& sampleType: sampleTypes) {
+    writeValueType(PROFILE_SAMPLE_TYPE, sampleType);
+  }
+  writeValueType(PROFILE_PERIOD_TYPE, periodType);
+  writeInt(out, PROFILE_PERIOD, period);
+}
+
+int64_t PprofBuilder::intern(kj::StringPtr str) {
+  return stringIds.findOrCreate(str, [&]() -> decltype(stringIds)::Entry {
+    auto copy = kj::str(str);
+    strings.add(copy);
+    return { kj::mv(copy), static_cast<int64_t>(strings.size() - 1) };
+  });
+}
+
+uint64_t PprofBuilder::addFunction(kj::StringPtr name, kj::StringPtr filename,
+                                   int64_t startLine) {
+  FunctionKey key { intern(name), intern(filename), startLine };
+  return functionIds.findOrCreate(key, [&]() -> decltype(functionIds)::Entry {
+    functions.add(key);
+    // IDs must be non-zero.
+    return { key, functions.size() };
+  });
+}
+
+uint64_t PprofBuilder::addLocation(uint64_t functionId, int64_t line, int64_t column) {
+  KJ_REQUIRE(functionId > 0 && functionId <= functions.size(), "unknown function ID");
+  LocationKey key { functionId, line, column };
+  return locationIds.findOrCreate(key, [&]() -> decltype(locationIds)::Entry {
+    locations.add(key);
+    return { key, locations.size() };
+  });
+}
+
+void PprofBuilder::addSample(kj::ArrayPtr<const uint64_t> locationIds,
+                             kj::ArrayPtr<const int64_t> values) {
+  KJ_REQUIRE(values.size() == sampleTypeCount, "wrong number of sample values");
+  kj::Vector<kj::byte> message;
+  writePacked(message, SAMPLE_LOCATION_ID, locationIds);
+  writePacked(message, SAMPLE_VALUE, values);
+  writeBytes(out, PROFILE_SAMPLE, message.asPtr());
+}
+
+void PprofBuilder::setTime(int64_t timeNanos, int64_t durationNanos) {
+  writeInt(out, PROFILE_TIME_NANOS, timeNanos);
+  writeInt(out, PROFILE_DURATION_NANOS, durationNanos);
+}
+
+void PprofBuilder::addComment(kj::StringPtr comment) {
+  auto id = intern(comment);
+  writeTag(out, PROFILE_COMMENT, VARINT);
+  writeVarint(out, id);
+}
+
+kj::Array<kj::byte> PprofBuilder::finish() {
+  kj::Vector<kj::byte> message;
+
+  for (auto i: kj::indices(functions)) {
+    auto& function = functions[i];
+    message.clear();
+    writeInt(message, FUNCTION_ID, i + 1);
+    writeInt(message, FUNCTION_NAME, function.name);
+    writeInt(message, FUNCTION_SYSTEM_NAME, function.name);
+    writeInt(message, FUNCTION_FILENAME, function.filename);
+    writeInt(message, FUNCTION_START_LINE, function.startLine);
+    writeBytes(out, PROFILE_FUNCTION, message.asPtr());
+  }
+
+  kj::Vector<kj::byte> line;
+  for (auto i: kj::indices(locations)) {
+    auto& location = locations[i];
+    line.clear();
+    writeInt(line, LINE_FUNCTION_ID, location.functionId);
+    writeInt(line, LINE_LINE, location.line);
+    writeInt(line, LINE_COLUMN, location.column);
+
+    message.clear();
+    writeInt(message, LOCATION_ID, i + 1);
+    writeBytes(message, LOCATION_LINE, line.asPtr());
+    writeBytes(out, PROFILE_LOCATION, message.asPtr());
+  }
+
+  // The string table goes last so that it includes every string interned by the code above.
+  for (auto str: strings) {
+    writeBytes(out, PROFILE_STRING_TABLE, str.asBytes());
+  }
+
+  return out.releaseAsArray();
+}
+
+}  // namespace workerd
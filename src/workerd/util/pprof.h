@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+#include <kj/map.h>
+#include <kj/string.h>
+#include <kj/vector.h>
+
+namespace workerd {
+
+// Builds a profile in the pprof format, i.e. a serialized `perftools.profiles.Profile` protobuf
+// message as described by:
+//
+//     https://github.com/google/pprof/blob/main/proto/profile.proto
+//
+// The output is uncompressed; `go tool pprof` and most other consumers accept it as is, or it can
+// be gzipped for tools that insist. Functions, locations and strings are deduplicated as they are
+// added.
+class PprofBuilder {
+public:
+  struct ValueType {
+    kj::StringPtr type;  // e.g. "samples", "cpu"
+    kj::StringPtr unit;  // e.g. "count", "nanoseconds"
+  };
+
+  // `sampleTypes` describes the values recorded for each sample, in order. `periodType` and
+  // `period` describe the sampling interval.
+  PprofBuilder(kj::ArrayPtr<const ValueType> sampleTypes, ValueType periodType, int64_t period);
+  KJ_DISALLOW_COPY_AND_MOVE(PprofBuilder);
+
+  // Returns the ID of the function with the given name, source file and starting line, adding it
+  // if this is the first time it was seen.
+  uint64_t addFunction(kj::StringPtr name, kj::StringPtr filename, int64_t startLine);
+
+  // Returns the ID of a location within `functionId` at the given line and column, adding it if
+  // this is the first time it was seen.
+  uint64_t addLocation(uint64_t functionId, int64_t line, int64_t column = 0);
+
+  // Records a sample. `locationIds` lists the stack starting from the leaf. There must be as
+  // many `values` as there are sample types.
+  void addSample(kj::ArrayPtr<const uint64_t> locationIds, kj::ArrayPtr<const int64_t> values);
+
+  // Sets the time at which the profile was started, in nanoseconds since the Unix epoch, and how
+  // long it covers.
+  void setTime(int64_t timeNanos, int64_t durationNanos);
+
+  void addComment(kj::StringPtr comment);
+
+  // Serializes the profile.
+  kj::Array<kj::byte> finish();
+
+private:
+  struct FunctionKey {
+    int64_t name;
+    int64_t filename;
+    int64_t startLine;
+
+    bool operator==(const FunctionKey& other) const = default;
+    uint hashCode() const { return kj::hashCode(name, filename, startLine); }
+  };
+
+  struct LocationKey {
+    uint64_t functionId;
+    int64_t line;
+    int64_t column;
+
+    bool operator==(const LocationKey& other) const = default;
+    uint hashCode() const { return kj::hashCode(functionId, line, column); }
+  };
+
+  // Fields of the top-level message, which are written as they are added. Functions and
+  // locations are written out by finish() since their IDs are only final once all are known.
+  kj::Vector<kj::byte> out;
+
+  kj::HashMap<kj::String, int64_t> stringIds;
+  kj::Vector<kj::StringPtr> strings;
+
+  kj::HashMap<FunctionKey, uint64_t> functionIds;
+  kj::Vector<FunctionKey> functions;
+
+  kj::HashMap<LocationKey, uint64_t> locationIds;
+  kj::Vector<LocationKey> locations;
+
+  size_t sampleTypeCount;
+
+  int64_t intern(kj::StringPtr str);
+};
+
+}  // namespace workerd
@@ -0,0 +1,207 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "shared-tee.h"
+#include "stream-utils.h"
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd {
+namespace {
+
+kj::Array<kj::byte> makeData(size_t size) {
+  auto data = kj::heapArray<kj::byte>(size);
+  for (auto i: kj::indices(data)) {
+    data[i] = i * 7;
+  }
+  return data;
+}
+
+bool readsAll(kj::AsyncInputStream& input, kj::ArrayPtr<const kj::byte> expected,
+              kj::WaitScope& ws) {
+  return input.readAllBytes().wait(ws).asPtr() == expected;
+}
+
+// Records where each write's bytes came from.
+class RecordingStream final: public kj::AsyncOutputStream {
+public:
+  kj::Vector<kj::ArrayPtr<const kj::byte>> writes;
+  size_t size = 0;
+
+  kj::Promise<void> write(const void* buffer, size_t size) override {
+    writes.add(kj::arrayPtr(static_cast<const kj::byte*>(buffer), size));
+    this->size += size;
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    KJ_UNIMPLEMENTED("not used");
+  }
+  kj::Promise<void> whenWriteDisconnected() override { return kj::NEVER_DONE; }
+};
+
+KJ_TEST("newSharedTee delivers the same data to both branches") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), kj::maxValue);
+
+  KJ_EXPECT(readsAll(*tee.branches[0], data, ws));
+  KJ_EXPECT(readsAll(*tee.branches[1], data, ws));
+}
+
+KJ_TEST("newSharedTee fails a branch that falls too far behind") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), 32 * 1024);
+
+  // The branch that keeps reading is unaffected...
+  KJ_EXPECT(readsAll(*tee.branches[0], data, ws));
+
+  // ...while the one that didn't is failed.
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded",
+      tee.branches[1]->readAllBytes().wait(ws));
+}
+
+KJ_TEST("newSharedTee can wait for a lagging branch instead") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), 32 * 1024,
+                          TeeLagPolicy::WAIT_FOR_LAGGING_BRANCH);
+
+  // The leading branch can't get all the data while the other one hasn't read anything.
+  auto leading = tee.branches[0]->readAllBytes();
+  KJ_EXPECT(!leading.poll(ws));
+
+  // Once the lagging branch catches up, both complete.
+  KJ_EXPECT(readsAll(*tee.branches[1], data, ws));
+  KJ_EXPECT(leading.wait(ws).asPtr() == data.asPtr());
+}
+
+KJ_TEST("newSharedTee branches pump the same buffers") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), kj::maxValue);
+
+  RecordingStream out0;
+  RecordingStream out1;
+  auto pump0 = tee.branches[0]->pumpTo(out0);
+  auto pump1 = tee.branches[1]->pumpTo(out1);
+  KJ_EXPECT(pump0.wait(ws) == data.size());
+  KJ_EXPECT(pump1.wait(ws) == data.size());
+
+  // Both branches wrote out of the same chunks rather than each having their own copy.
+  KJ_ASSERT(out0.writes.size() == out1.writes.size());
+  for (auto i: kj::indices(out0.writes)) {
+    KJ_EXPECT(out0.writes[i].begin() == out1.writes[i].begin());
+  }
+  KJ_EXPECT(out0.size == data.size());
+}
+
+KJ_TEST("newSharedTee branches can be tee'd again") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), kj::maxValue);
+
+  auto buffer = kj::heapArray<kj::byte>(1000);
+  KJ_EXPECT(tee.branches[0]->tryRead(buffer.begin(), buffer.size(), buffer.size()).wait(ws) ==
+      buffer.size());
+
+  // The new branch starts where the branch it was tee'd from is.
+  auto third = KJ_ASSERT_NONNULL(tee.branches[0]->tryTee(kj::maxValue));
+  KJ_EXPECT(readsAll(*third, data.slice(buffer.size(), data.size()), ws));
+  KJ_EXPECT(readsAll(*tee.branches[0], data.slice(buffer.size(), data.size()), ws));
+  KJ_EXPECT(readsAll(*tee.branches[1], data, ws));
+}
+
+KJ_TEST("newSharedTee of a branch shares the existing tee's buffer") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), kj::maxValue);
+  auto nested = newSharedTee(kj::mv(tee.branches[0]), kj::maxValue);
+
+  RecordingStream out0;
+  RecordingStream out1;
+  RecordingStream out2;
+  auto pump0 = nested.branches[0]->pumpTo(out0);
+  auto pump1 = nested.branches[1]->pumpTo(out1);
+  auto pump2 = tee.branches[1]->pumpTo(out2);
+  KJ_EXPECT(pump0.wait(ws) == data.size());
+  KJ_EXPECT(pump1.wait(ws) == data.size());
+  KJ_EXPECT(pump2.wait(ws) == data.size());
+
+  // All three branches wrote out of the original tee's chunks, rather than the nested tee
+  // buffering its own copy.
+  KJ_ASSERT(out0.writes.size() == out2.writes.size());
+  KJ_ASSERT(out1.writes.size() == out2.writes.size());
+  for (auto i: kj::indices(out2.writes)) {
+    KJ_EXPECT(out0.writes[i].begin() == out2.writes[i].begin());
+    KJ_EXPECT(out1.writes[i].begin() == out2.writes[i].begin());
+  }
+}
+
+KJ_TEST("newSharedTee tryTee() limits buffering for the new branches") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  auto data = makeData(100'000);
+  auto tee = newSharedTee(newMemoryInputStream(data), kj::maxValue);
+  auto third = KJ_ASSERT_NONNULL(tee.branches[0]->tryTee(32 * 1024));
+
+  // The branch that wasn't tee'd again keeps the unlimited lag...
+  KJ_EXPECT(readsAll(*tee.branches[1], data, ws));
+
+  // ...while the two that were are held to the limit passed to tryTee().
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded", third->readAllBytes().wait(ws));
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded",
+      tee.branches[0]->readAllBytes().wait(ws));
+}
+
+KJ_TEST("newSharedTee returns data read before an input error") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  // Produces `data` in one read, then fails.
+  class FailingStream final: public kj::AsyncInputStream {
+  public:
+    explicit FailingStream(kj::ArrayPtr<const kj::byte> data): data(data) {}
+
+    kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+      if (data.size() == 0) return KJ_EXCEPTION(DISCONNECTED, "input failed");
+      auto amount = kj::min(data.size(), maxBytes);
+      kj::arrayPtr(static_cast<kj::byte*>(buffer), amount).copyFrom(data.first(amount));
+      data = data.slice(amount, data.size());
+      return amount;
+    }
+
+  private:
+    kj::ArrayPtr<const kj::byte> data;
+  };
+
+  auto data = makeData(1000);
+  auto tee = newSharedTee(kj::heap<FailingStream>(data), kj::maxValue);
+
+  // Asking for more than the input has gets back what was read before it failed...
+  auto buffer = kj::heapArray<kj::byte>(2000);
+  KJ_EXPECT(tee.branches[0]->tryRead(buffer.begin(), buffer.size(), buffer.size()).wait(ws) ==
+      data.size());
+  KJ_EXPECT(buffer.first(data.size()) == data.asPtr());
+
+  // ...and the error comes with the next read.
+  KJ_EXPECT_THROW_MESSAGE("input failed",
+      tee.branches[0]->tryRead(buffer.begin(), 1, buffer.size()).wait(ws));
+}
+
+}  // namespace
+}  // namespace workerd
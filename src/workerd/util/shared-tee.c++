@@ -0,0 +1,363 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "shared-tee.h"
+#include <kj/debug.h>
+#include <kj/vector.h>
+#include <algorithm>
+#include <deque>
+
+namespace workerd {
+
+namespace {
+
+// How much we ask the input for at a time. Each successful read becomes one chunk.
+constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+// A branch's position in the stream.
+struct Cursor {
+  // Offset, from the start of the stream, of the next byte this branch will read.
+  uint64_t position = 0;
+
+  // How far this branch may fall behind the furthest-ahead branch.
+  uint64_t lagLimit = kj::maxValue;
+
+  // Set if this branch fell too far behind and was failed.
+  kj::Maybe<kj::Exception> error;
+
+  // False once the cursor no longer holds back the freeing of chunks, either because its branch
+  // was destroyed or because it was failed.
+  bool registered = false;
+};
+
+class SharedTee final: public kj::Refcounted, private kj::TaskSet::ErrorHandler {
+public:
+  struct Chunk final: public kj::Refcounted {
+    Chunk(uint64_t start, kj::Array<const kj::byte> bytes): start(start), bytes(kj::mv(bytes)) {}
+
+    // Offset of the first byte of this chunk from the start of the stream.
+    uint64_t start;
+    kj::Array<const kj::byte> bytes;
+  };
+
+  // Some bytes at a cursor's position, along with a reference that keeps them alive.
+  struct Piece {
+    kj::Own<Chunk> chunk;
+    kj::ArrayPtr<const kj::byte> bytes;
+  };
+
+  SharedTee(kj::Own<kj::AsyncInputStream> input, TeeLagPolicy policy)
+      : length(input->tryGetLength()),
+        input(kj::mv(input)),
+        policy(policy),
+        tasks(*this) {}
+
+  const kj::Maybe<uint64_t> length;
+
+  void addCursor(Cursor& cursor) {
+    if (cursor.error != kj::none) return;
+    if (cursor.position < startOfChunks()) {
+      // The data this cursor needs has already been freed. This can only happen when copying the
+      // cursor of a branch that was failed.
+      cursor.error = limitExceeded();
+      return;
+    }
+    cursors.add(&cursor);
+    cursor.registered = true;
+  }
+
+  void removeCursor(Cursor& cursor) {
+    if (!cursor.registered) return;
+    cursor.registered = false;
+    for (auto i: kj::indices(cursors)) {
+      if (cursors[i] == &cursor) {
+        unregisterAt(i);
+        break;
+      }
+    }
+    freeConsumedChunks();
+    maybePull();
+  }
+
+  // Returns the bytes at the cursor's position up to the end of the chunk containing them, or
+  // none if the cursor has consumed all data read so far.
+  kj::Maybe<Piece> peek(Cursor& cursor) {
+    throwIfFailed(cursor);
+    KJ_IF_SOME(chunk, findChunk(cursor.position)) {
+      return Piece {
+        .chunk = kj::addRef(chunk),
+        .bytes = chunk.bytes.slice(cursor.position - chunk.start, chunk.bytes.size()),
+      };
+    }
+    return kj::none;
+  }
+
+  // Copies as much data as is available at the cursor's position into `buffer` and advances the
+  // cursor past it. Returns the number of bytes copied.
+  size_t read(Cursor& cursor, kj::ArrayPtr<kj::byte> buffer) {
+    throwIfFailed(cursor);
+    size_t copied = 0;
+    while (copied < buffer.size()) {
+      KJ_IF_SOME(chunk, findChunk(cursor.position + copied)) {
+        auto bytes = chunk.bytes.slice(cursor.position + copied - chunk.start, chunk.bytes.size());
+        auto amount = kj::min(bytes.size(), buffer.size() - copied);
+        buffer.slice(copied, copied + amount).copyFrom(bytes.first(amount));
+        copied += amount;
+      } else {
+        break;
+      }
+    }
+    if (copied > 0) advance(cursor, copied);
+    return copied;
+  }
+
+  void advance(Cursor& cursor, size_t amount) {
+    cursor.position += amount;
+    freeConsumedChunks();
+    maybePull();
+  }
+
+  // Returns true if the cursor has reached the end of the stream. Throws if the input failed and
+  // the cursor has consumed everything that was read before the failure.
+  bool atEnd(Cursor& cursor) {
+    throwIfFailed(cursor);
+    if (cursor.position < end) return false;
+    KJ_IF_SOME(e, inputError) {
+      kj::throwFatalException(kj::cp(e));
+    }
+    return inputDone;
+  }
+
+  // Returns a promise that resolves once more data has been read from the input, or the input
+  // has ended or failed.
+  kj::Promise<void> whenMoreData() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    waiters.add(kj::mv(paf.fulfiller));
+    maybePull();
+    return kj::mv(paf.promise);
+  }
+
+private:
+  kj::Own<kj::AsyncInputStream> input;
+  const TeeLagPolicy policy;
+
+  // Chunks that some branch still needs, in stream order, without gaps.
+  std::deque<kj::Own<Chunk>> chunks;
+
+  // Offset just past the last byte read from the input so far.
+  uint64_t end = 0;
+
+  bool pulling = false;
+  bool inputDone = false;
+  kj::Maybe<kj::Exception> inputError;
+
+  kj::Vector<Cursor*> cursors;
+  kj::Vector<kj::Own<kj::PromiseFulfiller<void>>> waiters;
+
+  kj::TaskSet tasks;
+
+  static kj::Exception limitExceeded() {
+    return KJ_EXCEPTION(FAILED, "tee buffer size limit exceeded");
+  }
+
+  void throwIfFailed(Cursor& cursor) {
+    KJ_IF_SOME(e, cursor.error) {
+      kj::throwFatalException(kj::cp(e));
+    }
+  }
+
+  // Removes cursors[i]. The order of `cursors` doesn't matter.
+  void unregisterAt(size_t i) {
+    cursors[i] = cursors.back();
+    cursors.removeLast();
+  }
+
+  uint64_t startOfChunks() {
+    return chunks.empty() ? end : chunks.front()->start;
+  }
+
+  kj::Maybe<Chunk&> findChunk(uint64_t position) {
+    if (position >= end) return kj::none;
+    KJ_ASSERT(position >= startOfChunks(), "tee branch is behind the data that was kept for it");
+
+    // Find the last chunk starting at or before `position`.
+    auto iter = std::upper_bound(chunks.begin(), chunks.end(), position,
+        [](uint64_t position, const kj::Own<Chunk>& chunk) { return position < chunk->start; });
+    return **(iter - 1);
+  }
+
+  bool anyBranchAtLagLimit() {
+    for (auto cursor: cursors) {
+      if (end - cursor->position >= cursor->lagLimit) return true;
+    }
+    return false;
+  }
+
+  void freeConsumedChunks() {
+    uint64_t slowest = end;
+    for (auto cursor: cursors) {
+      slowest = kj::min(slowest, cursor->position);
+    }
+    // Branches that are in the middle of writing a chunk out hold their own reference to it, so
+    // dropping ours here doesn't free it out from under them.
+    while (!chunks.empty() && chunks.front()->start + chunks.front()->bytes.size() <= slowest) {
+      chunks.pop_front();
+    }
+  }
+
+  void failLaggingBranches() {
+    for (size_t i = 0; i < cursors.size();) {
+      auto& cursor = *cursors[i];
+      if (end - cursor.position > cursor.lagLimit) {
+        cursor.error = limitExceeded();
+        cursor.registered = false;
+        unregisterAt(i);
+      } else {
+        ++i;
+      }
+    }
+    freeConsumedChunks();
+  }
+
+  void maybePull() {
+    if (pulling || inputDone || inputError != kj::none || waiters.empty()) return;
+    if (policy == TeeLagPolicy::WAIT_FOR_LAGGING_BRANCH && anyBranchAtLagLimit()) {
+      // We'll be called again when the lagging branch advances or goes away.
+      return;
+    }
+
+    pulling = true;
+    auto buffer = kj::heapArray<kj::byte>(CHUNK_SIZE);
+    auto ptr = buffer.begin();
+    tasks.add(input->tryRead(ptr, 1, buffer.size())
+        .then([this, buffer = kj::mv(buffer)](size_t amount) mutable {
+      pulling = false;
+      if (amount == 0) {
+        inputDone = true;
+      } else {
+        kj::Array<const kj::byte> bytes;
+        if (amount < buffer.size() / 2) {
+          // Don't hold on to a mostly-empty buffer, since it could be a while before every branch
+          // has consumed it.
+          bytes = kj::heapArray<kj::byte>(buffer.first(amount));
+        } else {
+          bytes = buffer.first(amount).attach(kj::mv(buffer));
+        }
+        chunks.push_back(kj::refcounted<Chunk>(end, kj::mv(bytes)));
+        end += amount;
+
+        if (policy == TeeLagPolicy::ERROR_LAGGING_BRANCH) {
+          failLaggingBranches();
+        }
+      }
+      wakeWaiters();
+    }, [this](kj::Exception&& exception) {
+      pulling = false;
+      inputError = kj::mv(exception);
+      wakeWaiters();
+    }));
+  }
+
+  void wakeWaiters() {
+    for (auto& waiter: waiters) {
+      waiter->fulfill();
+    }
+    waiters.clear();
+  }
+
+  void taskFailed(kj::Exception&& exception) override {
+    // The read's error handler catches everything, so this is unreachable in practice.
+    KJ_LOG(ERROR, "shared tee pull failed", exception);
+  }
+};
+
+class SharedTeeBranch final: public kj::AsyncInputStream {
+public:
+  SharedTeeBranch(kj::Own<SharedTee> tee, const Cursor& from, uint64_t lagLimit)
+      : tee(kj::mv(tee)) {
+    cursor.position = from.position;
+    cursor.lagLimit = lagLimit;
+    cursor.error = from.error.map([](const kj::Exception& e) { return kj::cp(e); });
+    this->tee->addCursor(cursor);
+  }
+  ~SharedTeeBranch() noexcept(false) {
+    tee->removeCursor(cursor);
+  }
+  KJ_DISALLOW_COPY_AND_MOVE(SharedTeeBranch);
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    auto bytes = kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes);
+    size_t total = 0;
+    for (;;) {
+      bool done = false;
+      KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+        total += tee->read(cursor, bytes.slice(total, bytes.size()));
+        done = total >= minBytes || total == bytes.size() || tee->atEnd(cursor);
+      })) {
+        // Don't lose bytes that were already copied into the caller's buffer. The error stays
+        // recorded on the cursor or the tee, so the next read throws it.
+        if (total > 0) co_return total;
+        kj::throwFatalException(kj::mv(exception));
+      }
+      if (done) co_return total;
+      co_await tee->whenMoreData();
+    }
+  }
+
+  kj::Maybe<uint64_t> tryGetLength() override {
+    return tee->length.map([&](uint64_t length) { return length - cursor.position; });
+  }
+
+  kj::Promise<uint64_t> pumpTo(kj::AsyncOutputStream& output, uint64_t amount) override {
+    uint64_t pumped = 0;
+    while (pumped < amount) {
+      auto maybePiece = tee->peek(cursor);
+      KJ_IF_SOME(piece, maybePiece) {
+        // Write directly out of the shared chunk. `piece` keeps it alive until we're done, even if
+        // the other branches move past it in the meantime.
+        auto bytes = piece.bytes.first(kj::min(piece.bytes.size(), amount - pumped));
+        co_await output.write(bytes.begin(), bytes.size());
+        pumped += bytes.size();
+        tee->advance(cursor, bytes.size());
+      } else if (tee->atEnd(cursor)) {
+        break;
+      } else {
+        co_await tee->whenMoreData();
+      }
+    }
+    co_return pumped;
+  }
+
+  kj::Maybe<kj::Own<kj::AsyncInputStream>> tryTee(uint64_t limit) override {
+    // The new branch shares this tee's chunks, starting where this one is now. `limit` bounds the
+    // buffering between this branch and the new one, so both are held to it from now on.
+    cursor.lagLimit = kj::min(cursor.lagLimit, limit);
+    return kj::Own<kj::AsyncInputStream>(
+        kj::heap<SharedTeeBranch>(kj::addRef(*tee), cursor, cursor.lagLimit));
+  }
+
+private:
+  kj::Own<SharedTee> tee;
+  Cursor cursor;
+};
+
+}  // namespace
+
+kj::Tee newSharedTee(kj::Own<kj::AsyncInputStream> input, uint64_t lagLimit,
+                     TeeLagPolicy policy) {
+  // As with kj::newTee(), a stream that knows how to tee itself -- in particular a branch of an
+  // existing tee -- does so, rather than being buffered all over again.
+  KJ_IF_SOME(t, input->tryTee(lagLimit)) {
+    return {{ kj::mv(input), kj::mv(t) }};
+  }
+
+  auto tee = kj::refcounted<SharedTee>(kj::mv(input), policy);
+  Cursor start;
+  return {{
+    kj::heap<SharedTeeBranch>(kj::addRef(*tee), start, lagLimit),
+    kj::heap<SharedTeeBranch>(kj::mv(tee), start, lagLimit),
+  }};
+}
+
+}  // namespace workerd
@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+
+namespace workerd {
+
+// What a tee does when one of its branches falls further behind the furthest-ahead branch than
+// the tee's lag limit allows.
+enum class TeeLagPolicy {
+  // Fail the lagging branch with "tee buffer size limit exceeded" and release the data that was
+  // being held for it. The other branches carry on.
+  ERROR_LAGGING_BRANCH,
+
+  // Stop reading from the input until the lagging branch catches up, so the branches that are
+  // ahead wait for it. Note that a branch which is never read and never dropped then stalls all
+  // of the others forever.
+  WAIT_FOR_LAGGING_BRANCH,
+};
+
+// Like kj::newTee(), but all branches read from a single shared, refcounted copy of the data
+// instead of each branch buffering its own. Data is read from the input in chunks as the
+// furthest-ahead branch needs it, and a chunk is freed as soon as the last branch has moved past
+// it, so memory use is bounded by how far apart the branches are rather than by how much each of
+// them has left to read. pumpTo() writes straight out of the shared chunks without copying.
+//
+// `lagLimit` is the most data that may be held for the slowest branch, give or take one chunk.
+// The branches support tryTee(limit), which adds another branch sharing the same chunks and
+// starting at the same position. The new branch and the one it was tee'd from are then held to
+// the smaller of their lag limit and `limit`.
+//
+// Like kj::newTee(), if `input` can tee itself -- as a branch of another newSharedTee() can -- that
+// is used instead, and the existing tee's `policy` applies.
+kj::Tee newSharedTee(kj::Own<kj::AsyncInputStream> input, uint64_t lagLimit,
+                     TeeLagPolicy policy = TeeLagPolicy::ERROR_LAGGING_BRANCH);
+
+}  // namespace workerd
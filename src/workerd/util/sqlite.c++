@@ -6,6 +6,7 @@
 #include <kj/debug.h>
 #include <kj/refcount.h>
 #include <workerd/util/sentry.h>
+#include <workerd/util/use-perfetto-categories.h>
 
 #if _WIN32
 #include <kj/win32-api-version.h>
@@ -386,6 +387,7 @@ kj::StringPtr SqliteDatabase::getCurrentQueryForDebug() {
 // statement.
 kj::Own<sqlite3_stmt> SqliteDatabase::prepareSql(
     Regulator& regulator, kj::StringPtr sqlCode, uint prepFlags, Multi multi) {
+  TRACE_EVENT("workerd", "SqliteDatabase::prepareSql()");
   KJ_ASSERT(currentRegulator == nullptr, "recursive prepareSql()?");
   KJ_DEFER(currentRegulator = nullptr);
   currentRegulator = regulator;
@@ -908,6 +910,7 @@ void SqliteDatabase::Query::bind(uint i, decltype(nullptr)) {
 }
 
 void SqliteDatabase::Query::nextRow() {
+  TRACE_EVENT("workerd", "SqliteDatabase::Query::nextRow()", "sql", sqlite3_sql(statement));
   KJ_ASSERT(db.currentStatement == nullptr, "recursive nextRow()?");
   KJ_DEFER(db.currentStatement = nullptr);
   db.currentStatement = *statement;
@@ -0,0 +1,97 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+KJ_TEST("ThreadPool runs work off-thread and delivers the result") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadPool pool({ .threadCount = 2 });
+  KJ_EXPECT(pool.getThreadCount() == 2);
+
+  kj::Function<int()> func = []() { return 123; };
+  auto promise = KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(func)));
+  KJ_EXPECT(promise.wait(ws) == 123);
+
+  kj::Function<void()> voidFunc = []() {};
+  KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(voidFunc))).wait(ws);
+}
+
+KJ_TEST("ThreadPool propagates exceptions") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadPool pool({ .threadCount = 1 });
+
+  kj::Function<int()> func = []() -> int { KJ_FAIL_REQUIRE("boom"); };
+  auto promise = KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(func)));
+  KJ_EXPECT_THROW_MESSAGE("boom", promise.wait(ws));
+}
+
+KJ_TEST("ThreadPool refuses work when the queue is full") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadPool pool({ .threadCount = 1, .maxQueueDepth = 1 });
+
+  // Block the only thread until we say so.
+  kj::MutexGuarded<bool> release(false);
+  kj::MutexGuarded<bool> started(false);
+  kj::Function<void()> blocker = [&]() {
+    *started.lockExclusive() = true;
+    release.when([](bool r) { return r; }, [](bool&) {});
+  };
+  auto blockerPromise = KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(blocker)));
+  started.when([](bool s) { return s; }, [](bool&) {});
+
+  // One job fits in the queue.
+  kj::Function<int()> queued = []() { return 1; };
+  auto queuedPromise = KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(queued)));
+  KJ_EXPECT(pool.getQueueDepth() == 1);
+
+  // The next is refused, and the function is left intact so the caller can run it inline.
+  kj::Function<int()> refused = []() { return 2; };
+  KJ_EXPECT(pool.tryRun(kj::mv(refused)) == kj::none);
+  KJ_EXPECT(refused() == 2);
+
+  *release.lockExclusive() = true;
+  blockerPromise.wait(ws);
+  KJ_EXPECT(queuedPromise.wait(ws) == 1);
+}
+
+KJ_TEST("ThreadPool skips jobs whose promise was dropped") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+
+  ThreadPool pool({ .threadCount = 1 });
+
+  kj::MutexGuarded<bool> release(false);
+  kj::MutexGuarded<bool> started(false);
+  kj::Function<void()> blocker = [&]() {
+    *started.lockExclusive() = true;
+    release.when([](bool r) { return r; }, [](bool&) {});
+  };
+  auto blockerPromise = KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(blocker)));
+  started.when([](bool s) { return s; }, [](bool&) {});
+
+  bool ran = false;
+  kj::Function<void()> skipped = [&]() { ran = true; };
+  KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(skipped)));  // promise dropped immediately
+
+  *release.lockExclusive() = true;
+  blockerPromise.wait(ws);
+
+  // Run one more job to make sure the skipped one has been dequeued.
+  kj::Function<void()> after = []() {};
+  KJ_ASSERT_NONNULL(pool.tryRun(kj::mv(after))).wait(ws);
+  KJ_EXPECT(!ran);
+}
+
+}  // namespace
+}  // namespace workerd
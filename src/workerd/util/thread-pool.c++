@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "thread-pool.h"
+#include <kj/debug.h>
+#include <thread>
+
+namespace workerd {
+
+ThreadPool::ThreadPool(Options options)
+    : maxQueueDepth(options.maxQueueDepth) {
+  KJ_REQUIRE(options.threadCount > 0, "thread pool needs at least one thread");
+  threads.reserve(options.threadCount);
+  for (auto i KJ_UNUSED: kj::zeroTo(options.threadCount)) {
+    threads.add(kj::heap<kj::Thread>([this]() { threadMain(); }));
+  }
+}
+
+ThreadPool::~ThreadPool() noexcept(false) {
+  {
+    auto lock = state.lockExclusive();
+    lock->shuttingDown = true;
+    // Dropping the queued jobs destroys their fulfillers, which rejects the promises of anyone
+    // still waiting on them.
+    lock->queue.clear();
+  }
+
+  // Joins all threads. Each one exits after finishing the job it's currently running, if any.
+  threads.clear();
+}
+
+const ThreadPool& ThreadPool::getShared() {
+  // Intentionally leaked: joining the threads at exit could block process shutdown behind some
+  // long-running job, and there's no benefit to tearing the pool down at that point anyway.
+  static const ThreadPool* pool = new ThreadPool({
+    .threadCount = kj::max(std::thread::hardware_concurrency() / 2, 1u),
+    .maxQueueDepth = 256,
+  });
+  return *pool;
+}
+
+uint ThreadPool::getQueueDepth() const {
+  return state.lockShared()->queue.size();
+}
+
+bool ThreadPool::tryEnqueue(kj::FunctionParam<kj::Own<Job>()> makeJob) const {
+  auto lock = state.lockExclusive();
+  if (lock->shuttingDown || lock->queue.size() >= maxQueueDepth) {
+    return false;
+  }
+  lock->queue.push_back(makeJob());
+  return true;
+}
+
+void ThreadPool::threadMain() const {
+  for (;;) {
+    auto job = state.when([](const State& s) { return s.shuttingDown || !s.queue.empty(); },
+        [](State& s) -> kj::Maybe<kj::Own<Job>> {
+      if (s.shuttingDown) return kj::none;
+      auto job = kj::mv(s.queue.front());
+      s.queue.pop_front();
+      return kj::mv(job);
+    });
+
+    KJ_IF_SOME(j, job) {
+      // Run (and destroy) the job outside the lock.
+      j->run();
+    } else {
+      return;
+    }
+  }
+}
+
+}  // namespace workerd
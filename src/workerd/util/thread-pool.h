@@ -0,0 +1,121 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async.h>
+#include <kj/function.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <kj/vector.h>
+#include <deque>
+
+namespace workerd {
+
+using kj::uint;
+
+// A small, bounded pool of native threads for CPU-heavy work that does not touch any JavaScript
+// state, such as large digests or key derivation in SubtleCrypto. Work is submitted from an event
+// loop thread and its result is delivered back to that thread as a kj::Promise.
+//
+// Neither the number of threads nor the queue of pending work ever grows past the configured
+// limits. When the queue is full, tryRun() refuses the work and the caller is expected to run it
+// inline instead, so an overloaded pool degrades to plain synchronous execution rather than
+// queueing without bound.
+//
+// If the returned promise is dropped before the work has started, the work is skipped. Work that
+// has already started runs to completion and its result is discarded.
+class ThreadPool {
+public:
+  struct Options {
+    // Number of worker threads to start.
+    uint threadCount = 2;
+
+    // Maximum number of jobs waiting for a thread. Jobs that are currently running don't count.
+    uint maxQueueDepth = 64;
+  };
+
+  explicit ThreadPool(Options options);
+  ~ThreadPool() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ThreadPool);
+
+  // Returns the process-wide pool that is shared by all isolates. It is created on first use,
+  // sized according to the number of available cores, and never destroyed.
+  static const ThreadPool& getShared();
+
+  // Queues `func` to run on one of the pool's threads, returning a promise for its result. `func`
+  // must not capture anything that is not safe to use and destroy from another thread.
+  //
+  // Returns kj::none if the queue is full. `func` is only moved from if the work was accepted,
+  // so the caller can still invoke it directly in that case.
+  template <typename T>
+  kj::Maybe<kj::Promise<T>> tryRun(kj::Function<T()>&& func) const;
+
+  uint getThreadCount() const { return threads.size(); }
+
+  // Number of jobs currently waiting for a thread.
+  uint getQueueDepth() const;
+
+private:
+  class Job {
+  public:
+    virtual ~Job() noexcept(false) = default;
+    virtual void run() = 0;
+  };
+
+  template <typename T>
+  class JobImpl;
+
+  struct State {
+    std::deque<kj::Own<Job>> queue;
+    bool shuttingDown = false;
+  };
+
+  const uint maxQueueDepth;
+  kj::MutexGuarded<State> state;
+  kj::Vector<kj::Own<kj::Thread>> threads;
+
+  bool tryEnqueue(kj::FunctionParam<kj::Own<Job>()> makeJob) const;
+  void threadMain() const;
+};
+
+template <typename T>
+class ThreadPool::JobImpl final: public Job {
+public:
+  JobImpl(kj::Function<T()> func, kj::Own<kj::CrossThreadPromiseFulfiller<T>> fulfiller)
+      : func(kj::mv(func)), fulfiller(kj::mv(fulfiller)) {}
+
+  void run() override {
+    // Nobody is waiting for the result anymore, so don't bother computing it.
+    if (!fulfiller->isWaiting()) return;
+
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      if constexpr (kj::isSameType<T, void>()) {
+        func();
+        fulfiller->fulfill();
+      } else {
+        fulfiller->fulfill(func());
+      }
+    })) {
+      fulfiller->reject(kj::mv(exception));
+    }
+  }
+
+private:
+  kj::Function<T()> func;
+  kj::Own<kj::CrossThreadPromiseFulfiller<T>> fulfiller;
+};
+
+template <typename T>
+kj::Maybe<kj::Promise<T>> ThreadPool::tryRun(kj::Function<T()>&& func) const {
+  kj::Maybe<kj::Promise<T>> result;
+  tryEnqueue([&]() -> kj::Own<Job> {
+    auto paf = kj::newPromiseAndCrossThreadFulfiller<T>();
+    result = kj::mv(paf.promise);
+    return kj::heap<JobImpl<T>>(kj::mv(func), kj::mv(paf.fulfiller));
+  });
+  return kj::mv(result);
+}
+
+}  // namespace workerd
@@ -0,0 +1,120 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "utf8.h"
+#include <kj/encoding.h>
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd {
+namespace {
+
+kj::ArrayPtr<const kj::byte> bytes(kj::StringPtr str) {
+  return str.asBytes();
+}
+
+// Repeats `unit` until the result is at least `size` bytes long, so that the vectorized paths see
+// sequences straddling block boundaries at every offset.
+kj::Array<kj::byte> repeat(kj::StringPtr unit, size_t size) {
+  kj::Vector<kj::byte> result;
+  while (result.size() < size) result.addAll(unit.asBytes());
+  return result.releaseAsArray();
+}
+
+KJ_TEST("checkUtf8 classifies valid input") {
+  KJ_EXPECT(checkUtf8(nullptr) == Utf8Content::ASCII);
+  KJ_EXPECT(checkUtf8(bytes("hello")) == Utf8Content::ASCII);
+  KJ_EXPECT(checkUtf8(bytes("caf\xc3\xa9")) == Utf8Content::LATIN1);
+  KJ_EXPECT(checkUtf8(bytes("\xc2\x80\xc3\xbf")) == Utf8Content::LATIN1);
+  KJ_EXPECT(checkUtf8(bytes("\xc4\x80")) == Utf8Content::WIDE);
+  KJ_EXPECT(checkUtf8(bytes("\xe4\xb8\xad\xe6\x96\x87")) == Utf8Content::WIDE);
+  KJ_EXPECT(checkUtf8(bytes("\xf0\x9f\x98\x80")) == Utf8Content::WIDE);
+  KJ_EXPECT(checkUtf8(bytes("\xf4\x8f\xbf\xbf")) == Utf8Content::WIDE);
+
+  for (size_t offset = 0; offset < 40; offset++) {
+    auto prefix = kj::str(kj::repeat('a', offset));
+    KJ_EXPECT(checkUtf8(repeat(kj::str(prefix, "\xc3\xa9"), 200)) == Utf8Content::LATIN1,
+              offset);
+    KJ_EXPECT(checkUtf8(repeat(kj::str(prefix, "\xe4\xb8\xad"), 200)) == Utf8Content::WIDE,
+              offset);
+    KJ_EXPECT(checkUtf8(repeat(kj::str(prefix, "\xf0\x9f\x98\x80"), 200)) == Utf8Content::WIDE,
+              offset);
+  }
+}
+
+KJ_TEST("checkUtf8 rejects invalid input") {
+  kj::StringPtr cases[] = {
+    "\x80",              // lone continuation
+    "\xc3",              // truncated at the end
+    "\xc3" "a",          // truncated in the middle
+    "\xc0\x80",          // overlong two-byte
+    "\xc1\xbf",
+    "\xe0\x80\x80",      // overlong three-byte
+    "\xe0\x9f\xbf",
+    "\xed\xa0\x80",      // surrogate
+    "\xed\xbf\xbf",
+    "\xf0\x80\x80\x80",  // overlong four-byte
+    "\xf0\x8f\xbf\xbf",
+    "\xf4\x90\x80\x80",  // above U+10FFFF
+    "\xf5\x80\x80\x80",
+    "\xff",
+    "\xe4\xb8",          // truncated three-byte
+    "\xf0\x9f\x98",      // truncated four-byte
+    "\xc3\xa9\xa9",      // extra continuation
+  };
+  for (auto c: cases) {
+    KJ_EXPECT(checkUtf8(bytes(c)) == Utf8Content::INVALID, kj::encodeHex(bytes(c)));
+
+    // Also in the middle of a long run of valid text, at every offset within a block.
+    for (size_t offset = 0; offset < 40; offset++) {
+      auto input = kj::str(kj::repeat('a', offset), c, kj::repeat('b', 40));
+      KJ_EXPECT(checkUtf8(input.asBytes()) == Utf8Content::INVALID, kj::encodeHex(bytes(c)),
+                offset);
+    }
+  }
+
+  // Truncated at the very end of a long input.
+  for (size_t offset = 0; offset < 40; offset++) {
+    auto input = kj::str(kj::repeat('a', offset), "\xf0\x9f\x98");
+    KJ_EXPECT(checkUtf8(input.asBytes()) == Utf8Content::INVALID, offset);
+  }
+}
+
+KJ_TEST("asciiPrefixLength") {
+  KJ_EXPECT(asciiPrefixLength(nullptr) == 0);
+  for (size_t offset = 0; offset < 70; offset++) {
+    auto input = kj::str(kj::repeat('a', offset), "\xc3\xa9", kj::repeat('b', 20));
+    KJ_EXPECT(asciiPrefixLength(input.asBytes()) == offset);
+    KJ_EXPECT(asciiPrefixLength(input.asBytes().first(offset)) == offset);
+  }
+}
+
+KJ_TEST("decodeUtf8Sequence") {
+  auto check = [](kj::StringPtr input, Utf8Sequence::Kind kind, uint length,
+                  uint32_t codePoint = 0) {
+    auto seq = decodeUtf8Sequence(input.asBytes());
+    KJ_EXPECT(seq.kind == kind, input);
+    KJ_EXPECT(seq.length == length, input);
+    if (kind == Utf8Sequence::VALID) KJ_EXPECT(seq.codePoint == codePoint, input);
+  };
+
+  check("a", Utf8Sequence::VALID, 1, 'a');
+  check("\xc3\xa9z", Utf8Sequence::VALID, 2, 0xe9);
+  check("\xe4\xb8\xad", Utf8Sequence::VALID, 3, 0x4e2d);
+  check("\xf0\x9f\x98\x80", Utf8Sequence::VALID, 4, 0x1f600);
+
+  check("\xc3", Utf8Sequence::TRUNCATED, 1);
+  check("\xf0\x9f\x98", Utf8Sequence::TRUNCATED, 3);
+
+  // Only the maximal subpart of an invalid sequence is consumed.
+  check("\x80", Utf8Sequence::INVALID, 1);
+  check("\xc0\x80", Utf8Sequence::INVALID, 1);
+  check("\xe0\x80\x80", Utf8Sequence::INVALID, 1);
+  check("\xed\xa0\x80", Utf8Sequence::INVALID, 1);
+  check("\xe4\xb8z", Utf8Sequence::INVALID, 2);
+  check("\xf0\x9f\x98z", Utf8Sequence::INVALID, 3);
+}
+
+}  // namespace
+}  // namespace workerd
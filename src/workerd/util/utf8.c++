@@ -0,0 +1,373 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "utf8.h"
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(_WIN32)
+// As in base64.c++, vector paths are compiled with function-level target attributes and chosen
+// at runtime.
+#define WORKERD_UTF8_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define WORKERD_UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace workerd {
+
+namespace {
+
+// The largest byte that can appear in UTF-8 whose code points are all below U+0100: C3 is the
+// lead byte of U+00C0 through U+00FF.
+constexpr kj::byte MAX_LATIN1_BYTE = 0xc3;
+
+Utf8Content classify(kj::byte maxByte) {
+  if (maxByte < 0x80) return Utf8Content::ASCII;
+  if (maxByte <= MAX_LATIN1_BYTE) return Utf8Content::LATIN1;
+  return Utf8Content::WIDE;
+}
+
+Utf8Content checkUtf8Scalar(kj::ArrayPtr<const kj::byte> input) {
+  kj::byte maxByte = 0;
+  size_t i = 0;
+  while (i < input.size()) {
+    i += asciiPrefixLength(input.slice(i, input.size()));
+    if (i == input.size()) break;
+    auto seq = decodeUtf8Sequence(input.slice(i, input.size()));
+    if (seq.kind != Utf8Sequence::VALID) return Utf8Content::INVALID;
+    maxByte = kj::max(maxByte, input[i]);
+    i += seq.length;
+  }
+  return classify(maxByte);
+}
+
+size_t asciiPrefixLengthScalar(const kj::byte* in, size_t size) {
+  size_t i = 0;
+  for (; size - i >= 8; i += 8) {
+    uint64_t word;
+    memcpy(&word, in + i, sizeof(word));
+    if (word & 0x8080808080808080ull) break;
+  }
+  while (i < size && in[i] < 0x80) i++;
+  return i;
+}
+
+// =======================================================================================
+// Vectorized validation
+//
+// This is the "lookup" algorithm from John Keiser and Daniel Lemire's "Validating UTF-8 In Less
+// Than One Instruction Per Byte", as used by simdjson. Every error involving a pair of adjacent
+// bytes is found with three 16-entry table lookups -- on the high and low nibbles of the first
+// byte and the high nibble of the second -- whose results are ANDed together; each bit of the
+// result stands for one kind of error. Continuation bytes that belong to a three- or four-byte
+// sequence are then checked against the lead byte two or three positions back. Each block is
+// checked along with the tail of the block before it, so sequences can straddle blocks.
+
+constexpr kj::byte TOO_SHORT = 1 << 0;     // 11______ 0_______ or 11______ 11______
+constexpr kj::byte TOO_LONG = 1 << 1;      // 0_______ 10______
+constexpr kj::byte OVERLONG_3 = 1 << 2;    // 11100000 100_____
+constexpr kj::byte TOO_LARGE = 1 << 3;     // 11110100 1001____, 11110100 101_____, 11110101+
+constexpr kj::byte SURROGATE = 1 << 4;     // 11101101 101_____
+constexpr kj::byte OVERLONG_2 = 1 << 5;    // 1100000_ 10______
+constexpr kj::byte TOO_LARGE_1000 = 1 << 6;  // 11110101+ 1000____
+constexpr kj::byte OVERLONG_4 = 1 << 6;    // 11110000 1000____
+constexpr kj::byte TWO_CONTS = 1 << 7;     // 10______ 10______
+// Errors decided by the high nibble of the first byte alone.
+constexpr kj::byte CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+constexpr kj::byte BYTE_1_HIGH[16] = {
+  // 0_______: ASCII
+  TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+  // 10______: continuation
+  TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+  // 1100____, 1101____: two-byte lead
+  TOO_SHORT | OVERLONG_2,
+  TOO_SHORT,
+  // 1110____: three-byte lead
+  TOO_SHORT | OVERLONG_3 | SURROGATE,
+  // 1111____: four-byte lead
+  TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+constexpr kj::byte BYTE_1_LOW[16] = {
+  CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,  // ____0000
+  CARRY | OVERLONG_2,                            // ____0001
+  CARRY,                                         // ____0010
+  CARRY,                                         // ____0011
+  CARRY | TOO_LARGE,                             // ____0100
+  CARRY | TOO_LARGE | TOO_LARGE_1000,            // ____0101
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,  // ____1101
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+  CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+constexpr kj::byte BYTE_2_HIGH[16] = {
+  // ________ 0_______: ASCII
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+  // ________ 1000____
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+  // ________ 1001____
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+  // ________ 101_____
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+  // ________ 11______
+  TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// A block ends in the middle of a sequence if any of its last three bytes is a lead byte needing
+// more continuation bytes than are left in the block.
+constexpr kj::byte INCOMPLETE_MAX[16] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+
+#if WORKERD_UTF8_X86
+
+#define WORKERD_TARGET_SSSE3 __attribute__((target("ssse3")))
+
+bool haveSsse3() {
+  static const bool result = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3") != 0;
+  }();
+  return result;
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i load(const kj::byte* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i set1(int c) { return _mm_set1_epi8(static_cast<char>(c)); }
+
+// _mm_testz_si128() would need SSE4.1.
+WORKERD_TARGET_SSSE3 inline bool isZero(__m128i v) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i lookup(const kj::byte (&table)[16], __m128i nibbles) {
+  return _mm_shuffle_epi8(load(table), nibbles);
+}
+
+WORKERD_TARGET_SSSE3 inline __m128i highNibbles(__m128i v) {
+  return _mm_and_si128(_mm_srli_epi16(v, 4), set1(0x0f));
+}
+
+class Ssse3Validator {
+public:
+  WORKERD_TARGET_SSSE3 void check(__m128i input) {
+    maxBytes = _mm_max_epu8(maxBytes, input);
+    if (_mm_movemask_epi8(input) == 0) {
+      // All ASCII, so the only possible error is a sequence left open by the previous block.
+      error = _mm_or_si128(error, prevIncomplete);
+      prevIncomplete = _mm_setzero_si128();
+    } else {
+      auto prev1 = _mm_alignr_epi8(input, prevInput, 15);
+      auto specialCases = _mm_and_si128(
+          _mm_and_si128(lookup(BYTE_1_HIGH, highNibbles(prev1)),
+                        lookup(BYTE_1_LOW, _mm_and_si128(prev1, set1(0x0f)))),
+          lookup(BYTE_2_HIGH, highNibbles(input)));
+
+      auto prev2 = _mm_alignr_epi8(input, prevInput, 14);
+      auto prev3 = _mm_alignr_epi8(input, prevInput, 13);
+      // The top bit is set where prev2 is a three- or four-byte lead, or prev3 is a four-byte
+      // lead, and so this byte must be a continuation. specialCases has TWO_CONTS set for exactly
+      // the continuation bytes that follow another continuation byte, so these must agree.
+      auto must23 = _mm_or_si128(_mm_subs_epu8(prev2, set1(0xe0 - 0x80)),
+                                 _mm_subs_epu8(prev3, set1(0xf0 - 0x80)));
+      auto must23Mismatch = _mm_xor_si128(_mm_and_si128(must23, set1(0x80)), specialCases);
+      error = _mm_or_si128(error, must23Mismatch);
+
+      prevIncomplete = _mm_subs_epu8(input, load(INCOMPLETE_MAX));
+    }
+    prevInput = input;
+  }
+
+  WORKERD_TARGET_SSSE3 Utf8Content finish() {
+    error = _mm_or_si128(error, prevIncomplete);
+    if (!isZero(error)) return Utf8Content::INVALID;
+
+    // Horizontal max of the bytes seen.
+    auto m = _mm_max_epu8(maxBytes, _mm_srli_si128(maxBytes, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    return classify(_mm_cvtsi128_si32(m) & 0xff);
+  }
+
+private:
+  __m128i error = _mm_setzero_si128();
+  __m128i prevInput = _mm_setzero_si128();
+  __m128i prevIncomplete = _mm_setzero_si128();
+  __m128i maxBytes = _mm_setzero_si128();
+};
+
+WORKERD_TARGET_SSSE3 Utf8Content checkUtf8Ssse3(const kj::byte* in, size_t size) {
+  Ssse3Validator validator;
+  size_t i = 0;
+  for (; size - i >= 16; i += 16) {
+    validator.check(load(in + i));
+  }
+  if (i < size) {
+    // Zero padding is ASCII, so it can't hide an error: a sequence cut short by it is reported as
+    // TOO_SHORT just as it would be at the end of the input.
+    kj::byte last[16] = {};
+    memcpy(last, in + i, size - i);
+    validator.check(load(last));
+  }
+  return validator.finish();
+}
+
+WORKERD_TARGET_SSSE3 size_t asciiPrefixLengthSsse3(const kj::byte* in, size_t size) {
+  size_t i = 0;
+  for (; size - i >= 16; i += 16) {
+    int mask = _mm_movemask_epi8(load(in + i));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return i + asciiPrefixLengthScalar(in + i, size - i);
+}
+
+Utf8Content checkUtf8Simd(kj::ArrayPtr<const kj::byte> input) {
+  if (haveSsse3()) return checkUtf8Ssse3(input.begin(), input.size());
+  return checkUtf8Scalar(input);
+}
+
+size_t asciiPrefixLengthSimd(const kj::byte* in, size_t size) {
+  if (haveSsse3()) return asciiPrefixLengthSsse3(in, size);
+  return asciiPrefixLengthScalar(in, size);
+}
+
+#elif WORKERD_UTF8_NEON
+
+class NeonValidator {
+public:
+  void check(uint8x16_t input) {
+    maxBytes = vmaxq_u8(maxBytes, input);
+    if (vmaxvq_u8(input) < 0x80) {
+      error = vorrq_u8(error, prevIncomplete);
+      prevIncomplete = vdupq_n_u8(0);
+    } else {
+      auto prev1 = vextq_u8(prevInput, input, 15);
+      auto specialCases = vandq_u8(
+          vandq_u8(vqtbl1q_u8(vld1q_u8(BYTE_1_HIGH), vshrq_n_u8(prev1, 4)),
+                   vqtbl1q_u8(vld1q_u8(BYTE_1_LOW), vandq_u8(prev1, vdupq_n_u8(0x0f)))),
+          vqtbl1q_u8(vld1q_u8(BYTE_2_HIGH), vshrq_n_u8(input, 4)));
+
+      auto prev2 = vextq_u8(prevInput, input, 14);
+      auto prev3 = vextq_u8(prevInput, input, 13);
+      auto must23 = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80)),
+                             vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80)));
+      auto must23Mismatch = veorq_u8(vandq_u8(must23, vdupq_n_u8(0x80)), specialCases);
+      error = vorrq_u8(error, must23Mismatch);
+
+      prevIncomplete = vqsubq_u8(input, vld1q_u8(INCOMPLETE_MAX));
+    }
+    prevInput = input;
+  }
+
+  Utf8Content finish() {
+    error = vorrq_u8(error, prevIncomplete);
+    if (vmaxvq_u8(error) != 0) return Utf8Content::INVALID;
+    return classify(vmaxvq_u8(maxBytes));
+  }
+
+private:
+  uint8x16_t error = vdupq_n_u8(0);
+  uint8x16_t prevInput = vdupq_n_u8(0);
+  uint8x16_t prevIncomplete = vdupq_n_u8(0);
+  uint8x16_t maxBytes = vdupq_n_u8(0);
+};
+
+Utf8Content checkUtf8Simd(kj::ArrayPtr<const kj::byte> input) {
+  auto in = input.begin();
+  auto size = input.size();
+  NeonValidator validator;
+  size_t i = 0;
+  for (; size - i >= 16; i += 16) {
+    validator.check(vld1q_u8(in + i));
+  }
+  if (i < size) {
+    kj::byte last[16] = {};
+    memcpy(last, in + i, size - i);
+    validator.check(vld1q_u8(last));
+  }
+  return validator.finish();
+}
+
+size_t asciiPrefixLengthSimd(const kj::byte* in, size_t size) {
+  size_t i = 0;
+  for (; size - i >= 16; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(in + i)) >= 0x80) break;
+  }
+  return i + asciiPrefixLengthScalar(in + i, size - i);
+}
+
+#else
+
+Utf8Content checkUtf8Simd(kj::ArrayPtr<const kj::byte> input) {
+  return checkUtf8Scalar(input);
+}
+
+size_t asciiPrefixLengthSimd(const kj::byte* in, size_t size) {
+  return asciiPrefixLengthScalar(in, size);
+}
+
+#endif
+
+}  // namespace
+
+Utf8Content checkUtf8(kj::ArrayPtr<const kj::byte> input) {
+  return checkUtf8Simd(input);
+}
+
+size_t asciiPrefixLength(kj::ArrayPtr<const kj::byte> input) {
+  return asciiPrefixLengthSimd(input.begin(), input.size());
+}
+
+Utf8Sequence decodeUtf8Sequence(kj::ArrayPtr<const kj::byte> input) {
+  // This is the UTF-8 decoder algorithm from the Encoding Standard, applied to one sequence.
+  kj::byte lead = input[0];
+  if (lead < 0x80) return { Utf8Sequence::VALID, 1, lead };
+
+  uint needed;
+  uint32_t codePoint;
+  kj::byte lower = 0x80;
+  kj::byte upper = 0xbf;
+  if (0xc2 <= lead && lead <= 0xdf) {
+    needed = 1;
+    codePoint = lead & 0x1f;
+  } else if (0xe0 <= lead && lead <= 0xef) {
+    if (lead == 0xe0) lower = 0xa0;
+    if (lead == 0xed) upper = 0x9f;
+    needed = 2;
+    codePoint = lead & 0x0f;
+  } else if (0xf0 <= lead && lead <= 0xf4) {
+    if (lead == 0xf0) lower = 0x90;
+    if (lead == 0xf4) upper = 0x8f;
+    needed = 3;
+    codePoint = lead & 0x07;
+  } else {
+    return { Utf8Sequence::INVALID, 1, 0 };
+  }
+
+  for (uint i = 1; i <= needed; i++) {
+    if (i == input.size()) return { Utf8Sequence::TRUNCATED, i, 0 };
+    kj::byte c = input[i];
+    if (c < lower || c > upper) return { Utf8Sequence::INVALID, i, 0 };
+    lower = 0x80;
+    upper = 0xbf;
+    codePoint = (codePoint << 6) | (c & 0x3f);
+  }
+  return { Utf8Sequence::VALID, needed + 1, codePoint };
+}
+
+}  // namespace workerd
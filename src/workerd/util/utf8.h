@@ -0,0 +1,48 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/array.h>
+
+namespace workerd {
+
+// UTF-8 validation and decoding helpers for TextDecoder and friends. Validation follows the
+// WHATWG Encoding Standard's UTF-8 decoder exactly: overlong forms, surrogates, code points above
+// U+10FFFF and truncated sequences are all errors. The bulk checks run 16 bytes at a time using
+// SSSE3 (chosen at runtime) on x86 or NEON on ARM64, with a scalar fallback elsewhere.
+
+enum class Utf8Content {
+  ASCII,    // Every byte is below 0x80.
+  LATIN1,   // Valid, and every code point is below U+0100 (so fits in a one-byte string).
+  WIDE,     // Valid, with at least one code point at or above U+0100.
+  INVALID,  // Not valid UTF-8, including if the input ends in the middle of a sequence.
+};
+
+// Validates `input` and reports the narrowest kind of string that can hold its contents.
+Utf8Content checkUtf8(kj::ArrayPtr<const kj::byte> input);
+
+// Returns the number of leading bytes of `input` that are ASCII.
+size_t asciiPrefixLength(kj::ArrayPtr<const kj::byte> input);
+
+struct Utf8Sequence {
+  enum Kind {
+    VALID,
+    // The sequence is invalid. `length` bytes make up its maximal subpart, which is replaced by a
+    // single U+FFFD; decoding resumes at the byte after them.
+    INVALID,
+    // The input ended in the middle of an otherwise valid sequence, which is `length` bytes long
+    // so far.
+    TRUNCATED,
+  };
+
+  Kind kind;
+  uint length;
+  uint32_t codePoint;  // Only meaningful if `kind` is VALID.
+};
+
+// Decodes the sequence at the start of `input`, which must not be empty.
+Utf8Sequence decodeUtf8Sequence(kj::ArrayPtr<const kj::byte> input);
+
+}  // namespace workerd